@@ -0,0 +1,522 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#include "fuzzuf/algorithms/afl/afl_bitmap.hpp"
+
+#include <algorithm>
+#include <type_traits>
+#include "fuzzuf/algorithms/afl/afl_util.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FUZZUF_AFL_BITMAP_X86
+#include <immintrin.h>
+#endif
+
+namespace fuzzuf::algorithm::afl::util {
+
+namespace {
+
+constexpr CountClasses count_class = InitCountClasses();
+
+/* Returns 2 if cur hits a tuple which is pristine in vir, 1 if it only
+   changes the hit-count of a known tuple, and 0 otherwise. */
+
+inline u8 CheckNewBitsInWord(u64 cur, u64 vir) {
+    if (likely(!(cur & vir))) return 0;
+
+    const u8* cur8 = (const u8*)&cur;
+    const u8* vir8 = (const u8*)&vir;
+    for (u32 j=0; j < sizeof(u64); j++) {
+        if (cur8[j] && vir8[j] == 0xff) return 2;
+    }
+    return 1;
+}
+
+template<class MapSize>
+u8 ClassifyCountsAndCheckNewBitsScalar(
+    u8 *trace_bits,
+    const u8 *virgin_map,
+    MapSize map_size,
+    utils::DirtyRegions *dirty,
+    u32 from = 0
+) {
+    u8 ret = 0;
+
+    u32 i = from;
+    for (; i + sizeof(u64) <= map_size; i += sizeof(u64)) {
+        u64* mem = (u64*)(trace_bits + i);
+
+        /* Optimize for sparse bitmaps. */
+
+        if (likely(!*mem)) continue;
+        if (dirty) dirty->MarkOffset(i);
+
+        u16* mem16 = (u16*)mem;
+        for (u32 j=0; j*sizeof(u16) < sizeof(u64); j++) {
+            mem16[j] = count_class.lookup16[mem16[j]];
+        }
+
+        if (likely(ret < 2)) {
+            ret = std::max(ret, CheckNewBitsInWord(*mem, *(const u64*)(virgin_map + i)));
+        }
+    }
+
+    for (; i < map_size; i++) {
+        if (likely(!trace_bits[i])) continue;
+        if (dirty) dirty->MarkOffset(i);
+
+        trace_bits[i] = count_class.lookup8[trace_bits[i]];
+        if (trace_bits[i] & virgin_map[i]) {
+            ret = std::max<u8>(ret, virgin_map[i] == 0xff ? 2 : 1);
+        }
+    }
+
+    return ret;
+}
+
+/* Clear the bits of trace_bits in virgin_map, which other threads may be
+   clearing at the same time, and return what HasNewBits would return for the
+   bits this thread has cleared. Each word is cleared with an atomic fetch-and,
+   so a bit is reported as new by exactly one of the threads. len must be a
+   multiple of the word size. */
+
+inline u8 ClaimNewBits(
+    const u8 *trace_bits,
+    u8 *virgin_map,
+    u32 len
+) {
+    u8 ret = 0;
+
+    for (u32 j = 0; j < len; j += sizeof(u64)) {
+        u64 cur = *(const u64*)(trace_bits + j);
+        if (!cur) continue;
+
+        u64 old = __atomic_fetch_and((u64*)(virgin_map + j), ~cur, __ATOMIC_RELAXED);
+        ret = std::max(ret, CheckNewBitsInWord(cur, old));
+    }
+
+    return ret;
+}
+
+/* If Atomic is true, virgin_map may be updated by several threads at the same
+   time. Blocks are still skipped with plain loads of virgin_map: virgin bits
+   are only ever cleared, so a stale block can only show more of them, and a
+   block skipped as known is really known. The blocks left are claimed with
+   ClaimNewBits. */
+
+template<bool Atomic, class MapSize>
+u8 HasNewBitsScalar(
+    const u8 *trace_bits,
+    u8 *virgin_map,
+    MapSize map_size
+) {
+    u8 ret = 0;
+
+    u32 i = 0;
+    for (; i + sizeof(u64) <= map_size; i += sizeof(u64)) {
+        const u64* current = (const u64*)(trace_bits + i);
+        u64* virgin = (u64*)(virgin_map + i);
+
+        /* Optimize for (*current & *virgin) == 0 - i.e., no bits in current bitmap
+           that have not been already cleared from the virgin map - since this will
+           almost always be the case. */
+
+        if (likely(!*current) || likely(!(*current & *virgin))) continue;
+
+        if constexpr (Atomic) {
+            ret = std::max(ret, ClaimNewBits(trace_bits + i, virgin_map + i, sizeof(u64)));
+            continue;
+        }
+
+        if (likely(ret < 2)) {
+            ret = std::max(ret, CheckNewBitsInWord(*current, *virgin));
+        }
+
+        *virgin &= ~*current;
+    }
+
+    for (; i < map_size; i++) {
+        if (likely(!(trace_bits[i] & virgin_map[i]))) continue;
+
+        u8 old = virgin_map[i];
+        if constexpr (Atomic) {
+            old = __atomic_fetch_and(&virgin_map[i], (u8)~trace_bits[i], __ATOMIC_RELAXED);
+            if (!(trace_bits[i] & old)) continue;
+        } else {
+            virgin_map[i] &= ~trace_bits[i];
+        }
+
+        ret = std::max<u8>(ret, old == 0xff ? 2 : 1);
+    }
+
+    return ret;
+}
+
+#ifdef FUZZUF_AFL_BITMAP_X86
+
+/* The count classes depend only on the position of the highest set bit, so
+   they can be looked up per nibble: the low nibble decides the class of
+   counts below 16, and the high nibble decides it otherwise. */
+
+#define COUNT_CLASS_LO \
+    0, 1, 2, 4, 8, 8, 8, 8, 16, 16, 16, 16, 16, 16, 16, 16
+#define COUNT_CLASS_HI \
+    0, 32, 64, 64, 64, 64, 64, 64, 128, 128, 128, 128, 128, 128, 128, 128
+
+// The tables are repeated for each 128-bit lane, as vpshufb looks up within a lane
+alignas(64) constexpr u8 count_class_lo[64] = {
+    COUNT_CLASS_LO, COUNT_CLASS_LO, COUNT_CLASS_LO, COUNT_CLASS_LO
+};
+alignas(64) constexpr u8 count_class_hi[64] = {
+    COUNT_CLASS_HI, COUNT_CLASS_HI, COUNT_CLASS_HI, COUNT_CLASS_HI
+};
+
+#undef COUNT_CLASS_LO
+#undef COUNT_CLASS_HI
+
+template<class MapSize>
+__attribute__((target("avx2")))
+u8 ClassifyCountsAndCheckNewBitsAVX2(
+    u8 *trace_bits,
+    const u8 *virgin_map,
+    MapSize map_size,
+    utils::DirtyRegions *dirty
+) {
+    const __m256i lut_lo = _mm256_load_si256((const __m256i*)count_class_lo);
+    const __m256i lut_hi = _mm256_load_si256((const __m256i*)count_class_hi);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi8(-1);
+
+    u8 ret = 0;
+
+    u32 i = 0;
+    for (; i + sizeof(__m256i) <= map_size; i += sizeof(__m256i)) {
+        __m256i cur = _mm256_loadu_si256((const __m256i*)(trace_bits + i));
+        if (likely(_mm256_testz_si256(cur, cur))) continue;
+        if (dirty) dirty->MarkOffset(i);
+
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(cur, 4), nibble);
+        __m256i lo = _mm256_and_si256(cur, nibble);
+        cur = _mm256_blendv_epi8(
+                  _mm256_shuffle_epi8(lut_hi, hi),
+                  _mm256_shuffle_epi8(lut_lo, lo),
+                  _mm256_cmpeq_epi8(hi, zero)
+              );
+        _mm256_storeu_si256((__m256i*)(trace_bits + i), cur);
+
+        if (ret == 2) continue;
+
+        __m256i vir = _mm256_loadu_si256((const __m256i*)(virgin_map + i));
+        if (likely(_mm256_testz_si256(cur, vir))) continue;
+
+        __m256i pristine = _mm256_andnot_si256(
+                               _mm256_cmpeq_epi8(cur, zero),
+                               _mm256_cmpeq_epi8(vir, ones)
+                           );
+        ret = _mm256_movemask_epi8(pristine) ? 2 : 1;
+    }
+
+    return std::max(
+        ret,
+        ClassifyCountsAndCheckNewBitsScalar(trace_bits, virgin_map, map_size, dirty, i)
+    );
+}
+
+template<class MapSize>
+__attribute__((target("avx512f,avx512bw")))
+u8 ClassifyCountsAndCheckNewBitsAVX512(
+    u8 *trace_bits,
+    const u8 *virgin_map,
+    MapSize map_size,
+    utils::DirtyRegions *dirty
+) {
+    const __m512i lut_lo = _mm512_load_si512(count_class_lo);
+    const __m512i lut_hi = _mm512_load_si512(count_class_hi);
+    const __m512i nibble = _mm512_set1_epi8(0x0f);
+    const __m512i ones = _mm512_set1_epi8(-1);
+
+    u8 ret = 0;
+
+    u32 i = 0;
+    for (; i + sizeof(__m512i) <= map_size; i += sizeof(__m512i)) {
+        __m512i cur = _mm512_loadu_si512(trace_bits + i);
+        __mmask64 hit = _mm512_test_epi8_mask(cur, cur);
+        if (likely(!hit)) continue;
+        if (dirty) dirty->MarkOffset(i);
+
+        __m512i hi = _mm512_and_si512(_mm512_srli_epi16(cur, 4), nibble);
+        __m512i lo = _mm512_and_si512(cur, nibble);
+        cur = _mm512_mask_blend_epi8(
+                  _mm512_test_epi8_mask(hi, hi),
+                  _mm512_shuffle_epi8(lut_lo, lo),
+                  _mm512_shuffle_epi8(lut_hi, hi)
+              );
+        _mm512_storeu_si512(trace_bits + i, cur);
+
+        if (ret == 2) continue;
+
+        __m512i vir = _mm512_loadu_si512(virgin_map + i);
+        if (likely(!_mm512_test_epi8_mask(cur, vir))) continue;
+
+        ret = _mm512_mask_cmpeq_epi8_mask(hit, vir, ones) ? 2 : 1;
+    }
+
+    return std::max(
+        ret,
+        ClassifyCountsAndCheckNewBitsScalar(trace_bits, virgin_map, map_size, dirty, i)
+    );
+}
+
+template<bool Atomic, class MapSize>
+__attribute__((target("avx2")))
+u8 HasNewBitsAVX2(
+    const u8 *trace_bits,
+    u8 *virgin_map,
+    MapSize map_size
+) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi8(-1);
+
+    u8 ret = 0;
+
+    u32 i = 0;
+    for (; i + sizeof(__m256i) <= map_size; i += sizeof(__m256i)) {
+        __m256i cur = _mm256_loadu_si256((const __m256i*)(trace_bits + i));
+        if (likely(_mm256_testz_si256(cur, cur))) continue;
+
+        __m256i vir = _mm256_loadu_si256((const __m256i*)(virgin_map + i));
+        if (likely(_mm256_testz_si256(cur, vir))) continue;
+
+        if constexpr (Atomic) {
+            ret = std::max(ret, ClaimNewBits(trace_bits + i, virgin_map + i, sizeof(__m256i)));
+            continue;
+        }
+
+        if (likely(ret < 2)) {
+            __m256i pristine = _mm256_andnot_si256(
+                                   _mm256_cmpeq_epi8(cur, zero),
+                                   _mm256_cmpeq_epi8(vir, ones)
+                               );
+            ret = _mm256_movemask_epi8(pristine) ? 2 : 1;
+        }
+
+        _mm256_storeu_si256((__m256i*)(virgin_map + i), _mm256_andnot_si256(cur, vir));
+    }
+
+    return std::max(
+        ret,
+        HasNewBitsScalar<Atomic>(trace_bits + i, virgin_map + i, map_size - i)
+    );
+}
+
+template<bool Atomic, class MapSize>
+__attribute__((target("avx512f,avx512bw")))
+u8 HasNewBitsAVX512(
+    const u8 *trace_bits,
+    u8 *virgin_map,
+    MapSize map_size
+) {
+    const __m512i ones = _mm512_set1_epi8(-1);
+
+    u8 ret = 0;
+
+    u32 i = 0;
+    for (; i + sizeof(__m512i) <= map_size; i += sizeof(__m512i)) {
+        __m512i cur = _mm512_loadu_si512(trace_bits + i);
+        __mmask64 hit = _mm512_test_epi8_mask(cur, cur);
+        if (likely(!hit)) continue;
+
+        __m512i vir = _mm512_loadu_si512(virgin_map + i);
+        if (likely(!_mm512_test_epi8_mask(cur, vir))) continue;
+
+        if constexpr (Atomic) {
+            ret = std::max(ret, ClaimNewBits(trace_bits + i, virgin_map + i, sizeof(__m512i)));
+            continue;
+        }
+
+        if (likely(ret < 2)) {
+            ret = _mm512_mask_cmpeq_epi8_mask(hit, vir, ones) ? 2 : 1;
+        }
+
+        // vir & ~cur, written without vpandnq which trips -Wmaybe-uninitialized on GCC 12
+        _mm512_storeu_si512(virgin_map + i, _mm512_xor_si512(vir, _mm512_and_si512(cur, vir)));
+    }
+
+    return std::max(
+        ret,
+        HasNewBitsScalar<Atomic>(trace_bits + i, virgin_map + i, map_size - i)
+    );
+}
+
+#endif // FUZZUF_AFL_BITMAP_X86
+
+/* The kernels are instantiated with the usual map sizes as compile-time
+   constants, so that their loops have fixed trip counts and no tail. The
+   other sizes, e.g. a size negotiated with PUT which is not listed here, are
+   given at runtime. kernel is called with the size as either of them. */
+
+template<class Kernel>
+inline u8 WithMapSize(u32 map_size, Kernel kernel) {
+    switch (map_size) {
+    case 1u << 16: return kernel(std::integral_constant<u32, 1u << 16>());
+    case 1u << 17: return kernel(std::integral_constant<u32, 1u << 17>());
+    case 1u << 18: return kernel(std::integral_constant<u32, 1u << 18>());
+    case 1u << 19: return kernel(std::integral_constant<u32, 1u << 19>());
+    case 1u << 20: return kernel(std::integral_constant<u32, 1u << 20>());
+    default:       return kernel(map_size);
+    }
+}
+
+} // namespace
+
+bool IsBitmapKernelSupported(BitmapKernel kernel) {
+    switch (kernel) {
+    case BitmapKernel::Scalar:
+        return true;
+#ifdef FUZZUF_AFL_BITMAP_X86
+    case BitmapKernel::AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    case BitmapKernel::AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512f")
+            && __builtin_cpu_supports("avx512bw");
+#endif
+    default:
+        return false;
+    }
+}
+
+BitmapKernel GetBitmapKernel(void) {
+    static const BitmapKernel kernel = [] {
+        if (IsBitmapKernelSupported(BitmapKernel::AVX512)) return BitmapKernel::AVX512;
+        if (IsBitmapKernelSupported(BitmapKernel::AVX2)) return BitmapKernel::AVX2;
+        return BitmapKernel::Scalar;
+    }();
+    return kernel;
+}
+
+u8 ClassifyCountsAndCheckNewBits(
+    u8 *trace_bits,
+    const u8 *virgin_map,
+    u32 map_size,
+    utils::DirtyRegions *dirty
+) {
+    return ClassifyCountsAndCheckNewBits(
+               trace_bits, virgin_map, map_size, GetBitmapKernel(), dirty
+           );
+}
+
+/* kernel must be one for which IsBitmapKernelSupported() returns true. */
+
+u8 ClassifyCountsAndCheckNewBits(
+    u8 *trace_bits,
+    const u8 *virgin_map,
+    u32 map_size,
+    BitmapKernel kernel,
+    utils::DirtyRegions *dirty
+) {
+    if (dirty) dirty->StartRecording();
+
+    switch (kernel) {
+#ifdef FUZZUF_AFL_BITMAP_X86
+    case BitmapKernel::AVX512:
+        return WithMapSize(map_size, [&](auto size) {
+            return ClassifyCountsAndCheckNewBitsAVX512(trace_bits, virgin_map, size, dirty);
+        });
+    case BitmapKernel::AVX2:
+        return WithMapSize(map_size, [&](auto size) {
+            return ClassifyCountsAndCheckNewBitsAVX2(trace_bits, virgin_map, size, dirty);
+        });
+#endif
+    default:
+        return WithMapSize(map_size, [&](auto size) {
+            return ClassifyCountsAndCheckNewBitsScalar(trace_bits, virgin_map, size, dirty);
+        });
+    }
+}
+
+u8 HasNewBits(
+    const u8 *trace_bits,
+    u8 *virgin_map,
+    u32 map_size
+) {
+    return HasNewBits(trace_bits, virgin_map, map_size, GetBitmapKernel());
+}
+
+/* kernel must be one for which IsBitmapKernelSupported() returns true. */
+
+u8 HasNewBits(
+    const u8 *trace_bits,
+    u8 *virgin_map,
+    u32 map_size,
+    BitmapKernel kernel
+) {
+    switch (kernel) {
+#ifdef FUZZUF_AFL_BITMAP_X86
+    case BitmapKernel::AVX512:
+        return WithMapSize(map_size, [&](auto size) {
+            return HasNewBitsAVX512<false>(trace_bits, virgin_map, size);
+        });
+    case BitmapKernel::AVX2:
+        return WithMapSize(map_size, [&](auto size) {
+            return HasNewBitsAVX2<false>(trace_bits, virgin_map, size);
+        });
+#endif
+    default:
+        return WithMapSize(map_size, [&](auto size) {
+            return HasNewBitsScalar<false>(trace_bits, virgin_map, size);
+        });
+    }
+}
+
+u8 HasNewBitsAtomic(
+    const u8 *trace_bits,
+    u8 *virgin_map,
+    u32 map_size
+) {
+    return HasNewBitsAtomic(trace_bits, virgin_map, map_size, GetBitmapKernel());
+}
+
+/* kernel must be one for which IsBitmapKernelSupported() returns true. */
+
+u8 HasNewBitsAtomic(
+    const u8 *trace_bits,
+    u8 *virgin_map,
+    u32 map_size,
+    BitmapKernel kernel
+) {
+    switch (kernel) {
+#ifdef FUZZUF_AFL_BITMAP_X86
+    case BitmapKernel::AVX512:
+        return WithMapSize(map_size, [&](auto size) {
+            return HasNewBitsAVX512<true>(trace_bits, virgin_map, size);
+        });
+    case BitmapKernel::AVX2:
+        return WithMapSize(map_size, [&](auto size) {
+            return HasNewBitsAVX2<true>(trace_bits, virgin_map, size);
+        });
+#endif
+    default:
+        return WithMapSize(map_size, [&](auto size) {
+            return HasNewBitsScalar<true>(trace_bits, virgin_map, size);
+        });
+    }
+}
+
+} // namespace fuzzuf::algorithm::afl::util
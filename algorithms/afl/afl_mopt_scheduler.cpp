@@ -0,0 +1,216 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#include <algorithm>
+#include "fuzzuf/algorithms/afl/afl_mopt_scheduler.hpp"
+#include "fuzzuf/mutator/havoc_case.hpp"
+
+namespace fuzzuf::algorithm::afl {
+
+/* The initial positions are random, and the velocities and the best
+   positions start at the same values as the original MOpt. */
+
+MOptScheduler::MOptScheduler(u32 worker_id)
+    : rng(rand::CreateXSAdd(worker_id, "afl.mopt")) {
+    for (u32 i = 0; i < NUM_SWARMS * NUM_OPERATORS; i++) {
+        x_now[i] = UR(7000) * 0.0001 + 0.1;
+        v_now[i] = 0.1;
+        l_best[i] = 0.5;
+        eff_best[i] = 0.0;
+    }
+
+    g_best.fill(0.5);
+
+    for (u32 swarm = 0; swarm < NUM_SWARMS; swarm++) {
+        NormalizePositions(swarm);
+    }
+}
+
+u32 MOptScheduler::SelectCase() {
+    /* Pick an operator of the current swarm. The granularity of the dice
+       is the same as select_algorithm() of the original MOpt. */
+
+    const double *probs = &cumulative[swarm_now * NUM_OPERATORS];
+    double sele = UR(10000) * 0.0001;
+
+    u32 op = 0;
+    while (op < NUM_OPERATORS - 1 && sele >= probs[op]) op++;
+
+    hits[CurrentRow() * NUM_OPERATORS + op]++;
+    child_hits[op]++;
+
+    switch (op) {
+    case FLIP1:     return ::FLIP1;
+    case FLIP2:     return ::FLIP2;
+    case FLIP4:     return ::FLIP4;
+    case FLIP8:     return ::FLIP8;
+    case FLIP16:    return ::FLIP16;
+    case FLIP32:    return ::FLIP32;
+    case ARITH8:    return SUBADD8;
+    case ARITH16:   return SUBADD16;
+    case ARITH32:   return SUBADD32;
+    case INT8:      return ::INT8;
+    case INT16:     return UR(2) ? INT16_LE : INT16_BE;
+    case INT32:     return UR(2) ? INT32_LE : INT32_BE;
+    case RAND8:     return XOR;
+    case DELETE:    return DELETE_BYTES;
+    case CLONE:     return UR(4) ? CLONE_BYTES : INSERT_SAME_BYTE;
+    default: // OVERWRITE
+        return UR(4) ? OVERWRITE_WITH_CHUNK : OVERWRITE_WITH_SAME_BYTE;
+    }
+}
+
+void MOptScheduler::BeginStage(u64 total_finds) {
+    child_hits.fill(0);
+    last_total_finds = total_finds;
+}
+
+/* Every operator applied to the child shares the credit for what the child
+   has found, as in the original MOpt. */
+
+void MOptScheduler::UpdateAfterExec(u64 total_finds) {
+    if (total_finds > last_total_finds) {
+        u64 new_finds = total_finds - last_total_finds;
+        u32 row = CurrentRow();
+
+        for (u32 op = 0; op < NUM_OPERATORS; op++) {
+            if (child_hits[op]) finds[row * NUM_OPERATORS + op] += new_finds;
+        }
+
+        if (pilot) total_swarm_finds += new_finds;
+
+        last_total_finds = total_finds;
+    }
+
+    child_hits.fill(0);
+
+    if (++period_execs < (pilot ? PILOT_PERIOD : CORE_PERIOD)) return;
+
+    if (pilot) EndPilotPeriod();
+    else EndCorePeriod();
+
+    period_execs = 0;
+}
+
+double MOptScheduler::GetProbability(u32 swarm, u32 op) const {
+    return x_now[swarm * NUM_OPERATORS + op];
+}
+
+/* The current swarm has been used for PILOT_PERIOD execs. Record how well it
+   did, update the local best positions, and move on to the next swarm. */
+
+void MOptScheduler::EndPilotPeriod() {
+    swarm_fitness[swarm_now] = double(total_swarm_finds - period_start_finds) / period_execs;
+    period_start_finds = total_swarm_finds;
+
+    for (u32 op = 0; op < NUM_OPERATORS; op++) {
+        u32 idx = swarm_now * NUM_OPERATORS + op;
+
+        double eff = 0.0;
+        if (hits[idx] > period_hits[idx]) {
+            eff = double(finds[idx] - period_finds[idx]) / (hits[idx] - period_hits[idx]);
+        }
+
+        if (eff_best[idx] < eff) {
+            eff_best[idx] = eff;
+            l_best[idx] = x_now[idx];
+        }
+
+        period_hits[idx] = hits[idx];
+        period_finds[idx] = finds[idx];
+    }
+
+    if (++swarm_now < NUM_SWARMS) return;
+
+    /* All the swarms have been measured. Let the fittest one do the work. */
+
+    pilot = false;
+    swarm_now = 0;
+
+    double best_fitness = 0.0;
+    for (u32 swarm = 0; swarm < NUM_SWARMS; swarm++) {
+        if (swarm_fitness[swarm] > best_fitness) {
+            best_fitness = swarm_fitness[swarm];
+            swarm_now = swarm;
+        }
+    }
+}
+
+void MOptScheduler::EndCorePeriod() {
+    UpdatePositions();
+
+    pilot = true;
+    swarm_now = 0;
+}
+
+/* pso_updating() of the original MOpt. The global best position is the share
+   of the finds of each operator so far, in both modules. */
+
+void MOptScheduler::UpdatePositions() {
+    g_now++;
+    if (g_now > G_MAX) g_now = 0;
+
+    double w_now = (W_INIT - W_END) * (G_MAX - g_now) / G_MAX + W_END;
+
+    std::array<u64, NUM_OPERATORS> operator_finds {};
+    u64 total_finds = 0;
+
+    for (u32 op = 0; op < NUM_OPERATORS; op++) {
+        for (u32 row = 0; row < NUM_ROWS; row++) {
+            operator_finds[op] += finds[row * NUM_OPERATORS + op];
+        }
+        total_finds += operator_finds[op];
+    }
+
+    for (u32 op = 0; op < NUM_OPERATORS; op++) {
+        if (operator_finds[op]) g_best[op] = double(operator_finds[op]) / total_finds;
+    }
+
+    for (u32 swarm = 0; swarm < NUM_SWARMS; swarm++) {
+        for (u32 op = 0; op < NUM_OPERATORS; op++) {
+            u32 idx = swarm * NUM_OPERATORS + op;
+
+            double c1 = UR(1000) * 0.001;
+            double c2 = UR(1000) * 0.001;
+
+            v_now[idx] = w_now * v_now[idx]
+                       + c1 * (l_best[idx] - x_now[idx])
+                       + c2 * (g_best[op] - x_now[idx]);
+
+            x_now[idx] = std::clamp(x_now[idx] + v_now[idx], X_MIN, X_MAX);
+        }
+
+        NormalizePositions(swarm);
+    }
+}
+
+void MOptScheduler::NormalizePositions(u32 swarm) {
+    double *x = &x_now[swarm * NUM_OPERATORS];
+    double *probs = &cumulative[swarm * NUM_OPERATORS];
+
+    double sum = 0.0;
+    for (u32 op = 0; op < NUM_OPERATORS; op++) sum += x[op];
+
+    double acc = 0.0;
+    for (u32 op = 0; op < NUM_OPERATORS; op++) {
+        x[op] /= sum;
+        acc += x[op];
+        probs[op] = acc;
+    }
+}
+
+} // namespace fuzzuf::algorithm::afl
@@ -0,0 +1,92 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#include "fuzzuf/algorithms/afl/afl_shared_state.hpp"
+
+namespace fuzzuf::algorithm::afl {
+
+AFLSharedState::AFLSharedState(u32 map_size)
+    : virgin_bits(map_size, 255),
+      virgin_tmout(map_size, 255),
+      virgin_crash(map_size, 255) {}
+
+AFLSharedState::~AFLSharedState() {}
+
+/* Traces are sparse, so only their non-zero bytes are kept. The other workers
+   expand them into a zeroed map with RestoreTrace, and zero the map again with
+   EraseTrace when they are done. */
+
+void AFLSharedState::SharedTestcase::SetTrace(const u8 *trace_bits, u32 map_size) {
+    trace_offsets.clear();
+    trace_values.clear();
+
+    u32 i = 0;
+    for (; i + sizeof(u64) <= map_size; i += sizeof(u64)) {
+        if (likely(!*(const u64*)(trace_bits + i))) continue;
+
+        for (u32 j = i; j < i + sizeof(u64); j++) {
+            if (!trace_bits[j]) continue;
+            trace_offsets.emplace_back(j);
+            trace_values.emplace_back(trace_bits[j]);
+        }
+    }
+
+    for (; i < map_size; i++) {
+        if (!trace_bits[i]) continue;
+        trace_offsets.emplace_back(i);
+        trace_values.emplace_back(trace_bits[i]);
+    }
+}
+
+void AFLSharedState::SharedTestcase::RestoreTrace(u8 *trace_bits) const {
+    for (std::size_t k = 0; k < trace_offsets.size(); k++) {
+        trace_bits[trace_offsets[k]] = trace_values[k];
+    }
+}
+
+void AFLSharedState::SharedTestcase::EraseTrace(u8 *trace_bits) const {
+    for (u32 offset : trace_offsets) trace_bits[offset] = 0;
+}
+
+void AFLSharedState::Publish(std::shared_ptr<const SharedTestcase> testcase) {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    queue.push_back(std::move(testcase));
+    published.store(queue.size(), std::memory_order_release);
+}
+
+// Returns true if some testcases have been published from the index "from".
+// Cheap enough to be called between executions
+bool AFLSharedState::HasUnfetched(std::size_t from) const {
+    return published.load(std::memory_order_acquire) > from;
+}
+
+// Appends the published testcases from the index "from" to dest,
+// and returns the index from which the next call should start
+std::size_t AFLSharedState::Fetch(
+    std::size_t from,
+    std::vector<std::shared_ptr<const SharedTestcase>> &dest
+) const {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+
+    for (std::size_t i = from; i < queue.size(); i++) {
+        dest.push_back(queue[i]);
+    }
+
+    return queue.size();
+}
+
+} // namespace fuzzuf::algorithm::afl
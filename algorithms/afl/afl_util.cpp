@@ -21,6 +21,7 @@
 #include "fuzzuf/algorithms/afl/afl_macro.hpp"
 #include "fuzzuf/feedback/put_exit_reason_type.hpp"
 #include "fuzzuf/mutator/havoc_case.hpp"
+#include "fuzzuf/rand/rand.hpp"
 #include "fuzzuf/utils/common.hpp"
 #include "fuzzuf/utils/random.hpp"
 
@@ -36,20 +37,6 @@
 
 namespace fuzzuf::algorithm::afl::util {
 
-u32 UR(u32 limit, int rand_fd) {
-    static u32 rand_cnt;
-    if (rand_fd != -1 && unlikely(!rand_cnt--)) {
-        u32 seed[2];
-        Util::ReadFile(rand_fd, &seed, sizeof(seed));
-        srandom(seed[0]);
-
-        using option::AFLTag;
-        using option::GetReseedRng;
-        rand_cnt = (GetReseedRng<AFLTag>() / 2) + (seed[1] % GetReseedRng<AFLTag>());
-    }
-    return random() % limit;
-}
-
 /* Describe all the integers with five characters or less */
 
 std::string DescribeInteger(u64 val) {
@@ -171,6 +158,20 @@ std::string DescribeTimeDelta(u64 cur_ms, u64 event_ms) {
                             DescribeInteger(t_d).c_str(), t_h, t_m, t_s);
 }
 
+/* Compact trace bytes into a bitmap with one bit per byte, as minimize_bits()
+   of the original AFL. The bitmap is packed in u64 words, so that CullQueue
+   can walk the set bits with ctz instead of testing every bit. */
+
+std::vector<u64> MinimizeBits(const u8 *trace_bits, u32 map_size) {
+    std::vector<u64> mini((map_size + 63) / 64, 0);
+
+    for (u32 i = 0; i < map_size; i++) {
+        if (trace_bits[i]) mini[i >> 6] |= 1ULL << (i & 63);
+    }
+
+    return mini;
+}
+
 // In the following section, we define the probability distribution for the havoc mutation.
 // The definition consists of the following two steps:
 //   1. initialize the weights that represent 
@@ -190,6 +191,7 @@ std::string DescribeTimeDelta(u64 cur_ms, u64 event_ms) {
 // FIXME: is there any better way than this?
 
 u32 AFLHavocCaseDistrib(
+    rand::XSAdd& rng,
     const std::vector<dictionary::AFLDictData>& extras, 
     const std::vector<dictionary::AFLDictData>& a_extras
 ) {
@@ -216,7 +218,7 @@ u32 AFLHavocCaseDistrib(
 
     bool has_extras  = !extras.empty();
     bool has_aextras = !a_extras.empty();
-    return dists[has_extras][has_aextras]();
+    return dists[has_extras][has_aextras](rng);
 }
 
 } // namespace fuzzuf::algorithm::afl::util
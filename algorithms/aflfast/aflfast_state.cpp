@@ -74,16 +74,12 @@ void AFLFastState::UpdateBitmapScoreWithRawTrace(
 
             top_rated[i] = std::ref(testcase);
             testcase.tc_ref++;
+            MarkTopRatedDirty(i);
 
             if (!testcase.trace_mini) {
-                testcase.trace_mini.reset(
-                    new std::bitset<afl::option::GetMapSize<Tag>()>()
+                testcase.trace_mini = std::make_shared<const std::vector<u64>>(
+                    afl::util::MinimizeBits(trace_bits, map_size)
                 );
-
-                auto& trace_mini = *testcase.trace_mini;
-                for (u32 j=0; j < afl::option::GetMapSize<Tag>(); j++) {
-                    trace_mini[j] = trace_bits[j] != 0;
-                }
             }
 
             score_changed = true;
@@ -247,7 +243,7 @@ void AFLFastState::ShowStats(void) {
     // Lots of constants appear, so overlook this.
     using namespace afl::option;
 
-    const u32 MAP_SIZE = GetMapSize<Tag>();
+    const u32 MAP_SIZE = map_size;
 
     u64 cur_ms = Util::GetCurTimeMs();
 
@@ -53,7 +53,7 @@ DIEMutCalleeRef DIEMutate::operator()(
   state.stage_name = "DIE";
 
   /* Generate a seed used in esfuzz */
-  u32 seed = afl::util::UR(UINT32_MAX, state.rand_fd);
+  u32 seed = state.UR(UINT32_MAX);
 
   /* Number of scripts to generate in this mutation */
   int mut_cnt = state.setting->mut_cnt;
@@ -334,13 +334,18 @@ bool DIEState::SaveIfInteresting(
     /* Keep only if there are new bits in the map, add to queue for
        future fuzzing, etc. */
 
-    u8 hnb;
+    u8 hnb = 0;
 
-    inp_feed.ShowMemoryToFunc(
-      [this, &hnb](const u8* trace_bits, u32 /* map_size */) {
-        hnb = HasNewBits(trace_bits, &virgin_bits[0], afl::option::GetMapSize<Tag>());
-      }
-    );
+    /* inp_feed comes from RunExecutorWithClassifyCounts, which has
+       already told us whether virgin_bits needs to be updated. */
+
+    if (trace_hnb) {
+      inp_feed.ShowMemoryToFunc(
+        [this, &hnb](const u8* trace_bits, u32 /* map_size */) {
+          hnb = HasNewBits(trace_bits, &virgin_bits[0], map_size);
+        }
+      );
+    }
 
     if (!hnb) {
       if (crash_mode == PUTExitReasonType::FAULT_CRASH) {
@@ -407,16 +412,19 @@ bool DIEState::SaveIfInteresting(
       }
 
       if (!setting->dumb_mode) {
+          /* SimplifyTrace writes to every byte of the map */
+          executor->afl_dirty_regions.Invalidate();
+
           if constexpr (sizeof(size_t) == 8) {
               inp_feed.ModifyMemoryWithFunc(
-                  [](u8* trace_bits, u32 /* map_size */) {
-                      afl::util::SimplifyTrace<u64>((u64*)trace_bits, afl::option::GetMapSize<Tag>());
+                  [this](u8* trace_bits, u32 /* map_size */) {
+                      afl::util::SimplifyTrace<u64>((u64*)trace_bits, map_size);
                   }
                 );
           } else {
               inp_feed.ModifyMemoryWithFunc(
-                  [](u8* trace_bits, u32 /* map_size */) {
-                      afl::util::SimplifyTrace<u32>((u32*)trace_bits, afl::option::GetMapSize<Tag>());
+                  [this](u8* trace_bits, u32 /* map_size */) {
+                      afl::util::SimplifyTrace<u32>((u32*)trace_bits, map_size);
                   }
               );
           }
@@ -424,7 +432,7 @@ bool DIEState::SaveIfInteresting(
           u8 res;
           inp_feed.ShowMemoryToFunc(
               [this, &res](const u8* trace_bits, u32 /* map_size */) {
-                  res = HasNewBits(trace_bits, &virgin_tmout[0], afl::option::GetMapSize<Tag>());
+                  res = HasNewBits(trace_bits, &virgin_tmout[0], map_size);
               }
           );
 
@@ -440,7 +448,7 @@ bool DIEState::SaveIfInteresting(
          the target with a more generous timeout (unless the default timeout
          is already generous). */
 
-      if (setting->exec_timelimit_ms < hang_tmout) {
+      if (exec_tmout_us < static_cast<u64>(hang_tmout) * 1000) {
         // discard inp_feed here because we will use executor
         InplaceMemoryFeedback::DiscardActive(std::move(inp_feed));
         inp_feed = RunExecutorWithClassifyCounts(
@@ -492,16 +500,19 @@ bool DIEState::SaveIfInteresting(
       }
 
       if (!setting->dumb_mode) {
+        /* SimplifyTrace writes to every byte of the map */
+        executor->afl_dirty_regions.Invalidate();
+
         if constexpr (sizeof(size_t) == 8) {
             inp_feed.ModifyMemoryWithFunc(
-              [](u8* trace_bits, u32 /* map_size */) {
-                afl::util::SimplifyTrace<u64>((u64*)trace_bits, afl::option::GetMapSize<Tag>());
+              [this](u8* trace_bits, u32 /* map_size */) {
+                afl::util::SimplifyTrace<u64>((u64*)trace_bits, map_size);
               }
             );
           } else {
           inp_feed.ModifyMemoryWithFunc(
-            [](u8* trace_bits, u32 /* map_size */) {
-              afl::util::SimplifyTrace<u32>((u32*)trace_bits, afl::option::GetMapSize<Tag>());
+            [this](u8* trace_bits, u32 /* map_size */) {
+              afl::util::SimplifyTrace<u32>((u32*)trace_bits, map_size);
             }
           );
         }
@@ -509,7 +520,7 @@ bool DIEState::SaveIfInteresting(
         u8 res;
         inp_feed.ShowMemoryToFunc(
           [this, &res](const u8* trace_bits, u32 /* map_size */) {
-            res = HasNewBits(trace_bits, &virgin_crash[0], afl::option::GetMapSize<Tag>());
+            res = HasNewBits(trace_bits, &virgin_crash[0], map_size);
           }
         );
 
@@ -576,7 +587,7 @@ void DIEState::ShowStats(void) {
   // Lots of constants appear, so overlook this.
   using namespace afl::option;
 
-  const u32 MAP_SIZE = GetMapSize<Tag>();
+  const u32 MAP_SIZE = map_size;
 
   u64 cur_ms = Util::GetCurTimeMs();
 
@@ -206,8 +206,7 @@ void IJONFuzzer::BuildFuzzFlow() {
  */
 bool IJONFuzzer::IjonShouldSchedule(void) {
     if (state->nonempty_inputs.size() == 0) return false;
-    using fuzzuf::algorithm::afl::util::UR;
-    return UR(100, state->rand_fd) > 20;
+    return state->UR(100) > 20;
 }
 
 void IJONFuzzer::OneLoop(void) {
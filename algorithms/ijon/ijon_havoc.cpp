@@ -21,7 +21,9 @@
 #include <random>
 #include "fuzzuf/mutator/havoc_case.hpp"
 #include "fuzzuf/algorithms/afl/afl_util.hpp"
+#include "fuzzuf/mutator/mutator.hpp"
 #include "fuzzuf/algorithms/ijon/ijon_option.hpp"
+#include "fuzzuf/rand/rand.hpp"
 
 namespace fuzzuf::algorithm::ijon::havoc {
 
@@ -76,13 +78,10 @@ static constexpr std::array<double, IJON_NUM_CASE> IJONGetCaseWeights(bool has_e
  * Depending on whether IJON has a dictionary for a PUT, the function employs different distributions.
  */
 u32 IJONHavocCaseDistrib(
+    rand::XSAdd& rng,
     const std::vector<afl::dictionary::AFLDictData>& extras, 
     const std::vector<afl::dictionary::AFLDictData>& a_extras
 ) {
-    
-    // FIXME: replace this engine with our pRNG later to avoid being flooded with pRNGs.
-    static std::random_device seed_gen;
-    static std::mt19937 engine(seed_gen());
 
     // Static part: the following part doesn't run after a fuzzing campaign starts.
 
@@ -104,12 +103,13 @@ u32 IJONHavocCaseDistrib(
 
     bool has_extras  = !extras.empty();
     bool has_aextras = !a_extras.empty();
-    return dists[has_extras][has_aextras](engine);
+    return dists[has_extras][has_aextras](rng);
 }
 
 void IJONCustomCases(
+    rand::XSAdd& rng,
     u32 case_idx,
-    u8*& outbuf,
+    std::vector<u8>& outbuf,
     u32& len,
     const std::vector<afl::dictionary::AFLDictData>& extras,
     const std::vector<afl::dictionary::AFLDictData>& a_extras
@@ -136,31 +136,19 @@ void IJONCustomCases(
         if (use_auto) DEBUG_ASSERT(!a_extras.empty());
         else          DEBUG_ASSERT(!extras.empty());
 
-        // FIXME: replace AFL's pRNGs with ours later.
-        using afl::util::UR;
         using afl::dictionary::AFLDictData;
-        u32 idx = use_auto ? UR(a_extras.size(), -1) : UR(extras.size(), -1);
+        u32 idx = use_auto ? rand::UniformBelow(rng, a_extras.size())
+                           : rand::UniformBelow(rng, extras.size());
         const AFLDictData &extra = use_auto ? a_extras[idx] : extras[idx];
 
         u32 extra_len = extra.data.size();
         if (len + extra_len >= afl::option::GetMaxFile<option::IJONTag>()) break;
 
-        u8* new_buf = new u8[len + extra_len];
-
-        /* Head */
-        std::memcpy(new_buf, outbuf, insert_at);
-
-        /* Inserted part */
-        std::memcpy(new_buf + insert_at, &extra.data[0], extra_len);
-
-        /* Tail */
-        std::memcpy(new_buf + insert_at + extra_len, outbuf + insert_at,
-                len - insert_at);
-
-        delete[] outbuf;
-        outbuf = new_buf;
+        // Because insert_at == len, there is no tail to move
+        ReserveMutationBuffer(outbuf, len + extra_len);
+        std::memcpy(outbuf.data() + insert_at, &extra.data[0], extra_len);
         len += extra_len;
-        
+
         break;
     }
 
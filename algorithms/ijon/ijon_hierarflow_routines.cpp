@@ -18,7 +18,7 @@ SelectSeed::SelectSeed(struct IJONState& state) : state(state) {}
 NullableRef<HierarFlowCallee<void(void)>> SelectSeed::operator()(void) {
     StdoutLogger::Println("scheduled max input!!!!");
 
-    u32 idx = afl::util::UR(state.nonempty_inputs.size(), state.rand_fd);
+    u32 idx = state.UR(state.nonempty_inputs.size());
     auto& selected_input = *state.nonempty_inputs[idx];
     StdoutLogger::Println("schedule: " + selected_input.GetPath().string());
 
@@ -61,10 +61,17 @@ MaxHavoc::MaxHavoc(IJONState &state) : HavocBase(state) {}
  * https://github.com/RUB-SysSec/ijon/blob/4cb8ae04d/afl-fuzz.c#L6128-L6555
  */
 IJONMutCalleeRef MaxHavoc::operator()(IJONMutator& mutator) {
+    using afl::dictionary::AFLDictData;
+
     if (DoHavoc(
               mutator,
-              havoc::IJONHavocCaseDistrib,
-              havoc::IJONCustomCases,
+              [this](const std::vector<AFLDictData>& extras, const std::vector<AFLDictData>& a_extras) {
+                  return havoc::IJONHavocCaseDistrib(state.mutator_rng, extras, a_extras);
+              },
+              [this](u32 case_idx, std::vector<u8>& outbuf, u32& len,
+                     const std::vector<AFLDictData>& extras, const std::vector<AFLDictData>& a_extras) {
+                  havoc::IJONCustomCases(state.mutator_rng, case_idx, outbuf, len, extras, a_extras);
+              },
               "ijon-max", "ijon-max",
               state.orig_perf,
               afl::option::GetHavocCycles(state),
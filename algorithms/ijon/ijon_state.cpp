@@ -1,12 +1,23 @@
 #include "fuzzuf/algorithms/ijon/ijon_state.hpp"
 
+#include "fuzzuf/logger/logger.hpp"
+#include "fuzzuf/algorithms/ijon/shared_data.hpp"
+
 namespace fuzzuf::algorithm::ijon {
 
 IJONState::IJONState(
     std::shared_ptr<const afl::AFLSetting> setting,
     std::shared_ptr<NativeLinuxExecutor> executor
 ) : 
-    afl::AFLStateTemplate<IJONTestcase>(setting, executor) {}
+    afl::AFLStateTemplate<IJONTestcase>(setting, executor) {
+
+    // afl_max follows the coverage map in SharedData, so PUT and we agree on
+    // where it is only if the map has the size SharedData is laid out for.
+    if (map_size != sizeof(SharedData::afl_area)) {
+        ERROR("IJON requires the map size of %zu bytes, but PUT uses %u bytes",
+              sizeof(SharedData::afl_area), map_size);
+    }
+}
 
 IJONState::~IJONState() {}
 
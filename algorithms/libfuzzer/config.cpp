@@ -72,7 +72,9 @@ auto toString(std::string &dest, const FuzzerCreateInfo &value,
   FUZZUF_ALGORITHMS_LIBFUZZER_DUMP_MEMBER(afl_shm_size)
   FUZZUF_ALGORITHMS_LIBFUZZER_DUMP_MEMBER(bb_shm_size)
   FUZZUF_ALGORITHMS_LIBFUZZER_DUMP_MEMBER(cpuid_to_bind)
+  FUZZUF_ALGORITHMS_LIBFUZZER_DUMP_MEMBER(persistent_loop_count)
   FUZZUF_ALGORITHMS_LIBFUZZER_DUMP_MEMBER(use_afl_coverage)
+  FUZZUF_ALGORITHMS_LIBFUZZER_DUMP_MEMBER(in_process)
   FUZZUF_ALGORITHMS_LIBFUZZER_DUMP_MEMBER(sparse_energy_updates)
   FUZZUF_ALGORITHMS_LIBFUZZER_DUMP_MEMBER(crashed_only)
   FUZZUF_ALGORITHMS_LIBFUZZER_DUMP_MEMBER(max_input_length)
@@ -29,6 +29,7 @@
 
 #include "fuzzuf/utils/common.hpp"
 #include "fuzzuf/utils/workspace.hpp"
+#include "fuzzuf/rand/rand.hpp"
 #include "fuzzuf/feedback/exit_status_feedback.hpp"
 
 #include "fuzzuf/algorithms/vuzzer/vuzzer.hpp"
@@ -82,7 +83,7 @@ void VUzzer::PerformDryRun(VUzzerState &state) {
     DEBUG("Starting bad inputs...");
     /* Original VUzzer execute create_files_dry(30) twice. */
     for (int i = 0; i < 60; i++) {
-        const auto& testcase = state.pending_queue[rand() % state.pending_queue.size()];
+        const auto& testcase = state.pending_queue[rand::UniformBelow(state.rng, state.pending_queue.size())];
         testcase->input->Load();
         auto mutator = VUzzerMutator( *testcase->input, state );
         mutator.TotallyRandom();
@@ -120,8 +121,6 @@ void VUzzer::PerformDryRun(VUzzerState &state) {
  * @param (size) number of seeds
  */
 void VUzzer::FillSeeds(VUzzerState &state, u32 size) {
-    std::random_device rd;
-    std::default_random_engine eng(rd());
     std::uniform_real_distribution<> distr_cut(0.1, 1.0);
 
     u32 _sz = size;
@@ -130,13 +129,13 @@ void VUzzer::FillSeeds(VUzzerState &state, u32 size) {
     std::vector<std::shared_ptr<VUzzerTestcase>> initial_queue = state.pending_queue;
     for (u32 sz = 0; sz < size;) {
         std::vector<std::shared_ptr<VUzzerTestcase>> parents;
-        if (distr_cut(eng) > (1.0 - state.setting->fill_seeds_with_crossover_prob) && size - sz > 1) {
+        if (distr_cut(state.rng) > (1.0 - state.setting->fill_seeds_with_crossover_prob) && size - sz > 1) {
             DEBUG("Crossover");
             std::sample(initial_queue.begin(),
                         initial_queue.end(),
                         std::back_inserter(parents),
                         2,
-                        std::mt19937{std::random_device{}()});
+                        state.rng);
 
             DEBUG("Chose %s, %s", parents[0]->input->GetPath().c_str(), parents[1]->input->GetPath().c_str());
 
@@ -172,7 +171,7 @@ void VUzzer::FillSeeds(VUzzerState &state, u32 size) {
                         state.pending_queue.end(),
                         std::back_inserter(parents),
                         1,
-                        std::mt19937{std::random_device{}()});
+                        state.rng);
 
             parents[0]->input->LoadByMmap();
 
@@ -27,6 +27,7 @@
 #include "fuzzuf/hierarflow/hierarflow_intermediates.hpp"
 
 #include "fuzzuf/algorithms/vuzzer/vuzzer_mutator.hpp"
+#include "fuzzuf/rand/rand.hpp"
 
 namespace fuzzuf::algorithm::vuzzer::routine::mutation {
 
@@ -39,8 +40,6 @@ VUzzerMutCalleeRef Mutate::operator()(void) {
     DEBUG("Mutate seed(%zu)\n", state.seed_queue.size());
     assert(state.seed_queue.size() >= 2); // Mutator use at least two seeds from seed_queue
 
-    std::random_device rd;
-    std::default_random_engine eng(rd());
     std::uniform_real_distribution<> distr_cut(0.4, 0.8), distr_mut(0.1, 1.0);//XXX:
     u32 best_len = state.seed_queue[0]->input->GetLen(); //XXX
 
@@ -52,20 +51,20 @@ VUzzerMutCalleeRef Mutate::operator()(void) {
         std::vector<std::shared_ptr<VUzzerTestcase>> parents;        
 
         /* Choose two seeds from seed_queue. */
-        u32 cutp = (int)(distr_cut(eng) * state.seed_queue.size());
+        u32 cutp = (int)(distr_cut(state.rng) * state.seed_queue.size());
         std::sample(state.seed_queue.begin() + cutp,
                     state.seed_queue.end(),
                     std::back_inserter(parents),
                     2,
-                    std::mt19937{std::random_device{}()});
+                    state.rng);
 
         /* If we have seeds in taint_queue, choose them randomly. */
         if (state.taint_queue.size()) {
-            if ((u32)(rand() % 10) > state.setting->next_gen_from_special_prob) {
-                parents[0] = state.taint_queue[rand() % state.taint_queue.size()];
+            if (rand::UniformBelow(state.rng, 10) > state.setting->next_gen_from_special_prob) {
+                parents[0] = state.taint_queue[rand::UniformBelow(state.rng, state.taint_queue.size())];
             }
-            if ((u32)(rand() % 10) > state.setting->next_gen_from_special_prob) {
-                parents[1] = state.taint_queue[rand() % state.taint_queue.size()];
+            if (rand::UniformBelow(state.rng, 10) > state.setting->next_gen_from_special_prob) {
+                parents[1] = state.taint_queue[rand::UniformBelow(state.rng, state.taint_queue.size())];
             }
         }
 
@@ -103,7 +102,7 @@ VUzzerMutCalleeRef Mutate::operator()(void) {
             auto mutator1 = VUzzerMutator( *(seeds.first), state );
             auto mutator2 = VUzzerMutator( *(seeds.second), state );
             
-            if (distr_mut(eng) > (1.0 - state.setting->mutate_after_crossover_prob)) {                
+            if (distr_mut(state.rng) > (1.0 - state.setting->mutate_after_crossover_prob)) {                
                 mutator1.MutateRandom();
                 mutator1.TaintBasedChange();
             } else {
@@ -116,7 +115,7 @@ VUzzerMutCalleeRef Mutate::operator()(void) {
                                             state.queued_paths);
             state.AddToQueue(state.pending_queue, fn, mutator1.GetBuf(), mutator1.GetLen());
 
-            if (distr_mut(eng) > (1.0 - state.setting->mutate_after_crossover_prob)) {
+            if (distr_mut(state.rng) > (1.0 - state.setting->mutate_after_crossover_prob)) {
                 mutator2.MutateRandom();
                 mutator2.TaintBasedChange();                
             } else {
@@ -26,6 +26,7 @@
 
 #include "fuzzuf/utils/common.hpp"
 #include "fuzzuf/utils/random.hpp"
+#include "fuzzuf/rand/rand.hpp"
 #include "fuzzuf/mutator/mutator.hpp"
 #include "fuzzuf/exec_input/exec_input.hpp"
 #include "fuzzuf/algorithms/vuzzer/vuzzer_util.hpp"
@@ -59,8 +60,8 @@ const VUzzerMutator::MutCrossFunc VUzzerMutator::crossovers[] = {&VUzzerMutator:
                                                                 };
 /* TODO: Implement generator class */
 
-VUzzerMutator::VUzzerMutator( const ExecInput &input, const VUzzerState& state ) 
-    : Mutator<typename VUzzerState::Tag>(input), state(state) {}
+VUzzerMutator::VUzzerMutator( const ExecInput &input, VUzzerState& state ) 
+    : Mutator<typename VUzzerState::Tag>(input, state.mutator_rng), state(state) {}
 
 VUzzerMutator::~VUzzerMutator() {}
 
@@ -73,7 +74,7 @@ VUzzerMutator::VUzzerMutator(VUzzerMutator&& src)
  */
 u32 VUzzerMutator::GetCutPos(u32 limit) {
     u32 cut_pos = 0;
-    if (state.taint_cmp_offsets.size() && rand() % 10 > 3) {
+    if (state.taint_cmp_offsets.size() && UR(10) > 3) {
         u64 id = input.GetID();
         std::vector<std::pair<u32, std::set<u32>>> taint_choices;
 
@@ -86,7 +87,7 @@ u32 VUzzerMutator::GetCutPos(u32 limit) {
                         state.taint_cmp_offsets.end(),
                         std::back_inserter(taint_choices),
                         1,
-                        std::mt19937{std::random_device{}()});
+                        rng);
             offsets = &(taint_choices[0].second);
         }
         std::vector<u32> offsets_within_range;
@@ -95,11 +96,11 @@ u32 VUzzerMutator::GetCutPos(u32 limit) {
             if (offset < limit) offsets_within_range.emplace_back(offset);
 
         if (offsets_within_range.size())
-            cut_pos = offsets_within_range[rand() % offsets_within_range.size()];
+            cut_pos = offsets_within_range[UR(offsets_within_range.size())];
         else
-            cut_pos = limit ? rand() % limit : 0;
+            cut_pos = limit ? UR(limit) : 0;
     } else {
-        cut_pos = limit ? rand() % limit : 0;
+        cut_pos = limit ? UR(limit) : 0;
         /* TODO: MOSTCOMM */
     }
     DEBUG("GetCutPos %u (limit %u, taint_tag %lu)", cut_pos, limit, state.taint_cmp_offsets.size());
@@ -111,7 +112,7 @@ u32 VUzzerMutator::GetCutPos(u32 limit) {
  * @sa GetCutPos
  */
 void VUzzerMutator::EliminateRandom() {
-    u32 cut_size = std::max(1U, fuzzuf::utils::random::Random<u32>(1U, std::max(1U, (len / denominator))));
+    u32 cut_size = std::max(1U, fuzzuf::utils::random::Random<u32>(rng, 1U, std::max(1U, (len / denominator))));
     u32 cut_pos = GetCutPos(len - cut_size);
     DEBUG("EliminateRandom [%u, %u]", cut_pos, cut_pos + cut_size -1);
     Mutator::Delete(cut_pos, cut_size);
@@ -121,8 +122,8 @@ void VUzzerMutator::EliminateRandom() {
  * @brief Delete [pos: pos+size) range of input buffer. pos is chosen randomly.
  */
 void VUzzerMutator::EliminateRandomEnd() {
-    u32 cut_size = std::max(1U, fuzzuf::utils::random::Random<u32>(1U, std::max(1U, (len / denominator))));
-    u32 cut_pos = fuzzuf::utils::random::Random<u32>(len/2, len - cut_size);
+    u32 cut_size = std::max(1U, fuzzuf::utils::random::Random<u32>(rng, 1U, std::max(1U, (len / denominator))));
+    u32 cut_pos = fuzzuf::utils::random::Random<u32>(rng, len/2, len - cut_size);
     DEBUG("EliminateRandomEnd [%u, %u]", cut_pos, cut_pos + cut_size -1);
     Mutator::Delete(cut_pos, cut_size);
 }
@@ -143,9 +144,9 @@ void VUzzerMutator::DoubleEliminate() {
  * @sa GetCutPos
  */
 void VUzzerMutator::AddRandom() {
-    u32 add_size = std::max(1U, fuzzuf::utils::random::Random<u32>(1U, std::max(1U, (len / denominator))));
+    u32 add_size = std::max(1U, fuzzuf::utils::random::Random<u32>(rng, 1U, std::max(1U, (len / denominator))));
     u32 add_pos = GetCutPos(len - add_size);
-    auto rand_bytes = vuzzer::util::GenerateRandomBytesFromDict(add_size, state.all_dicts);
+    auto rand_bytes = vuzzer::util::GenerateRandomBytesFromDict(rng, add_size, state.all_dicts);
     DEBUG("AddRandom [%u, %u]", add_pos, add_pos + add_size - 1);
     Insert(add_pos, rand_bytes->data(), add_size);
     ChangeBytes();
@@ -156,9 +157,9 @@ void VUzzerMutator::AddRandom() {
  * @sa GetCutPos
  */
 void VUzzerMutator::ChangeRandom() {
-    u32 change_size = std::max(1U, fuzzuf::utils::random::Random<u32>(1U, std::max(1U, (len / denominator))));
+    u32 change_size = std::max(1U, fuzzuf::utils::random::Random<u32>(rng, 1U, std::max(1U, (len / denominator))));
     u32 change_pos = GetCutPos(len - change_size);
-    auto rand_bytes = vuzzer::util::GenerateRandomBytesFromDict(change_size, state.all_dicts);
+    auto rand_bytes = vuzzer::util::GenerateRandomBytesFromDict(rng, change_size, state.all_dicts);
     DEBUG("ChangeRandom [%u, %u]", change_pos, change_pos + change_size - 1);
     Replace(change_pos, rand_bytes->data(), change_size);
     ChangeBytes();
@@ -183,7 +184,7 @@ void VUzzerMutator::ChangeBytes() {
                     state.taint_cmp_offsets.end(),
                     std::back_inserter(taint_choices),
                     1,
-                    std::mt19937{std::random_device{}()});
+                    rng);
         offsets = &(taint_choices[0].second);
     }
 
@@ -196,11 +197,11 @@ void VUzzerMutator::ChangeBytes() {
                     offsets->end(),
                     std::back_inserter(off_choices),
                     std::max(1UL, offsets->size() / 4),
-                    std::mt19937{std::random_device{}()});
+                    rng);
         for (auto choice : off_choices) {
             if (choice < len) {
                 DEBUG("Change offset %u", choice);
-                outbuf[choice] = state.all_chars_dict[random() % state.all_chars_dict.size()].data[0];
+                outbuf[choice] = state.all_chars_dict[UR(state.all_chars_dict.size())].data[0];
             }
         }
     }
@@ -214,25 +215,23 @@ void VUzzerMutator::ChangeBytes() {
  * @sa GetCutPos
  */
 void VUzzerMutator::ChangeRandomFull() {
-    u32 change_size = std::max(1U, fuzzuf::utils::random::Random<u32>(1U, std::max(1U, (len / denominator))));
+    u32 change_size = std::max(1U, fuzzuf::utils::random::Random<u32>(rng, 1U, std::max(1U, (len / denominator))));
     u32 change_pos = GetCutPos(len - change_size);
 
     if (state.full_bytes_dict.size() > 1) {
         /* Insert random bytes generated from full_bytes_dict at change_pos */
         std::vector<const dict_t*> all_dicts;
         all_dicts.emplace_back(&state.full_bytes_dict);
-        auto rand_bytes = vuzzer::util::GenerateRandomBytesFromDict(change_size, all_dicts);
+        auto rand_bytes = vuzzer::util::GenerateRandomBytesFromDict(rng, change_size, all_dicts);
         DEBUG("Insert at [%u:%u]",change_pos, change_pos + change_size - 1);
         Insert(change_pos, rand_bytes->data(), change_size);
     } else if (state.unique_bytes_dict.size() > 2 && len > 3) {
         /* Insert words chosen from unique_bytes_dict at change_pos1 and change_pos2 */
-        std::random_device rd;
-        std::default_random_engine eng(rd());
         std::uniform_int_distribution<int> distr(1, len - 1);
-        auto word1 = &(state.unique_bytes_dict[random() % state.unique_bytes_dict.size()].data);
-        auto word2 = &(state.unique_bytes_dict[random() % state.unique_bytes_dict.size()].data);
-        u32 change_pos1 = distr(eng);
-        u32 change_pos2 = distr(eng);
+        auto word1 = &(state.unique_bytes_dict[UR(state.unique_bytes_dict.size())].data);
+        auto word2 = &(state.unique_bytes_dict[UR(state.unique_bytes_dict.size())].data);
+        u32 change_pos1 = distr(rng);
+        u32 change_pos2 = distr(rng);
         if (change_pos1 > change_pos2) std::swap(change_pos1, change_pos2); //sort 
         DEBUG("Insert at [%u:%lu]",change_pos1, change_pos1 + word1->size());
         DEBUG("Insert at [%u:%lu]",change_pos2, change_pos2 + word2->size());
@@ -240,7 +239,7 @@ void VUzzerMutator::ChangeRandomFull() {
         Insert(change_pos2 + word1->size(), word2->data(), word2->size());  // NOTICE: After first insertion, change_pos2 is shifted.
     } else {
         /* Replace bytes at [change_pos: change_pos+change_size) range of input buffer with random bytes geranted from all_dicts. */
-        auto rand_bytes = vuzzer::util::GenerateRandomBytesFromDict(change_size, state.all_dicts);
+        auto rand_bytes = vuzzer::util::GenerateRandomBytesFromDict(rng, change_size, state.all_dicts);
         DEBUG("Replace at [%u:%u]",change_pos, change_pos + change_size);
         Replace(change_pos, rand_bytes->data(), change_size);
     }
@@ -250,11 +249,11 @@ void VUzzerMutator::ChangeRandomFull() {
  * @brief Change each bytes at random offsets to random bytes.
  */
 void VUzzerMutator::SingleChangeRandom() {
-    int change_cnt = fuzzuf::utils::random::Random<int>(1, 100);
+    int change_cnt = fuzzuf::utils::random::Random<int>(rng, 1, 100);
     DEBUG("SingleChangeRandom %u", change_cnt);
     for (int i = 0; i < change_cnt; i++) {
-        u32 change_pos = fuzzuf::utils::random::Random<u32>(0, len - 1);
-        outbuf[change_pos] = fuzzuf::utils::random::Random<u8>(1, 255);
+        u32 change_pos = fuzzuf::utils::random::Random<u32>(rng, 0, len - 1);
+        outbuf[change_pos] = fuzzuf::utils::random::Random<u8>(rng, 1, 255);
     }
 }
 
@@ -262,10 +261,10 @@ void VUzzerMutator::SingleChangeRandom() {
  * @brief Decrease each bytes at random offsets.
  */
 void VUzzerMutator::LowerSingleRandom() {
-    int change_cnt = fuzzuf::utils::random::Random<int>(1, 100);
+    int change_cnt = fuzzuf::utils::random::Random<int>(rng, 1, 100);
     DEBUG("LowerSingleRandom %u", change_cnt);
     for (int i = 0; i < change_cnt; i++) {
-        u32 change_pos = fuzzuf::utils::random::Random<u32>(0, len - 1);
+        u32 change_pos = fuzzuf::utils::random::Random<u32>(rng, 0, len - 1);
         outbuf[change_pos] = std::max(0, outbuf[change_pos] - 1);
     }
 }
@@ -274,10 +273,10 @@ void VUzzerMutator::LowerSingleRandom() {
  * @brief Increase each bytes at random offsets.
  */
 void VUzzerMutator::RaiseSingleRandom() {
-    int change_cnt = fuzzuf::utils::random::Random<int>(1, 100);
+    int change_cnt = fuzzuf::utils::random::Random<int>(rng, 1, 100);
     DEBUG("RaiseSingleRandom %u", change_cnt);
     for (int i = 0; i < change_cnt; i++) {
-        u32 change_pos = fuzzuf::utils::random::Random<u32>(0, len - 1);        
+        u32 change_pos = fuzzuf::utils::random::Random<u32>(rng, 0, len - 1);        
         outbuf[change_pos] = std::min(255, outbuf[change_pos] + 1);
     }
 }
@@ -286,8 +285,8 @@ void VUzzerMutator::RaiseSingleRandom() {
  * @brief Replace a '\0' byte with a specified byte
  */
 void VUzzerMutator::EliminateNull() {
-    int start_pos = fuzzuf::utils::random::Random<int>(0, len);    
-    int cut_pos = std::distance(outbuf, std::find(outbuf + start_pos, outbuf + len, '\0'));
+    int start_pos = fuzzuf::utils::random::Random<int>(rng, 0, len);    
+    int cut_pos = std::distance(outbuf.data(), std::find(outbuf.data() + start_pos, outbuf.data() + len, '\0'));
     DEBUG("EliminateNull %d (found \\0 at %d)", start_pos, cut_pos);
     u8 replacement[] = {'A'}; //TODO: Specify it by argument
     if ((u32)cut_pos != len) {
@@ -299,20 +298,20 @@ void VUzzerMutator::EliminateNull() {
  * @brief Replace "\0\0" bytes with specified two bytes
  */
 void VUzzerMutator::EliminateDoubleNull() {
-    int start_pos = fuzzuf::utils::random::Random<int>(0, len - 1);
+    int start_pos = fuzzuf::utils::random::Random<int>(rng, 0, len - 1);
     u8 pattern[] = {'\0', '\0'};
     u8 replacement[] = "AA"; //TODO: Specify it by argument
-    auto itr = outbuf + start_pos;
+    auto itr = outbuf.data() + start_pos;
     bool found = false;
-    while (itr + sizeof(pattern) < outbuf + len) {    
+    while (itr + sizeof(pattern) < outbuf.data() + len) {    
         if (std::equal(itr, std::next(itr, sizeof(pattern)), pattern, std::next(pattern, sizeof(pattern)) )) {
             found = true;
             break;
         }
-        itr = std::find(itr + 1, outbuf + len, pattern[0]);
+        itr = std::find(itr + 1, outbuf.data() + len, pattern[0]);
     }
     if (found) {
-        u32 cut_pos = std::distance(outbuf, itr);
+        u32 cut_pos = std::distance(outbuf.data(), itr);
         Replace(cut_pos, replacement, sizeof(pattern));
         DEBUG("EliminateNull %d (found \\0\\0 at %d)", start_pos, cut_pos);
     } else {
@@ -325,11 +324,11 @@ void VUzzerMutator::EliminateDoubleNull() {
  */
 void VUzzerMutator::TotallyRandom() {
     DEBUG("TotallyRandom");
-    auto rand_bytes = vuzzer::util::GenerateRandomBytesFromDict(fuzzuf::utils::random::Random<u32>(100, 1000), state.all_dicts);
-    auto rand_bytes_ptr = rand_bytes.release(); // XXX: We should not use raw ptr instead of unique_ptr.
+    auto rand_bytes = vuzzer::util::GenerateRandomBytesFromDict(rng, fuzzuf::utils::random::Random<u32>(rng, 100, 1000), state.all_dicts);
 
-    delete[] outbuf;    
-    outbuf = rand_bytes_ptr->data();
+    len = rand_bytes->size();
+    ReserveMutationBuffer(outbuf, len);
+    std::memcpy(outbuf.data(), rand_bytes->data(), len);
 }
 
 /**
@@ -341,22 +340,15 @@ void VUzzerMutator::IntSlide() {
         u32 start = int_slide_pos % len;
         DEBUG("IntSlide %u", start);
         if (start > len - 4) {
-            /* XXX: Can't realloc buffer allocated by new[]. We should use std::vector instead of u8* for outbuf */
-            u8 *new_buf = new u8[start + 4];
-            std::memcpy(new_buf, outbuf, start);
-            std::memcpy(new_buf + start, slides[rand() % 3].data(), 4);
-            delete[] outbuf;
-            outbuf = new_buf;
+            ReserveMutationBuffer(outbuf, start + 4);
+            std::memcpy(outbuf.data() + start, slides[UR(3)].data(), 4);
             len = start + 4;
         } else {
-            Replace(start, slides[rand() % 3].data(), 4);
+            Replace(start, slides[UR(3)].data(), 4);
         }
         int_slide_pos += slide_step;
     } else {
-        u8 *new_buf = new u8[len];
-        std::memcpy(new_buf, slides[rand() % 3].data(), len);
-        delete[] outbuf;
-        outbuf = new_buf;
+        std::memcpy(outbuf.data(), slides[UR(3)].data(), len);
     }
 }
 
@@ -366,8 +358,8 @@ void VUzzerMutator::IntSlide() {
 void VUzzerMutator::DoubleFuzz() {
     DEBUG("DoubleFuzz");    
     u32 mut_cnt = sizeof(mutators) / sizeof(MutFunc);
-    (this->*mutators[rand() % mut_cnt])();
-    (this->*mutators[rand() % mut_cnt])();
+    (this->*mutators[UR(mut_cnt)])();
+    (this->*mutators[UR(mut_cnt)])();
 }
 
 /**
@@ -384,19 +376,14 @@ void VUzzerMutator::DoubleFullMutate() {
  * @brief Insert buf into [pos, pos+extra_len) of input buffer while overwriting input buffer[pos] with buf[0]. 
  */
 void VUzzerMutator::InsertWithOnebyteOverwrite(u32 pos, const u8 *buf, u32 extra_len) {
-    u8* new_buf = new u8[len + extra_len - 1];
-    /* Head */
-    std::memcpy(new_buf, outbuf, pos);
-
-    /* Inserted part */
-    std::memcpy(new_buf + pos, buf, extra_len);
-
-    /* Tail */
-    std::memcpy(new_buf + pos + extra_len, outbuf + pos + 1, len - pos - 1);
+    if (extra_len == 0) {
+        Delete(pos, 1);
+        return;
+    }
 
-    delete[] outbuf;
-    outbuf   = new_buf;
-    len += extra_len - 1;
+    // Overwrite outbuf[pos] and insert the rest
+    OpenGap(pos + 1, extra_len - 1);
+    std::memcpy(outbuf.data() + pos, buf, extra_len);
 }
 
 /**
@@ -420,10 +407,10 @@ void VUzzerMutator::TaintBasedChange() {
                         offsets_set.end(),
                         std::back_inserter(off_choices),
                         std::max(1UL, offsets_set.size() / 2),
-                        std::mt19937{std::random_device{}()});
+                        rng);
             for (auto choice : off_choices) {
                 if (choice < len) {                
-                    std::vector<u8> value = values[random() % values.size()];
+                    std::vector<u8> value = values[UR(values.size())];
                     InsertWithOnebyteOverwrite(choice, value.data(), value.size());
                 }
             }
@@ -439,12 +426,12 @@ void VUzzerMutator::TaintBasedChange() {
                         offsets_map.rend(),
                         std::back_inserter(off_choices),
                         std::max(1UL, offsets_map.size() / 2),
-                        std::mt19937{std::random_device{}()});
+                        rng);
             for (auto choice : off_choices) {
                 u32 offset = choice.first;
                 if (offset < len) {
                     // TODO: MOSTCOMMLAST
-                    u32 value = choice.second.at(random() % choice.second.size());
+                    u32 value = choice.second.at(UR(choice.second.size()));
                     //outbuf[offset] = value;//XXX
                     // Convert u32 value to bytes in a little endian manner(extract_offsetStr, get_hexStr in VUzzer)
                     // TODO: Move to Util
@@ -482,13 +469,11 @@ void VUzzerMutator::TaintBasedChange() {
 std::pair<std::shared_ptr<ExecInput>, std::shared_ptr<ExecInput>> 
 VUzzerMutator::SingleCrossOver(const ExecInput& target) {    
     std::unique_ptr<ExecInputSet> input_set(new ExecInputSet());
-    std::random_device rd;
-    std::default_random_engine eng(rd());
     std::uniform_real_distribution<> distr(0.1, 0.6);
     u32 len1 = len, len2 = target.GetLen();
-    u8 *buf1 = outbuf, *buf2 = target.GetBuf();
+    u8 *buf1 = outbuf.data(), *buf2 = target.GetBuf();
 
-    double point = distr(eng);
+    double point = distr(rng);
 
     u32 cut_pos1 = point * len1;
     u32 cut_pos2 = point * len2;
@@ -518,14 +503,12 @@ VUzzerMutator::SingleCrossOver(const ExecInput& target) {
 std::pair<std::shared_ptr<ExecInput>, std::shared_ptr<ExecInput>> 
 VUzzerMutator::DoubleCrossOver(const ExecInput& target) {
     std::unique_ptr<ExecInputSet> input_set(new ExecInputSet());
-    std::random_device rd;
-    std::default_random_engine eng(rd());
     std::uniform_real_distribution<> distr1(0.1, 0.3), distr2(0.6, 0.8);
 
     u32 len1 = len, len2 = target.GetLen();
-    u8 *buf1 = outbuf, *buf2 = target.GetBuf();
+    u8 *buf1 = outbuf.data(), *buf2 = target.GetBuf();
 
-    double point1 = distr1(eng), point2 = distr2(eng);
+    double point1 = distr1(rng), point2 = distr2(rng);
     u32 cut_pos11 = point1 * len1;
     u32 cut_pos12 = point2 * len1;
     u32 cut_pos21 = point1 * len2;
@@ -558,9 +541,9 @@ VUzzerMutator::DoubleCrossOver(const ExecInput& target) {
  */
 void VUzzerMutator::MutateRandom() {
     u32 mut_cnt = sizeof(mutators) / sizeof(MutFunc);    
-    (this->*mutators[rand() % mut_cnt])();    
+    (this->*mutators[UR(mut_cnt)])();    
     while (len < 3) { 
-        (this->*mutators[rand() % mut_cnt])();
+        (this->*mutators[UR(mut_cnt)])();
     }
     assert(len > 2);
 }
@@ -572,7 +555,7 @@ void VUzzerMutator::MutateRandom() {
 std::pair<std::shared_ptr<ExecInput>, std::shared_ptr<ExecInput>> 
 VUzzerMutator::CrossOver(const ExecInput& target) {
     u32 mut_cnt = sizeof(crossovers) / sizeof(MutCrossFunc);
-    return (this->*crossovers[rand() % mut_cnt])(target);
+    return (this->*crossovers[UR(mut_cnt)])(target);
 }
 
 } // namespace fuzzuf::algorithm::vuzzer
@@ -27,6 +27,7 @@
 #include "fuzzuf/hierarflow/hierarflow_intermediates.hpp"
 
 #include "fuzzuf/utils/get_hash.hpp"
+#include "fuzzuf/rand/rand.hpp"
 
 namespace fuzzuf::algorithm::vuzzer::routine::other {
 
@@ -55,7 +56,7 @@ VUzzerMidCalleeRef DecideKeep::operator()(void) {
                         state.seed_queue.end(),
                         std::back_inserter(state.keep_queue),
                         state.keepfilenum,
-                        std::mt19937{std::random_device{}()});
+                        state.rng);
             DEBUG("Keep queue");
             for (const auto &seed : state.keep_queue)
                 DEBUG("%s",seed->input->GetPath().c_str());
@@ -120,12 +121,16 @@ ExecutePUT::ExecutePUT(VUzzerState &state) : state(state) {}
  */
 VUzzerMidCalleeRef ExecutePUT::operator()(void) {
     DEBUG("ExecutePUT pending(%zu)\n", state.pending_queue.size());
-    ExitStatusFeedback exit_status;
-    /* Execute all inputs from pending_queue */
+    /* Execute all inputs from pending_queue at once */
+    std::vector<fuzzuf::executor::BatchInput> inputs;
+    inputs.reserve(state.pending_queue.size());
     for (const auto& testcase : state.pending_queue) {
         testcase->input->Load();
+        inputs.push_back({testcase->input->GetBuf(), testcase->input->GetLen()});
+    }
 
-        auto inp_feed = state.RunExecutor(testcase->input->GetBuf(), testcase->input->GetLen(), exit_status);
+    state.RunExecutorBatch(inputs, [this](std::size_t i, FileFeedback &inp_feed, const ExitStatusFeedback &exit_status) {
+        const auto &testcase = state.pending_queue[i];
 
         /* Calculate fitness score in child node (i.e. UpdateFitness method) */
         auto score = CallSuccessors(testcase, inp_feed);
@@ -152,6 +157,9 @@ VUzzerMidCalleeRef ExecutePUT::operator()(void) {
             }
             /* TODO: Implement STOPONCRASH mode */
         }
+    });
+
+    for (const auto& testcase : state.pending_queue) {
         testcase->input->Unload();
         /* Move a seed to seed_queue from pending_queue. */ 
         state.seed_queue.emplace_back(testcase);
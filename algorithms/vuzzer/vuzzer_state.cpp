@@ -22,8 +22,10 @@
  */
 #include "fuzzuf/algorithms/vuzzer/vuzzer_state.hpp"
 
+#include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <system_error>
 
 #include "fuzzuf/utils/common.hpp"
 #include "fuzzuf/utils/filesystem.hpp"
@@ -82,6 +84,86 @@ FileFeedback VUzzerState::RunExecutor(
     return FileFeedback(std::move(inp_feed));
 }
 
+/**
+ * @brief Execute a PUT with each input in a batch
+ * @param (inputs) Input buffers
+ * @param (callback) Called with the index, the feedback and the exit status of each execution
+ * @param (tmout) Timeout setting for the executor
+ */
+void VUzzerState::RunExecutorBatch(
+    const std::vector<fuzzuf::executor::BatchInput> &inputs,
+    const std::function<void(std::size_t, FileFeedback&, const ExitStatusFeedback&)> &callback,
+    u32 tmout
+) {
+    if (executor_pool) {
+        RunExecutorPool(inputs, callback, tmout);
+        return;
+    }
+
+    executor->RunBatch(
+        inputs,
+        [this, &callback](std::size_t i, const ExitStatusFeedback &exit_status) {
+            auto inp_feed = FileFeedback(executor->GetFileFeedback("bb.out"));
+            callback(i, inp_feed, exit_status);
+            return true;
+        },
+        tmout
+    );
+}
+
+/**
+ * The executors of executor_pool run the inputs in parallel, and callback is called for each input
+ * in the order of the inputs once all of them have been executed.
+ * @brief Execute a PUT with each input in a batch on executor_pool
+ * @param (inputs) Input buffers
+ * @param (callback) Called with the index, the feedback and the exit status of each execution
+ * @param (tmout) Timeout setting for the executors
+ */
+void VUzzerState::RunExecutorPool(
+    const std::vector<fuzzuf::executor::BatchInput> &inputs,
+    const std::function<void(std::size_t, FileFeedback&, const ExitStatusFeedback&)> &callback,
+    u32 tmout
+) {
+    struct PoolResult {
+        fs::path feed_path;
+        ExitStatusFeedback exit_status;
+    };
+
+    auto results = executor_pool->Map<PoolResult>(
+        inputs.size(),
+        [this, &inputs, tmout](PinToolExecutor &pool_executor, std::size_t i) {
+            pool_executor.Run(inputs[i].buf, inputs[i].len, tmout);
+
+            std::size_t k = 0;
+            while (&executor_pool->GetExecutor(k) != &pool_executor) k++;
+
+            /* The next execution of the executor overwrites its coverage file.
+               Move the file aside, so that it can be read after the whole batch. */
+            PoolResult result;
+            result.feed_path = setting->out_dir / Util::StrPrintf(".bb.%zu.out", i);
+            result.exit_status = pool_executor.GetExitStatusFeedback();
+
+            std::error_code ec;
+            fs::rename(pool_feed_paths[k], result.feed_path, ec);
+            if (ec) {
+                /* PUT died before writing the coverage. Treat it as no coverage. */
+                Util::CloseFile(Util::OpenFile(result.feed_path.native(), O_WRONLY | O_CREAT | O_TRUNC, 0600));
+            }
+            return result;
+        }
+    );
+
+    for (std::size_t i = 0; i < results.size(); i++) {
+        /* The tasks skipped by ReceiveStopSignal have no file. */
+        if (results[i].feed_path.empty()) continue;
+
+        auto inp_feed = FileFeedback(results[i].feed_path, nullptr);
+        callback(i, inp_feed, results[i].exit_status);
+
+        fs::remove(results[i].feed_path);
+    }
+}
+
 /**
  * Execute a PUT by dynamic taint analysis technique with input from the buffer.
  * The input buffer is marked as taint tag.
@@ -113,6 +195,7 @@ void VUzzerState::ReceiveStopSignal(void) {
     stop_soon = 1;
     executor->ReceiveStopSignal();
     taint_executor->ReceiveStopSignal();
+    if (executor_pool) executor_pool->ReceiveStopSignal();
 }
 
 /**
@@ -26,6 +26,7 @@
 
 #include "fuzzuf/utils/common.hpp"
 #include "fuzzuf/feedback/put_exit_reason_type.hpp"
+#include "fuzzuf/rand/rand.hpp"
 
 namespace fuzzuf::algorithm::vuzzer::util {
 
@@ -229,13 +230,14 @@ void DictToBitsWithKeys(
 
 /* Generate random n-bytes string from dictionaries */
 std::unique_ptr<std::vector<u8>> GenerateRandomBytesFromDict(
+    rand::XSAdd& rng,
     u32 size,
     const std::vector<const dict_t*>& all_dicts
 ) { 
     std::unique_ptr<std::vector<u8>> result(new std::vector<u8>);        
     while(result->size() < size) {
-        auto& dict = all_dicts[random() % all_dicts.size()];
-        const AFLDictData& word = dict->at(random() % dict->size());
+        auto& dict = all_dicts[rand::UniformBelow(rng, all_dicts.size())];
+        const AFLDictData& word = dict->at(rand::UniformBelow(rng, dict->size()));
         result->insert(result->end(), word.data.begin(), word.data.end());
     }
     return result;
@@ -25,6 +25,7 @@
 #include "fuzzuf/logger/log_file_logger.hpp"
 #include "fuzzuf/logger/logger.hpp"
 #include "fuzzuf/logger/stdout_logger.hpp"
+#include "fuzzuf/rand/rand.hpp"
 
 namespace fuzzuf::cli {
 
@@ -57,6 +58,12 @@ std::unique_ptr<Fuzzer> CreateFuzzerInstanceFromArgv(int argc, const char **argv
                                     __FILE__, __LINE__);
     }
 
+    // Fix the seed before the fuzzer creates its random number generators
+    if (global_options.seed) {
+        rand::SetGlobalSeed(*global_options.seed);
+    }
+    DEBUG("Global seed: %llu", static_cast<unsigned long long>(rand::GetGlobalSeed()));
+
     // Prepare a fuzzer specified by the command line as it states
     return FuzzerBuilderRegister::Get(global_options.fuzzer)(fuzzer_args, global_options);
 }
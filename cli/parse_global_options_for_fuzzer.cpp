@@ -73,6 +73,11 @@ FuzzerArgs ParseGlobalOptionsForFuzzer(GlobalArgs &global_args, GlobalFuzzerOpti
             po::value<std::string>()->default_value(global_options.log_file->string()):
             po::value<std::string>()->default_value(""),
             "Enable LogFile logger and set the log file path for LogFile logger")
+        ("seed",
+	    global_options.seed ?
+              po::value<u64>()->default_value(*global_options.seed):
+              po::value<u64>(),
+            "Seed the random number generators to make a run reproducible. Default is random.")
     ;
 
     // Dummy options to parse global options but not PUT options
@@ -112,6 +117,9 @@ FuzzerArgs ParseGlobalOptionsForFuzzer(GlobalArgs &global_args, GlobalFuzzerOpti
     if(vm.count("exec_memlimit")) {
         global_options.exec_memlimit = vm["exec_memlimit"].as<u32>();
     }
+    if(vm.count("seed")) {
+        global_options.seed = vm["seed"].as<u64>();
+    }
     auto log_file = vm["log_file"].as<std::string>();
     if (!log_file.empty()) {
         global_options.log_file = fs::path(std::move(log_file));
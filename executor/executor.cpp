@@ -88,6 +88,50 @@ void Executor::WriteTestInputToFile(const u8 *buf, u32 len) {
     Util::SeekFile(input_fd, 0, SEEK_SET);
 }
 
+std::vector<ExitStatusFeedback> Executor::RunBatch(
+    const std::vector<fuzzuf::executor::BatchInput> &inputs,
+    const BatchCallback &callback,
+    u32 timeout_ms
+) {
+    return RunBatchWithTimeoutUs(inputs, callback, static_cast<u64>(timeout_ms) * 1000);
+}
+
+/*
+ * Postcondition:
+ *  - Each input in inputs is executed by RunBatchInput in order, until callback returns false.
+ *  - callback is called after each execution, while the feedback of the execution is retrievable.
+ *  - FinishBatch is called after the last execution, even if callback throws.
+ *  - The exit statuses of the executed inputs are returned.
+ */
+std::vector<ExitStatusFeedback> Executor::RunBatchWithTimeoutUs(
+    const std::vector<fuzzuf::executor::BatchInput> &inputs,
+    const BatchCallback &callback,
+    u64 timeout_us
+) {
+    std::vector<ExitStatusFeedback> exit_statuses;
+    exit_statuses.reserve(inputs.size());
+
+    try {
+        for (std::size_t i = 0; i < inputs.size(); ++i) {
+            RunBatchInput(inputs[i], timeout_us);
+            exit_statuses.emplace_back(GetExitStatusFeedback());
+
+            if (callback && !callback(i, exit_statuses.back())) break;
+        }
+    } catch (...) {
+        FinishBatch();
+        throw;
+    }
+    FinishBatch();
+
+    return exit_statuses;
+}
+
+void Executor::RunBatchInput(const fuzzuf::executor::BatchInput &input, u64 timeout_us) {
+    // Never kill PUT earlier than requested
+    Run(input.buf, input.len, static_cast<u32>((timeout_us + 999) / 1000));
+}
+
 /*
  * Postcondition:
  *  - When child_pid has valid value,
@@ -0,0 +1,443 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#include "fuzzuf/executor/in_process_executor.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <dlfcn.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "fuzzuf/exceptions.hpp"
+#include "fuzzuf/executor/executor.hpp"
+#include "fuzzuf/executor/sancov_shim.hpp"
+#include "fuzzuf/utils/common.hpp"
+#include "fuzzuf/feedback/inplace_memory_feedback.hpp"
+#include "fuzzuf/feedback/exit_status_feedback.hpp"
+#include "fuzzuf/feedback/put_exit_reason_type.hpp"
+#include "fuzzuf/logger/logger.hpp"
+
+/**
+ * Precondition:
+ *   - path_to_library is a shared object exporting LLVMFuzzerTestOneInput.
+ * Postcondition:
+ *     - Run process below in order, with initializing members
+ *       * Configure shared memory
+ *         - afl_shm_size should indicate the size of shared memory which the harness built with AFL instrumentation uses.
+ *         - bb_shm_size should indicate the size of shared memory to which the 8bit counters of the harness are copied.
+ *         - If both parameters are set to zero, it is considered as unused, and never allocate.
+ *       * Load the harness. The constructors of the harness run in this process.
+ *       * Launch the runner.
+ */
+InProcessExecutor::InProcessExecutor(
+    const fs::path &path_to_library,
+    u32 exec_timelimit_ms,
+    u64 exec_memlimit,
+    const fs::path &path_to_write_input,
+    u32 afl_shm_size,
+    u32  bb_shm_size
+) :
+    Executor( { path_to_library.string() }, exec_timelimit_ms, exec_memlimit, path_to_write_input.string() ),
+    afl_shm_size( afl_shm_size ),
+    bb_shm_size( bb_shm_size ),
+    afl_shmid( INVALID_SHMID ),
+    afl_trace_bits( nullptr ),
+    bb_trace_bits( nullptr ),
+    input_buf( nullptr ),
+    library_handle( nullptr ),
+    test_one_input( nullptr ),
+    initialize( nullptr ),
+    afl_area_ptr( nullptr ),
+    runner_pid( 0 ),
+    runner_fd( -1 ),
+    child_timed_out( false ),
+    last_exit_reason( PUTExitReasonType::FAULT_NONE ),
+    last_signal( 0 )
+{
+    for (const auto &v : argv) {
+        cargv.emplace_back(v.c_str());
+    }
+    cargv.emplace_back(nullptr);
+
+    OpenExecutorDependantFiles();
+
+    // The harness built with AFL instrumentation attaches the shared memory on load.
+    // Therefore, it has to be allocated before the harness is loaded.
+    SetupSharedMemories();
+    LoadLibrary();
+    SetupRunner();
+}
+
+/**
+ * Postcondition:
+ *  - Terminate the runner, then free resources handled by this class.
+ *  - The harness is not unloaded, because its code may still be referred from the counters registered.
+ */
+InProcessExecutor::~InProcessExecutor() {
+    TerminateRunner();
+
+    if (input_fd != -1) {
+        Util::CloseFile(input_fd);
+        input_fd = -1;
+    }
+
+    if (null_fd != -1) {
+        Util::CloseFile(null_fd);
+        null_fd = -1;
+    }
+
+    EraseSharedMemories();
+}
+
+void InProcessExecutor::SetupSharedMemories() {
+    if (afl_shm_size > 0) {
+        afl_shmid = shmget(IPC_PRIVATE, afl_shm_size, IPC_CREAT | IPC_EXCL | 0600);
+        if (afl_shmid < 0) ERROR("shmget() failed");
+
+        afl_trace_bits = (u8 *)shmat(afl_shmid, nullptr, 0);
+        if (afl_trace_bits == (u8 *)-1) ERROR("shmat() failed");
+
+        setenv(AFL_SHM_ENV_VAR, std::to_string(afl_shmid).c_str(), 1);
+    } else {
+        unsetenv(AFL_SHM_ENV_VAR);
+    }
+
+    // Nobody but the runner has to attach these. Anonymous shared mappings are inherited by the runner.
+    if (bb_shm_size > 0) {
+        void *addr = mmap(nullptr, bb_shm_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) ERROR("mmap() failed");
+        bb_trace_bits = static_cast<u8 *>(addr);
+    }
+
+    void *addr = mmap(nullptr, INPUT_MAX_LEN, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED) ERROR("mmap() failed");
+    input_buf = static_cast<u8 *>(addr);
+}
+
+void InProcessExecutor::EraseSharedMemories() {
+    if (afl_shmid != INVALID_SHMID) {
+        if (shmdt(afl_trace_bits) == -1) ERROR("shmdt() failed");
+        afl_trace_bits = nullptr;
+        if (shmctl(afl_shmid, IPC_RMID, 0) == -1) ERROR("shmctl() failed");
+        afl_shmid = INVALID_SHMID;
+    }
+
+    if (bb_trace_bits) {
+        munmap(bb_trace_bits, bb_shm_size);
+        bb_trace_bits = nullptr;
+    }
+
+    if (input_buf) {
+        munmap(input_buf, INPUT_MAX_LEN);
+        input_buf = nullptr;
+    }
+}
+
+/**
+ * Postcondition:
+ *  - The harness at argv[0] is loaded, and test_one_input points LLVMFuzzerTestOneInput.
+ *  - If the harness is built with AFL instrumentation, afl_area_ptr points the pointer to the map it writes.
+ *  - The 8bit counters which belong to the harness are recorded to counter_regions.
+ */
+void InProcessExecutor::LoadLibrary() {
+    library_handle = dlopen(cargv[0], RTLD_NOW | RTLD_LOCAL);
+    if (!library_handle) {
+        // Typically, __sanitizer_cov_* are undefined because the harness is not linked with libfuzzuf-sancov
+        ERROR("Unable to load the harness: %s", dlerror());
+    }
+
+    test_one_input = reinterpret_cast<TestOneInputFunc>(dlsym(library_handle, TEST_ONE_INPUT_SYMBOL));
+    if (!test_one_input) {
+        ERROR("The harness doesn't export %s", TEST_ONE_INPUT_SYMBOL);
+    }
+    // Optional
+    initialize = reinterpret_cast<InitializeFunc>(dlsym(library_handle, INITIALIZE_SYMBOL));
+    afl_area_ptr = reinterpret_cast<u8 **>(dlsym(library_handle, AFL_AREA_PTR_SYMBOL));
+
+    // The counters are registered to libfuzzuf-sancov, which is either a dependency of the harness or preloaded.
+    auto get_counter_regions = reinterpret_cast<FuzzufSancovGetCounterRegionsFunc>(
+        dlsym(library_handle, FUZZUF_SANCOV_GET_COUNTER_REGIONS_SYMBOL));
+    if (!get_counter_regions) {
+        get_counter_regions = reinterpret_cast<FuzzufSancovGetCounterRegionsFunc>(
+            dlsym(RTLD_DEFAULT, FUZZUF_SANCOV_GET_COUNTER_REGIONS_SYMBOL));
+    }
+
+    // If the harness has been loaded by another instance, its counters are registered already, and dlopen doesn't register them again.
+    // Therefore, the counters are picked from all registered ones by the object they belong to.
+    if (get_counter_regions) {
+        Dl_info library_info;
+        if (!dladdr(reinterpret_cast<void *>(test_one_input), &library_info)) {
+            ERROR("Unable to find the harness in the memory");
+        }
+
+        std::size_t count = 0;
+        const auto *regions = get_counter_regions(&count);
+        for (std::size_t i = 0; i < count; i++) {
+            Dl_info info;
+            if (dladdr(regions[i].start, &info) && info.dli_fbase == library_info.dli_fbase) {
+                counter_regions.emplace_back(regions[i].start, regions[i].stop);
+            }
+        }
+    }
+
+    // Otherwise GetBBFeedback would silently report no coverage at all
+    if (bb_shm_size > 0 && counter_regions.empty() && !afl_area_ptr) {
+        ERROR("The harness has registered no 8bit counters. Build it with -fsanitize-coverage=inline-8bit-counters, "
+              "and link it with libfuzzuf-sancov(or load it with LD_PRELOAD)");
+    }
+}
+
+/*
+ * Precondition:
+ *  - The harness is loaded.
+ * Postcondition:
+ *  - A runner process is forked, and its pid and the socket to it are stored to runner_pid and runner_fd.
+ * Note:
+ *  - A socket is used instead of pipes so that both sides can write with MSG_NOSIGNAL.
+ *    A write to a dead peer then fails with EPIPE instead of raising SIGPIPE, without touching the signal dispositions of the process.
+ */
+void InProcessExecutor::SetupRunner() {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv)) ERROR("socketpair() failed");
+
+    runner_pid = fork();
+    if (runner_pid < 0) ERROR("fork() failed");
+
+    if (!runner_pid) {
+        close(sv[0]);
+        // Never returns
+        RunRunner(sv[1]);
+    }
+
+    close(sv[1]);
+    runner_fd = sv[0];
+}
+
+/*
+ * Precondition:
+ *  - This function is called in the process forked by SetupRunner.
+ * Postcondition:
+ *  - On each 4byte request holding the length of the input in input_buf, call LLVMFuzzerTestOneInput with the input.
+ *    Then, copy the 8bit counters to bb_trace_bits, and send 4byte response.
+ *  - The process exits when the socket to the parent process is closed. This function never returns.
+ */
+void InProcessExecutor::RunRunner(int fd) {
+    setsid();
+
+    // The harness may have handlers installed by fuzzuf inherited. Crashes must kill the runner.
+    for (int sig : { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT, SIGINT, SIGTERM, SIGPIPE }) {
+        signal(sig, SIG_DFL);
+    }
+
+    if (exec_memlimit) {
+        struct rlimit r;
+        r.rlim_max = r.rlim_cur = ((rlim_t)exec_memlimit) << 20;
+#ifdef RLIMIT_AS
+        setrlimit(RLIMIT_AS, &r); /* Ignore errors */
+#else
+        setrlimit(RLIMIT_DATA, &r); /* Ignore errors */
+#endif /* ^RLIMIT_AS */
+    }
+
+    dup2(null_fd, 0);
+    dup2(null_fd, 1);
+    dup2(null_fd, 2);
+
+    // The runtime of AFL attached the map of the instance which loaded the harness first. Use ours instead.
+    if (afl_area_ptr && afl_trace_bits) {
+        *afl_area_ptr = afl_trace_bits;
+    }
+
+    if (initialize) {
+        int argc = 1;
+        char **argv_ptr = const_cast<char **>(cargv.data());
+        initialize(&argc, &argv_ptr);
+    }
+
+    std::size_t bb_copy_size = 0;
+    for (const auto &region : counter_regions) {
+        bb_copy_size += region.second - region.first;
+    }
+    if (bb_copy_size > bb_shm_size) bb_copy_size = bb_shm_size;
+
+    // The harness gets a copy of the input, which grows only when a longer input comes.
+    // The input is put at the tail of the buffer, so that reads beyond its end are still detected
+    // as heap overflows, as libFuzzer does by allocating exactly len bytes.
+    std::vector<u8> data;
+
+    while (true) {
+        u32 len;
+        if (recv(fd, &len, 4, MSG_WAITALL) != 4) _exit(0);
+
+        for (const auto &region : counter_regions) {
+            std::memset(region.first, 0, region.second - region.first);
+        }
+
+        if (data.size() < len) {
+            data.reserve(std::max<std::size_t>(len, data.capacity() * 2));
+            data.resize(data.capacity());
+        }
+        u8 *head = data.data() + data.size() - len;
+        std::memcpy(head, input_buf, len);
+        test_one_input(head, len);
+
+        // Concatenate the counters of all modules
+        std::size_t offset = 0;
+        for (const auto &region : counter_regions) {
+            if (offset >= bb_copy_size) break;
+            const std::size_t size = std::min<std::size_t>(region.second - region.first, bb_copy_size - offset);
+            std::memcpy(bb_trace_bits + offset, region.first, size);
+            offset += size;
+        }
+
+        u32 status = 0;
+        if (send(fd, &status, 4, MSG_NOSIGNAL) != 4) _exit(0);
+    }
+}
+
+/**
+ * Precondition:
+ *  - The runner may be running or not.
+ * Postcondition:
+ *  - Close the socket, then kill the runner and reap it.
+ */
+void InProcessExecutor::TerminateRunner() {
+    if (runner_fd != -1) {
+        Util::CloseFile(runner_fd);
+        runner_fd = -1;
+    }
+
+    if (runner_pid > 0) {
+        int status;
+        kill(runner_pid, SIGKILL);
+        waitpid(runner_pid, &status, 0);
+        runner_pid = 0;
+    }
+}
+
+/**
+ * Precondition:
+ *  - The harness is loaded.
+ * Postcondition:
+ *  - LLVMFuzzerTestOneInput is called with buf(truncated to INPUT_MAX_LEN) in the runner.
+ *  - If the runner crashed or exceeded timeout_ms(or exec_timelimit_ms if it is 0), it is terminated.
+ *    A new runner is launched on the next call.
+ *  - afl_trace_bits and bb_trace_bits hold the coverage of the execution. If the runner died, bb_trace_bits is zeroed.
+ */
+void InProcessExecutor::Run(const u8 *buf, u32 len, u32 timeout_ms) {
+    // locked until std::shared_ptr<u8> lock is used in other places
+    while (lock.use_count() > 1) {
+        usleep(100);
+    }
+
+    // if timeout_ms is 0, then we use exec_timelimit_ms;
+    if (timeout_ms == 0) timeout_ms = exec_timelimit_ms;
+    // If exec_timelimit_ms is 0, the harness is never killed for timeout.
+    if (timeout_ms == 0) timeout_ms = std::numeric_limits<int>::max();
+
+    if (runner_pid <= 0) SetupRunner();
+
+    if (afl_shm_size > 0) {
+        std::memset(afl_trace_bits, 0, afl_shm_size);
+    }
+
+    if (len > INPUT_MAX_LEN) len = INPUT_MAX_LEN;
+    std::memcpy(input_buf, buf, len);
+
+    MEM_BARRIER();
+
+    child_timed_out = false;
+    last_exit_reason = PUTExitReasonType::FAULT_NONE;
+    last_signal = 0;
+
+    if (send(runner_fd, &len, 4, MSG_NOSIGNAL) != 4) {
+        ERROR("Unable to send the input to the runner");
+    }
+
+    u32 status = 0;
+    u32 res = Util::ReadFileTimed(runner_fd, &status, 4, timeout_ms);
+    if (res > 0 && res <= timeout_ms) {
+        MEM_BARRIER();
+        return;
+    }
+
+    // The runner is dead or hung. Either way, it is not reusable.
+    if (res > timeout_ms) {
+        kill(runner_pid, SIGKILL);
+        child_timed_out = true;
+    }
+
+    int put_status;
+    if (waitpid(runner_pid, &put_status, 0) <= 0) ERROR("waitpid() failed");
+    runner_pid = 0;
+    TerminateRunner();
+
+    // The counters of the last execution have not been copied
+    if (bb_shm_size > 0) {
+        std::memset(bb_trace_bits, 0, bb_shm_size);
+    }
+
+    if (WIFSIGNALED(put_status)) {
+        last_signal = WTERMSIG(put_status);
+
+        if (child_timed_out && last_signal == SIGKILL)
+            last_exit_reason = PUTExitReasonType::FAULT_TMOUT;
+        else
+            last_exit_reason = PUTExitReasonType::FAULT_CRASH;
+    } else {
+        // The harness must not exit. libFuzzer treats it as a crash as well.
+        last_exit_reason = PUTExitReasonType::FAULT_CRASH;
+    }
+}
+
+InplaceMemoryFeedback InProcessExecutor::GetAFLFeedback() {
+    return InplaceMemoryFeedback(afl_trace_bits, afl_shm_size, lock);
+}
+
+InplaceMemoryFeedback InProcessExecutor::GetBBFeedback() {
+    return InplaceMemoryFeedback(bb_trace_bits, bb_shm_size, lock);
+}
+
+InplaceMemoryFeedback InProcessExecutor::GetStdOut() {
+    return InplaceMemoryFeedback(nullptr, 0, lock);
+}
+
+InplaceMemoryFeedback InProcessExecutor::GetStdErr() {
+    return InplaceMemoryFeedback(nullptr, 0, lock);
+}
+
+ExitStatusFeedback InProcessExecutor::GetExitStatusFeedback() {
+    return ExitStatusFeedback(last_exit_reason, last_signal);
+}
+
+// this function may be called in signal handlers.
+// use only async-signal-safe functions inside.
+// The runner is killed, and reaped in Run() or the destructor.
+void InProcessExecutor::ReceiveStopSignal(void) {
+    if (runner_pid > 0) kill(runner_pid, SIGKILL);
+}
@@ -18,11 +18,16 @@
 #include "fuzzuf/executor/native_linux_executor.hpp"
 #include <chrono>
 #include <cstddef>
+#include <cstring>
 #include <cassert>
 #include <memory>
 #include <optional>
 #include <boost/container/static_vector.hpp>
 #include <sched.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
 
 #include "fuzzuf/algorithms/afl/afl_option.hpp"
 #include "fuzzuf/exceptions.hpp"
@@ -33,15 +38,13 @@
 #include "fuzzuf/utils/is_executable.hpp"
 #include "fuzzuf/utils/interprocess_shared_object.hpp"
 #include "fuzzuf/utils/errno_to_system_error.hpp"
+#include "fuzzuf/utils/huge_page.hpp"
+#include "fuzzuf/utils/numa.hpp"
 #include "fuzzuf/feedback/inplace_memory_feedback.hpp"
 #include "fuzzuf/feedback/exit_status_feedback.hpp"
 #include "fuzzuf/feedback/put_exit_reason_type.hpp"
 #include "fuzzuf/logger/logger.hpp"
 
-bool NativeLinuxExecutor::has_setup_sighandlers = false;
-
-NativeLinuxExecutor* NativeLinuxExecutor::active_instance = nullptr;
-
 /**
  * Precondition:
  *   - A file can be created at path path_str_to_write_input.
@@ -63,7 +66,7 @@ NativeLinuxExecutor* NativeLinuxExecutor::active_instance = nullptr;
  *           * On the other hand, this procedure affects whole the process. In simple word, it requires only 1 executor existing in 1 process.
  *           * As the future work, the class managing CPU cores and executors should be introduced for solving this limitation.
  *           * For the time being, 3 options which cover all situation are provided.
- *       * Configure signal handlers (Temporary workaround for non fork server mode. This will be removed in future.)
+ *       * Configure signal handlers (Ignore SIGTSTP and SIGPIPE)
  *       * Parsing and preprocessing of commandline arguments of PUT.
  *       * Generate a file for sending input to  PUT.
  *       * Configure shared memory
@@ -71,9 +74,45 @@ NativeLinuxExecutor* NativeLinuxExecutor::active_instance = nullptr;
  *         - bb_shm_size should indicate the size of shared memory that is used to record Basic Block Coverage by PUT built using fuzzuf-cc.
  *         - If both parameters are set to zero, it is considered as unused, and never allocate.
  *         - In kernel, Both parameters are round up to multiple of PAGE_SIZE, then memory is allocated.
+ *         - If the fork server reports the size of its coverage map, the AFL-style map is shrunk to it(see afl_map_size).
+ *           If PUT needs a larger map than afl_shm_size, the shared memory is enlarged, and the fork server is restarted.
+ *         - If use_huge_pages is true, the coverage maps are backed by huge pages when the system has reserved them.
+ *         - If this process is bound to a cpu core, the coverage maps are allocated on the NUMA node of the core.
+ *         - In fork server mode, the shared memory to pass inputs is also allocated. It is used only if PUT accepts it in the handshake.
  *       * Configure environment variables for PUT
- *       * If fork server mode, launch fork server.
+ *       * Allocate the fixed size buffers for the outputs recorded with OutputCapturePolicy::Head.
+ *         - The outputs recorded with any policy except Discard are read from pipes in Run().
+ *       * Launch fork server.
+ *         - In fork server mode, the fork server is the one instrumented in PUT.
+ *         - Otherwise, the virtual fork server, a helper process which speaks the same protocol and executes the uninstrumented PUT with fork() and exec(), is launched instead.
+ *       * If persistent_loop_count is not PERSISTENT_MODE_DISABLED, PUT processes are reused for persistent_loop_count inputs at most.
+ *         - Persistent mode is available only in fork server mode.
+ *       * If snapshot_point is SnapshotPoint::Deferred and PUT has DEFER_SIG, the fork server is started at __AFL_INIT().
+ *         - Otherwise, or if the fork server doesn't start at __AFL_INIT(), it is started at the entry of PUT as usual.
  */
+NativeLinuxExecutor::NativeLinuxExecutor(  
+    const std::vector<std::string> &argv,
+    u32 exec_timelimit_ms,
+    u64 exec_memlimit,
+    bool forksrv,
+    const fs::path &path_to_write_input,
+    u32 afl_shm_size,
+    u32  bb_shm_size,
+    int cpuid_to_bind,
+    bool record_stdout_and_err,
+    u32 persistent_loop_count,
+    u32 output_capture_limit,
+    fuzzuf::executor::SnapshotPoint snapshot_point,
+    bool use_huge_pages
+) :
+    NativeLinuxExecutor(
+        argv, exec_timelimit_ms, exec_memlimit, forksrv, path_to_write_input,
+        afl_shm_size, bb_shm_size, cpuid_to_bind,
+        StdOutAndErrCaptures( record_stdout_and_err, output_capture_limit ),
+        persistent_loop_count, snapshot_point, use_huge_pages
+    )
+{}
+
 NativeLinuxExecutor::NativeLinuxExecutor(  
     const std::vector<std::string> &argv,
     u32 exec_timelimit_ms,
@@ -83,26 +122,63 @@ NativeLinuxExecutor::NativeLinuxExecutor(
     u32 afl_shm_size,
     u32  bb_shm_size,
     int cpuid_to_bind,  // FIXME: Add tests against binding(How is it tested?）
-    bool record_stdout_and_err
+    const std::vector<fuzzuf::executor::OutputCapture> &output_captures,
+    u32 persistent_loop_count,
+    fuzzuf::executor::SnapshotPoint snapshot_point,
+    bool use_huge_pages
 ) :
     Executor( argv, exec_timelimit_ms, exec_memlimit, path_to_write_input.string() ),
     forksrv( forksrv ),
     afl_shm_size( afl_shm_size ),
     bb_shm_size( bb_shm_size ),
+    afl_map_size( afl_shm_size ),
+    afl_map_size_negotiated( false ),
+    persistent_loop_count( persistent_loop_count ),
+    output_captures( output_captures ),
+    snapshot_point( snapshot_point ),
+    use_huge_pages( use_huge_pages ),
     binded_cpuid( std::nullopt ),
 
     // cargv and stdin_mode are initialized at SetCArgvAndDecideInputMode
     cpu_core_count( Util::GetCpuCore() ), // This is a temporary implementation. Change the implementation properly if the value need to be specified from user side.
     bb_shmid( INVALID_SHMID ),
     afl_shmid( INVALID_SHMID ),
+    input_shmid( INVALID_SHMID ),
     forksrv_pid( 0 ),
     forksrv_read_fd( -1 ),
     forksrv_write_fd( -1 ),
     bb_trace_bits( nullptr ),
     afl_trace_bits( nullptr ),
+    bb_dirty_regions( bb_shm_size ),
+    afl_dirty_regions( afl_shm_size ),
+    input_shm( nullptr ),
+    uses_shm_input( false ),
     child_timed_out( false ),
-    record_stdout_and_err( record_stdout_and_err )
+    persistent_exec_count( 0 ),
+    persistent_child_killed( false ),
+    deferred_fork_server( false ),
+    exec_seq( 0 ),
+    captured_outputs( output_captures.size() )
 {
+    // In persistent mode, the fork server inside PUT is responsible for resuming the stopped process.
+    // Therefore, there is no way to reuse processes in non fork server mode.
+    if (IsPersistentMode() && !forksrv) {
+        ERROR("Persistent mode requires fork server mode");
+    }
+
+    for (std::size_t i = 0; i < output_captures.size(); ++i) {
+        const auto &capture = output_captures[i];
+        // Capturing the other fds would require moving the fds of the fork server out of the way.
+        if (capture.fd != 1 && capture.fd != 2) {
+            ERROR("Only stdout and stderr can be captured (fd %d)", capture.fd);
+        }
+        if (FindOutputCapture(capture.fd) != static_cast<int>(i)) {
+            ERROR("fd %d is captured twice", capture.fd);
+        }
+        if (capture.policy == fuzzuf::executor::OutputCapturePolicy::Head && capture.limit == 0) {
+            ERROR("The limit of the output of fd %d must not be zero", capture.fd);
+        }
+    }
 
 #ifdef __linux__
     // If cpuid_to_bind is not CPUID_DO_NOT_BIND,
@@ -142,43 +218,47 @@ NativeLinuxExecutor::NativeLinuxExecutor(
     }
 #endif /* __linux__ */
 
-    if (!has_setup_sighandlers) {
-	// For the time being, as signal handler is set globally, this function is static method, therefore it is not needed to set again if has_setup_handlers is ture.
-        SetupSignalHandlers();
-        has_setup_sighandlers = true;
-    }
-    // Assign self address to static pointer to make signal handlers can refer.
-    // active_instance may refer other instance if multiple NativeLinuxExecutor exist, therefore following assertion is not appliable.
-    // assert(active_instance == nullptr);
-    active_instance = this;
+    // The dispositions set here are the same for all instances and no instance is referred from signal handlers.
+    // Therefore, it is harmless to set them every time an instance is created, even from multiple threads.
+    SetupSignalHandlers();
 
     SetCArgvAndDecideInputMode();
     OpenExecutorDependantFiles();
 
+    // The uninstrumented PUT launched by the virtual fork server can't be snapshotted.
+    if (snapshot_point == fuzzuf::executor::SnapshotPoint::Deferred) {
+        if (!forksrv) {
+            DEBUG("Deferred fork server is unavailable in non fork server mode");
+        } else if (!HasDeferredForkServerSignature(cargv[0])) {
+            DEBUG("%s doesn't use __AFL_INIT(). The fork server is started at the entry", cargv[0]);
+        } else {
+            deferred_fork_server = true;
+        }
+    }
+
     // Allocate shared memory on initialization of Executor
     // It is sufficient if each NativeLinuxExecutor::Run() can refer the memory
     SetupSharedMemories();
     SetupEnvironmentVariablesForTarget();
 
-    if (forksrv) {
-        SetupForkServer();
+    // The buffers are allocated once, and reused in all executions.
+    for (std::size_t i = 0; i < output_captures.size(); ++i) {
+        if (output_captures[i].policy == fuzzuf::executor::OutputCapturePolicy::Head) {
+            captured_outputs[i].head.reset(new fuzzuf::utils::BoundedOutputBuffer(output_captures[i].limit));
+        }
     }
+
+    // Both modes share the same protocol with PUT, and thereby the same code path in Run().
+    SetupForkServer();
 }
 
 /**
  * Postcondition:
  *  - Free resources handled by this class, then invalidate data.
  *      - Close input_fd file descriptor. then the value is invalidated (fail-safe)
- *      - If running in fork server mode, close the pipes for communicating with fork server, then terminate fork server process.
- *  - Temporary purpose: If actve_instance which signal handlers refer has a pointer to self value, assign nullptr to it and invalidate.
+ *      - Close the pipes for communicating with fork server(or virtual fork server), then terminate fork server process.
  */
 NativeLinuxExecutor::~NativeLinuxExecutor() {
-    // Since active_instance can refer another instance of multiple N, it is considered FuzzerHandle::Reset is called if active_instance is not self value, therefore do nothing. On the other hand, assign nullptr if active_instance is self value.
-    // Although, assigning nullptr just in case, since the handlers will never called when the destructor is called, it is basically not a problem.
-    if (active_instance == this) {
-        active_instance = nullptr;
-    }
-
     if (input_fd != -1) {
         Util::CloseFile(input_fd);
         input_fd = -1;
@@ -191,11 +271,9 @@ NativeLinuxExecutor::~NativeLinuxExecutor() {
 
     EraseSharedMemories();
 
-    if (forksrv) {
-        TerminateForkServer();
-        // Although, PUT process should be handled by fork server, kill it just in case. (Since fork server is expected to be killed using kill, therefore it will never becoome a zombie. So never wait.)
-        KillChildWithoutWait();
-    }
+    TerminateForkServer();
+    // Although, PUT process should be handled by fork server, kill it just in case. (Since fork server is expected to be killed using kill, therefore it will never becoome a zombie. So never wait.)
+    KillChildWithoutWait();
 }
 
 void NativeLinuxExecutor::SetCArgvAndDecideInputMode() {
@@ -231,6 +309,11 @@ void NativeLinuxExecutor::TerminateForkServer() {
         fork_server_epoll_fd = -1;
     }
 
+    if (fork_server_timer_fd != -1) {
+        close( fork_server_timer_fd );
+        fork_server_timer_fd = -1;
+    }
+
     if (forksrv_read_fd != -1) {
         Util::CloseFile(forksrv_read_fd);
         forksrv_read_fd = -1;
@@ -241,14 +324,11 @@ void NativeLinuxExecutor::TerminateForkServer() {
         forksrv_write_fd = -1;
     }
 
-    if (fork_server_stdout_fd != -1) {
-        close( fork_server_stdout_fd );
-        fork_server_stdout_fd = -1;
-    }
-    
-    if (fork_server_stderr_fd != -1) {
-        close( fork_server_stderr_fd );
-        fork_server_stderr_fd = -1;
+    for (auto &captured : captured_outputs) {
+        if (captured.pipe_fd != -1) {
+            close( captured.pipe_fd );
+            captured.pipe_fd = -1;
+        }
     }
 
 
@@ -260,34 +340,13 @@ void NativeLinuxExecutor::TerminateForkServer() {
     }
 }
 
-/**
- * An static method
- * Precondition:
- *  - active_instance has a non-nullptr value definitely when this function is called.
- *  - active_instance has an address of valid Executor instance.
- *  - The global timer exists in the self process, and the function is called for SIGALRM signal.
- * Postcondition:
- *  - The function works as signal handler for SIGALRM
- *      - If called, the PUT is considered as expiring the execution time, therefore kill active_instance->child_pid.
- *      - Set a flag active_instance->child_timed_out
- */
-void NativeLinuxExecutor::AlarmHandler(int signum) {
-    assert (signum == SIGALRM);
-    assert (active_instance != nullptr);
-    active_instance->KillChildWithoutWait();
-    active_instance->child_timed_out = true;
-}
-
 /*
  * An static method
  * Postcondition:
  *  - It defines how the fuzzuf process respond to signals.
  *  - If signal handlers are needed, signal handlers are set.
- * FIXME: Since the configuration on signal handlers is shared in whole process,
- * it affects all fuzzuf instances running on the process.
- * As the result, it requires change of process design in some cases,
- * Therefore, the process design may be changed, 
- * yet currently the static function is implemented under the expection that only one fuzzuf instance is used simultaneously.
+ *  - Only SIG_IGN is set, so that no signal handler depends on a specific instance.
+ *    Timeouts are detected by each instance without signals.
  */
 void NativeLinuxExecutor::SetupSignalHandlers() {
     struct sigaction sa;
@@ -322,9 +381,6 @@ void NativeLinuxExecutor::SetupSignalHandlers() {
     sa.sa_handler = SIG_IGN;
     sigaction(SIGTSTP, &sa, NULL);
     sigaction(SIGPIPE, &sa, NULL);
-
-    sa.sa_handler = NativeLinuxExecutor::AlarmHandler;
-    sigaction(SIGALRM, &sa, NULL);
 }
 
 namespace detail {
@@ -355,6 +411,25 @@ namespace detail {
             dest.resize( cur_size + read_stat );
         return read_stat != 0;
     }
+
+    // Same as read_chunk, except that only the hash of the chunk is kept
+    bool hash_chunk( std::uint64_t &hash, int fd ) {
+        std::array< std::uint8_t, fuzzuf::executor::output_block_size > chunk;
+        auto read_stat = read( fd, chunk.data(), chunk.size() );
+        if( read_stat < 0 ) {
+            int e = errno;
+            if( e == EAGAIN || e == EWOULDBLOCK )
+                return false;
+            else if( !( e == EINTR ) )
+                throw fuzzuf::utils::errno_to_system_error(
+                    e,
+                    "read from child process failed during the execution"
+                );
+        }
+        else
+            hash = fuzzuf::executor::UpdateOutputHash( hash, chunk.data(), read_stat );
+        return read_stat != 0;
+    }
 }
 
 /**
@@ -362,6 +437,7 @@ namespace detail {
  *  - input_fd has a file descriptor that is set by NativeLinuxExecutor::SetupIO()
  * Postcondition:
  *  - (1) The contents of file refered by input_fd matches to fuzz ( the contents of buf with length of len )
+ *      - As the exception, if uses_shm_input is true, the contents of input_shm matches to fuzz instead, and the file is not updated.
  *  - (2) To execute process that satisfies following requirements ( process that satisfies them is notated as "competent process" ).
  *      - Providing command and commandline arguments specified by constructor argument argv.
  *      - Environment variables satisfy following condition:
@@ -370,6 +446,7 @@ namespace detail {
  *      - TODO: Specify the requirements of environemnt variables (Items on instrument tool. Currently, only major things are mentioned, as so that can increase for implementing new features. )
  *      - If Executor::stdin_mode is true, use input_fd as a standard input.
  *    (3) Competent process stops execution after the time specified by timeout_ms. As the exception, if the value is 0, the time limit is determined using member variable exec_timelimit_ms.
+ *      - RunWithTimeoutUs is the same except that the time limit is specified in microseconds.
  *    (4) When the method exits, it is triggered by self or third-party signals.
  *    (5) Assign process ID of competent process to child_pid
  *      - This postcondition is needed for third-party to exit competent process
@@ -378,22 +455,32 @@ namespace detail {
  */
 
 void NativeLinuxExecutor::Run(const u8 *buf, u32 len, u32 timeout_ms) {
+    RunWithTimeoutUs(buf, len, static_cast<u64>(timeout_ms) * 1000);
+}
+
+void NativeLinuxExecutor::RunWithTimeoutUs(const u8 *buf, u32 len, u64 timeout_us) {
     // locked until std::shared_ptr<u8> lock is used in other places
     while (lock.use_count() > 1) {
         usleep(100);
     }
 
-    // if timeout_ms is 0, then we use exec_timelimit_ms;
-    if (timeout_ms == 0) timeout_ms = exec_timelimit_ms;
+    // if timeout_us is 0, then we use exec_timelimit_ms;
+    if (timeout_us == 0) timeout_us = static_cast<u64>(exec_timelimit_ms) * 1000;
 
     // Aliases
     ResetSharedMemories();
-    if (record_stdout_and_err) {
-        stdout_buffer.clear();
-        stderr_buffer.clear();
+    for (auto &captured : captured_outputs) {
+        if (captured.head) captured.head->Rewind();
+        captured.buffer.clear();
+        captured.hash = fuzzuf::executor::output_hash_seed;
     }
 
-    WriteTestInputToFile(buf, len);
+    // If PUT supports, pass the input via the shared memory to avoid the syscalls to update the file.
+    if (uses_shm_input) {
+        WriteTestInputToSharedMemory(buf, len);
+    } else {
+        WriteTestInputToFile(buf, len);
+    }
 
     //#if 0
     // TODO: Since the information priority is Trace level that is less important than Debug, it should be hidden when runlevel is Debug.
@@ -403,303 +490,144 @@ void NativeLinuxExecutor::Run(const u8 *buf, u32 len, u32 timeout_ms) {
     DEBUG("\n")
     //#endif
 
-    // This structure is shared by both parent process and child process.
-    // Since execv never returns on success, it is initialized as success(0), then set value on failed.
-    auto child_state = fuzzuf::utils::interprocess::create_shared_object(
-      fuzzuf::executor::ChildState{ 0, 0 }
-    );
+    // In non fork server mode, the virtual fork server fills child_state for this execution.
+    exec_seq++;
 
-    std::array< int, 2u > stdout_fd{ 0, 0 };
-    std::array< int, 2u > stderr_fd{ 0, 0 };
     constexpr std::size_t read_size = 8u;
     boost::container::static_vector< std::uint8_t, read_size > read_buffer;
     bool timeout = true;
-    if (forksrv) {
-	// The value tmp which is needed only on persistent mode that is currently not implemented.
-        static u8 tmp[4];
 
-	// Request creating PUT process to fork server
-        // The new PUT execution can be requested to the fork server by writing 4byte values to the pipe.
-        // If the PUT launched successfully, the pid of PUT process is returned via the pipe.
-        // WriteFile, ReadFile throw exception if writing or reading couldn't consume specified bytes.
-        try {
-            // FIXME: When persistent mode is implemented, this tmp must be set to the value that represent if the last execution failed for timeout.
-            Util::WriteFile(forksrv_write_fd, tmp, 4);
-
-            read_buffer.resize( 4u );
-            Util::ReadFile( forksrv_read_fd, read_buffer.data(), 4u, false );
-
-            epoll_event event;
-            auto left_ms = timeout_ms;
-            while (left_ms > 0) {
-                const auto begin_date = std::chrono::steady_clock::now();
-                auto event_count = epoll_wait( fork_server_epoll_fd, &event, 1, left_ms );
-                if ( event_count < 0 ) {
-                    int e = errno;
-                    if( e != EINTR )
-                        throw fuzzuf::utils::errno_to_system_error(
-                                e,
-                                "epoll_wait failed during the execution"
-                              );
-                }
-                else if( event_count == 0 ) break;
-                else {
-                    if ( event.events & EPOLLIN ) {
-                        if ( event.data.fd == fork_server_stdout_fd )
-                            // Although the buffer may contain data larger than output_block_size, that is not a problem as it is level trigger.
-                            detail::read_chunk( stdout_buffer, fork_server_stdout_fd );
-                        else if( event.data.fd == fork_server_stderr_fd )
-                            // Although the buffer may contain data larger than output_block_size, that is not a problem as it is level trigger.
-                            detail::read_chunk( stderr_buffer, fork_server_stderr_fd );
-                        else if ( event.data.fd == forksrv_read_fd ) {
-                            std::size_t cur_size = read_buffer.size();
-                            read_buffer.resize( read_size );
-                            auto read_stat = read(
-                                    forksrv_read_fd,
-                                    std::next( read_buffer.data(), cur_size ),
-                                    read_size - cur_size
-                                 );
-                            if ( read_stat < 0 ) {
-                                int e = errno;
-                                if ( !( e == EAGAIN || e == EINTR || e == EWOULDBLOCK ) )
-                                    throw fuzzuf::utils::errno_to_system_error(
-                                            e,
-                                            "read pid from child process failed during the execution"
-                                          );
-                            } else {
-                                read_buffer.resize( cur_size + read_stat );
-                                if ( read_buffer.size() == read_size ) {
-                                    left_ms = 0;
-                                    timeout = false;
-                                }
+    child_timed_out = false;
+
+    // The 4byte value sent to the fork server tells whether fuzzuf killed the PUT process of the last execution.
+    // In persistent mode, the fork server reaps the stopped process and forks a new one if the value is non-zero.
+    // Otherwise, it resumes the stopped process to handle the next input. Non persistent fork servers ignore the value.
+    u32 was_killed = persistent_child_killed ? 1 : 0;
+    persistent_child_killed = false;
+
+    // Request creating PUT process to fork server(or virtual fork server in non fork server mode)
+    // The new PUT execution can be requested to the fork server by writing 4byte values to the pipe.
+    // If the PUT launched successfully, the pid of PUT process is returned via the pipe.
+    // WriteFile, ReadFile throw exception if writing or reading couldn't consume specified bytes.
+    try {
+        Util::WriteFile(forksrv_write_fd, &was_killed, 4);
+
+        read_buffer.resize( 4u );
+        Util::ReadFile( forksrv_read_fd, read_buffer.data(), 4u, false );
+
+        // If exec_timelimit_ms is 0, PUT is never killed for timeout.
+        // Otherwise, the timerfd in the epoll set expires at the deadline. Unlike the timeout of epoll_wait,
+        // it has the precision of the microseconds and doesn't have to be recomputed after each wakeup.
+        const bool has_timelimit = timeout_us != 0;
+        if (has_timelimit || fork_server_timer_armed) SetForkServerTimer(timeout_us);
+
+        epoll_event event;
+        while (true) {
+            auto event_count = epoll_wait( fork_server_epoll_fd, &event, 1, -1 );
+            if ( event_count < 0 ) {
+                int e = errno;
+                if( e != EINTR )
+                    throw fuzzuf::utils::errno_to_system_error(
+                            e,
+                            "epoll_wait failed during the execution"
+                          );
+            }
+            else if ( event.data.fd == fork_server_timer_fd ) break;
+            else {
+                if ( event.events & EPOLLIN ) {
+                    if ( event.data.fd != forksrv_read_fd ) {
+                        // The other fds registered are the pipes of captured_outputs.
+                        // Although the buffer may contain data larger than output_block_size, that is not a problem as it is level trigger.
+                        for ( std::size_t i = 0; i < captured_outputs.size(); ++i )
+                            if ( captured_outputs[ i ].pipe_fd == event.data.fd )
+                                ReadCapturedOutput( i );
+                    }
+                    else {
+                        std::size_t cur_size = read_buffer.size();
+                        read_buffer.resize( read_size );
+                        auto read_stat = read(
+                                forksrv_read_fd,
+                                std::next( read_buffer.data(), cur_size ),
+                                read_size - cur_size
+                             );
+                        if ( read_stat < 0 ) {
+                            read_buffer.resize( cur_size );
+                            int e = errno;
+                            if ( !( e == EAGAIN || e == EINTR || e == EWOULDBLOCK ) )
+                                throw fuzzuf::utils::errno_to_system_error(
+                                        e,
+                                        "read pid from child process failed during the execution"
+                                      );
+                        } else {
+                            read_buffer.resize( cur_size + read_stat );
+                            if ( read_buffer.size() == read_size ) {
+                                timeout = false;
+                                break;
                             }
                         }
                     }
-                    if( event.events == EPOLLHUP || event.events == EPOLLERR )
-                        ERROR("pipe to the child process was unexpectedly closed");
                 }
-                const auto end_date = std::chrono::steady_clock::now();
-                const auto elapsed = std::chrono::duration_cast< std::chrono::milliseconds >( end_date - begin_date ).count();
-                if ( left_ms < elapsed ) left_ms = 0;
-                else left_ms -= elapsed;
+                if( event.events == EPOLLHUP || event.events == EPOLLERR )
+                    ERROR("pipe to the child process was unexpectedly closed");
             }
-        } catch(const FileError &e) {
-            ERROR("Unable to request new process from fork server (OOM?)");
         }
-        if( read_buffer.size() >= 4u )
-            child_pid = *reinterpret_cast< std::uint32_t* >( read_buffer.data() );
 
-        if (child_pid <= 0) ERROR("Fork server is misbehaving (OOM?)");
-    } else {
-        if (record_stdout_and_err) {
-            if ( pipe( stdout_fd.data() ) < 0 ) {
-                throw fuzzuf::utils::errno_to_system_error(
-                        errno,
-                        "Unable to create stdout pipe"
-                      );
-            }
-            if ( pipe( stderr_fd.data() ) < 0 ) {
-                throw fuzzuf::utils::errno_to_system_error(
-                        errno,
-                        "Unable to create stderr pipe"
-                      );
-            }
-        }
-
-        child_pid = Util::Fork();
-        if (child_pid < 0) ERROR("fork() failed");
-
-        if (!child_pid) {
-            struct rlimit r;
-            if (exec_memlimit) {
-                r.rlim_max = r.rlim_cur = ((rlim_t)exec_memlimit) << 20;
-#ifdef RLIMIT_AS
-                setrlimit(RLIMIT_AS, &r); /* Ignore errors */
-#else
-                setrlimit(RLIMIT_DATA, &r); /* Ignore errors */
-#endif /* ^RLIMIT_AS */
-            }
-
-            r.rlim_max = r.rlim_cur = 0;
-
-            setrlimit(RLIMIT_CORE, &r); /* Ignore errors */
-
-            /* Isolate the process and configure standard descriptors. If out_file is
-               specified, stdin is /dev/null; otherwise, out_fd is cloned instead. */
-            setsid();
-
-            if (record_stdout_and_err) {
-                dup2(stdout_fd[ 1 ], 1);
-                dup2(stderr_fd[ 1 ], 2);
-                close( stdout_fd[ 0 ] );
-                close( stdout_fd[ 1 ] );
-                close( stderr_fd[ 0 ] );
-                close( stderr_fd[ 1 ] );
-            } else {
-                dup2(null_fd, 1);
-                dup2(null_fd, 2);
-            }
-
-            if (stdin_mode) {
-                dup2(input_fd, 0);
-            } else {
-		// stdin is bound to /dev/null ( Providing "nothing" as input ).
-                dup2(null_fd, 0);
-            }
-            // Execute new executable binary on the child process.
-	    // If failed, that matter is recorded to child_state.
-            child_state->exec_result = execv(cargv[0], (char**)cargv.data());
-            child_state->exec_errno = errno;
-
-            /* Use a distinctive bitmap value to tell the parent about execv()
-               falling through. */
-
-            exit(0);
-        }
+        // Disarming also clears the expiration, so the timer is not seen in the next execution.
+        // In a batch, the next input arms the timer again, which clears the expiration as well.
+        if (has_timelimit && !in_batch) SetForkServerTimer(0);
+    } catch(const FileError &e) {
+        ERROR("Unable to request new process from fork server (OOM?)");
     }
+    if( read_buffer.size() >= 4u )
+        child_pid = *reinterpret_cast< std::uint32_t* >( read_buffer.data() );
 
-    int put_status; // PUT's status(retrieved via waitpid)
-    if (forksrv) {
-        if( timeout ) { // The execution time may exceeded due to input that causes hanging was passed.
-            KillChildWithoutWait(); // After killing PUT that timed out, retrive put_status from fork server again.
-            child_timed_out = true;
-        }
-
-        if( read_buffer.size() < 8u ) {
-            std::size_t cur_size = read_buffer.size();
-            read_buffer.resize( read_size );
-            Util::ReadFile(
-                    forksrv_read_fd,
-                    std::next( read_buffer.data(), cur_size ),
-                    read_size - cur_size,
-                    false
-            );
-        }
+    if (child_pid <= 0) ERROR("Fork server is misbehaving (OOM?)");
 
-        if (record_stdout_and_err) {
-            while( detail::read_chunk( stdout_buffer, fork_server_stdout_fd ) );
-            while( detail::read_chunk( stderr_buffer, fork_server_stderr_fd ) );
-        }
+    int put_status; // PUT's status(retrieved via waitpid in the fork server)
+    if( timeout ) { // The execution time may exceeded due to input that causes hanging was passed.
+        KillChildWithoutWait(); // After killing PUT that timed out, retrive put_status from fork server again.
+        child_timed_out = true;
+    }
 
-        if( read_buffer.size() >= 8u )
-            put_status = *reinterpret_cast< std::uint32_t* >( std::next( read_buffer.data(), 4u ) );
-        else
-            ERROR("Unable to communicate with fork server (OOM?)");
-    } else {
-	// Initialize a flag that indicate whether the PUT hanged.
-	// It is set in the signal handler.
-        child_timed_out = false;
-
-        static struct itimerval it;
-
-	// Set timer to make SIGALRM to be sent on timeout.
-	// The handler for SIGALRM is set to NativeLinuxExecutor::AlarmHandler, and the PUT is killed in inside.
-	// Yet SIGALRM is not set if exec_timelimit_ms is set to 0.
-        if (exec_timelimit_ms) {        
-            it.it_value.tv_sec = (timeout_ms / 1000);
-            it.it_value.tv_usec = (timeout_ms % 1000) * 1000;
-            setitimer(ITIMER_REAL, &it, NULL);
-        }
+    if( read_buffer.size() < 8u ) {
+        std::size_t cur_size = read_buffer.size();
+        read_buffer.resize( read_size );
+        Util::ReadFile(
+                forksrv_read_fd,
+                std::next( read_buffer.data(), cur_size ),
+                read_size - cur_size,
+                false
+        );
+    }
 
-        // If record_stdout_and_err is true, here starts the loop for saving outputs to buffers.
-        if (record_stdout_and_err) {
-            close( stdout_fd[ 1 ] );
-            close( stderr_fd[ 1 ] );
-
-            auto epoll_fd = epoll_create( 1 );
-            epoll_event stdout_event;
-            stdout_event.data.fd = stdout_fd[ 0 ];
-            stdout_event.events = EPOLLIN|EPOLLRDHUP;
-            if( epoll_ctl(
-                        epoll_fd,
-                        EPOLL_CTL_ADD,
-                        stdout_fd[ 0 ],
-                        &stdout_event
-                ) < 0 ) {
-    
-                throw fuzzuf::utils::errno_to_system_error(
-                        errno,
-                        "Unable to epoll stdout pipe"
-                        );
-            }
-    
-            epoll_event stderr_event;
-            stderr_event.data.fd = stderr_fd[ 0 ];
-            stderr_event.events = EPOLLIN|EPOLLRDHUP;
-            if( epoll_ctl(
-                        epoll_fd,
-                        EPOLL_CTL_ADD,
-                        stderr_fd[ 0 ],
-                        &stderr_event
-                ) < 0 ) {
-                
-                throw fuzzuf::utils::errno_to_system_error(
-                        errno,
-                        "Unable to epoll stdout pipe"
-                        );
-            }
-    
-            epoll_event event;
-            auto left_ms = timeout_ms;
-            unsigned int closed_count = 0u;
-            fcntl( stdout_fd[ 0 ], F_SETFL, O_NONBLOCK );
-            fcntl( stderr_fd[ 0 ], F_SETFL, O_NONBLOCK );
-            while (left_ms > 0) {
-                const auto begin_date = std::chrono::steady_clock::now();
-                auto event_count = epoll_wait( epoll_fd, &event, 1, left_ms );
-                if( event_count < 0 ) {
-                    int e = errno;
-                    if( e != EINTR ) {
-                        throw fuzzuf::utils::errno_to_system_error(
-                                e,
-                                "epoll_wait failed during the execution"
-                                );
-                    }
-                }
-                else if( event_count == 0 ) break;
-                else {
-                    if( event.events & EPOLLIN ) {
-                        if( event.data.fd == stdout_fd[ 0 ] )
-                            // Although the buffer may contain data larger than output_block_size, that is not a problem as it is level trigger.
-                            detail::read_chunk( stdout_buffer, stdout_fd[ 0 ] );
-                        else if( event.data.fd == stderr_fd[ 0 ] )
-                            // Although the buffer may contain data larger than output_block_size, that is not a problem as it is level trigger.
-                            detail::read_chunk( stderr_buffer, stderr_fd[ 0 ] );
-                    }
-                    if( event.events == EPOLLHUP || event.events == EPOLLERR ) {
-                        ++closed_count;
-                        if( closed_count == 2u )
-                            break;
-                    }
-                }
-                const auto end_date = std::chrono::steady_clock::now();
-                const auto elapsed = std::chrono::duration_cast< std::chrono::milliseconds >( end_date - begin_date ).count();
-                if( left_ms < elapsed ) left_ms = 0;
-                else left_ms -= elapsed;
-            }
-            close( epoll_fd );
+    for (std::size_t i = 0; i < captured_outputs.size(); ++i) {
+        if (captured_outputs[i].pipe_fd != -1) {
+            while( ReadCapturedOutput( i ) );
         }
+    }
 
-        if (waitpid(child_pid, &put_status, 0) <= 0) ERROR("waitpid() failed");
-
-        if (record_stdout_and_err) {
-            bool cont = true;
-            while( cont ) {
-                cont = detail::read_chunk( stdout_buffer, stdout_fd[ 0 ] );
-            }
-            cont = true;
-            while( cont ) {
-                cont = detail::read_chunk( stderr_buffer, stderr_fd[ 0 ] );
+    if( read_buffer.size() >= 8u )
+        put_status = *reinterpret_cast< std::uint32_t* >( std::next( read_buffer.data(), 4u ) );
+    else
+        ERROR("Unable to communicate with fork server (OOM?)");
+
+    if (IsPersistentMode()) {
+        // The process killed for timeout has to be reaped by the fork server before it forks a new one.
+        persistent_child_killed = child_timed_out;
+
+        if (WIFSTOPPED(put_status)) {
+            // The PUT process finished one iteration of __AFL_LOOP() and raised SIGSTOP to wait for the next input.
+            // Once it has handled persistent_loop_count inputs, kill it to get a fresh process in the next execution.
+            // This prevents the states leaking across iterations(e.g. memory leaks) from accumulating forever.
+            persistent_exec_count++;
+            if (persistent_exec_count >= persistent_loop_count) {
+                KillChildWithoutWait();
+                persistent_child_killed = true;
+                persistent_exec_count = 0;
             }
-            close( stdout_fd[ 0 ] );
-            close( stderr_fd[ 0 ] );
-        }
-
-	// Reset the timer.
-        if (exec_timelimit_ms) {
-            it.it_value.tv_sec = 0;
-            it.it_value.tv_usec = 0;
-            setitimer(ITIMER_REAL, &it, NULL);
+        } else {
+            // The PUT process exited, crashed or timed out. The fork server spawns a new one in the next execution.
+            persistent_exec_count = 0;
         }
     }
 
@@ -718,8 +646,11 @@ void NativeLinuxExecutor::Run(const u8 *buf, u32 len, u32 timeout_ms) {
 
     u32 tb4 = 0;
 
+    if ( !forksrv && child_state->seq != exec_seq )
+        ERROR("Virtual fork server is out of sync");
+
     // Consider execution was failed if execv of child process failed.
-    if ( child_state->exec_result < 0 )
+    if ( !forksrv && child_state->exec_result < 0 )
         tb4 = EXEC_FAIL_SIG;
 
     last_exit_reason = PUTExitReasonType::FAULT_NONE;
@@ -754,8 +685,23 @@ void NativeLinuxExecutor::Run(const u8 *buf, u32 len, u32 timeout_ms) {
     return;
 }
 
+/*
+ * Postcondition:
+ *  - The same as RunWithTimeoutUs(input.buf, input.len, timeout_us), except that the timer is left armed.
+ *    Arming it for the next input resets it, so the expiration of this input is never seen by the next one.
+ */
+void NativeLinuxExecutor::RunBatchInput(const fuzzuf::executor::BatchInput &input, u64 timeout_us) {
+    in_batch = true;
+    RunWithTimeoutUs(input.buf, input.len, timeout_us);
+}
+
+void NativeLinuxExecutor::FinishBatch() {
+    in_batch = false;
+    if (fork_server_timer_armed) SetForkServerTimer(0);
+}
+
 InplaceMemoryFeedback NativeLinuxExecutor::GetAFLFeedback() {
-    return InplaceMemoryFeedback(afl_trace_bits, afl_shm_size, lock);
+    return InplaceMemoryFeedback(afl_trace_bits, afl_map_size, lock);
 }
 
 InplaceMemoryFeedback NativeLinuxExecutor::GetBBFeedback() {
@@ -763,45 +709,131 @@ InplaceMemoryFeedback NativeLinuxExecutor::GetBBFeedback() {
 }
 
 InplaceMemoryFeedback NativeLinuxExecutor::GetStdOut() {
-    return InplaceMemoryFeedback( stdout_buffer.data(), stdout_buffer.size(), lock);
+    return GetOutput( 1 );
 }
 
 InplaceMemoryFeedback NativeLinuxExecutor::GetStdErr() {
-    return InplaceMemoryFeedback( stderr_buffer.data(), stderr_buffer.size(), lock);
+    return GetOutput( 2 );
+}
+
+InplaceMemoryFeedback NativeLinuxExecutor::GetOutput(int fd) {
+    const int index = FindOutputCapture( fd );
+    if (index < 0) {
+        return InplaceMemoryFeedback( nullptr, 0, lock );
+    }
+
+    auto &captured = captured_outputs[ index ];
+    if (captured.head) {
+        return InplaceMemoryFeedback( captured.head->GetData(), captured.head->GetSize(), lock );
+    }
+    return InplaceMemoryFeedback( captured.buffer.data(), captured.buffer.size(), lock );
+}
+
+u64 NativeLinuxExecutor::GetOutputHash(int fd) {
+    const int index = FindOutputCapture( fd );
+    if (index < 0 || output_captures[ index ].policy == fuzzuf::executor::OutputCapturePolicy::Discard) {
+        ERROR("The output of fd %d is not recorded", fd);
+    }
+
+    const auto &captured = captured_outputs[ index ];
+    if (output_captures[ index ].policy == fuzzuf::executor::OutputCapturePolicy::HashOnly) {
+        return captured.hash;
+    }
+    if (captured.head) {
+        return fuzzuf::executor::UpdateOutputHash(
+            fuzzuf::executor::output_hash_seed, captured.head->GetData(), captured.head->GetSize()
+        );
+    }
+    return fuzzuf::executor::UpdateOutputHash(
+        fuzzuf::executor::output_hash_seed, captured.buffer.data(), captured.buffer.size()
+    );
 }
 
 ExitStatusFeedback NativeLinuxExecutor::GetExitStatusFeedback() {
     return ExitStatusFeedback(last_exit_reason, last_signal);
 }
 
+// Arm the timer of fork_server_epoll_fd to expire after timeout_us. 0 disarms it.
+void NativeLinuxExecutor::SetForkServerTimer(u64 timeout_us) {
+    itimerspec it{};
+    it.it_value.tv_sec = timeout_us / 1000000;
+    it.it_value.tv_nsec = ( timeout_us % 1000000 ) * 1000;
+    if (timerfd_settime( fork_server_timer_fd, 0, &it, nullptr ) < 0) {
+        throw fuzzuf::utils::errno_to_system_error(
+                errno,
+                "Unable to set timerfd"
+              );
+    }
+    fork_server_timer_armed = timeout_us != 0;
+}
+
 // Initialize shared memory group that the PUT writes the coverage.
 // These shared memory is reused for all PUTs (It is too slow to allocate for each PUT).
 void NativeLinuxExecutor::SetupSharedMemories() {
     if (afl_shm_size > 0) {
-        afl_shmid = shmget(IPC_PRIVATE, afl_shm_size, IPC_CREAT | IPC_EXCL | 0600);
-        if (afl_shmid < 0) ERROR("shmget() failed");
-
-        afl_trace_bits = (u8 *)shmat(afl_shmid, nullptr, 0);
-        if (afl_trace_bits == (u8 *)-1) ERROR("shmat() failed");
+        afl_trace_bits = AttachMapSharedMemory(afl_shmid, afl_shm_size);
     }
 
     if (bb_shm_size > 0) {
-        bb_shmid = shmget(IPC_PRIVATE, bb_shm_size, IPC_CREAT | IPC_EXCL | 0600);
-        if (bb_shmid < 0) ERROR("shmget() failed");
+        bb_trace_bits = AttachMapSharedMemory(bb_shmid, bb_shm_size);
+    }
+
+    // Only fork servers built with AFL++ can receive inputs via the shared memory.
+    // Whether it is actually used is decided in the handshake of the fork server.
+    if (forksrv) {
+        input_shmid = shmget(IPC_PRIVATE, sizeof(u32) + INPUT_SHM_MAX_LEN, IPC_CREAT | IPC_EXCL | 0600);
+        if (input_shmid < 0) ERROR("shmget() failed");
 
-        bb_trace_bits = (u8 *)shmat(bb_shmid, nullptr, 0);
-        if (bb_trace_bits == (u8 *)-1) ERROR("shmat() failed");
+        input_shm = (u8 *)shmat(input_shmid, nullptr, 0);
+        if (input_shm == (u8 *)-1) ERROR("shmat() failed");
     }
 }
 
+// The coverage maps are zeroed and scanned in every execution, so their pages are worth placing carefully.
+// With use_huge_pages, a few huge pages cover the whole map instead of many TLB entries.
+// If this process is bound to a CPU core, the pages are allocated on its NUMA node, which is where both of
+// fuzzuf and PUT access them. The size of the segment seen by PUT may be rounded up to the huge page.
+u8 *NativeLinuxExecutor::AttachMapSharedMemory(int &shmid, u32 size) {
+    std::size_t len = size;
+    shmid = INVALID_SHMID;
+
+    if (use_huge_pages) {
+        std::size_t huge_page_size = fuzzuf::utils::GetHugePageSize();
+        if (huge_page_size > 0) {
+            len = (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+            shmid = shmget(IPC_PRIVATE, len, IPC_CREAT | IPC_EXCL | SHM_HUGETLB | 0600);
+        }
+        if (shmid < 0) {
+            DEBUG("Huge pages are not available. The coverage map is allocated with normal pages.");
+            len = size;
+        }
+    }
+
+    if (shmid < 0) {
+        shmid = shmget(IPC_PRIVATE, len, IPC_CREAT | IPC_EXCL | 0600);
+        if (shmid < 0) ERROR("shmget() failed");
+    }
+
+    u8 *addr = (u8 *)shmat(shmid, nullptr, 0);
+    if (addr == (u8 *)-1) ERROR("shmat() failed");
+
+    // The pages are not allocated until touched, so the policy applies to all of them
+    if (binded_cpuid.has_value()) {
+        fuzzuf::utils::PreferNumaNode(addr, len, fuzzuf::utils::GetNumaNodeOfCpu(binded_cpuid.value()));
+    }
+
+    return addr;
+}
+
 // Since shared memory is reused, it is initialized every time before passed to PUT.
+// Only the regions recorded as dirty are zeroed if the consumer of the feedback recorded them.
 void NativeLinuxExecutor::ResetSharedMemories() {
     if (afl_shm_size > 0) {
-        std::memset(afl_trace_bits, 0, afl_shm_size);
+        afl_dirty_regions.Clear(afl_trace_bits);
     }
 
     if (bb_shm_size > 0) {
-        std::memset(bb_trace_bits, 0, bb_shm_size);
+        bb_dirty_regions.Clear(bb_trace_bits);
     }
 
     MEM_BARRIER();
@@ -822,38 +854,67 @@ void NativeLinuxExecutor::EraseSharedMemories() {
         if (shmctl(bb_shmid, IPC_RMID, 0) == -1) ERROR("shmctl() failed");
         bb_shmid = INVALID_SHMID;
     }
+
+    if (input_shmid != INVALID_SHMID) {
+        if (shmdt(input_shm) == -1) ERROR("shmdt() failed");
+        input_shm = nullptr;
+        if (shmctl(input_shmid, IPC_RMID, 0) == -1) ERROR("shmctl() failed");
+        input_shmid = INVALID_SHMID;
+    }
 }
 
 // Since PUT that is instrumented using afl-clang-fast or fuzzuf-cc
 // interprets some environment variables, this is the configuration for it.
 // Although, this is actually what the child process running PUT should do,
 // since there are no environment variables need update for each PUT execution for now,
-// by using feature that environment variables are inherited to child process, it is enough to do just once ( let's move it if not ).
+// the variables are prepared in target_env once, and passed to execve. Call this again when they change.
 // As the additional advantage, it can avoid to waste Copy on Write of heap region due to StrPrintf.
 void NativeLinuxExecutor::SetupEnvironmentVariablesForTarget() {
     // Pass the id of shared memory to PUT.
     if (afl_shm_size > 0) {
-        std::string afl_shmstr = std::to_string(afl_shmid);
-        setenv(AFL_SHM_ENV_VAR, afl_shmstr.c_str(), 1);
+        target_env.Set(AFL_SHM_ENV_VAR, std::to_string(afl_shmid));
+
+        // Let PUT use a map up to the size of the shared memory
+        target_env.Set(AFL_MAP_SIZE_ENV_VAR, std::to_string(afl_shm_size));
     } else {
         // make sure to unset the environmental variable if it's unused
-        unsetenv(AFL_SHM_ENV_VAR);
+        target_env.Unset(AFL_SHM_ENV_VAR);
+        target_env.Unset(AFL_MAP_SIZE_ENV_VAR);
     }
 
     if (bb_shm_size > 0) {
-        std::string bb_shmstr = std::to_string(bb_shmid);
-        setenv(FUZZUF_SHM_ENV_VAR, bb_shmstr.c_str(), 1);
+        target_env.Set(FUZZUF_SHM_ENV_VAR, std::to_string(bb_shmid));
     } else {
         // make sure to unset the environmental variable if it's unused
-        unsetenv(FUZZUF_SHM_ENV_VAR);
+        target_env.Unset(FUZZUF_SHM_ENV_VAR);
     }
 
     /* This should improve performance a bit, since it stops the linker from
         doing extra work post-fork(). */
-    if (!getenv("LD_BIND_LAZY")) setenv("LD_BIND_NOW", "1", 1); 
+    if (!target_env.Get("LD_BIND_LAZY")) target_env.Set("LD_BIND_NOW", "1");
+
+    if (input_shmid != INVALID_SHMID) {
+        target_env.Set(AFL_SHM_FUZZ_ENV_VAR, std::to_string(input_shmid));
+    } else {
+        target_env.Unset(AFL_SHM_FUZZ_ENV_VAR);
+    }
+
+    // Tell the PUT whether __AFL_LOOP() should actually loop.
+    if (IsPersistentMode()) {
+        target_env.Set(PERSIST_ENV_VAR, "1");
+    } else {
+        target_env.Unset(PERSIST_ENV_VAR);
+    }
+
+    // Tell the PUT whether the fork server should wait for __AFL_INIT().
+    if (deferred_fork_server) {
+        target_env.Set(DEFER_ENV_VAR, "1");
+    } else {
+        target_env.Unset(DEFER_ENV_VAR);
+    }
 
     // Since MSAN, ASAN and UBSAN related configurations below are inherited from AFL and not used in fuzzuf, it is not required. But since those functionality is  considered implementable without conflicts in fuzzuf in future, these configuration are left.
-    setenv("ASAN_OPTIONS",
+    target_env.Set("ASAN_OPTIONS",
         "abort_on_error=1:"
         "detect_leaks=0:"
         "malloc_context_size=0:"
@@ -865,9 +926,9 @@ void NativeLinuxExecutor::SetupEnvironmentVariablesForTarget() {
         "handle_abort=0:"
         "handle_sigfpe=0:"
         "handle_sigill=0",
-        0);
+        false);
 
-    setenv("MSAN_OPTIONS",
+    target_env.Set("MSAN_OPTIONS",
         Util::StrPrintf(
            "exit_code=%d:"
            "symbolize=0:"
@@ -881,10 +942,10 @@ void NativeLinuxExecutor::SetupEnvironmentVariablesForTarget() {
            "handle_sigfpe=0:"
            "handle_sigill=0",
            MSAN_ERROR
-        ).c_str(),
-        0);
+        ),
+        false);
 
-    setenv("UBSAN_OPTIONS",
+    target_env.Set("UBSAN_OPTIONS",
         "halt_on_error=1:"
         "abort_on_error=1:"
         "malloc_context_size=0:"
@@ -895,15 +956,16 @@ void NativeLinuxExecutor::SetupEnvironmentVariablesForTarget() {
         "handle_abort=0:"
         "handle_sigfpe=0:"
         "handle_sigill=0",
-        0);
+        false);
 
 }
 
 /*
  * Precondition:
- *  - The target PUT is a binary that supports fork server mode.
+ *  - In fork server mode, the target PUT is a binary that supports fork server mode.
  * Postcondition:
  *  - Generate child process, then launch PUT in fork server mode on the child process side.
+ *    - In non fork server mode, the child process works as the virtual fork server instead.
  *  - Apply proper limits ( ex. memory limits ) on PUT.
  *  - Setup the pipe between parent process ( the process that runs fuzzuf ) and child process.
  */
@@ -914,18 +976,29 @@ void NativeLinuxExecutor::SetupForkServer() {
 
     if (pipe(par2chld) || pipe(chld2par)) ERROR("pipe() failed");
 
-    std::array< int, 2u > stdout_fd{ -1, -1 };
-    std::array< int, 2u > stderr_fd{ -1, -1 };
+    // The write ends of the pipes for output_captures. -1 if the output isn't read from a pipe.
+    std::vector< int > capture_write_fds( output_captures.size(), -1 );
 
-    if (record_stdout_and_err) {
-        if ( pipe( stdout_fd.data() ) < 0 ) {
-            ERROR("Unable to create stdout pipe");
-        }
-        if ( pipe( stderr_fd.data() ) < 0 ) {
-            ERROR("Unable to create stderr pipe");
+    for (std::size_t i = 0; i < output_captures.size(); ++i) {
+        const auto policy = output_captures[i].policy;
+        if (policy != fuzzuf::executor::OutputCapturePolicy::Discard) {
+            std::array< int, 2u > pipe_fd{ -1, -1 };
+            if ( pipe( pipe_fd.data() ) < 0 ) {
+                ERROR("Unable to create the pipe for fd %d", output_captures[i].fd);
+            }
+            captured_outputs[i].pipe_fd = pipe_fd[ 0 ];
+            capture_write_fds[i] = pipe_fd[ 1 ];
         }
     }
 
+    // This structure is shared by both parent process and the processes forked by the virtual fork server.
+    // It has to be allocated before the virtual fork server is forked.
+    if (!forksrv) {
+        child_state = fuzzuf::utils::interprocess::create_shared_object(
+          fuzzuf::executor::ChildState{ 0, 0, 0, 0, 0 }
+        );
+    }
+
     forksrv_pid = fork();
     if (forksrv_pid < 0) ERROR("fork() failed");
 
@@ -943,7 +1016,9 @@ void NativeLinuxExecutor::SetupForkServer() {
             setrlimit(RLIMIT_NOFILE, &r); /* Ignore errors */
         }
 
-        if (exec_memlimit) {
+        // The virtual fork server is a copy of this process and may already use more memory than the limit.
+        // Therefore, in non fork server mode, the limit is applied to PUT processes just before execv.
+        if (forksrv && exec_memlimit) {
             r.rlim_max = r.rlim_cur = ((rlim_t)exec_memlimit) << 20;
 
 #ifdef RLIMIT_AS
@@ -963,14 +1038,17 @@ void NativeLinuxExecutor::SetupForkServer() {
 
         setsid();
 
-        if (record_stdout_and_err) {
-            dup2(stdout_fd[ 1 ], 1);
-            dup2(stderr_fd[ 1 ], 2);
-            close( stdout_fd[ 0 ] );
-            close( stderr_fd[ 0 ] );
-        } else {
-            dup2(null_fd, 1);
-            dup2(null_fd, 2);
+        // The outputs not recorded are discarded.
+        dup2(null_fd, 1);
+        dup2(null_fd, 2);
+
+        for (std::size_t i = 0; i < output_captures.size(); ++i) {
+            const int fd = output_captures[i].fd;
+            if (capture_write_fds[i] != -1) {
+                dup2(capture_write_fds[i], fd);
+                close( capture_write_fds[i] );
+                close( captured_outputs[i].pipe_fd );
+            }
         }
 
         if (stdin_mode) {
@@ -987,7 +1065,12 @@ void NativeLinuxExecutor::SetupForkServer() {
         close(chld2par[0]);
         close(chld2par[1]);
 
-        execve(cargv[0], (char**)cargv.data(), environ);
+        if (!forksrv) {
+            // Never returns
+            RunVirtualForkServer();
+        }
+
+        execve(cargv[0], (char**)cargv.data(), target_env.GetEnvp());
 	// TODO: It must be discussed whether it is needed that equivalent to EXEC_FAIL_SIG that is used in non-fork server mode.
         exit(0);
     }
@@ -995,39 +1078,40 @@ void NativeLinuxExecutor::SetupForkServer() {
     close(par2chld[0]);
     close(chld2par[1]);
 
-    if (record_stdout_and_err) {
-        close( stdout_fd[ 1 ] );
-        close( stderr_fd[ 1 ] );
-        fork_server_stdout_fd = stdout_fd[ 0 ];
-        fork_server_stderr_fd = stderr_fd[ 0 ];
-        fcntl( fork_server_stdout_fd, F_SETFL, O_NONBLOCK );
-        fcntl( fork_server_stderr_fd, F_SETFL, O_NONBLOCK );
+    for (std::size_t i = 0; i < output_captures.size(); ++i) {
+        if (capture_write_fds[i] != -1) {
+            close( capture_write_fds[i] );
+            fcntl( captured_outputs[i].pipe_fd, F_SETFL, O_NONBLOCK );
+        }
     }
 
     fork_server_epoll_fd = epoll_create( 1 );
-    if (record_stdout_and_err) {
-        fork_server_stdout_event.data.fd = fork_server_stdout_fd;
-        fork_server_stdout_event.events = EPOLLIN|EPOLLRDHUP;
-        if (epoll_ctl(
-              fork_server_epoll_fd,
-              EPOLL_CTL_ADD,
-              fork_server_stdout_fd,
-              &fork_server_stdout_event
-            ) < 0 ) {
 
-            ERROR("Unable to epoll stdout pipe");
-        }
+    // The timer to kill PUT for timeout, which is armed only while waiting for PUT in Run()
+    fork_server_timer_fd = timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC );
+    if (fork_server_timer_fd < 0) ERROR("Unable to create timerfd");
+    fork_server_timer_armed = false;
+    epoll_event timer_event;
+    timer_event.data.fd = fork_server_timer_fd;
+    timer_event.events = EPOLLIN;
+    if (epoll_ctl( fork_server_epoll_fd, EPOLL_CTL_ADD, fork_server_timer_fd, &timer_event ) < 0) {
+        ERROR("Unable to epoll timerfd");
+    }
 
-        fork_server_stderr_event.data.fd = fork_server_stderr_fd;
-        fork_server_stderr_event.events = EPOLLIN|EPOLLRDHUP;
+    for (std::size_t i = 0; i < output_captures.size(); ++i) {
+        if (captured_outputs[i].pipe_fd == -1) continue;
+
+        epoll_event pipe_event;
+        pipe_event.data.fd = captured_outputs[i].pipe_fd;
+        pipe_event.events = EPOLLIN|EPOLLRDHUP;
         if (epoll_ctl(
-                fork_server_epoll_fd,
-                EPOLL_CTL_ADD,
-                fork_server_stderr_fd,
-                &fork_server_stderr_event
+              fork_server_epoll_fd,
+              EPOLL_CTL_ADD,
+              captured_outputs[i].pipe_fd,
+              &pipe_event
             ) < 0 ) {
 
-            ERROR("Unable to epoll stderr pipe");
+            ERROR("Unable to epoll the pipe for fd %d", output_captures[i].fd);
         }
     }
 
@@ -1046,18 +1130,213 @@ void NativeLinuxExecutor::SetupForkServer() {
 
     // Wait for fork server to launch with 10 seconds of time limit (Conforming AFL++ that looks waiting 10 seconds.).
     // The handshake is sent from remote on launched.
-    u8 tmp[4];
+    u32 status = 0;
     u32 time_limit = 10000;
-    u32 res = Util::ReadFileTimed(forksrv_read_fd, &tmp, 4, time_limit);
+    u32 res = Util::ReadFileTimed(forksrv_read_fd, &status, 4, time_limit);
     // FIXME: There are various reason to fail fork server, and as the responses varies and identifiable, it is more decent to classify them.
     if (res == 0 || res > time_limit) { 
         TerminateForkServer();
+
+        // PUT may have exited or got stuck before reaching __AFL_INIT(), e.g. because it reads the input earlier.
+        // Retry once with the fork server started at the entry, which PUT always reaches.
+        if (deferred_fork_server) {
+            DEBUG("Deferred fork server didn't start. Retrying with the fork server at the entry");
+            deferred_fork_server = false;
+            target_env.Unset(DEFER_ENV_VAR);
+            SetupForkServer();
+            return;
+        }
+
         ERROR("Fork server crashed");
     }
 
+    // The fork server built with AFL++ may tell the size of the coverage map it uses.
+    // A smaller map is reset and scanned faster, while a larger one can't be handled without losing coverage.
+    if ((status & FS_OPT_ENABLED) == FS_OPT_ENABLED
+     && (status & FS_OPT_MAPSIZE) == FS_OPT_MAPSIZE
+     && afl_shm_size > 0) {
+        const u32 map_size = RoundUpMapSize(DecodeMapSizeOption(status));
+
+        // PUT has attached the shared memory before the handshake. Start it again with a large enough one.
+        if (map_size > afl_shm_size) {
+            DEBUG("The coverage map of PUT (%u bytes) is larger than afl_shm_size (%u bytes). Retrying with a larger one",
+                  map_size, afl_shm_size);
+            TerminateForkServer();
+            ResizeAFLSharedMemory(map_size);
+            SetupForkServer();
+            return;
+        }
+
+        afl_map_size = map_size;
+        afl_map_size_negotiated = true;
+        afl_dirty_regions.Resize(afl_map_size);
+    }
+
+    // The fork server built with AFL++ advertises optional features in the handshake.
+    // If it advertises any feature that requires a reply, it waits for the reply before accepting requests.
+    // We accept only the input delivery via the shared memory, and decline the others(e.g. auto dictionary).
+    if ((status & FS_OPT_ENABLED) == FS_OPT_ENABLED
+     && (status & (FS_OPT_SHDMEM_FUZZ | FS_OPT_AUTODICT))) {
+        u32 reply = FS_OPT_ENABLED;
+        if ((status & FS_OPT_SHDMEM_FUZZ) && input_shm) {
+            reply |= FS_OPT_SHDMEM_FUZZ;
+            uses_shm_input = true;
+        }
+
+        try {
+            Util::WriteFile(forksrv_write_fd, &reply, 4);
+        } catch (const FileError &e) {
+            TerminateForkServer();
+            ERROR("Unable to reply to the handshake of fork server");
+        }
+    }
+
     return;
 }
 
+/*
+ * Precondition:
+ *  - This function is called in the child process forked by SetupForkServer, after the standard descriptors and FORKSRV_FD_{READ,WRITE} are configured.
+ * Postcondition:
+ *  - The process works as the fork server for PUTs that don't have it, following the same protocol as the fork server inside PUTs:
+ *    1. Send 4byte handshake on launch.
+ *    2. On each 4byte request, fork a process that executes PUT with execv, and send its pid.
+ *    3. Wait for the process, and send its status retrieved via waitpid.
+ *  - For each request, the result of execv, the status, the execution time and the sequence number of the request
+ *    are recorded to child_state before the status is sent.
+ *  - The process exits when the pipe to the parent process is closed. This function never returns.
+ */
+void NativeLinuxExecutor::RunVirtualForkServer() {
+    u32 tmp = 0;
+    if (write(FORKSRV_FD_WRITE, &tmp, 4) != 4) _exit(1);
+
+    u64 seq = 0;
+    while (true) {
+        // The value is meaningful only in persistent mode, which is unavailable in non fork server mode.
+        u32 was_killed;
+        if (read(FORKSRV_FD_READ, &was_killed, 4) != 4) _exit(1);
+
+        // Since execv never returns on success, the result is initialized as success(0), then set value on failed.
+        child_state->exec_result = 0;
+        child_state->exec_errno = 0;
+
+        const auto begin_date = std::chrono::steady_clock::now();
+        pid_t pid = fork();
+        if (pid < 0) _exit(1);
+
+        if (!pid) {
+            close(FORKSRV_FD_READ);
+            close(FORKSRV_FD_WRITE);
+
+            if (exec_memlimit) {
+                struct rlimit r;
+                r.rlim_max = r.rlim_cur = ((rlim_t)exec_memlimit) << 20;
+#ifdef RLIMIT_AS
+                setrlimit(RLIMIT_AS, &r); /* Ignore errors */
+#else
+                setrlimit(RLIMIT_DATA, &r); /* Ignore errors */
+#endif /* ^RLIMIT_AS */
+            }
+
+            // Execute new executable binary on the child process.
+            // If failed, that matter is recorded to child_state.
+            child_state->exec_result = execve(cargv[0], (char**)cargv.data(), target_env.GetEnvp());
+            child_state->exec_errno = errno;
+            _exit(0);
+        }
+
+        if (write(FORKSRV_FD_WRITE, &pid, 4) != 4) _exit(1);
+
+        int status;
+        if (waitpid(pid, &status, 0) < 0) _exit(1);
+
+        const auto end_date = std::chrono::steady_clock::now();
+        child_state->exit_status = status;
+        child_state->exec_time_us = std::chrono::duration_cast< std::chrono::microseconds >( end_date - begin_date ).count();
+        child_state->seq = ++seq;
+
+        if (write(FORKSRV_FD_WRITE, &status, 4) != 4) _exit(1);
+    }
+}
+
+/**
+ * Precondition:
+ *  - input_shm is allocated, and PUT accepted to read inputs from it.
+ * Postcondition:
+ *  - The first 4 bytes of input_shm hold the length of the input, and the input follows it.
+ *  - Same as AFL++, the input longer than INPUT_SHM_MAX_LEN is truncated.
+ */
+void NativeLinuxExecutor::WriteTestInputToSharedMemory(const u8 *buf, u32 len) {
+    if (len > INPUT_SHM_MAX_LEN) len = INPUT_SHM_MAX_LEN;
+
+    std::memcpy(input_shm, &len, sizeof(u32));
+    std::memcpy(input_shm + sizeof(u32), buf, len);
+}
+
+bool NativeLinuxExecutor::IsPersistentMode() const {
+    return persistent_loop_count != PERSISTENT_MODE_DISABLED;
+}
+
+// The inverse of FS_OPT_SET_MAPSIZE of AFL++
+u32 NativeLinuxExecutor::DecodeMapSizeOption(u32 status) {
+    return ((status & FS_OPT_MAPSIZE_MASK) >> 1) + 1;
+}
+
+// The smallest power of two not less than size and MIN_AFL_MAP_SIZE.
+// FS_OPT_MAPSIZE_MASK limits the size to 2^23, so this never overflows.
+u32 NativeLinuxExecutor::RoundUpMapSize(u32 size) {
+    u32 rounded = MIN_AFL_MAP_SIZE;
+    while (rounded < size) rounded <<= 1;
+    return rounded;
+}
+
+/*
+ * Precondition:
+ *  - The fork server is not running.
+ * Postcondition:
+ *  - The AFL-style map is allocated again with size bytes, and the environment variables for PUT tell the new one.
+ *  - afl_shm_size and afl_map_size are size.
+ */
+void NativeLinuxExecutor::ResizeAFLSharedMemory(u32 size) {
+    if (shmdt(afl_trace_bits) == -1) ERROR("shmdt() failed");
+    if (shmctl(afl_shmid, IPC_RMID, 0) == -1) ERROR("shmctl() failed");
+
+    afl_shm_size = size;
+    afl_map_size = size;
+    afl_trace_bits = AttachMapSharedMemory(afl_shmid, afl_shm_size);
+    afl_dirty_regions.Resize(afl_shm_size);
+
+    SetupEnvironmentVariablesForTarget();
+}
+
+bool NativeLinuxExecutor::IsDeferredForkServer() const {
+    return deferred_fork_server;
+}
+
+/*
+ * Postcondition:
+ *  - Returns true if the file at path contains DEFER_SIG, i.e. the PUT calls __AFL_INIT().
+ *  - Returns false if the file can't be read.
+ */
+bool NativeLinuxExecutor::HasDeferredForkServerSignature(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return false;
+
+    bool found = memmem(addr, st.st_size, DEFER_SIG, std::strlen(DEFER_SIG)) != nullptr;
+    munmap(addr, st.st_size);
+    return found;
+}
+
 // this function may be called in signal handlers.
 // use only async-signal-safe functions inside.
 // basically, we care about only the case where NativeLinuxExecutor::Run is running.
@@ -1071,9 +1350,70 @@ void NativeLinuxExecutor::ReceiveStopSignal(void) {
 }
 
 fuzzuf::executor::output_t NativeLinuxExecutor::MoveStdOut() {
-    return std::move( stdout_buffer );
+    return MoveOutput( 1 );
 }
 
 fuzzuf::executor::output_t NativeLinuxExecutor::MoveStdErr() {
-    return std::move( stderr_buffer );
+    return MoveOutput( 2 );
+}
+
+fuzzuf::executor::output_t NativeLinuxExecutor::MoveOutput(int fd) {
+    const int index = FindOutputCapture( fd );
+    if (index < 0) {
+        return fuzzuf::executor::output_t();
+    }
+
+    auto &captured = captured_outputs[ index ];
+    if (captured.head) {
+        const auto *data = captured.head->GetData();
+        return fuzzuf::executor::output_t( data, std::next( data, captured.head->GetSize() ) );
+    }
+    return std::move( captured.buffer );
+}
+
+bool NativeLinuxExecutor::IsStdOutTruncated() const {
+    return IsOutputTruncated( 1 );
+}
+
+bool NativeLinuxExecutor::IsStdErrTruncated() const {
+    return IsOutputTruncated( 2 );
+}
+
+bool NativeLinuxExecutor::IsOutputTruncated(int fd) const {
+    const int index = FindOutputCapture( fd );
+    return index >= 0 && captured_outputs[ index ].head && captured_outputs[ index ].head->IsTruncated();
+}
+
+std::vector<fuzzuf::executor::OutputCapture> NativeLinuxExecutor::StdOutAndErrCaptures(
+    bool record_stdout_and_err,
+    u32 output_capture_limit
+) {
+    if (!record_stdout_and_err) return {};
+
+    using fuzzuf::executor::OutputCapturePolicy;
+    if (output_capture_limit == OUTPUT_CAPTURE_UNLIMITED) {
+        return { { 1, OutputCapturePolicy::Full }, { 2, OutputCapturePolicy::Full } };
+    }
+    return {
+        { 1, OutputCapturePolicy::Head, output_capture_limit },
+        { 2, OutputCapturePolicy::Head, output_capture_limit }
+    };
+}
+
+int NativeLinuxExecutor::FindOutputCapture(int fd) const {
+    for (std::size_t i = 0; i < output_captures.size(); ++i) {
+        if (output_captures[ i ].fd == fd) return static_cast<int>( i );
+    }
+    return -1;
+}
+
+bool NativeLinuxExecutor::ReadCapturedOutput(std::size_t index) {
+    auto &captured = captured_outputs[ index ];
+    if (output_captures[ index ].policy == fuzzuf::executor::OutputCapturePolicy::HashOnly) {
+        return detail::hash_chunk( captured.hash, captured.pipe_fd );
+    }
+    if (captured.head) {
+        return captured.head->ReadFrom( captured.pipe_fd );
+    }
+    return detail::read_chunk( captured.buffer, captured.pipe_fd );
 }
@@ -23,6 +23,8 @@
 #include <optional>
 #include <boost/container/static_vector.hpp>
 #include <sched.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
 
 #include "fuzzuf/algorithms/afl/afl_option.hpp"
 #include "fuzzuf/exceptions.hpp"
@@ -39,10 +41,6 @@
 #include "fuzzuf/feedback/put_exit_reason_type.hpp"
 #include "fuzzuf/logger/logger.hpp"
 
-bool ProxyExecutor::has_setup_sighandlers = false;
-
-ProxyExecutor* ProxyExecutor::active_instance = nullptr;
-
 // Precondition:
 //    - A file can be created at path path_str_to_write_input.
 //    - If fork server mode, proxy specified by proxy_path behave as fork server.
@@ -78,7 +76,13 @@ ProxyExecutor::ProxyExecutor(
     forksrv_write_fd( -1 ),
     bb_trace_bits( nullptr ),
     afl_trace_bits( nullptr ),
+    bb_dirty_regions( bb_shm_size ),
+    afl_dirty_regions( afl_shm_size ),
     child_timed_out( false ),
+    child_state( fuzzuf::utils::interprocess::create_shared_object(
+        fuzzuf::executor::ChildState{ 0, 0, 0, 0, 0 }
+    ) ),
+    exec_seq( 0 ),
     record_stdout_and_err( record_stdout_and_err ),
     has_shared_memories ( false )
 {
@@ -131,7 +135,7 @@ ied running on core a and other FUZZUF related processes never run on core a.
  *           * On the other hand, this procedure affects whole the process. In simple word, it requires only 1 executor existing in 1 process.
  *           * As the future work, the class managing CPU cores and executors should be introduced for solving this limitation.
  *           * For the time being, 3 options which cover all situation are provided.
- *       * Configure signal handlers (Temporary workaround for non fork server mode. This will be removed in future.)
+ *       * Configure signal handlers (Ignore SIGTSTP and SIGPIPE)
  *       * Parsing and preprocessing of commandline arguments of PUT.
  *       * Generate a file for sending input to  PUT.
  *       * Configure shared memory
@@ -182,17 +186,9 @@ void ProxyExecutor::Initilize()
     }
 #endif /* __linux__ */
 
-    if (!has_setup_sighandlers) {
-	// For the time being, as signal handler is set globally, this function is static method, therefore it is not needed to set again if has_setup_handlers is ture.
-        SetupSignalHandlers();
-        has_setup_sighandlers = true;
-    }
-
-
-    // Assign self address to static pointer to make signal handlers can refer.
-    // active_instance may refer other instance if multiple ProxyExecutor exist, therefore following assertion is not appliable.
-    // assert(active_instance == nullptr);
-    active_instance = this;
+    // The dispositions set here are the same for all instances and no instance is referred from signal handlers.
+    // Therefore, it is harmless to set them every time an instance is created, even from multiple threads.
+    SetupSignalHandlers();
 
     OpenExecutorDependantFiles();
 
@@ -214,16 +210,9 @@ void ProxyExecutor::Initilize()
  *  - Free resources handled by this class, then invalidate data.
  *      - Close input_fd file descriptor. then the value is invalidated (fail-safe)
  *      - If running in fork server mode, close the pipes for communicating with fork server, then terminate fork server process.
- *  - Temporary purpose: If actve_instance which signal handlers refer has a pointer to self value, assign nullptr to it and invalidate.
  */
 
 ProxyExecutor::~ProxyExecutor() {
-    // Since active_instance can refer another instance of multiple N, it is considered FuzzerHandle::Reset is called if active_instance is not self value, therefore do nothing. On the other hand, assign nullptr if active_instance is self value.
-    // Although, assigning nullptr just in case, since the handlers will never called when the destructor is called, it is basically not a problem.
-    if (active_instance == this) {
-        active_instance = nullptr;
-    }
-
     if (input_fd != -1) {
         Util::CloseFile(input_fd);
         input_fd = -1;
@@ -327,35 +316,13 @@ void ProxyExecutor::TerminateForkServer() {
 }
 
 
-/**
- * An static method
- * Precondition:
- *  - active_instance has a non-nullptr value definitely when this function is called.
- *  - active_instance has an address of valid Executor instance.
- *  - The global timer exists in the self process, and the function is called for SIGALRM signal.
- * Postcondition:
- *  - The function works as signal handler for SIGALRM
- *      - If called, the PUT is considered as expiring the execution time, therefore kill active_instance->child_pid.
- *      - Set a flag active_instance->child_timed_out
- */
-void ProxyExecutor::AlarmHandler(int signum) {
-    assert (signum == SIGALRM);
-    assert (active_instance != nullptr);
-    active_instance->KillChildWithoutWait();
-    active_instance->child_timed_out = true;
-}
-
-
 /*
  * An static method
  * Postcondition:
  *  - It defines how the fuzzuf process respond to signals.
  *  - If signal handlers are needed, signal handlers are set.
- * FIXME: Since the configuration on signal handlers is shared in whole process,
- * it affects all fuzzuf instances running on the process.
- * As the result, it requires change of process design in some cases,
- * Therefore, the process design may be changed, 
- * yet currently the static function is implemented under the expection that only one fuzzuf instance is used simultaneously.
+ *  - Only SIG_IGN is set, so that no signal handler depends on a specific instance.
+ *    Timeouts are detected by each instance without signals.
  */
 void ProxyExecutor::SetupSignalHandlers() {
     struct sigaction sa;
@@ -391,9 +358,6 @@ void ProxyExecutor::SetupSignalHandlers() {
     sa.sa_handler = SIG_IGN;
     sigaction(SIGTSTP, &sa, NULL);
     sigaction(SIGPIPE, &sa, NULL);
-
-    sa.sa_handler = ProxyExecutor::AlarmHandler;
-    sigaction(SIGALRM, &sa, NULL);
 }
 
 namespace detail {
@@ -472,11 +436,10 @@ void ProxyExecutor::Run(const u8 *buf, u32 len, u32 timeout_ms) {
     //#endif
 
     
-    // This structure is shared by both parent process and child process.
+    // child_state is shared by both parent process and child process.
     // Since execv never returns on success, it is initialized as success(0), then set value on failed.
-    auto child_state = fuzzuf::utils::interprocess::create_shared_object(
-      fuzzuf::executor::ChildState{ 0, 0 }
-    );
+    *child_state = fuzzuf::executor::ChildState{ 0, 0, 0, 0, ++exec_seq };
+    const auto exec_begin_date = std::chrono::steady_clock::now();
 
     std::array< int, 2u > stdout_fd{ 0, 0 };
     std::array< int, 2u > stderr_fd{ 0, 0 };
@@ -485,7 +448,7 @@ void ProxyExecutor::Run(const u8 *buf, u32 len, u32 timeout_ms) {
     bool timeout = true;
     if (forksrv) {
 	// The value tmp which is needed only on persistent mode that is currently not implemented.
-        static u8 tmp[4];
+        u32 tmp = 0;
 
 
         // Request creating PUT process to fork server
@@ -494,7 +457,7 @@ void ProxyExecutor::Run(const u8 *buf, u32 len, u32 timeout_ms) {
         // WriteFile, ReadFile throw exception if writing or reading couldn't consume specified bytes.
         try {
             // FIXME: When persistent mode is implemented, this tmp must be set to the value that represent if the last execution failed for timeout.
-            Util::WriteFile(forksrv_write_fd, tmp, 4);
+            Util::WriteFile(forksrv_write_fd, &tmp, 4);
 
             read_buffer.resize( 4u );
             Util::ReadFile( forksrv_read_fd, read_buffer.data(), 4u, false );
@@ -620,7 +583,7 @@ void ProxyExecutor::Run(const u8 *buf, u32 len, u32 timeout_ms) {
 
             // Execute new executable binary on the child process.
             // If failed, that matter is recorded to child_state.
-            child_state->exec_result = execv(cargv[0], (char**)cargv.data());
+            child_state->exec_result = execve(cargv[0], (char**)cargv.data(), target_env.GetEnvp());
             child_state->exec_errno = errno;
 
             /* Use a distinctive bitmap value to tell the parent about execv()
@@ -659,125 +622,131 @@ void ProxyExecutor::Run(const u8 *buf, u32 len, u32 timeout_ms) {
             ERROR("Unable to communicate with fork server (OOM?)");
     } else {
         // Initialize a flag that indicate whether the PUT hanged.
-        // It is set in the signal handler.
         child_timed_out = false;
 
-        static struct itimerval it;
-
-
-        // Set timer to make SIGALRM to be sent on timeout.
-        // The handler for SIGALRM is set to ProxyExecutor::AlarmHandler, and the PUT is killed in inside.
-        // Yet SIGALRM is not set if exec_timelimit_ms is set to 0.
-        if (exec_timelimit_ms) {        
-            it.it_value.tv_sec = (timeout_ms / 1000);
-            it.it_value.tv_usec = (timeout_ms % 1000) * 1000;
-            setitimer(ITIMER_REAL, &it, NULL);
-        }
-
-        // If record_stdout_and_err is true, here starts the loop for saving outputs to buffers.
         if (record_stdout_and_err) {
             close( stdout_fd[ 1 ] );
             close( stderr_fd[ 1 ] );
+            fcntl( stdout_fd[ 0 ], F_SETFL, O_NONBLOCK );
+            fcntl( stderr_fd[ 0 ], F_SETFL, O_NONBLOCK );
+        }
+
+        // Wait for the PUT without process-wide timers and signal handlers so that each instance handles its own timeout.
+        // The exit of the PUT is notified via pidfd, and the timeout is notified via timerfd.
+        // pidfd_open is available since Linux 5.3. If it is unavailable, the exit of the PUT is polled instead.
+        pid_t pid = child_pid;
+        bool reaped = false;
+
+        auto epoll_fd = epoll_create1( EPOLL_CLOEXEC );
+        if ( epoll_fd < 0 ) {
+            throw fuzzuf::utils::errno_to_system_error(
+                    errno,
+                    "Unable to create epoll"
+                    );
+        }
 
-            auto epoll_fd = epoll_create( 1 );
-            epoll_event stdout_event;
-            stdout_event.data.fd = stdout_fd[ 0 ];
-            stdout_event.events = EPOLLIN|EPOLLRDHUP;
-            if( epoll_ctl(
-                        epoll_fd,
-                        EPOLL_CTL_ADD,
-                        stdout_fd[ 0 ],
-                        &stdout_event
-                        ) < 0 ) {
+        auto add_to_epoll = [epoll_fd]( int fd ) {
+            epoll_event event;
+            event.data.fd = fd;
+            event.events = EPOLLIN|EPOLLRDHUP;
+            if ( epoll_ctl( epoll_fd, EPOLL_CTL_ADD, fd, &event ) < 0 ) {
                 throw fuzzuf::utils::errno_to_system_error(
                         errno,
-                        "Unable to epoll stdout pipe"
+                        "Unable to epoll the file descriptor"
                         );
             }
+        };
 
-            epoll_event stderr_event;
-            stderr_event.data.fd = stderr_fd[ 0 ];
-            stderr_event.events = EPOLLIN|EPOLLRDHUP;
-            if( epoll_ctl(
-                        epoll_fd,
-                        EPOLL_CTL_ADD,
-                        stderr_fd[ 0 ],
-                        &stderr_event
-                        ) < 0 ) {
+#ifdef SYS_pidfd_open
+        int pid_fd = syscall( SYS_pidfd_open, pid, 0 );
+#else
+        int pid_fd = -1;
+#endif
+        if ( pid_fd >= 0 ) add_to_epoll( pid_fd );
+
+        // Yet the timer is not set if timeout_ms is 0.
+        int timer_fd = -1;
+        if ( timeout_ms ) {
+            timer_fd = timerfd_create( CLOCK_MONOTONIC, TFD_CLOEXEC );
+            if ( timer_fd < 0 ) {
                 throw fuzzuf::utils::errno_to_system_error(
                         errno,
-                        "Unable to epoll stdout pipe"
+                        "Unable to create timerfd"
                         );
             }
+            itimerspec it{};
+            it.it_value.tv_sec = timeout_ms / 1000;
+            it.it_value.tv_nsec = ( timeout_ms % 1000 ) * 1000000;
+            timerfd_settime( timer_fd, 0, &it, nullptr );
+            add_to_epoll( timer_fd );
+        }
 
+        // If record_stdout_and_err is true, outputs are saved to buffers in the same loop.
+        if (record_stdout_and_err) {
+            add_to_epoll( stdout_fd[ 0 ] );
+            add_to_epoll( stderr_fd[ 0 ] );
+        }
+
+        while (true) {
             epoll_event event;
-            auto left_ms = timeout_ms;
-            unsigned int closed_count = 0u;
-            fcntl( stdout_fd[ 0 ], F_SETFL, O_NONBLOCK );
-            fcntl( stderr_fd[ 0 ], F_SETFL, O_NONBLOCK );
-            while (left_ms > 0) {
-                const auto begin_date = std::chrono::steady_clock::now();
-                auto event_count = epoll_wait( epoll_fd, &event, 1, left_ms );
-                if ( event_count < 0 ) {
-                    int e = errno;
-                    if( e != EINTR ) {
-                        throw fuzzuf::utils::errno_to_system_error(
-                                e,
-                                "epoll_wait failed during the execution"
-                              );
-                    }
+            auto event_count = epoll_wait( epoll_fd, &event, 1, pid_fd >= 0 ? -1 : 1 );
+            if ( event_count < 0 ) {
+                int e = errno;
+                if( e != EINTR ) {
+                    throw fuzzuf::utils::errno_to_system_error(
+                            e,
+                            "epoll_wait failed during the execution"
+                          );
                 }
-                else if ( event_count == 0 ) break;
-                else {
-                    if ( event.events & EPOLLIN ) {
-                        if ( event.data.fd == stdout_fd[ 0 ] )
-                            // Although the buffer may contain data larger than output_block_size, that is not a problem as it is level trigger.
-                            detail::read_chunk( stdout_buffer, stdout_fd[ 0 ] );
-                        else if ( event.data.fd == stderr_fd[ 0 ] )
-                            // Although the buffer may contain data larger than output_block_size, that is not a problem as it is level trigger.
-                            detail::read_chunk( stderr_buffer, stderr_fd[ 0 ] );
-                    }
-                    if ( event.events == EPOLLHUP || event.events == EPOLLERR ) {
-                        ++closed_count;
-                        if ( closed_count == 2u )
-                            break;
-                    }
+            }
+            else if ( event_count == 0 ) {
+                // Only when pidfd is unavailable
+                if ( waitpid( pid, &put_status, WNOHANG ) == pid ) {
+                    reaped = true;
+                    break;
+                }
+            }
+            else if ( event.data.fd == pid_fd ) break;
+            else if ( event.data.fd == timer_fd ) {
+                // The execution time exceeded due to input that causes hanging was passed.
+                KillChildWithoutWait();
+                child_timed_out = true;
+                break;
+            }
+            else {
+                if ( event.events & EPOLLIN ) {
+                    // Although the buffer may contain data larger than output_block_size, that is not a problem as it is level trigger.
+                    if ( event.data.fd == stdout_fd[ 0 ] )
+                        detail::read_chunk( stdout_buffer, stdout_fd[ 0 ] );
+                    else if ( event.data.fd == stderr_fd[ 0 ] )
+                        detail::read_chunk( stderr_buffer, stderr_fd[ 0 ] );
+                }
+                else if ( event.events & ( EPOLLHUP|EPOLLERR ) ) {
+                    // The pipe is closed and drained. Stop watching it not to be woken up repeatedly.
+                    epoll_ctl( epoll_fd, EPOLL_CTL_DEL, event.data.fd, nullptr );
                 }
-                const auto end_date = std::chrono::steady_clock::now();
-                const auto elapsed = std::chrono::duration_cast< std::chrono::milliseconds >( end_date - begin_date ).count();
-                if ( left_ms < elapsed ) left_ms = 0;
-                else left_ms -= elapsed;
             }
-            close( epoll_fd );
         }
 
-        if (waitpid(child_pid, &put_status, 0) <= 0) ERROR("waitpid() failed");
+        if ( timer_fd >= 0 ) close( timer_fd );
+        if ( pid_fd >= 0 ) close( pid_fd );
+        close( epoll_fd );
+
+        if (!reaped && waitpid(pid, &put_status, 0) <= 0) ERROR("waitpid() failed");
 
         if (record_stdout_and_err) {
-            {
-            bool cont = true;
-            while( cont ) {
-              cont = detail::read_chunk( stdout_buffer, stdout_fd[ 0 ] );
-            }
-            }
-            {
-            bool cont = true;
-            while( cont ) {
-              cont = detail::read_chunk( stderr_buffer, stderr_fd[ 0 ] );
-            }
-            }
+            while( detail::read_chunk( stdout_buffer, stdout_fd[ 0 ] ) );
+            while( detail::read_chunk( stderr_buffer, stderr_fd[ 0 ] ) );
             close( stdout_fd[ 0 ] );
             close( stderr_fd[ 0 ] );
         }
-
-	// Reset the timer.
-        if (exec_timelimit_ms) {
-            it.it_value.tv_sec = 0;
-            it.it_value.tv_usec = 0;
-            setitimer(ITIMER_REAL, &it, NULL);
-        }
     }
    
+    child_state->exit_status = put_status;
+    child_state->exec_time_us = std::chrono::duration_cast< std::chrono::microseconds >(
+        std::chrono::steady_clock::now() - exec_begin_date
+    ).count();
+
     // If the PUT process is not stopped but exited ( It should happen except in persistent mode ), since child_pid is no longer needed, it can be set to 0. 
     if (!WIFSTOPPED(put_status)) child_pid = 0; 
     DEBUG("Exec Status %d (pid %d)\n", put_status, child_pid);
@@ -874,13 +843,14 @@ void ProxyExecutor::SetupSharedMemories() {
 }
 
 // Since shared memory is reused, it is initialized every time before passed to PUT.
+// Only the regions recorded as dirty are zeroed if the consumer of the feedback recorded them.
 void ProxyExecutor::ResetSharedMemories() {
     if (afl_shm_size > 0) {
-        std::memset(afl_trace_bits, 0, afl_shm_size);
+        afl_dirty_regions.Clear(afl_trace_bits);
     }
 
     if (bb_shm_size > 0) {
-        std::memset(bb_trace_bits, 0, bb_shm_size);
+        bb_dirty_regions.Clear(bb_trace_bits);
     }
 
     MEM_BARRIER();
@@ -908,32 +878,30 @@ void ProxyExecutor::EraseSharedMemories() {
 // interprets some environment variables, this is the configuration for it.
 // Although, this is actually what the child process running PUT should do,
 // since there are no environment variables need update for each PUT execution for now,
-// by using feature that environment variables are inherited to child process, it is enough to do just once ( let's move it if not ).
+// the variables are prepared in target_env once, and passed to execve.
 // As the additional advantage, it can avoid to waste Copy on Write of heap region due to StrPrintf.
 void ProxyExecutor::SetupEnvironmentVariablesForTarget() {
     // Pass the id of shared memory to PUT.
     if (afl_shm_size > 0) {
-        std::string afl_shmstr = std::to_string(afl_shmid);
-        setenv(AFL_SHM_ENV_VAR, afl_shmstr.c_str(), 1);
+        target_env.Set(AFL_SHM_ENV_VAR, std::to_string(afl_shmid));
     } else {
         // make sure to unset the environmental variable if it's unused
-        unsetenv(AFL_SHM_ENV_VAR);
+        target_env.Unset(AFL_SHM_ENV_VAR);
     }
 
     if (bb_shm_size > 0) {
-        std::string bb_shmstr = std::to_string(bb_shmid);
-        setenv(FUZZUF_SHM_ENV_VAR, bb_shmstr.c_str(), 1);
+        target_env.Set(FUZZUF_SHM_ENV_VAR, std::to_string(bb_shmid));
     } else {
         // make sure to unset the environmental variable if it's unused
-        unsetenv(FUZZUF_SHM_ENV_VAR);
+        target_env.Unset(FUZZUF_SHM_ENV_VAR);
     }
 
     /* This should improve performance a bit, since it stops the linker from
         doing extra work post-fork(). */
-    if (!getenv("LD_BIND_LAZY")) setenv("LD_BIND_NOW", "1", 1); 
+    if (!target_env.Get("LD_BIND_LAZY")) target_env.Set("LD_BIND_NOW", "1");
 
     // Since MSAN, ASAN and UBSAN related configurations below are inherited from AFL and not used in fuzzuf, it is not required. But since those functionality is  considered implementable without conflicts in fuzzuf in future, these configuration are left.
-    setenv("ASAN_OPTIONS",
+    target_env.Set("ASAN_OPTIONS",
         "abort_on_error=1:"
         "detect_leaks=0:"
         "malloc_context_size=0:"
@@ -945,9 +913,9 @@ void ProxyExecutor::SetupEnvironmentVariablesForTarget() {
         "handle_abort=0:"
         "handle_sigfpe=0:"
         "handle_sigill=0",
-        0);
+        false);
 
-    setenv("MSAN_OPTIONS",
+    target_env.Set("MSAN_OPTIONS",
         Util::StrPrintf(
            "exit_code=%d:"
            "symbolize=0:"
@@ -961,10 +929,10 @@ void ProxyExecutor::SetupEnvironmentVariablesForTarget() {
            "handle_sigfpe=0:"
            "handle_sigill=0",
            MSAN_ERROR
-        ).c_str(),
-        0);
+        ),
+        false);
 
-    setenv("UBSAN_OPTIONS",
+    target_env.Set("UBSAN_OPTIONS",
         "halt_on_error=1:"
         "abort_on_error=1:"
         "malloc_context_size=0:"
@@ -975,7 +943,7 @@ void ProxyExecutor::SetupEnvironmentVariablesForTarget() {
         "handle_abort=0:"
         "handle_sigfpe=0:"
         "handle_sigill=0",
-        0);
+        false);
 
 }
 
@@ -1068,7 +1036,7 @@ void ProxyExecutor::SetupForkServer() {
         close(chld2par[0]);
         close(chld2par[1]);
 
-        execve(cargv[0], (char**)cargv.data(), environ);
+        execve(cargv[0], (char**)cargv.data(), target_env.GetEnvp());
 	// TODO: It must be discussed whether it is needed that equivalent to EXEC_FAIL_SIG that is used in non-fork server mode.
         exit(0);
     }
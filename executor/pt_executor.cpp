@@ -33,7 +33,9 @@ PTExecutor::PTExecutor(
 ) : ProxyExecutor ( proxy_path, std::vector<std::string>(), argv, exec_timelimit_ms, exec_memlimit, forksrv,
                     path_to_write_input, 0, 0, cpuid_to_bind, record_stdout_and_err ),
     path_shm_size ( PTExecutor::PATH_SHM_SIZE ),
-    fav_shm_size ( PTExecutor::FAV_SHM_SIZE )
+    fav_shm_size ( PTExecutor::FAV_SHM_SIZE ),
+    path_dirty_regions ( PTExecutor::PATH_SHM_SIZE ),
+    fav_dirty_regions ( PTExecutor::FAV_SHM_SIZE )
 {
     if (path_shm_size > 0 || fav_shm_size > 0) {
         has_shared_memories = true;
@@ -63,11 +65,11 @@ void PTExecutor::SetupSharedMemories() {
 
 void PTExecutor::ResetSharedMemories() {
     if (path_shm_size > 0) {
-        std::memset(path_trace_bits, 0, path_shm_size);
+        path_dirty_regions.Clear(path_trace_bits);
     }
 
     if (fav_shm_size > 0) {
-        std::memset(fav_trace_bits, 0, fav_shm_size);
+        fav_dirty_regions.Clear(fav_trace_bits);
     }
 
     MEM_BARRIER();
@@ -93,19 +95,17 @@ void PTExecutor::SetupEnvironmentVariablesForTarget() {
     ProxyExecutor::SetupEnvironmentVariablesForTarget();
 
     if (path_shm_size > 0) {
-        std::string path_shmstr = std::to_string(path_shmid);
-        setenv(PATH_SHM_ENV_VAR, path_shmstr.c_str(), 1);
+        target_env.Set(PATH_SHM_ENV_VAR, std::to_string(path_shmid));
     } else {
         // make sure to unset the environmental variable if it's unused
-        unsetenv(PATH_SHM_ENV_VAR);
+        target_env.Unset(PATH_SHM_ENV_VAR);
     }
 
     if (fav_shm_size > 0) {
-        std::string fav_shmstr = std::to_string(fav_shmid);
-        setenv(FAV_SHM_ENV_VAR, fav_shmstr.c_str(), 1);
+        target_env.Set(FAV_SHM_ENV_VAR, std::to_string(fav_shmid));
     } else {
         // make sure to unset the environmental variable if it's unused
-        unsetenv(FAV_SHM_ENV_VAR);
+        target_env.Unset(FAV_SHM_ENV_VAR);
     }
 }
 
@@ -0,0 +1,57 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#include "fuzzuf/executor/sancov_shim.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// This file is built into libfuzzuf-sancov, which is linked with the harness, not with fuzzuf.
+
+namespace {
+    // The constructors of the harness may run before the static objects of this library are initialized
+    std::vector<fuzzuf_sancov_region> &GetRegisteredCounterRegions() {
+        static std::vector<fuzzuf_sancov_region> regions;
+        return regions;
+    }
+}
+
+extern "C" {
+    const fuzzuf_sancov_region *fuzzuf_sancov_get_counter_regions(std::size_t *count) {
+        auto &regions = GetRegisteredCounterRegions();
+        *count = regions.size();
+        return regions.data();
+    }
+
+    void __sanitizer_cov_8bit_counters_init(std::uint8_t *start, std::uint8_t *stop) {
+        if (start < stop) GetRegisteredCounterRegions().push_back({ start, stop });
+    }
+    void __sanitizer_cov_pcs_init(const std::uintptr_t *, const std::uintptr_t *) {}
+    void __sanitizer_cov_trace_pc_indir(std::uintptr_t) {}
+    void __sanitizer_cov_trace_cmp1(std::uint8_t, std::uint8_t) {}
+    void __sanitizer_cov_trace_cmp2(std::uint16_t, std::uint16_t) {}
+    void __sanitizer_cov_trace_cmp4(std::uint32_t, std::uint32_t) {}
+    void __sanitizer_cov_trace_cmp8(std::uint64_t, std::uint64_t) {}
+    void __sanitizer_cov_trace_const_cmp1(std::uint8_t, std::uint8_t) {}
+    void __sanitizer_cov_trace_const_cmp2(std::uint16_t, std::uint16_t) {}
+    void __sanitizer_cov_trace_const_cmp4(std::uint32_t, std::uint32_t) {}
+    void __sanitizer_cov_trace_const_cmp8(std::uint64_t, std::uint64_t) {}
+    void __sanitizer_cov_trace_switch(std::uint64_t, std::uint64_t *) {}
+    void __sanitizer_cov_trace_div4(std::uint32_t) {}
+    void __sanitizer_cov_trace_div8(std::uint64_t) {}
+    void __sanitizer_cov_trace_gep(std::uintptr_t) {}
+}
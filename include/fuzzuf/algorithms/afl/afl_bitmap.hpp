@@ -0,0 +1,95 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include "fuzzuf/utils/common.hpp"
+#include "fuzzuf/utils/dirty_regions.hpp"
+
+namespace fuzzuf::algorithm::afl::util {
+
+// Implementations of the kernels scanning the coverage map on every exec.
+// The fastest one supported by the running CPU is chosen at runtime.
+enum class BitmapKernel {
+    Scalar,
+    AVX2,
+    AVX512
+};
+
+bool IsBitmapKernelSupported(BitmapKernel kernel);
+BitmapKernel GetBitmapKernel(void);
+
+/* Classify execution counts in trace_bits as ClassifyCounts does and, in the
+   same pass, compare the classified trace against virgin_map. Returns what
+   HasNewBits would return for the classified trace, but leaves virgin_map
+   untouched: virgin_map is updated only when a caller decides to keep the
+   trace, which is rare. If dirty is given, the cache lines of trace_bits
+   which are not zero are recorded into it, so that the executor can reset
+   only them before the next run. */
+
+u8 ClassifyCountsAndCheckNewBits(
+    u8 *trace_bits,
+    const u8 *virgin_map,
+    u32 map_size,
+    utils::DirtyRegions *dirty = nullptr
+);
+
+u8 ClassifyCountsAndCheckNewBits(
+    u8 *trace_bits,
+    const u8 *virgin_map,
+    u32 map_size,
+    BitmapKernel kernel,
+    utils::DirtyRegions *dirty = nullptr
+);
+
+/* The kernel of AFLStateTemplate::HasNewBits. Returns 1 if the only change
+   is the hit-count for a particular tuple; 2 if there are new tuples seen.
+   virgin_map is updated, so subsequent calls will always return 0. Blocks
+   of trace_bits which are all zero are skipped with a single compare. */
+
+u8 HasNewBits(
+    const u8 *trace_bits,
+    u8 *virgin_map,
+    u32 map_size
+);
+
+u8 HasNewBits(
+    const u8 *trace_bits,
+    u8 *virgin_map,
+    u32 map_size,
+    BitmapKernel kernel
+);
+
+/* The same as HasNewBits, except that virgin_map may be updated by several
+   threads at the same time, like the virgin maps of AFLSharedState. Each bit
+   is reported as new by exactly one of the threads clearing it. virgin_map
+   must be aligned to 8 bytes. */
+
+u8 HasNewBitsAtomic(
+    const u8 *trace_bits,
+    u8 *virgin_map,
+    u32 map_size
+);
+
+u8 HasNewBitsAtomic(
+    const u8 *trace_bits,
+    u8 *virgin_map,
+    u32 map_size,
+    BitmapKernel kernel
+);
+
+} // namespace fuzzuf::algorithm::afl::util
@@ -0,0 +1,140 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <array>
+#include "fuzzuf/utils/common.hpp"
+#include "fuzzuf/rand/rand.hpp"
+
+namespace fuzzuf::algorithm::afl {
+
+// Responsibility:
+//   - Choose the mutation operators of havoc with the probabilities MOpt learns by
+//     Particle Swarm Optimization(PSO), instead of the static AFLHavocCaseDistrib
+//   - Count how many times each operator is used and how many finds it contributes to
+//
+// The scheduler alternates between two modules, as in the original MOpt:
+//   - Pilot module: each swarm is used for PILOT_PERIOD executions in turn, so that
+//     the efficiency of each operator in each swarm can be measured
+//   - Core module: the swarm which found the most is used for CORE_PERIOD executions.
+//     After that, the positions of all the swarms are moved by PSO and the pilot module starts again
+//
+// NOTE: unlike AFL's havoc, MOpt doesn't use the dictionaries in havoc.
+// We follow the paper here, so SelectCase never returns the cases about extras.
+class MOptScheduler {
+public:
+    // The mutation operators of MOpt. Each operator corresponds to one or more HavocCase
+    enum Operator : u32 {
+        FLIP1, FLIP2, FLIP4, FLIP8, FLIP16, FLIP32,
+        ARITH8, ARITH16, ARITH32,
+        INT8, INT16, INT32,
+        RAND8, DELETE, CLONE, OVERWRITE,
+        NUM_OPERATORS
+    };
+
+    static constexpr u32 NUM_SWARMS = 5;
+
+    // The counters of the core module are kept in the row after the swarms
+    static constexpr u32 CORE_ROW = NUM_SWARMS;
+
+    static constexpr u64 PILOT_PERIOD = 50000;
+    static constexpr u64 CORE_PERIOD = 500000;
+
+    static constexpr u32 G_MAX = 5000;
+    static constexpr double W_INIT = 0.9;
+    static constexpr double W_END = 0.3;
+    static constexpr double X_MIN = 0.05;
+    static constexpr double X_MAX = 1.0;
+
+    // The scheduler draws from its own stream of the worker(see AFLStateTemplate::SetWorkerId)
+    explicit MOptScheduler(u32 worker_id = 0);
+
+    MOptScheduler( const MOptScheduler& ) = delete;
+    MOptScheduler& operator=( const MOptScheduler& ) = delete;
+
+    // Pick an operator for the current child and convert it to a HavocCase
+    u32 SelectCase();
+
+    // Called when a havoc stage starts. total_finds is queued_paths + unique_crashes
+    void BeginStage(u64 total_finds);
+
+    // Called after each child of havoc is executed and saved if interesting
+    void UpdateAfterExec(u64 total_finds);
+
+    bool IsPilot() const { return pilot; }
+    u32 GetCurrentSwarm() const { return swarm_now; }
+
+    // The probability that the swarm selects the operator
+    double GetProbability(u32 swarm, u32 op) const;
+
+    // row is either a swarm or CORE_ROW
+    u64 GetHits(u32 row, u32 op) const { return hits[row * NUM_OPERATORS + op]; }
+    u64 GetFinds(u32 row, u32 op) const { return finds[row * NUM_OPERATORS + op]; }
+
+private:
+    static constexpr u32 NUM_ROWS = NUM_SWARMS + 1;
+
+    using SwarmArray = std::array<double, NUM_SWARMS * NUM_OPERATORS>;
+    using CounterArray = std::array<u64, NUM_ROWS * NUM_OPERATORS>;
+
+    u32 CurrentRow() const { return pilot ? swarm_now : CORE_ROW; }
+
+    void EndPilotPeriod();
+    void EndCorePeriod();
+    void UpdatePositions();
+    void NormalizePositions(u32 swarm);
+
+    u32 UR(u32 limit) { return rand::UniformBelow(rng, limit); }
+
+    rand::XSAdd rng;
+
+    bool pilot = true;
+    u32 swarm_now = 0;
+    u32 g_now = 0;
+    u64 period_execs = 0;
+
+    // Particle positions(i.e. the probability of each operator) and velocities,
+    // the best local positions and the efficiency measured at them
+    SwarmArray x_now;
+    SwarmArray v_now;
+    SwarmArray l_best;
+    SwarmArray eff_best;
+
+    // Cumulative sums of x_now, so that an operator can be chosen by a linear search
+    SwarmArray cumulative;
+
+    std::array<double, NUM_OPERATORS> g_best;
+
+    // How many times each operator has been applied and how many finds it has contributed to
+    CounterArray hits {};
+    CounterArray finds {};
+
+    // hits and finds at the beginning of the current period
+    CounterArray period_hits {};
+    CounterArray period_finds {};
+
+    std::array<double, NUM_SWARMS> swarm_fitness {};
+    u64 period_start_finds = 0;
+    u64 total_swarm_finds = 0;
+
+    // Operators applied to the child being built, and the finds before it is executed
+    std::array<u32, NUM_OPERATORS> child_hits {};
+    u64 last_total_finds = 0;
+};
+
+} // namespace fuzzuf::algorithm::afl
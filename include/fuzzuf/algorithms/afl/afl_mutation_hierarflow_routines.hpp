@@ -18,6 +18,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include "fuzzuf/exec_input/exec_input.hpp"
 #include "fuzzuf/algorithms/afl/afl_state.hpp"
 #include "fuzzuf/algorithms/afl/afl_mutator.hpp"
@@ -37,6 +38,9 @@ using AFLMutCalleeRef = NullableRef<HierarFlowCallee<AFLMutInputType<State>>>;
 
 using AFLMutOutputType = bool(const u8*, u32);
 
+// The output of the routines which execute PUT by themselves(e.g. BatchedHavocBaseTemplate)
+using AFLBatchedMutOutputType = bool(const u8*, u32, InplaceMemoryFeedback&, ExitStatusFeedback&);
+
 template<class State>
 struct BitFlip1WithAutoDictBuildTemplate
     : public HierarFlowRoutine<
@@ -391,10 +395,9 @@ AFLMutCalleeRef<State> DictOverwriteTemplate<State, is_auto>::operator()(
                is redundant, or if its entire span has no bytes set in the
                effector map. */
 
-            using afl::util::UR;
             if (!is_auto) {
                 if ( extras.size() > option::GetMaxDetExtras(state)
-                  && UR(state.extras.size(), state.rand_fd) >= option::GetMaxDetExtras(state)) {
+                  && state.UR(state.extras.size()) >= option::GetMaxDetExtras(state)) {
                     state.stage_max--;
                     continue;
                 }
@@ -495,8 +498,71 @@ protected:
 
 using HavocBase = HavocBaseTemplate<AFLState>;
 
+// The same as HavocBaseTemplate, except that DoHavoc generates up to state.havoc_batch_size children
+// into an arena before executing them with one RunExecutorBatchWithClassifyCounts.
+// The children are still evaluated one by one in order once the batch has finished, so the successors
+// are the update routines that would follow ExecutePUT, and they may execute PUT by themselves.
 template<class State>
-struct HavocTemplate : public HavocBaseTemplate<State> {
+struct BatchedHavocBaseTemplate
+    : public HierarFlowRoutine<
+          AFLMutInputType<State>,
+          AFLBatchedMutOutputType
+      > {
+
+public:
+    BatchedHavocBaseTemplate(State &state);
+    virtual ~BatchedHavocBaseTemplate() {}
+
+    template<typename CaseDistrib, typename CustomCases>
+    bool DoHavoc(
+        AFLMutatorTemplate<State>& mutator,
+        CaseDistrib case_distrib,
+        CustomCases custom_cases,
+        const std::string &stage_name,
+        const std::string &stage_short,
+        u32 perf_score,
+        s32 stage_max_multiplier, 
+        int stage_idx
+    );
+
+    virtual AFLMutCalleeRef<State> operator()(AFLMutatorTemplate<State>& mutator) = 0;
+
+protected:
+    State &state;
+
+private:
+    // Reused across batches so that each batch doesn't allocate
+    std::vector<u8> arena;
+    std::vector<std::size_t> offsets;
+    std::vector<u32> stackings;
+    std::vector<fuzzuf::executor::BatchInput> inputs;
+};
+
+using BatchedHavocBase = BatchedHavocBaseTemplate<AFLState>;
+
+// Wraps HavocBaseTemplate(or any other class with the same DoHavoc) so that the mutation operators
+// are chosen by state.mopt instead of the given CaseDistrib.
+// MOptUpdateTemplate must follow the execution of each child to tell the scheduler what the child found.
+template<class State, class Base = HavocBaseTemplate<State>>
+struct MOptHavocBaseTemplate : public Base {
+public:
+    MOptHavocBaseTemplate(State &state);
+
+    template<typename CaseDistrib, typename CustomCases>
+    bool DoHavoc(
+        AFLMutatorTemplate<State>& mutator,
+        CaseDistrib case_distrib,
+        CustomCases custom_cases,
+        const std::string &stage_name,
+        const std::string &stage_short,
+        u32 perf_score,
+        s32 stage_max_multiplier, 
+        int stage_idx
+    );
+};
+
+template<class State, class Base = HavocBaseTemplate<State>>
+struct HavocTemplate : public Base {
 public:
     HavocTemplate(State &state);
 
@@ -505,8 +571,8 @@ public:
 
 using Havoc = HavocTemplate<AFLState>;
 
-template<class State>
-struct SplicingTemplate : public HavocBaseTemplate<State> {
+template<class State, class Base = HavocBaseTemplate<State>>
+struct SplicingTemplate : public Base {
 public:
     SplicingTemplate(State &state);
 
@@ -515,6 +581,24 @@ public:
 
 using Splicing = SplicingTemplate<AFLState>;
 
+template<class State>
+using BatchedHavocTemplate = HavocTemplate<State, BatchedHavocBaseTemplate<State>>;
+
+template<class State>
+using BatchedSplicingTemplate = SplicingTemplate<State, BatchedHavocBaseTemplate<State>>;
+
+using BatchedHavoc = BatchedHavocTemplate<AFLState>;
+using BatchedSplicing = BatchedSplicingTemplate<AFLState>;
+
+template<class State>
+using MOptHavocTemplate = HavocTemplate<State, MOptHavocBaseTemplate<State>>;
+
+template<class State>
+using MOptSplicingTemplate = SplicingTemplate<State, MOptHavocBaseTemplate<State>>;
+
+using MOptHavoc = MOptHavocTemplate<AFLState>;
+using MOptSplicing = MOptSplicingTemplate<AFLState>;
+
 } // namespace fuzzuf::algorithm::afl::routine::mutation
 
 #include "fuzzuf/algorithms/afl/templates/afl_mutation_hierarflow_routines.hpp"
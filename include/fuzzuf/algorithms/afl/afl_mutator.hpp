@@ -51,7 +51,8 @@ public:
     // Move constructor
     AFLMutatorTemplate(AFLMutatorTemplate&&);
 
-    AFLMutatorTemplate( const ExecInput&, const State& );
+    // The mutations draw from state.mutator_rng
+    AFLMutatorTemplate( const ExecInput&, State& );
     ~AFLMutatorTemplate();
 
     u32 ChooseBlockLen(u32);
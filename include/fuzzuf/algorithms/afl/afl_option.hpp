@@ -75,14 +75,6 @@ constexpr const char* GetVersion(AFLStateTemplate<Testcase>&) {
     return "2.57b";
 }
 
-// NOTE: this function cannot have the argument
-// because this is used in afl::util.
-
-template<class Tag>
-constexpr u32 GetReseedRng(void) { 
-    return 10000;
-}
-
 // NOTE: this function cannot have the argument
 // because this is used in the declaration of member variables.
 
@@ -216,6 +208,24 @@ constexpr u32 GetCalTmoutAdd(AFLStateTemplate<Testcase>&) {
     return 50;
 }
 
+/* Granularity of the timeout scaled from the calibration when no timeout is
+   given. AFL rounds it up to 20 ms, which fast targets would spend on each
+   hang. In microseconds: */
+
+template<class Testcase>
+constexpr u32 GetExecTmRoundUs(AFLStateTemplate<Testcase>&) { 
+    return 100;
+}
+
+/* Lower bound of the timeout scaled from the calibration. Without it, a
+   target that happened to run in a few microseconds during the dry run
+   would hit the timeout on any scheduling jitter. In microseconds: */
+
+template<class Testcase>
+constexpr u32 GetExecTmoutMinUs(AFLStateTemplate<Testcase>&) { 
+    return 5000;
+}
+
 /* Number of chances to calibrate a case before giving up: */
 
 template<class Testcase>
@@ -232,7 +242,9 @@ constexpr u32 GetMapSizePow2(void) {
 }
 
 // NOTE: this function cannot have the argument
-// because this is used in the declaration of member variables.
+// because this is used before any state is created, e.g. as afl_shm_size.
+// This is the default size of the coverage map. A PUT built with AFL++ may
+// tell another one, which AFLStateTemplate::map_size follows.
 
 template<class Tag>
 constexpr u32 GetMapSize(void) { 
@@ -244,6 +256,18 @@ constexpr u32 GetStatusUpdateFreq(AFLStateTemplate<Testcase>&) {
     return 1;
 }
 
+/* Sync interval (every n havoc cycles): */
+template<class Testcase>
+constexpr u32 GetSyncInterval(AFLStateTemplate<Testcase>&) { 
+    return 5;
+}
+
+/* Maximum number of test cases of other fuzzers run as one batch: */
+template<class Testcase>
+constexpr u32 GetSyncBatchSize(AFLStateTemplate<Testcase>&) { 
+    return 64;
+}
+
 // NOTE: this function cannot have the argument
 // because this is used outside AFL.
 // Maybe we can move this to NativeLinuxExecutor?
@@ -0,0 +1,64 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <atomic>
+#include "fuzzuf/utils/common.hpp"
+#include "fuzzuf/fuzzer/fuzzer.hpp"
+
+namespace fuzzuf::algorithm::afl {
+
+// Runs several AFL-like fuzzers(workers) in threads of one process.
+// Worker is supposed to be AFLFuzzerTemplate<State> whose State refers to
+// an AFLSharedState common to all the workers; this class is only responsible
+// for the threads, and the workers exchange findings by themselves.
+// The first worker runs on the thread calling OneLoop, and the others run in
+// background threads which are started by the first call of OneLoop.
+template<class Worker>
+class AFLParallelFuzzerTemplate : public Fuzzer {
+public:
+    // cpuids[i] is the cpu core the executor of workers[i] is bound to, if any
+    explicit AFLParallelFuzzerTemplate(
+        std::vector<std::unique_ptr<Worker>>&& workers,
+        const std::vector<std::optional<int>>& cpuids
+    );
+    virtual ~AFLParallelFuzzerTemplate();
+
+    virtual void OneLoop(void);
+    virtual void ReceiveStopSignal(void);
+    virtual bool ShouldEnd(void);
+
+    std::size_t GetWorkerCount(void) const;
+
+protected:
+    void StartWorkers(void);
+    void StopWorkers(void);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::optional<int>> cpuids;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stop_requested;
+};
+
+} // namespace fuzzuf::algorithm::afl
+
+#include "fuzzuf/algorithms/afl/templates/afl_parallel_fuzzer.hpp"
@@ -0,0 +1,95 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include "fuzzuf/utils/common.hpp"
+#include "fuzzuf/utils/huge_page.hpp"
+
+namespace fuzzuf::algorithm::afl {
+
+// Responsibility:
+//   - Hold everything that the workers of a thread-parallel campaign have to share,
+//     i.e. which coverage has already been found and which inputs have been queued
+//   - The lifetime of an instance of this class must be longer than that of all AFLStates referring to it
+
+// NOTE: each worker still owns its AFLState, executor and mutator.
+// Coverage is tracked in the shared virgin maps below, which are updated with
+// afl::util::HasNewBitsAtomic, so exactly one worker wins the race to report a given bit as new.
+// The queue is shared as an append-only log: a worker publishes each input it has just
+// added to its own queue together with its trace and calibration, and other workers
+// queue the log from where they left off without executing the inputs again.
+struct AFLSharedState {
+    struct SharedTestcase {
+        u32 worker_id = 0;
+        u32 id = 0;                   /* Index in the queue of the worker */
+        std::vector<u8> buf;
+
+        /* The classified trace which was new to the campaign, kept as the
+           offsets and the values of its non-zero bytes */
+        std::vector<u32> trace_offsets;
+        std::vector<u8> trace_values;
+
+        u8 cal_failed = 0;            /* See AFLTestcase                  */
+        bool has_new_cov = false;
+        bool var_behavior = false;
+        u32 bitmap_size = 0;
+        u32 exec_cksum = 0;
+        u64 exec_us = 0;
+        u64 depth = 0;
+
+        void SetTrace(const u8 *trace_bits, u32 map_size);
+        void RestoreTrace(u8 *trace_bits) const;
+        void EraseTrace(u8 *trace_bits) const;
+    };
+
+    explicit AFLSharedState(u32 map_size);
+    ~AFLSharedState();
+
+    AFLSharedState( const AFLSharedState& ) = delete;
+    AFLSharedState& operator=( const AFLSharedState& ) = delete;
+
+    void Publish(std::shared_ptr<const SharedTestcase> testcase);
+    bool HasUnfetched(std::size_t from) const;
+    std::size_t Fetch(
+        std::size_t from,
+        std::vector<std::shared_ptr<const SharedTestcase>> &dest
+    ) const;
+
+    /* Regions yet untouched by any of the workers */
+    utils::HugePageVector<u8> virgin_bits;
+
+    /* Bits no worker has seen in tmouts */
+    utils::HugePageVector<u8> virgin_tmout;
+
+    /* Bits no worker has seen in crashes */
+    utils::HugePageVector<u8> virgin_crash;
+
+private:
+    mutable std::mutex queue_mutex;
+    std::vector<std::shared_ptr<const SharedTestcase>> queue;
+
+    // The size of queue, which can be polled without taking queue_mutex
+    std::atomic<std::size_t> published = 0;
+};
+
+} // namespace fuzzuf::algorithm::afl
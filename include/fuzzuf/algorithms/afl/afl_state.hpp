@@ -20,9 +20,13 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <map>
+#include <functional>
+#include <optional>
 
 #include "fuzzuf/utils/common.hpp"
 #include "fuzzuf/utils/filesystem.hpp"
+#include "fuzzuf/utils/huge_page.hpp"
 #include "fuzzuf/exec_input/exec_input_set.hpp"
 #include "fuzzuf/executor/native_linux_executor.hpp"
 #include "fuzzuf/feedback/inplace_memory_feedback.hpp"
@@ -32,6 +36,9 @@
 #include "fuzzuf/algorithms/afl/afl_setting.hpp"
 #include "fuzzuf/algorithms/afl/afl_macro.hpp"
 #include "fuzzuf/algorithms/afl/afl_dict_data.hpp"
+#include "fuzzuf/algorithms/afl/afl_shared_state.hpp"
+#include "fuzzuf/algorithms/afl/afl_mopt_scheduler.hpp"
+#include "fuzzuf/rand/rand.hpp"
 
 namespace fuzzuf::algorithm::afl {
 
@@ -67,6 +74,20 @@ struct AFLStateTemplate {
         u32 tmout = 0
     );
 
+    // Called for each input executed by RunExecutorBatchWithClassifyCounts, with the same feedback
+    // as RunExecutorWithClassifyCounts. Return false to skip the rest of the batch.
+    using BatchCallback = std::function<bool(std::size_t, InplaceMemoryFeedback&, ExitStatusFeedback&)>;
+
+    // Execute the inputs in order with RunBatch of the executor, and then call callback for each of them in order.
+    // callback is called after the executor has finished the batch, so that it may execute PUT by itself
+    // (e.g. CalibrateCase in SaveIfInteresting).
+    // inp_feed holds a copy of the trace only if the input has new bits, timed out or crashed.
+    // Otherwise, inp_feed is empty and nothing in SaveIfInteresting looks at it.
+    void RunExecutorBatchWithClassifyCounts(
+        const std::vector<fuzzuf::executor::BatchInput> &inputs,
+        const BatchCallback &callback
+    );
+
     PUTExitReasonType CalibrateCaseWithFeedDestroyed(
         Testcase &testcase,
         const u8 *buf,
@@ -110,6 +131,9 @@ struct AFLStateTemplate {
     void MarkAsVariable(Testcase &testcase);
     void MarkAsRedundant(Testcase &testcase, bool val);
 
+    // Called whenever top_rated[i] is replaced, so that CullQueue looks at the slot again
+    void MarkTopRatedDirty(u32 i);
+
     void WriteStatsFile(double bitmap_cvg, double stability, double eps);
     void SaveAuto(void);
     void WriteBitmap(void);
@@ -119,8 +143,15 @@ struct AFLStateTemplate {
     void FixUpBanner(const std::string &name);
     void CheckIfTty(void);
     void ReadTestcases(void);
+    void LoadAuto(void);
     void PivotInputs(void);
+    void NukeResumeDir(void);
+    void LoadPreviousSession(void);
+    u32 FindStartPosition(void);
     void PerformDryRun(void);
+    void DecideExecTimeout(void);
+    void SyncFuzzers(void);
+    u32 ImportSharedTestcases(void);
     virtual void ShowStats(void);
 
     void ReceiveStopSignal(void);
@@ -128,12 +159,21 @@ struct AFLStateTemplate {
     bool ShouldConstructAutoDict(void);
     void SetShouldConstructAutoDict(bool v);
 
+    // Set worker_id, and restart rng and mutator_rng from the streams of the worker
+    void SetWorkerId(u32 id);
+
+    // A random integer in [0, limit) drawn from rng
+    u32 UR(u32 limit);
+
     std::shared_ptr<const AFLSetting> setting;
     std::shared_ptr<NativeLinuxExecutor> executor;
-    ExecInputSet input_set;
 
-    // TODO: what if this product works on environments other than *NIX?
-    int rand_fd = -1;
+    // The size of the coverage map, and hence of the maps below which are indexed like it.
+    // It is option::GetMapSize<Tag>() unless the fork server of PUT has told the size of its map
+    // (see NativeLinuxExecutor::afl_map_size). It is a power of two in either case.
+    const u32 map_size;
+
+    ExecInputSet input_set;
 
     // these will be required in dictionary construction
     std::vector<u8> a_collect;
@@ -183,6 +223,7 @@ struct AFLStateTemplate {
     // FIXME: maybe we can split the below into subclasses?
 
     std::string sync_id;                    /* Fuzzer ID                        */
+    std::string sync_dir;                   /* Synchronization directory        */
     std::string use_banner;                 /* Display banner                   */
     std::string in_bitmap;                  /* Input bitmap                     */
     std::string orig_cmdline;               /* Original command line            */
@@ -190,7 +231,12 @@ struct AFLStateTemplate {
     /* Timeout used for hang det (ms)   */
     u32 hang_tmout = option::GetExecTimeout<Tag>();
 
+    /* Timeout of each exec (us). setting->exec_timelimit_ms unless it is
+       scaled from the calibration (see DecideExecTimeout) */
+    u64 exec_tmout_us = 0;
+
     u32 stats_update_freq = 1;              /* Stats update frequency (execs)   */
+    u32 havoc_batch_size = 1;               /* Havoc children executed at once  */
 
     bool skip_deterministic = false;        /* Skip deterministic stages?       */
     bool force_deterministic = false;       /* Force deterministic stages?      */
@@ -217,18 +263,29 @@ struct AFLStateTemplate {
     bool persistent_mode = false;           /* Running in persistent mode?      */
     bool deferred_mode = false;             /* Deferred forkserver mode?        */
     bool fast_cal = false;                  /* Try to calibrate faster?         */
+    bool quick_cal = false;                 /* Calibrate with a single run?     */
+
+    /* The virgin maps are compared with the trace after every exec, so
+       they are backed by huge pages if they are large enough. */
 
     /* Regions yet untouched by fuzzing */
-    std::vector<u8> virgin_bits; // its initialization depends on in_bitmap
+    utils::HugePageVector<u8> virgin_bits; // its initialization depends on in_bitmap
 
     /* Bits we haven't seen in tmouts   */
-    std::vector<u8> virgin_tmout = std::vector<u8>(option::GetMapSize<Tag>(), 255);
+    utils::HugePageVector<u8> virgin_tmout = utils::HugePageVector<u8>(map_size, 255);
 
     /* Bits we haven't seen in crashes  */
-    std::vector<u8> virgin_crash = std::vector<u8>(option::GetMapSize<Tag>(), 255);
+    utils::HugePageVector<u8> virgin_crash = utils::HugePageVector<u8>(map_size, 255);
 
     /* Bytes that appear to be variable */
-    std::vector<u8> var_bytes    = std::vector<u8>(option::GetMapSize<Tag>(), 0);
+    std::vector<u8> var_bytes    = std::vector<u8>(map_size, 0);
+
+    /* The first trace of the case being calibrated */
+    std::vector<u8> first_trace  = std::vector<u8>(map_size, 0);
+
+    /* What HasNewBits would return for virgin_bits on the trace of the
+       last RunExecutorWithClassifyCounts */
+    u8 trace_hnb = 0;
 
     u8 stop_soon = 0;                       /* Ctrl-C pressed?                  */
     bool clear_screen = true;               /* Window resized?                  */
@@ -285,6 +342,10 @@ struct AFLStateTemplate {
     u32 master_max = 0;                     /* Master instance job splitting    */
 
     u32 syncing_case = 0;                   /* Syncing with case #...           */
+    u32 sync_interval_cnt = 0;              /* Seeds fuzzed since last sync     */
+
+    /* The ID from which testcases of each peer should be imported next */
+    std::map<std::string, u32> sync_min_accept;
 
     s32 stage_cur_byte = 0;                 /* Byte offset of current stage op  */
     s32 stage_cur_val = 0;                  /* Value used for stage op          */
@@ -308,7 +369,26 @@ struct AFLStateTemplate {
 
     /* Top entries for bitmap bytes     */
     std::vector<NullableRef<Testcase>> top_rated
-        = std::vector<NullableRef<Testcase>>(option::GetMapSize<Tag>());
+        = std::vector<NullableRef<Testcase>>(map_size);
+
+    /* CullQueue keeps its greedy pass over top_rated across calls, and
+       redoes only the slots affected by the entries replaced since. */
+
+    /* Slots CullQueue has to look at again, and whether a slot is listed */
+    std::vector<u32> cull_pending_slots;
+    std::vector<u8> cull_pending = std::vector<u8>(map_size, 0);
+
+    /* Number of entries favored at the preceding slots covering each slot */
+    std::vector<u32> cull_cover_count = std::vector<u32>(map_size, 0);
+
+    /* The entry favored at each slot, and the trace_mini it was favored with */
+    std::vector<NullableRef<Testcase>> cull_favored
+        = std::vector<NullableRef<Testcase>>(map_size);
+    std::vector<std::shared_ptr<const std::vector<u64>>> cull_favored_mini
+        = std::vector<std::shared_ptr<const std::vector<u64>>>(map_size);
+
+    /* Entries CullQueue has already marked as redundant or not */
+    std::size_t culled_queue_size = 0;
 
     using AFLDictData = afl::dictionary::AFLDictData;
     /* Extra tokens to fuzz with        */
@@ -317,8 +397,42 @@ struct AFLStateTemplate {
     /* Automatically selected extras    */
     std::vector<AFLDictData> a_extras;
 
+    // these will be required in thread-parallel fuzzing
+    // (null shared_state means this instance is fuzzing alone)
+    std::shared_ptr<AFLSharedState> shared_state;
+    u32 worker_id = 0; // set by SetWorkerId
+    std::size_t shared_queue_pos = 0;
+
+    /* The trace of the testcase being imported, which is all zero otherwise */
+    std::vector<u8> import_trace;
+
+    // the operator scheduler of havoc and splicing
+    // (null mopt means the static distribution of AFL is used)
+    std::unique_ptr<MOptScheduler> mopt;
+
+    // The RNGs of the worker, derived from the global seed and worker_id.
+    // rng is for the decisions of the state and routines(e.g. skipping entries),
+    // and mutator_rng is for the Mutators and the operator distributions of havoc.
+    rand::XSAdd rng = rand::CreateXSAdd(0, "afl.state");
+    rand::XSAdd mutator_rng = rand::CreateXSAdd(0, "afl.mutator");
+
 private:
+    // Classify the counts of the trace in place and set trace_hnb
+    void ClassifyCounts(InplaceMemoryFeedback &inp_feed);
+
     bool should_construct_auto_dict;
+
+    // What RunExecutorBatchWithClassifyCounts keeps for each input until the batch has finished
+    struct BatchResult {
+        ExitStatusFeedback exit_status;
+        u8 trace_hnb;
+        // The offset of the trace in batch_traces, if it is kept
+        std::optional<std::size_t> trace_offset;
+    };
+
+    // Reused across batches so that each batch doesn't allocate
+    std::vector<BatchResult> batch_results;
+    std::vector<u8> batch_traces;
 };
 
 using AFLState = AFLStateTemplate<AFLTestcase>;
@@ -18,7 +18,7 @@
 #pragma once
 
 #include <memory>
-#include <bitset>
+#include <vector>
 
 #include "fuzzuf/algorithms/afl/afl_option.hpp"
 #include "fuzzuf/exec_input/on_disk_exec_input.hpp"
@@ -45,6 +45,7 @@ struct AFLTestcase {
     bool fs_redundant = false;    /* Marked as redundant in the fs?   */
 
     u32 bitmap_size = 0;          /* Number of bits set in bitmap     */
+    u32 favored_slots = 0;        /* Slots CullQueue favors it at     */
     u32 fuzz_level = 0;           /* Number of fuzzing iterations     */
     u32 exec_cksum = 0;           /* Checksum of the execution trace  */
 
@@ -52,9 +53,9 @@ struct AFLTestcase {
     u64 handicap = 0;             /* Number of queue cycles behind    */
     u64 depth = 0;                /* Path depth                       */
 
-    /* Trace bytes, if kept             */
-    std::unique_ptr<
-        std::bitset<option::GetMapSize<Tag>()>> trace_mini;
+    /* Trace bytes, if kept (see MinimizeBits). Shared because CullQueue
+       keeps what it has used even after the testcase drops it */
+    std::shared_ptr<const std::vector<u64>> trace_mini;
 
     u32 tc_ref = 0;               /* Trace bytes ref count            */
 };
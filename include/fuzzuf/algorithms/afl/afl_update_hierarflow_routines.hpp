@@ -89,6 +89,26 @@ private:
 
 using ConstructEffMap = ConstructEffMapTemplate<AFLState>;
 
+// Tell state.mopt whether the child executed last has found something.
+// Put this after NormalUpdate so that queued_paths and unique_crashes are already updated.
+template<class State>
+struct MOptUpdateTemplate
+    : public HierarFlowRoutine<
+        AFLUpdInputType,
+        AFLUpdOutputType
+    > {
+public:
+    MOptUpdateTemplate(State &state);
+
+    AFLUpdCalleeRef operator()(
+        const u8*, u32, InplaceMemoryFeedback&, ExitStatusFeedback&);
+
+private:
+    State &state;
+};
+
+using MOptUpdate = MOptUpdateTemplate<AFLState>;
+
 } // namespace fuzzuf::algorithm::afl::routine::update
 
 #include "fuzzuf/algorithms/afl/templates/afl_update_hierarflow_routines.hpp"
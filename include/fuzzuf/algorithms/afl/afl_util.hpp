@@ -18,11 +18,13 @@
 #pragma once
 
 #include <string>
+#include <vector>
 #include "fuzzuf/utils/common.hpp"
 #include "fuzzuf/mutator/havoc_case.hpp"
 #include "fuzzuf/algorithms/afl/afl_option.hpp"
 #include "fuzzuf/algorithms/afl/afl_dict_data.hpp"
 #include "fuzzuf/algorithms/afl/count_classes.hpp"
+#include "fuzzuf/rand/xsadd.hpp"
 
 namespace fuzzuf::algorithm::afl::util {
     
@@ -38,8 +40,6 @@ UInt EFF_ALEN(UInt l);
 template<class Tag, class UInt>
 UInt EFF_SPAN_ALEN(UInt p, UInt l);
 
-u32 UR(u32 limit, int rand_fd);
-
 std::string DescribeInteger(u64 val);
 std::string DescribeFloat(double val);
 std::string DescribeMemorySize(u64 val);
@@ -51,9 +51,12 @@ void ClassifyCounts(UInt *mem, u32 map_size);
 template<class UInt>
 void SimplifyTrace(UInt *mem, u32 map_size);
 
+std::vector<u64> MinimizeBits(const u8 *trace_bits, u32 map_size);
+
 constexpr std::array<double, NUM_CASE> AFLGetCaseWeights(bool has_extras, bool has_aextras);
 
 u32 AFLHavocCaseDistrib(
+    rand::XSAdd& rng,
     const std::vector<dictionary::AFLDictData>& extras,
     const std::vector<dictionary::AFLDictData>& a_extras
 );
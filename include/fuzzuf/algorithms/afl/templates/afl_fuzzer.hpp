@@ -38,7 +38,9 @@ AFLFuzzerTemplate<State>::AFLFuzzerTemplate(
     state->CheckIfTty();
 
     state->ReadTestcases();
+    state->LoadAuto();
     state->PivotInputs();
+    state->LoadPreviousSession();
     state->PerformDryRun();
 }
 
@@ -80,8 +82,6 @@ void AFLFuzzerTemplate<State>::BuildFuzzFlow() {
     auto user_dict_overwrite = CreateNode<UserDictOverwriteTemplate<State>>(*state);
     auto user_dict_insert = CreateNode<UserDictInsertTemplate<State>>(*state);
     auto auto_dict_overwrite = CreateNode<AutoDictOverwriteTemplate<State>>(*state);
-    auto havoc = CreateNode<HavocTemplate<State>>(*state);
-    auto splicing = CreateNode<SplicingTemplate<State>>(*state);
 
     // execution
     auto execute = CreateNode<ExecutePUTTemplate<State>>(*state);
@@ -112,12 +112,38 @@ void AFLFuzzerTemplate<State>::BuildFuzzFlow() {
           || user_dict_overwrite << execute.HardLink() << normal_update.HardLink()
           || auto_dict_overwrite << execute.HardLink() << normal_update.HardLink()
          )
-       || apply_rand_muts << (
-               havoc << execute.HardLink() << normal_update.HardLink()
-            || splicing << execute.HardLink() << normal_update.HardLink()
-          )
+       || apply_rand_muts
        || abandon_node
     );
+
+    // With state->mopt, the operators of havoc and splicing are scheduled by MOpt.
+    // With havoc_batch_size > 1, havoc and splicing execute the batch of children by themselves
+    if (state->mopt) {
+        auto mopt_havoc = CreateNode<MOptHavocTemplate<State>>(*state);
+        auto mopt_splicing = CreateNode<MOptSplicingTemplate<State>>(*state);
+        auto mopt_update = CreateNode<MOptUpdateTemplate<State>>(*state);
+
+        apply_rand_muts << (
+             mopt_havoc << execute.HardLink() << (normal_update.HardLink() || mopt_update)
+          || mopt_splicing << execute.HardLink() << (normal_update.HardLink() || mopt_update.HardLink())
+        );
+    } else if (state->havoc_batch_size > 1) {
+        auto batched_havoc = CreateNode<BatchedHavocTemplate<State>>(*state);
+        auto batched_splicing = CreateNode<BatchedSplicingTemplate<State>>(*state);
+
+        apply_rand_muts << (
+             batched_havoc << normal_update.HardLink()
+          || batched_splicing << normal_update.HardLink()
+        );
+    } else {
+        auto havoc = CreateNode<HavocTemplate<State>>(*state);
+        auto splicing = CreateNode<SplicingTemplate<State>>(*state);
+
+        apply_rand_muts << (
+             havoc << execute.HardLink() << normal_update.HardLink()
+          || splicing << execute.HardLink() << normal_update.HardLink()
+        );
+    }
 }
 
 template<class State>
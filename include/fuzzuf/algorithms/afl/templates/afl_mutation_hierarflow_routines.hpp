@@ -17,6 +17,7 @@
  */
 #pragma once
 
+#include <algorithm>
 #include "fuzzuf/utils/common.hpp"
 #include "fuzzuf/exec_input/exec_input.hpp"
 
@@ -409,9 +410,7 @@ bool HavocBaseTemplate<State>::DoHavoc(
        where we take the input file and make random stacked tweaks. */
 
     for (state.stage_cur = 0; state.stage_cur < state.stage_max; state.stage_cur++) {
-        using afl::util::UR;
-
-        u32 use_stacking = 1 << (1 + UR(option::GetHavocStackPow2(state), state.rand_fd));
+        u32 use_stacking = 1 << (1 + state.UR(option::GetHavocStackPow2(state)));
 
         state.stage_cur_val = use_stacking;
         mutator.Havoc(use_stacking, state.extras, state.a_extras, case_distrib, custom_cases);
@@ -434,6 +433,15 @@ bool HavocBaseTemplate<State>::DoHavoc(
 
             havoc_queued = state.queued_paths;
         }
+
+        /* In thread-parallel fuzzing, queue what the other workers have found
+           without waiting for this entry to be done. They are not our finds. */
+
+        if (state.shared_state) {
+            u32 imported = state.ImportSharedTestcases();
+            havoc_queued += imported;
+            orig_hit_cnt += imported;
+        }
     }
 
     u64 new_hit_cnt = state.queued_paths + state.unique_crashes;
@@ -444,11 +452,160 @@ bool HavocBaseTemplate<State>::DoHavoc(
 }
 
 template<class State>
-HavocTemplate<State>::HavocTemplate(State &state)
-  : HavocBaseTemplate<State>(state) {}
+BatchedHavocBaseTemplate<State>::BatchedHavocBaseTemplate(State &state)
+    : state(state) {}
 
+// The children of a batch are generated from the same buffer as in HavocBaseTemplate::DoHavoc,
+// so the only difference is when they are executed. The bookkeeping done per child there
+// (stage_cur, stage_cur_val and extending stage_max) is done in the callback of the batch.
 template<class State>
-AFLMutCalleeRef<State> HavocTemplate<State>::operator()(
+template<typename CaseDistrib, typename CustomCases>
+bool BatchedHavocBaseTemplate<State>::DoHavoc(
+    AFLMutatorTemplate<State>& mutator,
+    CaseDistrib case_distrib,
+    CustomCases custom_cases,
+    const std::string &stage_name,
+    const std::string &stage_short,
+    u32 perf_score,
+    s32 stage_max_multiplier, // see HavocBaseTemplate::DoHavoc
+    int stage_idx
+) {
+    state.stage_name = stage_name;
+    state.stage_short = stage_short;
+    state.stage_max = stage_max_multiplier * perf_score / state.havoc_div / 100;
+    state.stage_cur_byte = -1;
+
+    if (state.stage_max < option::GetHavocMin(state)) {
+        state.stage_max = option::GetHavocMin(state);
+    }
+
+    u64 orig_hit_cnt = state.queued_paths + state.unique_crashes;
+
+    u64 havoc_queued = state.queued_paths;
+
+    state.stage_cur = 0;
+    while (state.stage_cur < state.stage_max) {
+        u32 batch_size = std::min(std::max(state.havoc_batch_size, 1u),
+                                  static_cast<u32>(state.stage_max - state.stage_cur));
+
+        /* Generate the whole batch first. out_buf is restored after each
+           child, so every child is derived from the same input. */
+
+        arena.clear();
+        offsets.clear();
+        stackings.clear();
+
+        for (u32 i = 0; i < batch_size; i++) {
+            u32 use_stacking = 1 << (1 + state.UR(option::GetHavocStackPow2(state)));
+
+            mutator.Havoc(use_stacking, state.extras, state.a_extras, case_distrib, custom_cases);
+
+            offsets.emplace_back(arena.size());
+            stackings.emplace_back(use_stacking);
+            arena.insert(arena.end(), mutator.GetBuf(), mutator.GetBuf() + mutator.GetLen());
+
+            mutator.RestoreHavoc();
+        }
+        offsets.emplace_back(arena.size());
+
+        /* The arena doesn't move any more, so the inputs can point into it. */
+
+        inputs.clear();
+        for (u32 i = 0; i < batch_size; i++) {
+            inputs.push_back({ arena.data() + offsets[i],
+                               static_cast<u32>(offsets[i + 1] - offsets[i]) });
+        }
+
+        u32 batch_begin = state.stage_cur;
+        bool should_abort = false;
+
+        state.RunExecutorBatchWithClassifyCounts(
+            inputs,
+            [&](std::size_t i, InplaceMemoryFeedback &inp_feed, ExitStatusFeedback &exit_status) {
+                state.stage_cur = batch_begin + i;
+                state.stage_cur_val = stackings[i];
+
+                if (this->CallSuccessors(inputs[i].buf, inputs[i].len, inp_feed, exit_status)) {
+                    should_abort = true;
+                    return false;
+                }
+
+                /* If we're finding new stuff, let's run for a bit longer, limits
+                   permitting. */
+
+                if (state.queued_paths != havoc_queued) {
+                    if (perf_score <= option::GetHavocMaxMult(state) * 100) {
+                        state.stage_max *= 2;
+                        perf_score *= 2;
+                    }
+
+                    havoc_queued = state.queued_paths;
+                }
+
+                return true;
+            }
+        );
+
+        if (should_abort) return true;
+
+        state.stage_cur = batch_begin + batch_size;
+
+        /* In thread-parallel fuzzing, queue what the other workers have found
+           between the batches. They are not our finds. */
+
+        if (state.shared_state) {
+            u32 imported = state.ImportSharedTestcases();
+            havoc_queued += imported;
+            orig_hit_cnt += imported;
+        }
+    }
+
+    u64 new_hit_cnt = state.queued_paths + state.unique_crashes;
+    state.stage_finds[stage_idx] += new_hit_cnt - orig_hit_cnt;
+    state.stage_cycles[stage_idx] += state.stage_max;
+
+    return false;
+}
+
+template<class State, class Base>
+MOptHavocBaseTemplate<State, Base>::MOptHavocBaseTemplate(State &state)
+    : Base(state) {}
+
+template<class State, class Base>
+template<typename CaseDistrib, typename CustomCases>
+bool MOptHavocBaseTemplate<State, Base>::DoHavoc(
+    AFLMutatorTemplate<State>& mutator,
+    CaseDistrib /* unused */,
+    CustomCases custom_cases,
+    const std::string &stage_name,
+    const std::string &stage_short,
+    u32 perf_score,
+    s32 stage_max_multiplier,
+    int stage_idx
+) {
+    auto &mopt = *this->state.mopt;
+
+    mopt.BeginStage(this->state.queued_paths + this->state.unique_crashes);
+
+    using afl::dictionary::AFLDictData;
+
+    return Base::DoHavoc(
+               mutator,
+               [&mopt](const std::vector<AFLDictData>&, const std::vector<AFLDictData>&) {
+                   return mopt.SelectCase();
+               },
+               custom_cases,
+               stage_name, stage_short,
+               perf_score, stage_max_multiplier,
+               stage_idx);
+}
+
+template<class State, class Base>
+HavocTemplate<State, Base>::HavocTemplate(State &state)
+  : Base(state) {}
+
+template<class State, class Base>
+AFLMutCalleeRef<State> HavocTemplate<State, Base>::operator()(
     AFLMutatorTemplate<State>& mutator
 ) {
     // Declare the alias just to omit "this->" in this function.
@@ -463,8 +620,10 @@ AFLMutCalleeRef<State> HavocTemplate<State>::operator()(
 
     if (this->DoHavoc(
                 mutator,
-                AFLHavocCaseDistrib,
-                [](int, u8*&, u32&, const std::vector<AFLDictData>&, const std::vector<AFLDictData>&){},
+                [&state](const std::vector<AFLDictData>& extras, const std::vector<AFLDictData>& a_extras) {
+                    return AFLHavocCaseDistrib(state.mutator_rng, extras, a_extras);
+                },
+                [](int, std::vector<u8>&, u32&, const std::vector<AFLDictData>&, const std::vector<AFLDictData>&){},
                 "havoc", "havoc",
                 state.orig_perf, stage_max_multiplier,
                 option::STAGE_HAVOC)) {
@@ -475,12 +634,12 @@ AFLMutCalleeRef<State> HavocTemplate<State>::operator()(
     return this->GoToDefaultNext();
 }
 
-template<class State>
-SplicingTemplate<State>::SplicingTemplate(State &state)
-    : HavocBaseTemplate<State>(state) {}
+template<class State, class Base>
+SplicingTemplate<State, Base>::SplicingTemplate(State &state)
+    : Base(state) {}
 
-template<class State>
-AFLMutCalleeRef<State> SplicingTemplate<State>::operator()(
+template<class State, class Base>
+AFLMutCalleeRef<State> SplicingTemplate<State, Base>::operator()(
     AFLMutatorTemplate<State>& mutator
 ) {
     // Declare the alias just to omit "this->" in this function.
@@ -499,8 +658,7 @@ AFLMutCalleeRef<State> SplicingTemplate<State>::operator()(
 
         u32 tid;
         do {
-            using afl::util::UR;
-            tid = UR(state.queued_paths, state.rand_fd);
+            tid = state.UR(state.queued_paths);
         } while (tid == state.current_entry);
 
         /* Make sure that the target has a reasonable length. */
@@ -531,8 +689,10 @@ AFLMutCalleeRef<State> SplicingTemplate<State>::operator()(
         using afl::dictionary::AFLDictData;
 
         if (this->DoHavoc(mutator,
-                    AFLHavocCaseDistrib,
-                    [](int, u8*&, u32&, const std::vector<AFLDictData>&, const std::vector<AFLDictData>&){},
+                    [&state](const std::vector<AFLDictData>& extras, const std::vector<AFLDictData>& a_extras) {
+                        return AFLHavocCaseDistrib(state.mutator_rng, extras, a_extras);
+                    },
+                    [](int, std::vector<u8>&, u32&, const std::vector<AFLDictData>&, const std::vector<AFLDictData>&){},
                     Util::StrPrintf("splice %u", splice_cycle),
                     "splice",
                     state.orig_perf, option::GetSpliceHavoc(state),
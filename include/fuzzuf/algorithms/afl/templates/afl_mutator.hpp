@@ -32,8 +32,8 @@ namespace fuzzuf::algorithm::afl {
 template<class State>
 AFLMutatorTemplate<State>::AFLMutatorTemplate(
     const ExecInput &input,
-    const State& state
-) : Mutator<typename State::Tag>(input),
+    State& state
+) : Mutator<typename State::Tag>(input, state.mutator_rng),
     state(state) {}
 
 template<class State>
@@ -53,12 +53,7 @@ u32 AFLMutatorTemplate<State>::ChooseBlockLen(u32 limit) {
 
     if (!state.run_over10m) rlim = 1;
 
-    // just an alias of afl::util::UR
-    auto UR = [this](u32 limit) {
-        return afl::util::UR(limit, state.rand_fd);
-    };
-
-    switch (UR(rlim)) {
+    switch (this->UR(rlim)) {
     case 0:  min_value = 1;
              max_value = option::GetHavocBlkSmall<Tag>();
              break;
@@ -67,7 +62,7 @@ u32 AFLMutatorTemplate<State>::ChooseBlockLen(u32 limit) {
              max_value = option::GetHavocBlkMedium<Tag>();
              break;
     default:
-        if (UR(10)) {
+        if (this->UR(10)) {
             min_value = option::GetHavocBlkMedium<Tag>();
             max_value = option::GetHavocBlkLarge<Tag>();
         } else {
@@ -78,7 +73,7 @@ u32 AFLMutatorTemplate<State>::ChooseBlockLen(u32 limit) {
 
     if (min_value >= limit) min_value = 1;
 
-    return min_value + UR(std::min(max_value, limit) - min_value + 1);
+    return min_value + this->UR(std::min(max_value, limit) - min_value + 1);
 }
 
 // FIXME: these three functions easily get buggy and
@@ -17,6 +17,10 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <functional>
+#include <vector>
+
 #include "fuzzuf/hierarflow/hierarflow_routine.hpp"
 #include "fuzzuf/hierarflow/hierarflow_node.hpp"
 #include "fuzzuf/hierarflow/hierarflow_intermediates.hpp"
@@ -32,38 +36,118 @@ template<class State>
 CullQueueTemplate<State>::CullQueueTemplate(State &state)
     : state(state) {}
 
+/* The same greedy pass as cull_queue() of the original AFL: walking top_rated
+   in the order of slots, the entry of each slot is favored unless the slot is
+   covered by the trace_mini of an entry favored at a preceding slot.
+
+   Instead of redoing the whole pass, we keep how many favored entries cover
+   each slot(cull_cover_count). The decision at a slot changes only if its
+   entry has been replaced or the count crosses zero, and such a change can only
+   affect the following slots. So we process the slots in ascending order with
+   a min-heap, starting from the slots replaced since the last call, and push
+   the slots whose count crosses zero on the way. This gives the same favored
+   set as the full pass in time proportional to what has changed. */
+
 template<class State>
 NullableRef<HierarFlowCallee<void(void)>> CullQueueTemplate<State>::operator()(void) {
     if (state.setting->dumb_mode || !state.score_changed) return GoToDefaultNext();
 
-    using Tag = typename State::Tag;
+    using Testcase = typename State::OwnTestcase;
 
     state.score_changed = false;
 
-    std::bitset<option::GetMapSize<Tag>()> has_top_rated;
+    auto& pending = state.cull_pending_slots;
+    auto slot_greater = std::greater<u32>();
 
-    state.queued_favored = 0;
-    state.pending_favored = 0;
+    const auto Push = [&state = this->state, &pending, slot_greater](u32 j) {
+        if (state.cull_pending[j]) return;
 
-    for (const auto& testcase : state.case_queue) {
-        testcase->favored = false;
-    }
+        state.cull_pending[j] = 1;
+        pending.emplace_back(j);
+        std::push_heap(pending.begin(), pending.end(), slot_greater);
+    };
+
+    // Count(or uncount) the slots after i covered by mini
+    const auto Cover = [&state = this->state, &Push](u32 i, const std::vector<u64>& mini, bool add) {
+        u32 first = i + 1;
+        for (u32 w = first >> 6; w < mini.size(); w++) {
+            u64 bits = mini[w];
+            if (w == (first >> 6)) bits &= ~0ULL << (first & 63);
+
+            while (bits) {
+                u32 j = (w << 6) | __builtin_ctzll(bits);
+                bits &= bits - 1;
+
+                if (add) {
+                    if (state.cull_cover_count[j]++ == 0) Push(j);
+                } else {
+                    if (--state.cull_cover_count[j] == 0) Push(j);
+                }
+            }
+        }
+    };
+
+    // The entries whose favored_slots has crossed zero
+    std::vector<std::reference_wrapper<Testcase>> changed;
+
+    std::make_heap(pending.begin(), pending.end(), slot_greater);
+
+    while (!pending.empty()) {
+        std::pop_heap(pending.begin(), pending.end(), slot_greater);
+        u32 i = pending.back();
+        pending.pop_back();
+        state.cull_pending[i] = 0;
+
+        NullableRef<Testcase> next = std::nullopt;
+        if (state.top_rated[i] && state.cull_cover_count[i] == 0) next = state.top_rated[i];
 
-    for (u32 i=0; i < option::GetMapSize<Tag>(); i++) {
-        if (state.top_rated[i] && !has_top_rated[i]) {
-            auto &top_testcase = state.top_rated[i].value().get();
+        auto& prev = state.cull_favored[i];
+        auto& prev_mini = state.cull_favored_mini[i];
 
-            has_top_rated |= *(top_testcase.trace_mini);
+        Testcase* prev_ptr = prev ? &prev.value().get() : nullptr;
+        Testcase* next_ptr = next ? &next.value().get() : nullptr;
 
-            top_testcase.favored = true;
-            state.queued_favored++;
+        if (prev_ptr == next_ptr && (!next_ptr || prev_mini == next_ptr->trace_mini)) continue;
 
-            if (!top_testcase.WasFuzzed()) state.pending_favored++;
+        if (prev_ptr) {
+            Cover(i, *prev_mini, false);
+            if (--prev_ptr->favored_slots == 0) changed.emplace_back(*prev_ptr);
         }
+
+        if (next_ptr) {
+            Cover(i, *next_ptr->trace_mini, true);
+            if (next_ptr->favored_slots++ == 0) changed.emplace_back(*next_ptr);
+        }
+
+        prev = next;
+        prev_mini = next_ptr ? next_ptr->trace_mini : nullptr;
+    }
+
+    /* An entry can be favored at several slots, e.g. at the slots it has won
+       but its trace_mini doesn't cover. It is favored as long as it is favored
+       at any slot, so the flag and the counts follow only the entries whose
+       favored_slots has crossed zero, and only if it ends up on the other side. */
+
+    for (Testcase& testcase : changed) {
+        bool now_favored = testcase.favored_slots > 0;
+
+        if (testcase.favored != now_favored) {
+            testcase.favored = now_favored;
+            if (now_favored) {
+                state.queued_favored++;
+                if (!testcase.WasFuzzed()) state.pending_favored++;
+            } else {
+                state.queued_favored--;
+                if (!testcase.WasFuzzed()) state.pending_favored--;
+            }
+        }
+
+        state.MarkAsRedundant(testcase, !testcase.favored);
     }
 
-    for (const auto& testcase : state.case_queue) {
-        state.MarkAsRedundant(*testcase, !testcase->favored);
+    for (; state.culled_queue_size < state.case_queue.size(); state.culled_queue_size++) {
+        auto& testcase = *state.case_queue[state.culled_queue_size];
+        state.MarkAsRedundant(testcase, !testcase.favored);
     }
 
     return GoToDefaultNext();
@@ -97,10 +181,8 @@ NullableRef<HierarFlowCallee<void(void)>> SelectSeedTemplate<State>::operator()(
 
         prev_queued = state.queued_paths;
 
-#if 0
-        if (sync_id && queue_cycle == 1 && getenv("AFL_IMPORT_FIRST"))
-            sync_fuzzers(use_argv);
-#endif
+        if (!state.sync_id.empty() && state.queue_cycle == 1 && getenv("AFL_IMPORT_FIRST"))
+            state.SyncFuzzers();
 
         DEBUG_ASSERT(state.current_entry < state.case_queue.size());
     }
@@ -110,14 +192,15 @@ NullableRef<HierarFlowCallee<void(void)>> SelectSeedTemplate<State>::operator()(
     this->CallSuccessors(testcase);
     state.current_entry++;
 
-#if 0
-    auto skipped_fuzz = CallSuccessors(testcase);
+    if (!state.stop_soon && !state.sync_id.empty()) {
+        if (!(state.sync_interval_cnt++ % option::GetSyncInterval(state)))
+            state.SyncFuzzers();
+    }
 
-    if (!state.stop_soon && state.sync_id && !skipped_fuzz) {
-      if (!(state.sync_interval_cnt++ % option::GetSyncInterval(state)))
-        SyncFuzzers(use_argv);
+    // In thread-parallel fuzzing, pick up what the other workers have found
+    if (!state.stop_soon && state.shared_state) {
+        state.ImportSharedTestcases();
     }
-#endif
 
     return this->GoToDefaultNext();
 }
@@ -131,11 +214,6 @@ template<class State>
 AFLMidCalleeRef<State> ConsiderSkipMutTemplate<State>::operator()(
     std::shared_ptr<typename State::OwnTestcase> testcase
 ) {
-    // just an alias of afl::util::UR
-    auto UR = [this](u32 limit) {
-        return afl::util::UR(limit, state.rand_fd);
-    };
-
     if (state.setting->ignore_finds) {
         if (testcase->depth > 1) {
             this->SetResponseValue(true);
@@ -144,7 +222,7 @@ AFLMidCalleeRef<State> ConsiderSkipMutTemplate<State>::operator()(
     } else {
         if (state.pending_favored) {
             if ( (testcase->WasFuzzed() || !testcase->favored)
-              && UR(100) < option::GetSkipToNewProb(state)) {
+              && state.UR(100) < option::GetSkipToNewProb(state)) {
                 this->SetResponseValue(true);
                 return this->GoToParent();
             }
@@ -152,12 +230,12 @@ AFLMidCalleeRef<State> ConsiderSkipMutTemplate<State>::operator()(
                    !testcase->favored &&
                    state.queued_paths > 10) {
             if (state.queue_cycle > 1 && !testcase->WasFuzzed()) {
-                if (UR(100) < option::GetSkipNfavNewProb(state)) {
+                if (state.UR(100) < option::GetSkipNfavNewProb(state)) {
                     this->SetResponseValue(true);
                     return this->GoToParent();
                 }
             } else {
-                if (UR(100) < option::GetSkipNfavOldProb(state)) {
+                if (state.UR(100) < option::GetSkipNfavOldProb(state)) {
                     this->SetResponseValue(true);
                     return this->GoToParent();
                 }
@@ -376,7 +454,7 @@ static PUTExitReasonType DoTrimCase(
         state.UpdateBitmapScoreWithRawTrace(
             testcase,
             pers_feed.mem.get(),
-            option::GetMapSize<typename State::Tag>()
+            state.map_size
         );
     }
 
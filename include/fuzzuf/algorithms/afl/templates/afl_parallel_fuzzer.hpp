@@ -0,0 +1,132 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <sched.h>
+#include "fuzzuf/logger/logger.hpp"
+
+namespace fuzzuf::algorithm::afl {
+
+template<class Worker>
+AFLParallelFuzzerTemplate<Worker>::AFLParallelFuzzerTemplate(
+    std::vector<std::unique_ptr<Worker>>&& workers,
+    const std::vector<std::optional<int>>& cpuids
+) :
+    workers(std::move(workers)),
+    cpuids(cpuids),
+    stop_requested(false)
+{
+    if (this->workers.empty()) {
+        ERROR("At least one worker is required");
+    }
+
+    if (this->cpuids.size() != this->workers.size()) {
+        ERROR("The number of cpu cores does not match the number of workers");
+    }
+}
+
+template<class Worker>
+AFLParallelFuzzerTemplate<Worker>::~AFLParallelFuzzerTemplate() {
+    StopWorkers();
+}
+
+/**
+ * Precondition:
+ *   - Executors of all the workers have already been created, on the calling thread
+ * Postcondition:
+ *   - Every worker except the first one is looping in its own thread,
+ *     bound to the same cpu core as its executor
+ * Note:
+ *   - sched_setaffinity in the executors only binds the calling thread, and each call
+ *     overrides the previous one. Hence each thread has to bind itself again here.
+ */
+template<class Worker>
+void AFLParallelFuzzerTemplate<Worker>::StartWorkers(void) {
+    auto bind = [this](std::size_t i) {
+#ifdef __linux__
+        if (!cpuids[i]) return;
+
+        cpu_set_t c;
+        CPU_ZERO(&c);
+        CPU_SET(cpuids[i].value(), &c);
+
+        if (sched_setaffinity(0, sizeof(c), &c)) ERROR("sched_setaffinity failed");
+#else
+        (void)i;
+#endif
+    };
+
+    bind(0);
+
+    for (std::size_t i = 1; i < workers.size(); i++) {
+        threads.emplace_back([this, bind, i]() {
+            bind(i);
+
+            auto& worker = *workers[i];
+            while (!stop_requested.load(std::memory_order_relaxed) && !worker.ShouldEnd()) {
+                worker.OneLoop();
+            }
+        });
+    }
+}
+
+template<class Worker>
+void AFLParallelFuzzerTemplate<Worker>::StopWorkers(void) {
+    stop_requested.store(true, std::memory_order_relaxed);
+
+    for (auto& worker : workers) {
+        worker->ReceiveStopSignal();
+    }
+
+    for (auto& thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+    threads.clear();
+}
+
+template<class Worker>
+void AFLParallelFuzzerTemplate<Worker>::OneLoop(void) {
+    if (threads.empty() && workers.size() > 1) {
+        StartWorkers();
+    }
+
+    workers[0]->OneLoop();
+}
+
+// Do not call non aync-signal-safe functions inside
+// because this function can be called during signal handling
+template<class Worker>
+void AFLParallelFuzzerTemplate<Worker>::ReceiveStopSignal(void) {
+    stop_requested.store(true, std::memory_order_relaxed);
+
+    for (auto& worker : workers) {
+        worker->ReceiveStopSignal();
+    }
+}
+
+template<class Worker>
+bool AFLParallelFuzzerTemplate<Worker>::ShouldEnd(void) {
+    return stop_requested.load(std::memory_order_relaxed) || workers[0]->ShouldEnd();
+}
+
+template<class Worker>
+std::size_t AFLParallelFuzzerTemplate<Worker>::GetWorkerCount(void) const {
+    return workers.size();
+}
+
+} // namespace fuzzuf::algorithm::afl
@@ -18,6 +18,7 @@
 #pragma once
 
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <vector>
 #include <string>
 #include <memory>
@@ -25,6 +26,7 @@
 #include "fuzzuf/logger/logger.hpp"
 #include "fuzzuf/utils/common.hpp"
 #include "fuzzuf/utils/filesystem.hpp"
+#include "fuzzuf/utils/numa.hpp"
 #include "fuzzuf/exec_input/exec_input.hpp"
 #include "fuzzuf/exec_input/exec_input_set.hpp"
 #include "fuzzuf/executor/native_linux_executor.hpp"
@@ -33,6 +35,7 @@
 #include "fuzzuf/algorithms/afl/afl_option.hpp"
 #include "fuzzuf/algorithms/afl/afl_setting.hpp"
 #include "fuzzuf/algorithms/afl/afl_util.hpp"
+#include "fuzzuf/algorithms/afl/afl_bitmap.hpp"
 #include "fuzzuf/algorithms/afl/afl_macro.hpp"
 #include "fuzzuf/algorithms/afl/afl_dict_data.hpp"
 #include "fuzzuf/algorithms/afl/afl_update_hierarflow_routines.hpp"
@@ -47,15 +50,36 @@ AFLStateTemplate<Testcase>::AFLStateTemplate(
 )
     : setting( setting ),
       executor( executor ),
+      map_size( executor->afl_map_size_negotiated
+                    ? executor->afl_map_size
+                    : option::GetMapSize<Tag>() ),
       input_set(),
-      rand_fd( Util::OpenFile("/dev/urandom", O_RDONLY | O_CLOEXEC) ),
       should_construct_auto_dict(false)
 {
-    if (in_bitmap.empty()) virgin_bits.assign(option::GetMapSize<Tag>(), 255);
+    exec_tmout_us = static_cast<u64>(setting->exec_timelimit_ms) * 1000;
+
+    if (in_bitmap.empty()) virgin_bits.assign(map_size, 255);
     else {
         ReadBitmap(in_bitmap);
     }
 
+    /* Keep the virgin maps on the NUMA node of the core the executor is
+       bound to, next to the trace they are compared with. */
+
+    if (executor->binded_cpuid.has_value()) {
+        int node = utils::GetNumaNodeOfCpu(executor->binded_cpuid.value());
+        utils::PreferNumaNode(virgin_bits.data(), virgin_bits.size(), node);
+        utils::PreferNumaNode(virgin_tmout.data(), virgin_tmout.size(), node);
+        utils::PreferNumaNode(virgin_crash.data(), virgin_crash.size(), node);
+    }
+
+    /* RunExecutorWithClassifyCounts scans the whole map after every exec,
+       so it can tell the executor which part of the map needs resetting. */
+
+    if (executor->afl_map_size == map_size) {
+        executor->afl_dirty_regions.Enable();
+    }
+
     /* Gnuplot output file. */
 
     auto plot_fn = setting->out_dir / "plot_data";
@@ -69,11 +93,6 @@ AFLStateTemplate<Testcase>::AFLStateTemplate(
 
 template<class Testcase>
 AFLStateTemplate<Testcase>::~AFLStateTemplate() {
-    if (rand_fd != -1) {
-        Util::CloseFile(rand_fd);
-        rand_fd = -1;
-    }
-
     fclose(plot_file);
 }
 
@@ -87,7 +106,7 @@ InplaceMemoryFeedback AFLStateTemplate<Testcase>::RunExecutorWithClassifyCounts(
     total_execs++;
 
     if (tmout == 0) {
-        executor->Run(buf, len);
+        executor->RunWithTimeoutUs(buf, len, exec_tmout_us);
     } else {
         executor->Run(buf, len, tmout);
     }
@@ -95,21 +114,75 @@ InplaceMemoryFeedback AFLStateTemplate<Testcase>::RunExecutorWithClassifyCounts(
     auto inp_feed = executor->GetAFLFeedback();
     exit_status = executor->GetExitStatusFeedback();
 
-    if constexpr (sizeof(size_t) == 8) {
-        inp_feed.ModifyMemoryWithFunc(
-            [](u8* trace_bits, u32 /* map_size */) {
-                afl::util::ClassifyCounts<u64>((u64*)trace_bits, option::GetMapSize<Tag>());
-            }
-        );
-    } else {
-        inp_feed.ModifyMemoryWithFunc(
-            [](u8* trace_bits, u32 /* map_size */) {
-                afl::util::ClassifyCounts<u32>((u32*)trace_bits, option::GetMapSize<Tag>());
+    ClassifyCounts(inp_feed);
+
+    return InplaceMemoryFeedback(std::move(inp_feed));
+}
+
+template<class Testcase>
+void AFLStateTemplate<Testcase>::RunExecutorBatchWithClassifyCounts(
+    const std::vector<fuzzuf::executor::BatchInput> &inputs,
+    const BatchCallback &callback
+) {
+    batch_results.clear();
+    batch_traces.clear();
+
+    executor->RunBatchWithTimeoutUs(
+        inputs,
+        [this](std::size_t /* i */, const ExitStatusFeedback &exit_status) {
+            total_execs++;
+
+            auto inp_feed = executor->GetAFLFeedback();
+
+            ClassifyCounts(inp_feed);
+
+            /* The trace is overwritten by the next input. Copy it only if
+               SaveIfInteresting may look at it, which is rare. */
+
+            std::optional<std::size_t> trace_offset;
+            if (trace_hnb || exit_status.exit_reason != PUTExitReasonType::FAULT_NONE) {
+                trace_offset = batch_traces.size();
+                inp_feed.ShowMemoryToFunc(
+                    [this](const u8* trace_bits, u32 len) {
+                        batch_traces.insert(batch_traces.end(), trace_bits, trace_bits + len);
+                    }
+                );
             }
-        );
+
+            batch_results.push_back({ exit_status, trace_hnb, trace_offset });
+
+            return !stop_soon;
+        },
+        exec_tmout_us
+    );
+
+    /* The executor is idle from here, so callback can execute PUT. */
+
+    for (std::size_t i = 0; i < batch_results.size(); i++) {
+        auto &result = batch_results[i];
+
+        InplaceMemoryFeedback inp_feed;
+        if (result.trace_offset) {
+            inp_feed = InplaceMemoryFeedback(&batch_traces[*result.trace_offset], map_size, nullptr);
+        }
+        trace_hnb = result.trace_hnb;
+
+        if (!callback(i, inp_feed, result.exit_status)) break;
     }
+}
 
-    return InplaceMemoryFeedback(std::move(inp_feed));
+template<class Testcase>
+void AFLStateTemplate<Testcase>::ClassifyCounts(InplaceMemoryFeedback &inp_feed) {
+    /* Compare the trace with virgin_bits while it is still hot in the cache.
+       HasNewBits walks the map again only if something new shows up. */
+
+    inp_feed.ModifyMemoryWithFunc(
+        [this](u8* trace_bits, u32 /* map_size */) {
+            trace_hnb = afl::util::ClassifyCountsAndCheckNewBits(
+                            trace_bits, &virgin_bits[0], map_size,
+                            &executor->afl_dirty_regions);
+        }
+    );
 }
 
 template<class Testcase>
@@ -122,34 +195,32 @@ PUTExitReasonType AFLStateTemplate<Testcase>::CalibrateCaseWithFeedDestroyed(
     u32 handicap,
     bool from_queue
 ) {
-    std::array<u8, option::GetMapSize<Tag>()> first_trace;
-
     bool first_run = testcase.exec_cksum == 0;
 
     s32 old_sc = stage_cur;
     s32 old_sm = stage_max;
     std::string old_sn = std::move(stage_name);
 
-    u32 use_tmout;
+    /* 0 means exec_tmout_us */
+    u32 use_tmout = 0;
     if (!from_queue || resuming_fuzz) {
-        use_tmout = std::max(setting->exec_timelimit_ms + option::GetCalTmoutAdd(*this),
-                             setting->exec_timelimit_ms * option::GetCalTmoutPerc(*this) / 100);
-    } else {
-        use_tmout = setting->exec_timelimit_ms;
+        u32 exec_tmout = (exec_tmout_us + 999) / 1000;
+        use_tmout = std::max(exec_tmout + option::GetCalTmoutAdd(*this),
+                             exec_tmout * option::GetCalTmoutPerc(*this) / 100);
     }
 
     testcase.cal_failed++;
 
     stage_name = "calibration";
-    stage_max = fast_cal ? 3 : option::GetCalCycles(*this);
+    stage_max = quick_cal ? 1 : fast_cal ? 3 : option::GetCalCycles(*this);
 
     u8 hnb = 0;
     u8 new_bits = 0;
     if (testcase.exec_cksum) {
         inp_feed.ShowMemoryToFunc(
-            [this, &first_trace, &hnb](const u8* trace_bits, u32 /* map_size */) {
-                std::memcpy(first_trace.data(), trace_bits, option::GetMapSize<Tag>());
-                hnb = HasNewBits(trace_bits, &virgin_bits[0], option::GetMapSize<Tag>());
+            [this, &hnb](const u8* trace_bits, u32 /* map_size */) {
+                std::memcpy(first_trace.data(), trace_bits, map_size);
+                hnb = HasNewBits(trace_bits, &virgin_bits[0], map_size);
             }
         );
 
@@ -183,18 +254,21 @@ PUTExitReasonType AFLStateTemplate<Testcase>::CalibrateCaseWithFeedDestroyed(
         u32 cksum = inp_feed.CalcCksum32();
 
         if (testcase.exec_cksum != cksum) {
-            inp_feed.ShowMemoryToFunc(
-                [this, &hnb](const u8* trace_bits, u32 /* map_size */) {
-                    hnb = HasNewBits(trace_bits, &virgin_bits[0], option::GetMapSize<Tag>());
-                }
-            );
+            hnb = 0;
+            if (trace_hnb) {
+                inp_feed.ShowMemoryToFunc(
+                    [this, &hnb](const u8* trace_bits, u32 /* map_size */) {
+                        hnb = HasNewBits(trace_bits, &virgin_bits[0], map_size);
+                    }
+                );
+            }
 
             if (hnb > new_bits) new_bits = hnb;
 
             if (testcase.exec_cksum) {
                 inp_feed.ShowMemoryToFunc(
-                    [this, &first_trace](const u8* trace_bits, u32 /* map_size */) {
-                        for (u32 i=0; i < option::GetMapSize<Tag>(); i++) {
+                    [this](const u8* trace_bits, u32 /* map_size */) {
+                        for (u32 i=0; i < map_size; i++) {
                             if (!var_bytes[i] && first_trace[i] != trace_bits[i]) {
                                 var_bytes[i] = 1;
                                 stage_max = option::GetCalCyclesLong(*this);
@@ -207,8 +281,8 @@ PUTExitReasonType AFLStateTemplate<Testcase>::CalibrateCaseWithFeedDestroyed(
             } else {
                 testcase.exec_cksum = cksum;
                 inp_feed.ShowMemoryToFunc(
-                    [&first_trace](const u8* trace_bits, u32 /* map_size */) {
-                        std::memcpy(first_trace.data(), trace_bits, option::GetMapSize<Tag>());
+                    [this](const u8* trace_bits, u32 /* map_size */) {
+                        std::memcpy(first_trace.data(), trace_bits, map_size);
                     }
                 );
             }
@@ -326,16 +400,12 @@ void AFLStateTemplate<Testcase>::UpdateBitmapScoreWithRawTrace(
 
             top_rated[i] = std::ref(testcase);
             testcase.tc_ref++;
+            MarkTopRatedDirty(i);
 
             if (!testcase.trace_mini) {
-                testcase.trace_mini.reset(
-                    new std::bitset<option::GetMapSize<Tag>()>()
+                testcase.trace_mini = std::make_shared<const std::vector<u64>>(
+                    afl::util::MinimizeBits(trace_bits, map_size)
                 );
-
-                auto& trace_mini = *testcase.trace_mini;
-                for (u32 j=0; j < option::GetMapSize<Tag>(); j++) {
-                    trace_mini[j] = trace_bits[j] != 0;
-                }
             }
 
             score_changed = true;
@@ -350,7 +420,7 @@ void AFLStateTemplate<Testcase>::UpdateBitmapScore(
 ) {
     inp_feed.ShowMemoryToFunc(
         [this, &testcase](const u8* trace_bits, u32 /* map_size */) {
-            UpdateBitmapScoreWithRawTrace(testcase, trace_bits, option::GetMapSize<Tag>());
+            UpdateBitmapScoreWithRawTrace(testcase, trace_bits, map_size);
         }
     );
 }
@@ -370,13 +440,18 @@ bool AFLStateTemplate<Testcase>::SaveIfInteresting(
         /* Keep only if there are new bits in the map, add to queue for
            future fuzzing, etc. */
 
-        u8 hnb;
+        u8 hnb = 0;
 
-        inp_feed.ShowMemoryToFunc(
-            [this, &hnb](const u8* trace_bits, u32 /* map_size */) {
-                hnb = HasNewBits(trace_bits, &virgin_bits[0], option::GetMapSize<Tag>());
-            }
-        );
+        /* inp_feed comes from RunExecutorWithClassifyCounts, which has
+           already told us whether virgin_bits needs to be updated. */
+
+        if (trace_hnb) {
+            inp_feed.ShowMemoryToFunc(
+                [this, &hnb](const u8* trace_bits, u32 /* map_size */) {
+                    hnb = HasNewBits(trace_bits, &virgin_bits[0], map_size);
+                }
+            );
+        }
 
         if (!hnb) {
             if (crash_mode == PUTExitReasonType::FAULT_CRASH) {
@@ -399,6 +474,20 @@ bool AFLStateTemplate<Testcase>::SaveIfInteresting(
         }
 
         auto testcase = AddToQueue(fn, buf, len, false);
+
+        /* The other workers get the trace which was new to the campaign,
+           so that they can queue the input without executing it. */
+
+        std::shared_ptr<AFLSharedState::SharedTestcase> shared_case;
+        if (shared_state) {
+            shared_case = std::make_shared<AFLSharedState::SharedTestcase>();
+            inp_feed.ShowMemoryToFunc(
+                [this, &shared_case](const u8* trace_bits, u32 /* map_size */) {
+                    shared_case->SetTrace(trace_bits, map_size);
+                }
+            );
+        }
+
         if (hnb == 2) {
             testcase->has_new_cov = 1;
             queued_with_cov++;
@@ -420,6 +509,21 @@ bool AFLStateTemplate<Testcase>::SaveIfInteresting(
             ERROR("Unable to execute target application");
         }
 
+        if (shared_case) {
+            shared_case->worker_id = worker_id;
+            shared_case->id = queued_paths - 1;
+            shared_case->buf.assign(buf, buf + len);
+            shared_case->cal_failed = testcase->cal_failed;
+            shared_case->has_new_cov = testcase->has_new_cov;
+            shared_case->var_behavior = testcase->var_behavior;
+            shared_case->bitmap_size = testcase->bitmap_size;
+            shared_case->exec_cksum = testcase->exec_cksum;
+            shared_case->exec_us = testcase->exec_us;
+            shared_case->depth = testcase->depth;
+
+            shared_state->Publish(std::move(shared_case));
+        }
+
         keeping = true;
     }
 
@@ -438,16 +542,19 @@ bool AFLStateTemplate<Testcase>::SaveIfInteresting(
         }
 
         if (!setting->dumb_mode) {
+            /* SimplifyTrace writes to every byte of the map */
+            executor->afl_dirty_regions.Invalidate();
+
             if constexpr (sizeof(size_t) == 8) {
                 inp_feed.ModifyMemoryWithFunc(
-                    [](u8* trace_bits, u32 /* map_size */) {
-                        afl::util::SimplifyTrace<u64>((u64*)trace_bits, option::GetMapSize<Tag>());
+                    [this](u8* trace_bits, u32 /* map_size */) {
+                        afl::util::SimplifyTrace<u64>((u64*)trace_bits, map_size);
                     }
                 );
             } else {
                 inp_feed.ModifyMemoryWithFunc(
-                    [](u8* trace_bits, u32 /* map_size */) {
-                        afl::util::SimplifyTrace<u32>((u32*)trace_bits, option::GetMapSize<Tag>());
+                    [this](u8* trace_bits, u32 /* map_size */) {
+                        afl::util::SimplifyTrace<u32>((u32*)trace_bits, map_size);
                     }
                 );
             }
@@ -455,7 +562,7 @@ bool AFLStateTemplate<Testcase>::SaveIfInteresting(
             u8 res;
             inp_feed.ShowMemoryToFunc(
                 [this, &res](const u8* trace_bits, u32 /* map_size */) {
-                    res = HasNewBits(trace_bits, &virgin_tmout[0], option::GetMapSize<Tag>());
+                    res = HasNewBits(trace_bits, &virgin_tmout[0], map_size);
                 }
             );
 
@@ -471,7 +578,7 @@ bool AFLStateTemplate<Testcase>::SaveIfInteresting(
            the target with a more generous timeout (unless the default timeout
            is already generous). */
 
-        if (setting->exec_timelimit_ms < hang_tmout) {
+        if (exec_tmout_us < static_cast<u64>(hang_tmout) * 1000) {
             // discard inp_feed here because we will use executor
             InplaceMemoryFeedback::DiscardActive(std::move(inp_feed));
             inp_feed = RunExecutorWithClassifyCounts(
@@ -523,16 +630,19 @@ keep_as_crash:
         }
 
         if (!setting->dumb_mode) {
+            /* SimplifyTrace writes to every byte of the map */
+            executor->afl_dirty_regions.Invalidate();
+
             if constexpr (sizeof(size_t) == 8) {
                 inp_feed.ModifyMemoryWithFunc(
-                    [](u8* trace_bits, u32 /* map_size */) {
-                        afl::util::SimplifyTrace<u64>((u64*)trace_bits, option::GetMapSize<Tag>());
+                    [this](u8* trace_bits, u32 /* map_size */) {
+                        afl::util::SimplifyTrace<u64>((u64*)trace_bits, map_size);
                     }
                 );
             } else {
                 inp_feed.ModifyMemoryWithFunc(
-                    [](u8* trace_bits, u32 /* map_size */) {
-                        afl::util::SimplifyTrace<u32>((u32*)trace_bits, option::GetMapSize<Tag>());
+                    [this](u8* trace_bits, u32 /* map_size */) {
+                        afl::util::SimplifyTrace<u32>((u32*)trace_bits, map_size);
                     }
                 );
             }
@@ -540,7 +650,7 @@ keep_as_crash:
             u8 res;
             inp_feed.ShowMemoryToFunc(
                 [this, &res](const u8* trace_bits, u32 /* map_size */) {
-                    res = HasNewBits(trace_bits, &virgin_crash[0], option::GetMapSize<Tag>());
+                    res = HasNewBits(trace_bits, &virgin_crash[0], map_size);
                 }
             );
 
@@ -668,51 +778,41 @@ u32 AFLStateTemplate<Testcase>::DoCalcScore(Testcase &testcase) {
    the hit-count for a particular tuple; 2 if there are new tuples seen.
    Updates the map, so subsequent calls will always return 0.
    This function is called after every exec() on a fairly large buffer, so
-   it needs to be fast. We do this in 32-bit and 64-bit flavors. */
+   it needs to be fast. The scan itself is done by afl::util::HasNewBits,
+   which picks a SIMD flavor supported by the CPU. */
 
 template<class Testcase>
 u8 AFLStateTemplate<Testcase>::HasNewBits(const u8 *trace_bits, u8 *virgin_map, u32 map_size) {
-    // we assume the word size is the same as sizeof(size_t)
-    static_assert( sizeof(size_t) == 4 || sizeof(size_t) == 8 );
-    using UInt = std::conditional_t<sizeof(size_t) == 4, u32, u64>;
-
-    constexpr int width = sizeof(UInt);
-    constexpr int wlog =   width == 4 ?  2 :
-                        /* width == 8 */ 3 ;
-
-    UInt* virgin  = (UInt*)virgin_map;
-    const UInt* current = (const UInt*)trace_bits;
-
-    u32 i = map_size >> wlog;
-
-    u8 ret = 0;
-    while (i--) {
-        /* Optimize for (*current & *virgin) == 0 - i.e., no bits in current bitmap
-           that have not been already cleared from the virgin map - since this will
-           almost always be the case. */
+    u8* shared_map = nullptr;
+    if (shared_state) {
+        if (virgin_map == &virgin_bits[0]) shared_map = &shared_state->virgin_bits[0];
+        else if (virgin_map == &virgin_tmout[0]) shared_map = &shared_state->virgin_tmout[0];
+        else if (virgin_map == &virgin_crash[0]) shared_map = &shared_state->virgin_crash[0];
+    }
 
-        if (unlikely(*current) && unlikely(*current & *virgin)) {
-            if (likely(ret < 2)) {
-                u8* cur = (u8*)current;
-                u8* vir = (u8*)virgin;
+    /* The seeds are in the queue of every worker, so PerformDryRun, which
+       runs before the first queue cycle, judges them by our own map and just
+       lets the shared one know about them. */
 
-                /* Looks like we have not found any new bytes yet; see if any non-zero
-                   bytes in current[] are pristine in virgin[]. */
+    if (shared_map && queue_cycle == 0) {
+        afl::util::HasNewBitsAtomic(trace_bits, shared_map, map_size);
+        shared_map = nullptr;
+    }
 
-                for (int j=0; j < width; j++) {
-                    if (cur[j] && vir[j] == 0xff) {
-                        ret = 2;
-                        break;
-                    }
-                }
-                if (ret != 2) ret = 1;
-            }
+    /* When several workers share the campaign, the finding counts only if no
+       other worker has reported it yet. Claim it in the shared map first, and
+       touch our own map only if we have won: otherwise the bits belong to the
+       entry of the winner, which ImportSharedTestcases clears from our map
+       when it queues the entry. */
 
-            *virgin &= ~*current;
-        }
+    u8 ret;
+    if (shared_map) {
+        ret = afl::util::HasNewBitsAtomic(trace_bits, shared_map, map_size);
+        if (!ret) return 0;
 
-        current++;
-        virgin++;
+        afl::util::HasNewBits(trace_bits, virgin_map, map_size);
+    } else {
+        ret = afl::util::HasNewBits(trace_bits, virgin_map, map_size);
     }
 
     if (ret && virgin_map == &virgin_bits[0]) bitmap_changed = 1;
@@ -751,6 +851,14 @@ void AFLStateTemplate<Testcase>::MarkAsVariable(Testcase &testcase) {
     testcase.var_behavior = true;
 }
 
+template<class Testcase>
+void AFLStateTemplate<Testcase>::MarkTopRatedDirty(u32 i) {
+    if (cull_pending[i]) return;
+
+    cull_pending[i] = 1;
+    cull_pending_slots.emplace_back(i);
+}
+
 template<class Testcase>
 void AFLStateTemplate<Testcase>::MarkAsRedundant(Testcase &testcase, bool val) {
     const auto& input = *testcase.input;
@@ -776,7 +884,8 @@ void AFLStateTemplate<Testcase>::MarkAsRedundant(Testcase &testcase, bool val) {
 template<class State>
 static double GetRunnableProcesses(State &state) {
     // FIXME: static variable
-    static double res = 0;
+    // (at least, thread_local so that workers of thread-parallel fuzzing don't race on it)
+    static thread_local double res = 0;
 
 #if defined(__APPLE__) || defined(__FreeBSD__) || defined (__OpenBSD__)
 
@@ -877,7 +986,7 @@ void AFLStateTemplate<Testcase>::WriteStatsFile(double bitmap_cvg, double stabil
                queued_variable, stability, bitmap_cvg, unique_crashes,
                unique_hangs, last_path_time / 1000, last_crash_time / 1000,
                last_hang_time / 1000, total_execs - last_crash_execs,
-               setting->exec_timelimit_ms, use_banner.c_str(), option::GetVersion(*this),
+               static_cast<u32>(exec_tmout_us / 1000), use_banner.c_str(), option::GetVersion(*this),
                qemu_mode ? "qemu " : "", setting->dumb_mode ? " dumb " : "",
                no_forkserver ? "no_forksrv " : "",
                crash_mode != PUTExitReasonType::FAULT_NONE ? "crash " : "",
@@ -942,7 +1051,7 @@ void AFLStateTemplate<Testcase>::WriteBitmap(void) {
     int fd = Util::OpenFile(fn.string(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
     if (fd < 0) ERROR("Unable to create '%s'", fn.c_str());
 
-    Util::WriteFile(fd, virgin_bits.data(), option::GetMapSize<Tag>());
+    Util::WriteFile(fd, virgin_bits.data(), map_size);
     Util::CloseFile(fd);
 }
 
@@ -953,8 +1062,17 @@ void AFLStateTemplate<Testcase>::ReadBitmap(fs::path fname) {
     int fd = Util::OpenFile(fname.string(), O_RDONLY);
     if (fd < 0) ERROR("Unable to open '%s'", fname.c_str());
 
-    virgin_bits.resize(option::GetMapSize<Tag>());
-    Util::ReadFile(fd, virgin_bits.data(), option::GetMapSize<Tag>());
+    /* The bitmap must come from a PUT with the same map size. */
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) ERROR("Unable to stat '%s'", fname.c_str());
+    if (static_cast<u64>(st.st_size) != map_size) {
+        ERROR("The size of '%s' (%llu bytes) differs from the map size (%u bytes)",
+              fname.c_str(), static_cast<unsigned long long>(st.st_size), map_size);
+    }
+
+    virgin_bits.resize(map_size);
+    Util::ReadFile(fd, virgin_bits.data(), map_size);
     Util::CloseFile(fd);
 }
 
@@ -1037,9 +1155,9 @@ void AFLStateTemplate<Testcase>::CheckIfTty(void) {
     }
 }
 
-static void ShufflePtrs(void** ptrs, u32 cnt, int rand_fd) {
+static void ShufflePtrs(void** ptrs, u32 cnt, rand::XSAdd &rng) {
     for (u32 i=0; i < cnt-2; i++) {
-        u32 j = i + util::UR(cnt - i, rand_fd);
+        u32 j = i + rand::UniformBelow(rng, cnt - i);
         std::swap(ptrs[i], ptrs[j]);
     }
 }
@@ -1069,7 +1187,7 @@ void AFLStateTemplate<Testcase>::ReadTestcases(void) {
 
     if (shuffle_queue && nl_cnt > 1) {
         ACTF("Shuffling queue...");
-        ShufflePtrs((void**)nl, nl_cnt, rand_fd);
+        ShufflePtrs((void**)nl, nl_cnt, rng);
     }
 
     for (int i=0; i < nl_cnt; i++) {
@@ -1077,6 +1195,7 @@ void AFLStateTemplate<Testcase>::ReadTestcases(void) {
 
         std::string fn = Util::StrPrintf("%s/%s", in_dir.c_str(), nl[i]->d_name);
         std::string dfn = Util::StrPrintf("%s/.state/deterministic_done/%s", in_dir.c_str(), nl[i]->d_name);
+        std::string vfn = Util::StrPrintf("%s/.state/variable_behavior/%s", in_dir.c_str(), nl[i]->d_name);
 
         bool passed_det = false;
         free(nl[i]); /* not tracked */
@@ -1106,7 +1225,16 @@ void AFLStateTemplate<Testcase>::ReadTestcases(void) {
 
         if (access(dfn.c_str(), F_OK) == 0) passed_det = true;
 
-        AddToQueue(fn, nullptr, (u32)st.st_size, passed_det);
+        auto testcase = AddToQueue(fn, nullptr, (u32)st.st_size, passed_det);
+
+        /* Likewise, a resumed entry remembers if it has shown variable
+           behavior. The marker is usually a symlink to the entry itself. */
+
+        struct stat vst;
+        if (lstat(vfn.c_str(), &vst) == 0) {
+            testcase->var_behavior = true;
+            queued_variable++;
+        }
     }
 
     free(nl); /* not tracked */
@@ -1125,6 +1253,43 @@ void AFLStateTemplate<Testcase>::ReadTestcases(void) {
     queued_at_start = queued_paths;
 }
 
+/* Load automatically generated extras. */
+
+template<class Testcase>
+void AFLStateTemplate<Testcase>::LoadAuto(void) {
+    u32 i;
+
+    for (i=0; i < option::GetUseAutoExtras(*this); i++) {
+        auto fn =   setting->in_dir
+                  / ".state/auto_extras"
+                  / Util::StrPrintf("auto_%06u", i);
+
+        int fd = open(fn.c_str(), O_RDONLY);
+        if (fd < 0) {
+            if (errno != ENOENT) ERROR("Unable to open '%s'", fn.c_str());
+            break;
+        }
+
+        /* We read one byte more to cheaply detect tokens that are too
+           long (and skip them). */
+
+        std::vector<u8> tmp(option::GetMaxAutoExtra(*this) + 1);
+        ssize_t len = read(fd, tmp.data(), tmp.size());
+        if (len < 0) ERROR("Unable to read from '%s'", fn.c_str());
+
+        if ( option::GetMinAutoExtra(*this) <= len
+          && len <= option::GetMaxAutoExtra(*this)) {
+            tmp.resize(len);
+            routine::update::MaybeAddAuto(*this, tmp);
+        }
+
+        Util::CloseFile(fd);
+    }
+
+    if (i) OKF("Loaded %u auto-discovered dictionary tokens.", i);
+    else OKF("No auto-generated dictionary tokens to reuse.");
+}
+
 template<class Testcase>
 void AFLStateTemplate<Testcase>::PivotInputs() {
     ACTF("Creating hard links for all input files...");
@@ -1145,6 +1310,13 @@ void AFLStateTemplate<Testcase>::PivotInputs() {
             resuming_fuzz = true;
             nfn = Util::StrPrintf("%s/queue/%s", setting->out_dir.c_str(), rsl.c_str());
 
+            /* The name also tells whether the entry brought new tuples. */
+
+            if (rsl.find(",+cov") != std::string::npos && !testcase->has_new_cov) {
+                testcase->has_new_cov = true;
+                queued_with_cov++;
+            }
+
             /* Since we're at it, let's also try to find parent and figure out the
                appropriate depth for this entry. */
 
@@ -1191,18 +1363,97 @@ void AFLStateTemplate<Testcase>::PivotInputs() {
 
         if (testcase->passed_det) MarkAsDetDone(*testcase);
 
+        /* The same goes for var_behavior. */
+
+        if (testcase->var_behavior) MarkAsVariable(*testcase);
+
         id++;
     }
 
-#if 0
     if (in_place_resume) NukeResumeDir();
-#endif
+}
+
+/* When resuming with -i -, get rid of the _resume directory, which has been
+   pivoted into queue/ at this point. */
+
+template<class Testcase>
+void AFLStateTemplate<Testcase>::NukeResumeDir(void) {
+    auto resume_dir = setting->out_dir / "_resume";
+
+    try {
+        fs::remove_all(resume_dir);
+    } catch (const fs::filesystem_error &e) {
+        ERROR("_resume directory cleanup failed: %s", e.what());
+    }
+}
+
+/* When resuming, load what the previous session had found but which cannot be
+   derived from the queue itself: the coverage (fuzz_bitmap) and the queue
+   position (fuzzer_stats). With the bitmap restored, the dry run only needs to
+   execute every entry once instead of calibrating it from scratch. */
+
+template<class Testcase>
+void AFLStateTemplate<Testcase>::LoadPreviousSession(void) {
+    if (!resuming_fuzz) return;
+
+    /* The files of the previous session are in out_dir for in-place resume,
+       and next to the old queue/ otherwise. */
+
+    fs::path prev_dir = in_place_resume ? setting->out_dir : setting->in_dir / "..";
+
+    auto bitmap_fn = prev_dir / "fuzz_bitmap";
+    if (in_bitmap.empty() && fs::exists(bitmap_fn)) {
+        in_bitmap = bitmap_fn.string();
+        ReadBitmap(in_bitmap);
+        bitmap_changed = true;
+
+        OKF("Loaded the bitmap of the previous session.");
+    }
+
+    seek_to = FindStartPosition();
+
+    /* Every entry of the old queue went through calibration when it was
+       added. Having the coverage back, one run is enough to get its trace,
+       checksum and speed. */
+
+    quick_cal = !in_bitmap.empty();
+}
+
+/* When resuming, try to find the queue position to start from. This makes sense
+   only when resuming, and when we can find the original fuzzer_stats. */
+
+template<class Testcase>
+u32 AFLStateTemplate<Testcase>::FindStartPosition(void) {
+    if (!resuming_fuzz) return 0;
+
+    fs::path fn;
+    if (in_place_resume) fn = setting->out_dir / "fuzzer_stats";
+    else fn = setting->in_dir / "../fuzzer_stats";
+
+    int fd = open(fn.c_str(), O_RDONLY);
+    if (fd < 0) return 0;
+
+    char tmp[4096] = {}; /* Ought to be enough for anybody. */
+    if (read(fd, tmp, sizeof(tmp) - 1) < 0) { /* Ignore errors */ }
+    Util::CloseFile(fd);
+
+    const char *off = strstr(tmp, "cur_path          : ");
+    if (!off) return 0;
+
+    u32 ret = atoi(off + 20);
+    if (ret >= queued_paths) ret = 0;
+    return ret;
 }
 
 template<class Tag>
-static void CheckMapCoverage(const InplaceMemoryFeedback &inp_feed) {
+static void CheckMapCoverage(const InplaceMemoryFeedback &inp_feed, u32 map_size) {
     if (inp_feed.CountNonZeroBytes() < 100) return ;
 
+    /* A map whose size PUT has told is as small as PUT needs, so its upper
+       half can be legitimately empty. */
+
+    if (map_size != option::GetMapSize<Tag>()) return;
+
     inp_feed.ShowMemoryToFunc(
         [](const u8 *trace_bits, u32 /* map_size */) {
             u32 start = 1 << (option::GetMapSizePow2<Tag>() - 1);
@@ -1254,7 +1505,7 @@ void AFLStateTemplate<Testcase>::PerformDryRun() {
         switch (res) {
         case PUTExitReasonType::FAULT_NONE:
             if (testcase == case_queue.front()) {
-                CheckMapCoverage<typename Testcase::Tag>(inp_feed);
+                CheckMapCoverage<typename Testcase::Tag>(inp_feed, map_size);
             }
 
             if (crash_mode != PUTExitReasonType::FAULT_NONE) {
@@ -1389,10 +1640,14 @@ void AFLStateTemplate<Testcase>::PerformDryRun() {
             break;
         }
 
-        if (testcase->var_behavior)
+        if (testcase->var_behavior && !quick_cal)
             WARNF("Instrumentation output varies across runs.");
     }
 
+    /* From now on, calibrate new entries as usual. */
+
+    quick_cal = false;
+
     if (cal_failures) {
         if (cal_failures == queued_paths)
             EXIT("All test cases time out%s, giving up!",
@@ -1407,6 +1662,306 @@ void AFLStateTemplate<Testcase>::PerformDryRun() {
     }
 
     OKF("All test cases processed.");
+
+    if (!timeout_given) DecideExecTimeout();
+}
+
+/* Figure out the appropriate timeout from the calibration of the initial
+   test cases, as AFL does when -t is not given: 5x average or 1x max,
+   capped at GetExecTimeout. Unlike AFL, the timeout is kept in
+   microseconds, never goes below GetExecTmoutMinUs, and is rounded up only
+   to GetExecTmRoundUs. */
+
+template<class Testcase>
+void AFLStateTemplate<Testcase>::DecideExecTimeout(void) {
+    if (!total_cal_cycles) return;
+
+    u64 avg_us = total_cal_us / total_cal_cycles;
+    u64 max_us = 0;
+    for (const auto& testcase : case_queue) {
+        if (testcase->exec_us > max_us) max_us = testcase->exec_us;
+    }
+
+    u64 tmout_us;
+    if (avg_us > 50000) tmout_us = avg_us * 2;
+    else if (avg_us > 10000) tmout_us = avg_us * 3;
+    else tmout_us = avg_us * 5;
+
+    tmout_us = std::max(tmout_us, max_us);
+    tmout_us = std::max<u64>(tmout_us, option::GetExecTmoutMinUs(*this));
+
+    const u64 round_us = option::GetExecTmRoundUs(*this);
+    tmout_us = (tmout_us + round_us) / round_us * round_us;
+
+    tmout_us = std::min<u64>(tmout_us, static_cast<u64>(option::GetExecTimeout<Tag>()) * 1000);
+
+    ACTF("No -t option specified, so I'll use exec timeout of %llu us.", tmout_us);
+
+    exec_tmout_us = tmout_us;
+    timeout_given = 1;
+}
+
+/* Grab interesting test cases from other fuzzers. */
+
+template<class Testcase>
+void AFLStateTemplate<Testcase>::SyncFuzzers(void) {
+    struct dirent **sd;
+
+    int sd_cnt = Util::ScanDirAlpha(sync_dir, &sd);
+    if (sd_cnt < 0) ERROR("Unable to open '%s'", sync_dir.c_str());
+
+    stage_max = stage_cur = 0;
+    cur_depth = 0;
+
+    const char *case_format = setting->simple_files ? "id_%06u" : "id:%06u";
+
+    /* Look at the entries created for every other fuzzer in the sync directory.
+       Unlike the original AFL, we first list the new test cases of all the
+       peers, and then run them together as batches in one stage. */
+
+    struct SyncCandidate {
+        std::string party;
+        u32 id;
+        std::string path;
+    };
+
+    std::vector<SyncCandidate> candidates;
+    std::map<std::string, u32> next_min_accept;
+
+    for (int i=0; i < sd_cnt; i++) {
+        std::string party = sd[i]->d_name;
+        free(sd[i]); /* not tracked */
+
+        /* Skip dot files and our own output directory. */
+
+        if (party[0] == '.' || party == sync_id) continue;
+
+        /* Skip anything that doesn't have a queue/ subdirectory. */
+
+        std::string qd_path = Util::StrPrintf("%s/%s/queue", sync_dir.c_str(), party.c_str());
+
+        struct dirent **qd;
+        int qd_cnt = Util::ScanDirAlpha(qd_path, &qd);
+        if (qd_cnt < 0) continue;
+
+        /* Retrieve the ID of the last seen test case. .synced/ is read only
+           when we see the peer for the first time since start-up. */
+
+        auto itr = sync_min_accept.find(party);
+        if (itr == sync_min_accept.end()) {
+            u32 min_accept = 0;
+
+            std::string synced_path = Util::StrPrintf("%s/.synced/%s",
+                                        setting->out_dir.c_str(), party.c_str());
+            int id_fd = open(synced_path.c_str(), O_RDONLY);
+            if (id_fd >= 0) {
+                if (read(id_fd, &min_accept, sizeof(u32)) != sizeof(u32)) min_accept = 0;
+                Util::CloseFile(id_fd);
+            }
+
+            itr = sync_min_accept.emplace(party, min_accept).first;
+        }
+
+        u32 min_accept = itr->second;
+        u32& next = next_min_accept[party];
+        next = min_accept;
+
+        /* For every file queued by this fuzzer, parse ID and see if we have
+           looked at it before. Thanks to alphasort(), they come in order of ID. */
+
+        for (int j=0; j < qd_cnt; j++) {
+            std::string fn = qd[j]->d_name;
+            free(qd[j]); /* not tracked */
+
+            u32 id;
+            if (fn[0] == '.' || sscanf(fn.c_str(), case_format, &id) != 1
+             || id < min_accept) continue;
+
+            /* OK, sounds like a new one. Let's give it a try. */
+
+            if (id >= next) next = id + 1;
+
+            candidates.push_back({party, id, qd_path + "/" + fn});
+        }
+
+        free(qd); /* not tracked */
+    }
+
+    free(sd); /* not tracked */
+
+    stage_name = "sync";
+    stage_short = "sync";
+    stage_max = candidates.size();
+
+    /* Read up to GetSyncBatchSize test cases at once and hand them to the
+       executor as a batch. The ones found interesting are calibrated by
+       SaveIfInteresting as usual, from within the callback of the batch. */
+
+    std::vector<u8> arena;
+    std::vector<std::size_t> offsets;
+    std::vector<const SyncCandidate*> batch;
+    std::vector<fuzzuf::executor::BatchInput> inputs;
+
+    std::size_t next_candidate = 0;
+    while (next_candidate < candidates.size()) {
+        arena.clear();
+        offsets.clear();
+        batch.clear();
+
+        while (next_candidate < candidates.size()
+            && batch.size() < option::GetSyncBatchSize(*this)) {
+            const auto& candidate = candidates[next_candidate++];
+
+            /* Allow this to fail in case the other fuzzer is resuming or so... */
+
+            int fd = open(candidate.path.c_str(), O_RDONLY);
+            if (fd < 0) continue;
+
+            struct stat st;
+            if (fstat(fd, &st)) ERROR("fstat() failed");
+
+            /* Ignore zero-sized or oversized files. */
+
+            if (st.st_size && st.st_size <= option::GetMaxFile<Tag>()) {
+                offsets.emplace_back(arena.size());
+                arena.resize(arena.size() + st.st_size);
+                Util::ReadFile(fd, arena.data() + offsets.back(), st.st_size);
+                batch.emplace_back(&candidate);
+            }
+
+            Util::CloseFile(fd);
+        }
+        offsets.emplace_back(arena.size());
+
+        /* The arena doesn't move any more, so the inputs can point into it. */
+
+        inputs.clear();
+        for (std::size_t i = 0; i < batch.size(); i++) {
+            inputs.push_back({ arena.data() + offsets[i],
+                               static_cast<u32>(offsets[i + 1] - offsets[i]) });
+        }
+
+        /* See what happens. We rely on SaveIfInteresting() to catch major
+           errors and save the test case. */
+
+        RunExecutorBatchWithClassifyCounts(
+            inputs,
+            [&](std::size_t i, InplaceMemoryFeedback &inp_feed, ExitStatusFeedback &exit_status) {
+                if (stop_soon) return false;
+
+                syncing_party = batch[i]->party;
+                syncing_case = batch[i]->id;
+
+                if (SaveIfInteresting(inputs[i].buf, inputs[i].len, inp_feed, exit_status)) {
+                    queued_imported++;
+                }
+
+                syncing_party.clear();
+
+                if (!(stage_cur++ % stats_update_freq)) ShowStats();
+
+                return true;
+            }
+        );
+
+        if (stop_soon) return;
+    }
+
+    /* Everything has been imported. Remember where to start next time. */
+
+    for (const auto& [party, next] : next_min_accept) {
+        sync_min_accept[party] = next;
+
+        std::string synced_path = Util::StrPrintf("%s/.synced/%s",
+                                    setting->out_dir.c_str(), party.c_str());
+        int id_fd = Util::OpenFile(synced_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+        Util::WriteFile(id_fd, &next, sizeof(u32));
+        Util::CloseFile(id_fd);
+    }
+}
+
+/* Grab the testcases the other workers have queued since the last call,
+   and add them to our queue. Unlike SyncFuzzers, the testcases are not
+   executed again: each of them has been new to the whole campaign, and the
+   worker which found it has published its trace and calibration through
+   AFLSharedState. Returns the number of the imported testcases. */
+
+template<class Testcase>
+u32 AFLStateTemplate<Testcase>::ImportSharedTestcases(void) {
+    if (!shared_state || !shared_state->HasUnfetched(shared_queue_pos)) return 0;
+
+    std::vector<std::shared_ptr<const AFLSharedState::SharedTestcase>> shared_cases;
+    shared_queue_pos = shared_state->Fetch(shared_queue_pos, shared_cases);
+
+    if (import_trace.empty()) import_trace.resize(map_size, 0);
+
+    u32 imported = 0;
+    for (const auto& shared_case : shared_cases) {
+        if (shared_case->worker_id == worker_id) continue;
+
+        std::string fn;
+        if (!setting->simple_files) {
+            fn = Util::StrPrintf("%s/queue/id:%06u,sync:worker%u,src:%06u",
+                                    setting->out_dir.c_str(),
+                                    queued_paths,
+                                    shared_case->worker_id,
+                                    shared_case->id
+                                );
+        } else {
+            fn = Util::StrPrintf("%s/queue/id_%06u",
+                                    setting->out_dir.c_str(),
+                                    queued_paths
+                                );
+        }
+
+        const auto& buf = shared_case->buf;
+        auto testcase = AddToQueue(fn, buf.data(), buf.size(), false);
+
+        testcase->depth = shared_case->depth;
+        if (testcase->depth > max_depth) max_depth = testcase->depth;
+
+        /* Take over what CalibrateCaseWithFeedDestroyed has found in the
+           worker which queued the testcase. */
+
+        testcase->exec_cksum = shared_case->exec_cksum;
+        testcase->exec_us = shared_case->exec_us;
+        testcase->bitmap_size = shared_case->bitmap_size;
+        testcase->handicap = queue_cycle - 1;
+        testcase->cal_failed = shared_case->cal_failed;
+
+        if (shared_case->has_new_cov) {
+            testcase->has_new_cov = true;
+            queued_with_cov++;
+        }
+
+        if (shared_case->var_behavior) {
+            MarkAsVariable(*testcase);
+            queued_variable++;
+        }
+
+        /* The bits are no longer new to the campaign, so clear them from our
+           virgin_bits as well. */
+
+        shared_case->RestoreTrace(&import_trace[0]);
+
+        if (afl::util::HasNewBits(&import_trace[0], &virgin_bits[0], map_size)) {
+            bitmap_changed = 1;
+        }
+
+        if (!testcase->cal_failed) {
+            total_bitmap_size += testcase->bitmap_size;
+            total_bitmap_entries++;
+
+            UpdateBitmapScoreWithRawTrace(*testcase, &import_trace[0], map_size);
+        }
+
+        shared_case->EraseTrace(&import_trace[0]);
+
+        queued_imported++;
+        imported++;
+    }
+
+    return imported;
 }
 
 /* Check terminal dimensions after resize. */
@@ -1429,7 +1984,7 @@ void AFLStateTemplate<Testcase>::ShowStats(void) {
     // Lots of constants appear, so overlook this.
     using namespace afl::option;
 
-    const u32 MAP_SIZE = GetMapSize<Tag>();
+    const u32 MAP_SIZE = map_size;
 
     u64 cur_ms = Util::GetCurTimeMs();
 
@@ -1854,4 +2409,16 @@ void AFLStateTemplate<Testcase>::SetShouldConstructAutoDict(bool v) {
     should_construct_auto_dict = v;
 }
 
+template<class Testcase>
+void AFLStateTemplate<Testcase>::SetWorkerId(u32 id) {
+    worker_id = id;
+    rng = rand::CreateXSAdd(id, "afl.state");
+    mutator_rng = rand::CreateXSAdd(id, "afl.mutator");
+}
+
+template<class Testcase>
+u32 AFLStateTemplate<Testcase>::UR(u32 limit) {
+    return rand::UniformBelow(rng, limit);
+}
+
 } // namespace fuzzuf::algorithm::afl
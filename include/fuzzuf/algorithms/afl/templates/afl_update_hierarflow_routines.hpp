@@ -138,10 +138,8 @@ static void MaybeAddAuto(State &state, const std::vector<u8> &mem) {
         if (state.a_extras.size() < option::GetMaxAutoExtras(state)) {
             state.a_extras.emplace_back(AFLDictData{mem, 0});
         } else {
-            using afl::util::UR;
-
             int idx = option::GetMaxAutoExtras(state) / 2;
-            idx += UR((option::GetMaxAutoExtras(state) + 1) / 2, state.rand_fd);
+            idx += state.UR((option::GetMaxAutoExtras(state) + 1) / 2);
 
             state.a_extras[idx].data = mem;
             state.a_extras[idx].hit_cnt = 0;
@@ -322,4 +320,19 @@ AFLUpdCalleeRef ConstructEffMapTemplate<State>::operator()(
     return GoToDefaultNext();
 }
 
+template<class State>
+MOptUpdateTemplate<State>::MOptUpdateTemplate(State &state)
+    : state(state) {}
+
+template<class State>
+AFLUpdCalleeRef MOptUpdateTemplate<State>::operator()(
+    const u8* /* unused */,
+    u32 /* unused */,
+    InplaceMemoryFeedback& /* unused */,
+    ExitStatusFeedback& /* unused */
+) {
+    state.mopt->UpdateAfterExec(state.queued_paths + state.unique_crashes);
+    return GoToDefaultNext();
+}
+
 } // namespace fuzzuf::algorithm::afl::routine::update
@@ -20,17 +20,20 @@
 #define FUZZUF_INCLUDE_ALGORITHM_IJON_IJON_HAVOC_HPP
 
 #include "fuzzuf/algorithms/afl/afl_dict_data.hpp"
+#include "fuzzuf/rand/xsadd.hpp"
 
 namespace fuzzuf::algorithm::ijon::havoc {
 
 u32 IJONHavocCaseDistrib(
+    rand::XSAdd& rng,
     const std::vector<afl::dictionary::AFLDictData>& extras,
     const std::vector<afl::dictionary::AFLDictData>& a_extras
 );
 
 void IJONCustomCases(
+    rand::XSAdd& rng,
     u32 case_idx,
-    u8*& outbuf,
+    std::vector<u8>& outbuf,
     u32& len,
     const std::vector<afl::dictionary::AFLDictData>& extras,
     const std::vector<afl::dictionary::AFLDictData>& a_extras
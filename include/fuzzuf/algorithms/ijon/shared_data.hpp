@@ -27,6 +27,7 @@ namespace fuzzuf::algorithm::ijon {
  * @struct SharedData
  * IJON has some extra fields in shared memory in addition to the array of edge coverage.
  * This struct represents its memory layout.
+ * The layout is fixed at compile time, so IJONState rejects PUT telling another map size.
  *
  * Corresponding code of original IJON implementation:
  * https://github.com/RUB-SysSec/ijon/blob/4cb8ae04d/afl-ijon-min.h#L7-L11
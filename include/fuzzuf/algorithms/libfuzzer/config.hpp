@@ -158,7 +158,9 @@ struct FuzzerCreateInfo {
   FUZZUF_SETTER(afl_shm_size)
   FUZZUF_SETTER(bb_shm_size)
   FUZZUF_SETTER(cpuid_to_bind)
+  FUZZUF_SETTER(persistent_loop_count)
   FUZZUF_SETTER(use_afl_coverage)
+  FUZZUF_SETTER(in_process)
   FUZZUF_SETTER(sparse_energy_updates)
   FUZZUF_SETTER(crashed_only)
   FUZZUF_SETTER(max_input_length)
@@ -281,12 +283,29 @@ struct FuzzerCreateInfo {
    */
   int cpuid_to_bind = NativeLinuxExecutor::CPUID_DO_NOT_BIND;
 
+  /**
+   * Maximum number of inputs one target process handles in persistent mode.
+   * If 0, persistent mode is disabled. Persistent mode requires forksrv to be
+   * true and the target to use __AFL_LOOP().
+   */
+  std::uint32_t persistent_loop_count =
+      NativeLinuxExecutor::PERSISTENT_MODE_DISABLED;
+
   /**
    * If true, feature is calculated using AFL compatible coverage
    * Otherwise, feature is calculated using basic block coverage
    */
   bool use_afl_coverage = true;
 
+  /**
+   * If true, the target is a shared object exporting LLVMFuzzerTestOneInput,
+   * and it is executed by InProcessExecutor instead of NativeLinuxExecutor.
+   * forksrv, cpuid_to_bind and persistent_loop_count are ignored.
+   * Set use_afl_coverage to false if the target is built with
+   * -fsanitize=fuzzer-no-link.
+   */
+  bool in_process = false;
+
   /**
    * On entropic mode, even if distribution updating is not required, it is updated with a probability of 1/n. 
    */
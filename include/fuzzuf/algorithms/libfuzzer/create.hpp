@@ -24,6 +24,7 @@
 #include "fuzzuf/algorithms/libfuzzer/exec_input_set_range.hpp"
 #include "fuzzuf/algorithms/libfuzzer/hierarflow.hpp"
 #include "fuzzuf/algorithms/libfuzzer/select_seed.hpp"
+#include "fuzzuf/executor/in_process_executor.hpp"
 #include "fuzzuf/hierarflow/hierarflow_intermediates.hpp"
 #include <config.h>
 
@@ -125,22 +126,35 @@ auto createExecuteAndFeedback(const fs::path &target_path,
 
   auto create_coverage = hf::CreateNode<Clear<F, decltype(Ord::coverage)>>();
 
-  std::unique_ptr<NativeLinuxExecutor> executor_(new NativeLinuxExecutor(
-      {target_path.string(), output_file_path.string()},
-      create_info.exec_timelimit_ms, create_info.exec_memlimit,
-      create_info.forksrv, path_to_write_seed, create_info.afl_shm_size,
-      create_info.bb_shm_size, create_info.cpuid_to_bind));
-  auto execute_ =
-      hf::CreateNode<standard_order::Execute<F, NativeLinuxExecutor, Ord>>(
-          std::move(executor_), create_info.use_afl_coverage);
-
   auto collect_features =
       hf::CreateNode<standard_order::CollectFeatures<F, Ord>>();
   auto add_to_corpus = hf::CreateNode<standard_order::AddToCorpus<F, Ord>>(
       force_add_to_corpus, may_delete_file, persistent, strict_match,
       create_info.output_dir, Sink(sink));
 
-  create_coverage << execute_ << collect_features << add_to_corpus;
+  if (create_info.in_process) {
+    std::unique_ptr<InProcessExecutor> executor_(new InProcessExecutor(
+        target_path, create_info.exec_timelimit_ms, create_info.exec_memlimit,
+        path_to_write_seed, create_info.afl_shm_size,
+        create_info.bb_shm_size));
+    auto execute_ =
+        hf::CreateNode<standard_order::Execute<F, InProcessExecutor, Ord>>(
+            std::move(executor_), create_info.use_afl_coverage);
+
+    create_coverage << execute_ << collect_features << add_to_corpus;
+  } else {
+    std::unique_ptr<NativeLinuxExecutor> executor_(new NativeLinuxExecutor(
+        {target_path.string(), output_file_path.string()},
+        create_info.exec_timelimit_ms, create_info.exec_memlimit,
+        create_info.forksrv, path_to_write_seed, create_info.afl_shm_size,
+        create_info.bb_shm_size, create_info.cpuid_to_bind,
+        /* record_stdout_and_err */ false, create_info.persistent_loop_count));
+    auto execute_ =
+        hf::CreateNode<standard_order::Execute<F, NativeLinuxExecutor, Ord>>(
+            std::move(executor_), create_info.use_afl_coverage);
+
+    create_coverage << execute_ << collect_features << add_to_corpus;
+  }
 
   return create_coverage;
 }
@@ -76,9 +76,14 @@ auto Execute(Range &range, Output &output, Cov &cov, InputInfo &exec_result,
       cov.assign(head, std::next(head, size));
     });
   }
-  output = executor.MoveStdOut();
-  auto err = executor.MoveStdErr();
-  output.insert(output.end(), err.begin(), err.end());
+  // The outputs are copied from the buffers of the executor so that output can
+  // reuse its storage across executions.
+  executor.GetStdOut().ShowMemoryToFunc([&](const u8 *head, u32 size) {
+    output.assign(head, std::next(head, size));
+  });
+  executor.GetStdErr().ShowMemoryToFunc([&](const u8 *head, u32 size) {
+    output.insert(output.end(), head, std::next(head, size));
+  });
 }
 
 } // namespace fuzzuf::algorithm::libfuzzer::executor
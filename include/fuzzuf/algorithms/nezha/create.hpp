@@ -73,7 +73,10 @@ auto CreateRunSingleTarget(const fs::path &target_path,
       {target_path.string(), output_file_path.string()},
       create_info.exec_timelimit_ms, create_info.exec_memlimit,
       create_info.forksrv, path_to_write_seed, create_info.afl_shm_size,
-      create_info.bb_shm_size, create_info.cpuid_to_bind, true));
+      create_info.bb_shm_size, create_info.cpuid_to_bind,
+      /* record_stdout_and_err */ true,
+      NativeLinuxExecutor::PERSISTENT_MODE_DISABLED,
+      fuzzuf::executor::default_output_capture_limit));
   auto execute =
       hf::CreateNode<lf::standard_order::Execute<F, NativeLinuxExecutor, Ord>>(
           std::move(executor), create_info.use_afl_coverage);
@@ -58,7 +58,8 @@ public:
     // ムーブコンストラクタ
     VUzzerMutator(VUzzerMutator&&);
 
-    VUzzerMutator( const ExecInput&, const VUzzerState& );
+    // The mutations draw from state.mutator_rng
+    VUzzerMutator( const ExecInput&, VUzzerState& );
     ~VUzzerMutator();
 
     u32 GetCutPos(u32);
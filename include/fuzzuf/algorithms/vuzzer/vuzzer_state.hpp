@@ -27,12 +27,14 @@
 #include <memory>
 #include <random>
 #include <algorithm>
+#include <functional>
 #include <boost/dynamic_bitset.hpp>
 
 #include "fuzzuf/utils/common.hpp"
 #include "fuzzuf/utils/filesystem.hpp"
 #include "fuzzuf/exec_input/exec_input.hpp"
 #include "fuzzuf/exec_input/exec_input_set.hpp"
+#include "fuzzuf/executor/executor_pool.hpp"
 #include "fuzzuf/executor/pintool_executor.hpp"
 #include "fuzzuf/executor/polytracker_executor.hpp"
 #include "fuzzuf/feedback/inplace_memory_feedback.hpp"
@@ -40,6 +42,7 @@
 #include "fuzzuf/algorithms/afl/afl_dict_data.hpp"
 #include "fuzzuf/algorithms/vuzzer/vuzzer_setting.hpp"
 #include "fuzzuf/algorithms/vuzzer/vuzzer_testcase.hpp"
+#include "fuzzuf/rand/rand.hpp"
 
 using AFLDictData = fuzzuf::algorithm::afl::dictionary::AFLDictData;
 using dict_t = std::vector< AFLDictData >;
@@ -63,6 +66,19 @@ struct VUzzerState {
         u32 tmout = 0
     );
 
+    // Execute the inputs with RunBatch of the executor, or in parallel with executor_pool if it is set.
+    // callback receives the same feedback as RunExecutor for each input, in the order of the inputs.
+    void RunExecutorBatch(
+        const std::vector<fuzzuf::executor::BatchInput> &inputs,
+        const std::function<void(std::size_t, FileFeedback&, const ExitStatusFeedback&)> &callback,
+        u32 tmout = 0
+    );
+    void RunExecutorPool(
+        const std::vector<fuzzuf::executor::BatchInput> &inputs,
+        const std::function<void(std::size_t, FileFeedback&, const ExitStatusFeedback&)> &callback,
+        u32 tmout
+    );
+
     FileFeedback RunTaintExecutor(
         const u8* buf,
         u32 len,
@@ -88,6 +104,11 @@ struct VUzzerState {
     std::shared_ptr<PinToolExecutor> executor;
     std::shared_ptr<PolyTrackerExecutor> taint_executor;
 
+    // If set, RunExecutorBatch uses these executors instead of executor.
+    // pool_feed_paths[i] is the file the i-th executor of executor_pool writes the coverage to.
+    std::unique_ptr<fuzzuf::executor::ExecutorPool<PinToolExecutor>> executor_pool;
+    std::vector<fs::path> pool_feed_paths;
+
     ExecInputSet input_set;
 
     u32 queued_paths = 0;                   /* Total number of queued testcases */
@@ -147,6 +168,11 @@ struct VUzzerState {
     std::map<u64, std::map<u32, std::vector<u32>>> taint_cmp_all;
     std::map<u64, std::set<u32>> taint_cmp_offsets;
     std::map<u64, std::set<u32>> taint_lea_offsets;
+
+    // rng is for the decisions of the state and routines(e.g. choosing parents),
+    // and mutator_rng is for VUzzerMutator.
+    rand::XSAdd rng = rand::CreateXSAdd(0, "vuzzer.state");
+    rand::XSAdd mutator_rng = rand::CreateXSAdd(0, "vuzzer.mutator");
 };
 
 } //namespace fuzzuf::algorithm::vuzzer
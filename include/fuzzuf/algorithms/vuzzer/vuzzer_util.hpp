@@ -52,6 +52,7 @@ void DictToBitsWithKeys(
 );
 
 std::unique_ptr<std::vector<u8>> GenerateRandomBytesFromDict(
+    rand::XSAdd& rng,
     u32 size,
     const std::vector<const dict_t *>& all_dicts
 );
@@ -24,6 +24,8 @@
 #include "fuzzuf/algorithms/afl/afl_option.hpp"
 #include "fuzzuf/algorithms/afl/afl_setting.hpp"
 #include "fuzzuf/algorithms/afl/afl_state.hpp"
+#include "fuzzuf/algorithms/afl/afl_shared_state.hpp"
+#include "fuzzuf/algorithms/afl/afl_parallel_fuzzer.hpp"
 #include "fuzzuf/executor/native_linux_executor.hpp"
 #include <boost/program_options.hpp>
 
@@ -31,12 +33,28 @@ namespace po = boost::program_options;
 
 struct AFLFuzzerOptions {
     bool forksrv;                           // Optional
+    bool deferred;                          // Optional
+    u32 persistent_loop;                    // Optional
+    bool huge_pages;                        // Optional
     std::string dict_file;                  // Optional
+    u32 jobs;                               // Optional
+    u32 havoc_batch;                        // Optional
+    bool mopt;                              // Optional
+    std::string master_id;                  // Optional
+    std::string slave_id;                   // Optional
 
     // Default values
     AFLFuzzerOptions() : 
         forksrv(true),
-        dict_file("")
+        deferred(false),
+        persistent_loop(NativeLinuxExecutor::PERSISTENT_MODE_DISABLED),
+        huge_pages(false),
+        dict_file(""),
+        jobs(1),
+        havoc_batch(1),
+        mopt(false),
+        master_id(""),
+        slave_id("")
         {};
 };
 
@@ -70,9 +88,35 @@ std::unique_ptr<TFuzzer> BuildAFLFuzzerFromArgs(
         ("forksrv", 
             po::value<bool>(&afl_options.forksrv)->default_value(afl_options.forksrv), 
             "Enable/disable fork server mode. default is true.")
+        ("deferred", 
+            po::value<bool>(&afl_options.deferred)->default_value(afl_options.deferred), 
+            "Start the fork server at __AFL_INIT() of PUT, if PUT has it. default is false.")
+        ("persistent_loop", 
+            po::value<u32>(&afl_options.persistent_loop)->default_value(afl_options.persistent_loop), 
+            "Let one PUT process handle up to this number of inputs in __AFL_LOOP(), if PUT has it. "
+            "0 disables persistent mode. default is 0.")
+        ("huge_pages", 
+            po::value<bool>(&afl_options.huge_pages)->default_value(afl_options.huge_pages), 
+            "Allocate the coverage map with huge pages, if the system has reserved them. default is false.")
         ("dict_file", 
             po::value<std::string>(&afl_options.dict_file), 
             "Load additional dictionary file.")
+        ("jobs", 
+            po::value<u32>(&afl_options.jobs)->default_value(afl_options.jobs), 
+            "Number of worker threads sharing the queue and the coverage. default is 1.")
+        ("havoc_batch", 
+            po::value<u32>(&afl_options.havoc_batch)->default_value(afl_options.havoc_batch), 
+            "Number of havoc children generated before executing them as a batch. default is 1.")
+        ("mopt", 
+            po::value<bool>(&afl_options.mopt)->default_value(afl_options.mopt), 
+            "Schedule the mutation operators of havoc with MOpt. default is false.")
+        ("master,M", 
+            po::value<std::string>(&afl_options.master_id), 
+            "Run as a master instance with the given fuzzer ID, syncing with the other instances in out_dir. "
+            "Use ID:i/n to split deterministic steps among n masters.")
+        ("slave,S", 
+            po::value<std::string>(&afl_options.slave_id), 
+            "Run as a slave instance with the given fuzzer ID, syncing with the other instances in out_dir.")
         ("pargs", 
             po::value<std::vector<std::string>>(&pargs), 
             "Specify PUT and args for PUT.")
@@ -113,53 +157,219 @@ std::unique_ptr<TFuzzer> BuildAFLFuzzerFromArgs(
     using fuzzuf::algorithm::afl::option::GetExecTimeout;
     using fuzzuf::algorithm::afl::option::GetMemLimit;
 
-    // Create AFLSetting
+    if (afl_options.jobs == 0) {
+        std::cerr << "[!] jobs must be greater than 0" << std::endl;
+        fuzzuf::cli::fuzzer::afl::usage(fuzzer_args.global_options_description);
+    }
+
+    if (afl_options.persistent_loop != NativeLinuxExecutor::PERSISTENT_MODE_DISABLED && !afl_options.forksrv) {
+        std::cerr << "[!] --persistent_loop requires fork server mode" << std::endl;
+        fuzzuf::cli::fuzzer::afl::usage(fuzzer_args.global_options_description);
+    }
+
+    if (afl_options.havoc_batch == 0) {
+        std::cerr << "[!] havoc_batch must be greater than 0" << std::endl;
+        fuzzuf::cli::fuzzer::afl::usage(fuzzer_args.global_options_description);
+    }
+
+    if (afl_options.mopt && afl_options.havoc_batch > 1) {
+        std::cerr << "[!] --mopt and --havoc_batch are mutually exclusive" << std::endl;
+        fuzzuf::cli::fuzzer::afl::usage(fuzzer_args.global_options_description);
+    }
+
+    // Parse -M/-S in the same way as the original AFL (see fix_up_sync in afl-fuzz.c)
+    std::string sync_id;
+    u32 master_id = 0;
+    u32 master_max = 0;
+    bool force_deterministic = false;
 
-    auto setting = std::make_shared<const AFLSetting>(
-                        put.Args(),
-                        global_options.in_dir,
-                        global_options.out_dir,
-                        global_options.exec_timelimit_ms.value_or(GetExecTimeout<AFLTag>()),
-                        global_options.exec_memlimit.value_or(GetMemLimit<AFLTag>()),
-                        afl_options.forksrv,
-                        /* dumb_mode */ false,  // FIXME: add dumb_mode
-                        NativeLinuxExecutor::CPUID_BIND_WHICHEVER
-                    );
+    if (!afl_options.master_id.empty() && !afl_options.slave_id.empty()) {
+        std::cerr << "[!] Multiple -S or -M options not supported" << std::endl;
+        fuzzuf::cli::fuzzer::afl::usage(fuzzer_args.global_options_description);
+    }
+
+    if (!afl_options.master_id.empty()) {
+        sync_id = afl_options.master_id;
+
+        auto colon = sync_id.find(':');
+        if (colon != std::string::npos) {
+            std::string job = sync_id.substr(colon + 1);
+            sync_id.resize(colon);
+
+            if (sscanf(job.c_str(), "%u/%u", &master_id, &master_max) != 2
+             || !master_id || !master_max || master_id > master_max
+             || master_max > 1000000) {
+                std::cerr << "[!] Bogus master ID passed to -M" << std::endl;
+                fuzzuf::cli::fuzzer::afl::usage(fuzzer_args.global_options_description);
+            }
+        }
+
+        force_deterministic = true;
+    } else if (!afl_options.slave_id.empty()) {
+        sync_id = afl_options.slave_id;
+    }
+
+    if (!sync_id.empty()) {
+        for (char c : sync_id) {
+            if (!isalnum(c) && c != '_' && c != '-') {
+                std::cerr << "[!] Non-alphanumeric fuzzer ID specified via -S or -M" << std::endl;
+                fuzzuf::cli::fuzzer::afl::usage(fuzzer_args.global_options_description);
+            }
+        }
+
+        if (sync_id.size() > 32) {
+            std::cerr << "[!] Fuzzer ID too long" << std::endl;
+            fuzzuf::cli::fuzzer::afl::usage(fuzzer_args.global_options_description);
+        }
 
-    // NativeLinuxExecutor needs the directory specified by "out_dir" to be already set up
-    // so we need to create the directory first, and then initialize Executor
-    SetupDirs(setting->out_dir.string());
+        if (afl_options.jobs > 1) {
+            std::cerr << "[!] -S / -M and --jobs are mutually exclusive" << std::endl;
+            fuzzuf::cli::fuzzer::afl::usage(fuzzer_args.global_options_description);
+        }
+    }
 
+    using fuzzuf::algorithm::afl::AFLState;
     using fuzzuf::algorithm::afl::option::GetDefaultOutfile;
     using fuzzuf::algorithm::afl::option::GetMapSize;
 
-    // Create NativeLinuxExecutor
-    // TODO: support more types of executors
-
-    auto executor = std::make_shared<NativeLinuxExecutor>(
-                        setting->argv,
-                        setting->exec_timelimit_ms,
-                        setting->exec_memlimit,
-                        setting->forksrv,
-                        setting->out_dir / GetDefaultOutfile<AFLTag>(),
-                        GetMapSize<AFLTag>(), // afl_shm_size
-                                           0, //  bb_shm_size
-                        setting->cpuid_to_bind
-                    );
-
-    // Create AFLState
-    using fuzzuf::algorithm::afl::AFLState;
-    auto state = std::make_unique<AFLState>(setting, executor);
+    // Each worker has its own setting, executor and state.
+    // With multiple workers, the i-th worker writes into out_dir/worker<i>,
+    // and its RNGs are derived from the global seed and i.
+    auto create_state = [&](const fs::path& out_dir, u32 worker_id) {
+        // "-i -" resumes the session left in out_dir, using its old queue as the input
+        bool in_place_resume = global_options.in_dir == "-";
+        std::string in_dir = in_place_resume
+                                ? SetupDirsForInPlaceResume(out_dir.string())
+                                : global_options.in_dir;
+
+        // Create AFLSetting
+
+        auto setting = std::make_shared<const AFLSetting>(
+                            put.Args(),
+                            in_dir,
+                            out_dir.string(),
+                            global_options.exec_timelimit_ms.value_or(GetExecTimeout<AFLTag>()),
+                            global_options.exec_memlimit.value_or(GetMemLimit<AFLTag>()),
+                            afl_options.forksrv,
+                            /* dumb_mode */ false,  // FIXME: add dumb_mode
+                            NativeLinuxExecutor::CPUID_BIND_WHICHEVER
+                        );
+
+        // NativeLinuxExecutor needs the directory specified by "out_dir" to be already set up
+        // so we need to create the directory first, and then initialize Executor
+        SetupDirs(setting->out_dir.string());
+
+        // Create NativeLinuxExecutor
+        // TODO: support more types of executors
+
+        auto executor = std::make_shared<NativeLinuxExecutor>(
+                            setting->argv,
+                            setting->exec_timelimit_ms,
+                            setting->exec_memlimit,
+                            setting->forksrv,
+                            setting->out_dir / GetDefaultOutfile<AFLTag>(),
+                            GetMapSize<AFLTag>(), // afl_shm_size
+                                               0, //  bb_shm_size
+                            setting->cpuid_to_bind,
+                            /* record_stdout_and_err */ false,
+                            afl_options.persistent_loop,
+                            NativeLinuxExecutor::OUTPUT_CAPTURE_UNLIMITED,
+                            afl_options.deferred
+                                ? fuzzuf::executor::SnapshotPoint::Deferred
+                                : fuzzuf::executor::SnapshotPoint::Entry,
+                            afl_options.huge_pages
+                        );
+
+        // Create AFLState
+        auto state = std::make_unique<AFLState>(setting, executor);
+        state->in_place_resume = in_place_resume;
+        // Without -t, the timeout is scaled from the calibration of the initial seeds
+        state->timeout_given = global_options.exec_timelimit_ms.has_value();
+        state->deferred_mode = executor->IsDeferredForkServer();
+        state->havoc_batch_size = afl_options.havoc_batch;
+        state->SetWorkerId(worker_id);
+
+        if (afl_options.mopt) {
+            state->mopt = std::make_unique<fuzzuf::algorithm::afl::MOptScheduler>(worker_id);
+        }
+
+        // Load dictionary
+        if(afl_options.dict_file != ""){
+            using fuzzuf::algorithm::afl::dictionary::AFLDictData;
+
+            const std::function<void( std::string&& )> f = [](std::string s){
+                ERROR("Dictionary error: %s", s.c_str());     
+            };
+
+            fuzzuf::algorithm::afl::dictionary::load(afl_options.dict_file, state->extras, false, f);
+        }
+
+        return state;
+    };
+
+    if (afl_options.jobs > 1) {
+        using fuzzuf::algorithm::afl::AFLSharedState;
+        using fuzzuf::algorithm::afl::AFLParallelFuzzerTemplate;
+
+        Util::CreateDir(global_options.out_dir);
+
+        // The shared maps follow the map of PUT, which is known once the first executor has started
+        std::shared_ptr<AFLSharedState> shared_state;
+
+        std::vector<std::unique_ptr<TAFLFuzzer>> workers;
+        std::vector<std::optional<int>> cpuids;
+        for (u32 i = 0; i < afl_options.jobs; i++) {
+            auto state = create_state(
+                            fs::path(global_options.out_dir) / Util::StrPrintf("worker%u", i),
+                            i
+                         );
+            if (!shared_state) {
+                shared_state = std::make_shared<AFLSharedState>(state->map_size);
+            } else if (shared_state->virgin_bits.size() != state->map_size) {
+                ERROR("The workers disagree on the size of the coverage map");
+            }
+            state->shared_state = shared_state;
+
+            // Only the first worker draws the status screen
+            if (i > 0) state->not_on_tty = true;
+
+            cpuids.emplace_back(state->executor->binded_cpuid);
+            workers.emplace_back(new TAFLFuzzer(std::move(state)));
+        }
+
+        return std::unique_ptr<TFuzzer>(
+                    dynamic_cast<TFuzzer *>(
+                        new AFLParallelFuzzerTemplate<TAFLFuzzer>(std::move(workers), cpuids)
+                    )
+                );
+    }
+
+    if (sync_id.empty()) {
+        auto state = create_state(global_options.out_dir, 0);
+
+        return std::unique_ptr<TFuzzer>(
+                    dynamic_cast<TFuzzer *>(
+                        new TAFLFuzzer(std::move(state))
+                    )
+                );
+    }
+
+    // In distributed mode, out_dir is used as the sync directory
+    // and this instance writes into out_dir/sync_id
+    Util::CreateDir(global_options.out_dir);
 
-    // Load dictionary
-    if(afl_options.dict_file != ""){
-        using fuzzuf::algorithm::afl::dictionary::AFLDictData;
+    auto state = create_state(fs::path(global_options.out_dir) / sync_id, 0);
+    Util::CreateDir(state->setting->out_dir.string() + "/.synced");
 
-        const std::function<void( std::string&& )> f = [](std::string s){
-            ERROR("Dictionary error: %s", s.c_str());     
-        };
+    state->sync_id = sync_id;
+    state->sync_dir = global_options.out_dir;
+    state->master_id = master_id;
+    state->master_max = master_max;
+    state->force_deterministic = force_deterministic;
 
-        fuzzuf::algorithm::afl::dictionary::load(afl_options.dict_file, state->extras, false, f);
+    if (!force_deterministic) {
+        state->skip_deterministic = true;
+        state->use_splicing = true;
     }
 
     return std::unique_ptr<TFuzzer>(
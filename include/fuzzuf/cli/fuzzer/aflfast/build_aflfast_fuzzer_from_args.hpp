@@ -111,11 +111,17 @@ std::unique_ptr<TFuzzer> BuildAFLFastFuzzerFromArgs(
     using fuzzuf::algorithm::afl::option::GetMemLimit;
     using fuzzuf::algorithm::aflfast::option::FAST;
 
+    // "-i -" resumes the session left in out_dir, using its old queue as the input
+    bool in_place_resume = global_options.in_dir == "-";
+    std::string in_dir = in_place_resume
+                            ? SetupDirsForInPlaceResume(global_options.out_dir)
+                            : global_options.in_dir;
+
     // Create AFLFastSetting
 
     auto setting = std::make_shared<const AFLFastSetting>(
                         put.Args(),
-                        global_options.in_dir,
+                        in_dir,
                         global_options.out_dir,
                         global_options.exec_timelimit_ms.value_or(GetExecTimeout<AFLFastTag>()),
                         global_options.exec_memlimit.value_or(GetMemLimit<AFLFastTag>()),
@@ -149,6 +155,9 @@ std::unique_ptr<TFuzzer> BuildAFLFastFuzzerFromArgs(
     // Create AFLFastState
     using fuzzuf::algorithm::aflfast::AFLFastState;
     auto state = std::make_unique<AFLFastState>(setting, executor);
+    state->in_place_resume = in_place_resume;
+    // Without -t, the timeout is scaled from the calibration of the initial seeds
+    state->timeout_given = global_options.exec_timelimit_ms.has_value();
 
     return std::unique_ptr<TFuzzer>(
                 dynamic_cast<TFuzzer *>(
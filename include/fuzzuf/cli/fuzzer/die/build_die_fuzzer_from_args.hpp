@@ -57,12 +57,14 @@ struct DIEOptions {
   std::string d8_flags; // (optional) Flags for d8
   std::string typer_path; // (optional) Path to die_typer.py
   int mut_cnt;            // (optional) Mutation count
+  bool deferred;          // (optional) Start the fork server at __AFL_INIT()
 
   /* Default values */
   DIEOptions() : die_dir   ("tools/die/DIE"),
                  d8_flags  (""),
                  typer_path("tools/die/typer.py"),
-                 mut_cnt   (100) {};
+                 mut_cnt   (100),
+                 deferred  (false) {};
 };
 
 /**
@@ -98,6 +100,8 @@ std::unique_ptr<TFuzzer> BuildDIEFuzzerFromArgs(FuzzerArgs &fuzzer_args,
      "Set path to python script to collect type information.\nDefault: tools/die/typer.py")
     ("mut_cnt" , po::value<int>(&die_options.mut_cnt),
      "Set number of scripts to generate per mutation.\nDefault: 100")
+    ("deferred", po::value<bool>(&die_options.deferred),
+     "Start the fork server at __AFL_INIT() of PUT, if PUT has it.\nDefault: false")
     //
     ("pargs", po::value<std::vector<std::string>>(&pargs),
      "Specify PUT and args for PUT.")
@@ -192,13 +196,21 @@ std::unique_ptr<TFuzzer> BuildDIEFuzzerFromArgs(FuzzerArgs &fuzzer_args,
     setting->out_dir / GetDefaultOutfile<DIETag>(),
     GetMapSize<DIETag>(), // afl_shm_size
     0, // bb_shm_size
-    setting->cpuid_to_bind
+    setting->cpuid_to_bind,
+    false, // record_stdout_and_err
+    NativeLinuxExecutor::PERSISTENT_MODE_DISABLED,
+    NativeLinuxExecutor::OUTPUT_CAPTURE_UNLIMITED,
+    die_options.deferred ? fuzzuf::executor::SnapshotPoint::Deferred
+                         : fuzzuf::executor::SnapshotPoint::Entry
   );
 
   using fuzzuf::algorithm::die::DIEState;
 
   /* Create state for DIE */
   auto state = std::make_unique<DIEState>(setting, executor);
+  state->deferred_mode = executor->IsDeferredForkServer();
+  // Without -t, the timeout is scaled from the calibration of the initial seeds
+  state->timeout_given = global_options.exec_timelimit_ms.has_value();
 
   return std::unique_ptr<TFuzzer>(
     dynamic_cast<TFuzzer *>(
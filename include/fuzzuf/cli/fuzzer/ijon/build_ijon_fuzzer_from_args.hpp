@@ -146,6 +146,8 @@ std::unique_ptr<TFuzzer> BuildIJONFuzzerFromArgs(
     // Create IJONState
     using fuzzuf::algorithm::ijon::IJONState;
     auto state = std::make_unique<IJONState>(setting, executor);
+    // Without -t, the timeout is scaled from the calibration of the initial seeds
+    state->timeout_given = global_options.exec_timelimit_ms.has_value();
 
     return std::unique_ptr<TFuzzer>(
                 dynamic_cast<TFuzzer *>(
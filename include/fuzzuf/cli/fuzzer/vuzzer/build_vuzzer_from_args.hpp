@@ -56,6 +56,7 @@ struct VUzzerOptions {
     std::string inst_bin;                   // Optional
     std::string taint_db;                   // Optional
     std::string taint_out;                  // Optional
+    u32 jobs;                               // Optional
 
     // Default values
     VUzzerOptions() : 
@@ -64,7 +65,8 @@ struct VUzzerOptions {
         weight("./weight"), 
         inst_bin("./instrumented.bin"), 
         taint_db("/mnt/polytracker/polytracker.db"),
-        taint_out("/tmp/taint.out")
+        taint_out("/tmp/taint.out"),
+        jobs(1)
         {};
 };
 
@@ -98,6 +100,9 @@ std::unique_ptr<TFuzzer> BuildVUzzerFromArgs(FuzzerArgs &fuzzer_args, GlobalFuzz
         ("taint_out", 
             po::value<std::string>(&vuzzer_options.taint_out), 
             "Set path to output for taint analysis. Default is `/tmp/taint.out`.")
+        ("jobs", 
+            po::value<u32>(&vuzzer_options.jobs)->default_value(vuzzer_options.jobs), 
+            "Number of PUT executions running in parallel to evaluate a generation. Default is 1.")
         ("pargs", 
             po::value<std::vector<std::string>>(&pargs), 
             "Specify PUT and args for PUT.")
@@ -117,6 +122,11 @@ std::unique_ptr<TFuzzer> BuildVUzzerFromArgs(FuzzerArgs &fuzzer_args, GlobalFuzz
         fuzzuf::cli::fuzzer::vuzzer::usage(fuzzer_args.global_options_description);
     }
 
+    if (vuzzer_options.jobs == 0) {
+        std::cerr << "[!] jobs must be greater than 0" << std::endl;
+        fuzzuf::cli::fuzzer::vuzzer::usage(fuzzer_args.global_options_description);
+    }
+
     /* (Pin) Executor of vuzzer requires absolute path of PUT binary */
     pargs[0] = fs::absolute(pargs[0]).native();
 
@@ -191,6 +201,31 @@ std::unique_ptr<TFuzzer> BuildVUzzerFromArgs(FuzzerArgs &fuzzer_args, GlobalFuzz
 
     auto state = std::make_unique<VUzzerState>(setting, executor, taint_executor);
 
+    // With jobs > 1, each generation is evaluated by that many PinToolExecutors in parallel.
+    // They need their own input files and coverage files.
+    if (vuzzer_options.jobs > 1) {
+        std::vector<std::shared_ptr<PinToolExecutor>> pool_executors;
+        for (u32 i = 0; i < vuzzer_options.jobs; i++) {
+            const auto feed_path = Util::StrPrintf("bb.%u.out", i);
+            pool_executors.emplace_back(
+                new PinToolExecutor(
+                    FUZZUF_PIN_EXECUTABLE,
+                    {TEST_BINARY_DIR "/../tools/bbcounts2/bbcounts2.so", "-o", feed_path, "-libc", "0"},
+                    setting->argv,
+                    setting->exec_timelimit_ms,
+                    setting->exec_memlimit,
+                    setting->out_dir / Util::StrPrintf("%s.%u", GetDefaultOutfile(), i)
+                    )
+            );
+            state->pool_feed_paths.emplace_back(feed_path);
+        }
+
+        state->executor_pool = std::make_unique<fuzzuf::executor::ExecutorPool<PinToolExecutor>>(
+            pool_executors,
+            std::vector<std::optional<int>>(vuzzer_options.jobs)
+        );
+    }
+
     return std::unique_ptr<TFuzzer>(
             dynamic_cast<TFuzzer *>(
                 new TVUzzer(std::move(state))
@@ -32,6 +32,7 @@ struct GlobalFuzzerOptions {
     std::optional<u32> exec_memlimit;       // Optional
     Logger logger;                          // Required
     std::optional<fs::path> log_file;       // Optional
+    std::optional<u64> seed;                // Optional
 
     // Default values
     GlobalFuzzerOptions() : 
@@ -42,6 +43,7 @@ struct GlobalFuzzerOptions {
         exec_timelimit_ms(std::nullopt), // Specify no limits
         exec_memlimit(std::nullopt),
         logger(Logger::Stdout),
-        log_file(std::nullopt)
+        log_file(std::nullopt),
+        seed(std::nullopt) // Chosen at random
         {};
 };
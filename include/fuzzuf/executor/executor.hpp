@@ -17,19 +17,79 @@
  */
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <memory>
+#include <vector>
 #include "fuzzuf/utils/common.hpp"
+#include "fuzzuf/feedback/exit_status_feedback.hpp"
 #include "fuzzuf/feedback/put_exit_reason_type.hpp"
 
 namespace fuzzuf::executor {
 
+// The control block shared between an executor and the processes it forks.
+// Each executor allocates it once, and it is overwritten in every execution.
 struct ChildState {
+  // The return value of execv and errno. exec_result is negative if execv failed.
   int exec_result;
   int exec_errno;
+  // The status of PUT retrieved via waitpid
+  int exit_status;
+  // Microseconds from fork to waitpid
+  std::uint64_t exec_time_us;
+  // The sequence number of the execution that wrote this block
+  std::uint64_t seq;
 };
 
 using output_t = std::vector< std::uint8_t >;
 constexpr std::size_t output_block_size = 512u;
+// The default maximum number of bytes of stdout(and stderr) recorded in each execution by the executors which bound them
+constexpr std::size_t default_output_capture_limit = 1024u * 1024u;
+
+// How an executor records the bytes PUT writes to a file descriptor
+enum class OutputCapturePolicy {
+  // Redirect to /dev/null
+  Discard,
+  // Keep only the hash of the bytes(see UpdateOutputHash). The bytes themselves are never stored.
+  HashOnly,
+  // Keep the first OutputCapture::limit bytes in a fixed size buffer, and discard the rest
+  Head,
+  // Keep all bytes in a growing buffer
+  Full,
+};
+
+struct OutputCapture {
+  // The file descriptor of PUT, e.g. 1 for stdout
+  int fd;
+  OutputCapturePolicy policy;
+  // The maximum number of bytes kept. Used only by OutputCapturePolicy::Head
+  std::size_t limit = 0;
+};
+
+// Where the fork server inside PUT takes the snapshot, i.e. the state from which the process of each execution is forked
+enum class SnapshotPoint {
+  // The entry of PUT, before main() is called
+  Entry,
+  // The point PUT marks with __AFL_INIT(), usually after the initialization which doesn't depend on the input.
+  // Falls back to Entry if PUT doesn't have the mark.
+  Deferred,
+};
+
+// One of the inputs executed by Executor::RunBatch. The buffer must be alive until RunBatch returns.
+struct BatchInput {
+  const u8 *buf;
+  u32 len;
+};
+
+// The hash of the outputs, which is updated on every chunk read from PUT(64bit FNV-1a)
+constexpr std::uint64_t output_hash_seed = 0xcbf29ce484222325ULL;
+inline std::uint64_t UpdateOutputHash( std::uint64_t hash, const std::uint8_t *data, std::size_t size ) {
+  for( std::size_t i = 0; i < size; ++i ) {
+    hash ^= data[ i ];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
 }
 
 // A base class that abstracts any kinds of execution environments and fuzz executions.
@@ -77,6 +137,29 @@ public:
     // Read an input and actually execute the PUT
     virtual void Run(const u8 *buf, u32 len, u32 timeout_ms=0) = 0;
 
+    // Called by RunBatch after each execution with the index of the input and its exit status.
+    // The other feedback of the execution(e.g. GetAFLFeedback()) can be retrieved until the callback returns.
+    // Return false to skip the rest of the batch.
+    using BatchCallback = std::function<bool(std::size_t, const ExitStatusFeedback&)>;
+
+    // Execute the inputs in order, as if Run(input.buf, input.len, timeout_ms) is called for each input.
+    // Returns the exit statuses of the executed inputs with the same indices.
+    // Derivatives share the cost of the executions among the inputs through RunBatchInput and FinishBatch.
+    std::vector<ExitStatusFeedback> RunBatch(
+        const std::vector<fuzzuf::executor::BatchInput> &inputs,
+        const BatchCallback &callback = BatchCallback(),
+        u32 timeout_ms = 0
+    );
+    // The same as RunBatch, except that the time limit has the precision of microseconds.
+    // The executors whose time limit has the precision of milliseconds round it up.
+    std::vector<ExitStatusFeedback> RunBatchWithTimeoutUs(
+        const std::vector<fuzzuf::executor::BatchInput> &inputs,
+        const BatchCallback &callback,
+        u64 timeout_us
+    );
+
+    virtual ExitStatusFeedback GetExitStatusFeedback() = 0;
+
     void KillChildWithoutWait();
 
     // Called when fuzzuf needs to be stopped earlier, such as when SIGTERM is triggered
@@ -86,5 +169,11 @@ public:
     void WriteTestInputToFile(const u8 *buf, u32 len);
 
 protected:
+    // Execute one input of RunBatch. The feedback is retrieved with the usual getters afterwards.
+    // The default is Run with the time limit rounded up to milliseconds.
+    virtual void RunBatchInput(const fuzzuf::executor::BatchInput &input, u64 timeout_us);
+    // Called once RunBatch has executed the inputs, e.g. to release what RunBatchInput kept between the inputs.
+    virtual void FinishBatch() {}
+
     std::shared_ptr<u8> lock;
 };
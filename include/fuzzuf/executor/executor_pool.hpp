@@ -0,0 +1,112 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <cstddef>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include "fuzzuf/utils/common.hpp"
+
+namespace fuzzuf::executor {
+
+// A class which runs independent executions on several executors in parallel,
+// e.g. to evaluate all inputs of a generation in population-based algorithms.
+//
+// Each executor is used only by its own worker thread, which is bound to the cpu core the executor is bound to.
+// The tasks of Dispatch are split evenly among the workers first. A worker which has run out of its tasks
+// steals the latter half of the remaining tasks of another worker, so that slow executions don't leave the other cores idle.
+//
+// Responsibility:
+//  - The executors binding themselves with NativeLinuxExecutor::CPUID_BIND_WHICHEVER must be created one after another,
+//    so that each of them sees the cores taken by the former ones and picks a distinct one.
+//  - Tasks must not access anything shared with the other tasks without synchronization.
+//  - Dispatch and Map must be called from one thread at a time.
+template<class E>
+class ExecutorPool {
+public:
+    using Task = std::function<void(E&, std::size_t)>;
+
+    // cpuids[i] is the cpu core executors[i] is bound to, if any(e.g. NativeLinuxExecutor::binded_cpuid)
+    ExecutorPool(
+        std::vector<std::shared_ptr<E>> executors,
+        const std::vector<std::optional<int>> &cpuids
+    );
+    ~ExecutorPool();
+
+    ExecutorPool( const ExecutorPool& ) = delete;
+    ExecutorPool &operator=( const ExecutorPool& ) = delete;
+
+    // Call task(executor, i) for each i in [0, task_count) on one of the executors, and wait for all of them.
+    // If a task throws, the tasks not started yet are skipped and the exception is rethrown.
+    void Dispatch(std::size_t task_count, const Task &task);
+
+    // The same as Dispatch, except that the values returned by task are collected in the order of i.
+    // The values of the tasks skipped by ReceiveStopSignal are default constructed.
+    template<class R>
+    std::vector<R> Map(std::size_t task_count, const std::function<R(E&, std::size_t)> &task);
+
+    // Skip all tasks not started yet, and stop the executions in progress.
+    // The stop is terminal: every task given to Dispatch and Map afterwards is skipped as well.
+    void ReceiveStopSignal(void);
+
+    std::size_t GetExecutorCount(void) const;
+    E &GetExecutor(std::size_t i);
+
+private:
+    // The tasks [begin, end) assigned to a worker
+    struct TaskRange {
+        std::mutex mutex;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+    };
+
+    void WorkerLoop(std::size_t worker);
+    bool PopTask(std::size_t worker, std::size_t &index);
+    bool StealTask(std::size_t worker, std::size_t &index);
+
+    std::vector<std::shared_ptr<E>> executors;
+    std::vector<std::optional<int>> cpuids;
+    std::unique_ptr<TaskRange[]> ranges;
+    std::vector<std::thread> threads;
+
+    // The members below are guarded by mutex
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    const Task *current_task = nullptr;
+    u64 generation = 0;
+    std::size_t running_workers = 0;
+    bool terminating = false;
+    std::exception_ptr error;
+
+    // Set if the rest of the tasks have to be skipped.
+    // failed is reset by each Dispatch, whereas stop_requested is never reset.
+    std::atomic<bool> failed;
+    std::atomic<bool> stop_requested;
+};
+
+} // namespace fuzzuf::executor
+
+#include "fuzzuf/executor/templates/executor_pool.hpp"
@@ -0,0 +1,131 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <string>
+#include "fuzzuf/utils/filesystem.hpp"
+#include "fuzzuf/executor/executor.hpp"
+#include "fuzzuf/utils/common.hpp"
+#include "fuzzuf/feedback/inplace_memory_feedback.hpp"
+#include "fuzzuf/feedback/exit_status_feedback.hpp"
+
+// A class for fuzz execution of libFuzzer style harnesses, i.e. shared objects exporting LLVMFuzzerTestOneInput,
+// without creating a process per input.
+//
+// The shared object is loaded into this process with dlopen. Then a runner process is forked from this process,
+// which receives inputs via a socket and a shared memory, and calls LLVMFuzzerTestOneInput directly in a loop.
+// If an input crashes or hangs the runner, only the runner dies. A new one is forked in the next execution.
+//
+// Coverage:
+//  - If the harness is built with -fsanitize-coverage=inline-8bit-counters(e.g. -fsanitize=fuzzer-no-link),
+//    the counters are copied to the map returned by GetBBFeedback after each execution.
+//    The harness has to be linked with libfuzzuf-sancov(or loaded with it in LD_PRELOAD), which defines
+//    the callbacks of SanitizerCoverage and records the counters (see fuzzuf/executor/sancov_shim.hpp).
+//  - If the harness is built with the instrumentation of AFL, it writes to the map returned by GetAFLFeedback directly.
+//    The runner makes __afl_area_ptr of the harness point the map.
+//
+// Responsibility:
+//  - Class member Executor::argv holds the path to the shared object
+//  - Only the counters in the shared object itself are used. Those in the libraries it depends on are ignored.
+class InProcessExecutor : public Executor {
+public:
+    static constexpr int INVALID_SHMID = -1;
+
+    // The maximum length of inputs. Longer inputs are truncated(Same as NativeLinuxExecutor::INPUT_SHM_MAX_LEN).
+    static constexpr u32 INPUT_MAX_LEN = 1 * 1024 * 1024;
+
+    static constexpr const char* AFL_SHM_ENV_VAR = "__AFL_SHM_ID";
+
+    static constexpr const char* TEST_ONE_INPUT_SYMBOL = "LLVMFuzzerTestOneInput";
+    static constexpr const char* INITIALIZE_SYMBOL = "LLVMFuzzerInitialize";
+    // The pointer to the coverage map in the runtime of AFL
+    static constexpr const char* AFL_AREA_PTR_SYMBOL = "__afl_area_ptr";
+
+    using TestOneInputFunc = int (*)(const u8 *data, std::size_t size);
+    using InitializeFunc = int (*)(int *argc, char ***argv);
+
+    // Members holding settings handed over a constructor
+    const u32 afl_shm_size;
+    const u32  bb_shm_size;
+
+    // InProcessExecutor::INVALID_SHMID means not holding valid ID
+    int afl_shmid;
+
+    u8 *afl_trace_bits;
+    u8 *bb_trace_bits;
+    // The shared memory to pass inputs to the runner
+    u8 *input_buf;
+
+    // The regions of the 8bit counters in the shared object. They are shared by all instances loading the same shared object,
+    // but each runner has its own copy.
+    std::vector<std::pair<u8*, u8*>> counter_regions;
+
+    void *library_handle;
+    TestOneInputFunc test_one_input;
+    InitializeFunc initialize;
+    // Points __afl_area_ptr of the harness if it is built with AFL instrumentation. nullptr otherwise.
+    u8 **afl_area_ptr;
+
+    // The pid of the runner, and the socket between this process and the runner. 0 and -1 if the runner is not running.
+    int runner_pid;
+    int runner_fd;
+
+    bool child_timed_out;
+
+    InProcessExecutor(
+        const fs::path &path_to_library,
+        u32 exec_timelimit_ms,
+        u64 exec_memlimit,
+        const fs::path &path_to_write_input,
+        u32 afl_shm_size,
+        u32  bb_shm_size
+    );
+    ~InProcessExecutor();
+
+    InProcessExecutor( const InProcessExecutor& ) = delete;
+    InProcessExecutor( InProcessExecutor&& ) = delete;
+    InProcessExecutor &operator=( const InProcessExecutor& ) = delete;
+    InProcessExecutor &operator=( InProcessExecutor&& ) = delete;
+    InProcessExecutor() = delete;
+
+    void Run(const u8 *buf, u32 len, u32 timeout_ms=0);
+    void ReceiveStopSignal(void);
+
+    // Environment-specific methods
+    InplaceMemoryFeedback GetAFLFeedback();
+    InplaceMemoryFeedback GetBBFeedback();
+    // The outputs of the harness are not recorded. These are always empty.
+    InplaceMemoryFeedback GetStdOut();
+    InplaceMemoryFeedback GetStdErr();
+    ExitStatusFeedback GetExitStatusFeedback();
+
+    void LoadLibrary();
+    void SetupSharedMemories();
+    void EraseSharedMemories();
+    void SetupRunner();
+    [[noreturn]] void RunRunner(int fd);
+    void TerminateRunner();
+
+private:
+    PUTExitReasonType last_exit_reason;
+    u8 last_signal;
+};
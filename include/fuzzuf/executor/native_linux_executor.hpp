@@ -27,6 +27,9 @@
 #include "fuzzuf/exceptions.hpp"
 #include "fuzzuf/executor/executor.hpp"
 #include "fuzzuf/utils/common.hpp"
+#include "fuzzuf/utils/dirty_regions.hpp"
+#include "fuzzuf/utils/environment.hpp"
+#include "fuzzuf/utils/bounded_output_buffer.hpp"
 #include "fuzzuf/feedback/inplace_memory_feedback.hpp"
 #include "fuzzuf/feedback/exit_status_feedback.hpp"
 
@@ -46,6 +49,18 @@ public:
 
     static constexpr int INVALID_SHMID = -1; 
 
+    // Options exchanged in the handshake of the fork server built with AFL++
+    static constexpr u32 FS_OPT_ENABLED     = 0x80000001;
+    static constexpr u32 FS_OPT_AUTODICT    = 0x10000000;
+    static constexpr u32 FS_OPT_SHDMEM_FUZZ = 0x01000000;
+    // The size of the coverage map PUT uses is encoded in the bits of FS_OPT_MAPSIZE_MASK
+    static constexpr u32 FS_OPT_MAPSIZE      = 0x40000000;
+    static constexpr u32 FS_OPT_MAPSIZE_MASK = 0x00fffffe;
+
+    // The maximum length of inputs passed via the shared memory(Same as MAX_FILE of AFL++).
+    // The shared memory has a 4byte header holding the length of the input in front of the input.
+    static constexpr u32 INPUT_SHM_MAX_LEN = 1 * 1024 * 1024;
+
     // Constant values used as "cpuid_to_bind", one of the arguments of the constructor
     static constexpr int CPUID_DO_NOT_BIND    = -2;
     static constexpr int CPUID_BIND_WHICHEVER = -1;
@@ -56,15 +71,66 @@ public:
     static constexpr const char* AFL_SHM_ENV_VAR = "__AFL_SHM_ID";
     // FIXME: we have to modify fuzzuf-cc to change __WYVERN_SHM_ID to __FUZZUF_SHM_ID
     static constexpr const char* FUZZUF_SHM_ENV_VAR = "__WYVERN_SHM_ID";
+    // The PUT built with AFL++ reads inputs from the shared memory specified by this variable
+    // if it is told to do so in the handshake of the fork server
+    static constexpr const char* AFL_SHM_FUZZ_ENV_VAR = "__AFL_SHM_FUZZ_ID";
+    // The PUT built with afl-clang-fast enters persistent mode(__AFL_LOOP) only if this variable is set
+    static constexpr const char* PERSIST_ENV_VAR = "__AFL_PERSISTENT";
+    // The PUT built with AFL++ refuses to start if its coverage map is larger than the size told by this variable
+    static constexpr const char* AFL_MAP_SIZE_ENV_VAR = "AFL_MAP_SIZE";
+    // The PUT built with afl-clang-fast starts the fork server at __AFL_INIT() instead of its entry
+    // only if this variable is set
+    static constexpr const char* DEFER_ENV_VAR = "__AFL_DEFER_FORKSRV";
+    // The PUT using __AFL_INIT() has this string in its binary
+    static constexpr const char* DEFER_SIG = "##SIG_AFL_DEFER_FORKSRV##";
+
+    // Constant value used as "persistent_loop_count", one of the arguments of the constructor
+    static constexpr u32 PERSISTENT_MODE_DISABLED = 0;
+
+    // Constant value used as "output_capture_limit", one of the arguments of the constructor
+    static constexpr u32 OUTPUT_CAPTURE_UNLIMITED = 0;
+
+    // The smallest coverage map afl_map_size is rounded up to
+    static constexpr u32 MIN_AFL_MAP_SIZE = 64;
 
     // Members holding settings handed over a constructor
     const bool forksrv;
 
     // FIXME: we want to change the type of these variables to u64.
     // But to do this, we have to modify InplaceFeedback and everything using it.
-    const u32  afl_shm_size;
+    // afl_shm_size is the one given to the constructor, unless PUT has told it needs a larger map(see afl_map_size).
+    u32  afl_shm_size;
     const u32   bb_shm_size;
 
+    // The size of the coverage map PUT actually uses, which is told in the handshake of the fork server built with AFL++.
+    // It is rounded up to a power of two(at least MIN_AFL_MAP_SIZE), so that the kernels scanning the map work on whole blocks.
+    // Equal to afl_shm_size if PUT doesn't tell it. Only this part of afl_trace_bits is reset and returned by GetAFLFeedback.
+    // Never larger than afl_shm_size: If PUT needs a larger map, the shared memory is allocated again, and the fork server is restarted.
+    u32 afl_map_size;
+    // True if afl_map_size is the one PUT has told
+    bool afl_map_size_negotiated;
+
+    // In persistent mode, a PUT process handles multiple inputs in a loop until it is recycled.
+    // This value is the maximum number of inputs one PUT process handles before fuzzuf kills it and
+    // lets the fork server spawn a new one. PERSISTENT_MODE_DISABLED means persistent mode is not used.
+    const u32 persistent_loop_count;
+
+    // How the outputs of PUT are recorded in each execution. The fds not listed here are redirected to /dev/null.
+    //  - Full: The output is drained from a pipe into a growing buffer.
+    //  - Head: The output is drained from a pipe into a fixed size buffer, which is read in place without copying.
+    //          The rest is discarded without being copied, so that a PUT writing a lot uses no more memory.
+    //  - HashOnly: The output is drained from a pipe and only its hash is kept.
+    // Only stdout(1) and stderr(2) can be captured for now.
+    const std::vector<fuzzuf::executor::OutputCapture> output_captures;
+
+    // Where the fork server inside PUT is requested to take the snapshot. Only meaningful in fork server mode.
+    const fuzzuf::executor::SnapshotPoint snapshot_point;
+
+    // If true, bb_trace_bits and afl_trace_bits are allocated with SHM_HUGETLB to reduce TLB misses while they are
+    // zeroed and scanned in each execution. Falls back to normal pages if no huge page is reserved(vm.nr_hugepages).
+    // Regardless of this, the maps are placed on the NUMA node of binded_cpuid if this process is bound.
+    const bool use_huge_pages;
+
     // NativeLinuxExecutor may specify a CPU core executing this process (or PUT processes) for speed
     // If specified, an id in the range 0-origin is assigned. std::nullopt otherwise.
     std::optional<int> binded_cpuid; 
@@ -76,6 +142,7 @@ public:
     // NativeLinuxExecutor::INVALID_SHMID means not holding valid ID
     int bb_shmid;  
     int afl_shmid; 
+    int input_shmid;
 
     int forksrv_pid;
     int forksrv_read_fd;
@@ -83,15 +150,68 @@ public:
 
     u8 *bb_trace_bits;
     u8 *afl_trace_bits;
+    // Regions of bb_trace_bits and afl_trace_bits which have to be zeroed before the next execution.
+    // Disabled by default, in which case the whole maps are zeroed. Enable them to let the
+    // consumer of the feedback record the regions the PUT actually touched (see DirtyRegions).
+    fuzzuf::utils::DirtyRegions bb_dirty_regions;
+    fuzzuf::utils::DirtyRegions afl_dirty_regions;
+    // The shared memory to pass inputs to PUT. Allocated only in fork server mode.
+    u8 *input_shm;
+    // True if PUT accepted to read inputs from input_shm in the handshake of the fork server.
+    // Otherwise, inputs are written to the file at path_str_to_write_input.
+    bool uses_shm_input;
 
     bool child_timed_out;
 
-    static bool has_setup_sighandlers;
-    // A pointer to a currently active instance, used by a signal handler.
-    // nullptr if no such instance.
-    // Beware that it temporarily assumes that multiple fuzzer instances do not become active simultaneously.
-    static NativeLinuxExecutor *active_instance;
+    // The number of inputs the current (stopped) PUT process has handled in persistent mode.
+    u32 persistent_exec_count;
+    // Whether the PUT process of the last execution was killed by fuzzuf(for timeout or recycle).
+    // This is told to the fork server in the next request so that it reaps the process and forks a new one.
+    bool persistent_child_killed;
+
+    // True if the fork server was started at __AFL_INIT(). This becomes false if snapshot_point is Deferred
+    // but PUT doesn't have DEFER_SIG or the fork server didn't start, in which case the fork server is
+    // restarted from the entry of PUT.
+    bool deferred_fork_server;
+
+    // Shared with the virtual fork server and the processes it forks to report the result of each execution.
+    // Allocated only once, and only in non fork server mode.
+    std::shared_ptr<fuzzuf::executor::ChildState> child_state;
+    // The number of executions requested so far. child_state->seq must match it after each execution.
+    u64 exec_seq;
 
+    // The environment variables PUT is executed with. It starts with a copy of the environment of this process
+    // at the construction, then SetupEnvironmentVariablesForTarget adds the ones for this instance.
+    // The environment of this process is never modified, so that multiple instances can coexist in one process.
+    fuzzuf::utils::Environment target_env;
+
+    NativeLinuxExecutor(  
+        const std::vector<std::string> &argv,
+        u32 exec_timelimit_ms,
+        u64 exec_memlimit,
+        bool forksrv,
+        const fs::path &path_to_write_input,
+        u32 afl_shm_size,
+        u32  bb_shm_size,
+        int cpuid_to_bind, 
+        // Recording the outputs in every execution of a PUT isn't required in most fuzzers, and costs a lot.
+        // Therefore, they are discarded by default. If true, stdout and stderr are recorded with
+        // OutputCapturePolicy::Full, or OutputCapturePolicy::Head if output_capture_limit is set.
+        // Use the other constructor to choose the policy for each fd.
+        bool record_stdout_and_err = false,
+        // Pass a non-zero value to enable persistent mode. It requires fork server mode and a PUT
+        // that uses __AFL_LOOP(). See also the comment on the member "persistent_loop_count".
+        u32 persistent_loop_count = PERSISTENT_MODE_DISABLED,
+        // Pass a non-zero value to record stdout and stderr into bounded buffers without copying.
+        u32 output_capture_limit = OUTPUT_CAPTURE_UNLIMITED,
+        // Pass SnapshotPoint::Deferred to skip the initialization of PUT before __AFL_INIT() in each execution.
+        // See also the comment on the member "deferred_fork_server".
+        fuzzuf::executor::SnapshotPoint snapshot_point = fuzzuf::executor::SnapshotPoint::Entry,
+        // See the comment on the member "use_huge_pages".
+        bool use_huge_pages = false
+    );
+    // The same as above, except that the outputs to record are specified for each fd.
+    // See also the comment on the member "output_captures".
     NativeLinuxExecutor(  
         const std::vector<std::string> &argv,
         u32 exec_timelimit_ms,
@@ -101,14 +221,10 @@ public:
         u32 afl_shm_size,
         u32  bb_shm_size,
         int cpuid_to_bind, 
-        // FIXME: The below is a temporary flag to avoid a big performance issue.
-        // The issue appears when we save the outputs of stdout/stderr to buffers
-        // in every execution of a PUT, which isn't required in most fuzzers.
-        // This is just a temporary and ugly countermeasure.
-        // In the future, we should generalize this flag so that we can arbitrarily specify 
-        // which fd should be recorded. For example, by passing std::vector<int>{1, 2} to this class,
-        // we would tell that we would like to record stdout and stderr.
-        bool record_stdout_and_err = false
+        const std::vector<fuzzuf::executor::OutputCapture> &output_captures,
+        u32 persistent_loop_count = PERSISTENT_MODE_DISABLED,
+        fuzzuf::executor::SnapshotPoint snapshot_point = fuzzuf::executor::SnapshotPoint::Entry,
+        bool use_huge_pages = false
     );
     ~NativeLinuxExecutor();
 
@@ -122,12 +238,21 @@ public:
     // Declare in the base class and define in each derivative, if possible (how to achieve?)
     void Run(const u8 *buf, u32 len, u32 timeout_ms=0);
     void ReceiveStopSignal(void);
+    // The same as Run, except that the time limit has the precision of microseconds.
+    // Useful for fast PUTs, whose adequate time limits are far less than a millisecond.
+    void RunWithTimeoutUs(const u8 *buf, u32 len, u64 timeout_us);
 
     // Environment-specific methods
     InplaceMemoryFeedback GetAFLFeedback();
     InplaceMemoryFeedback GetBBFeedback();
     InplaceMemoryFeedback GetStdOut();
     InplaceMemoryFeedback GetStdErr();
+    // The recorded output written to fd in the last execution. Empty if fd is not recorded,
+    // or its policy is Discard or HashOnly.
+    InplaceMemoryFeedback GetOutput(int fd);
+    // The hash of the output written to fd in the last execution, for any policy except Discard.
+    // With Head, it covers only the recorded bytes.
+    u64 GetOutputHash(int fd);
     ExitStatusFeedback GetExitStatusFeedback();
 
     void TerminateForkServer();
@@ -137,25 +262,71 @@ public:
     void EraseSharedMemories();
     void SetupEnvironmentVariablesForTarget();
     void SetupForkServer();    
+    [[noreturn]] void RunVirtualForkServer();
+    bool IsPersistentMode() const;
+    static u32 DecodeMapSizeOption(u32 status);
+    static u32 RoundUpMapSize(u32 size);
+    void ResizeAFLSharedMemory(u32 size);
+    bool IsDeferredForkServer() const;
+    static bool HasDeferredForkServerSignature(const char *path);
+    void WriteTestInputToSharedMemory(const u8 *buf, u32 len);
 
     static void SetupSignalHandlers();
-    static void AlarmHandler(int signum);
+
+    // True if the output of the last execution exceeded the limit of OutputCapturePolicy::Head and was truncated.
+    bool IsStdOutTruncated() const;
+    bool IsStdErrTruncated() const;
+    bool IsOutputTruncated(int fd) const;
+
+    static std::vector<fuzzuf::executor::OutputCapture> StdOutAndErrCaptures(
+        bool record_stdout_and_err,
+        u32 output_capture_limit
+    );
 
     // InplaceMemoryFeedback made of GetStdOut before calling this function becomes invalid after Run()
+    // With OutputCapturePolicy::Head, the outputs are copied instead of moved.
     fuzzuf::executor::output_t MoveStdOut();
     // InplaceMemoryFeedback made of GetStdErr before calling this function becomes invalid after Run()
     fuzzuf::executor::output_t MoveStdErr();
+    fuzzuf::executor::output_t MoveOutput(int fd);
 private:    
+    // The state of an fd in output_captures
+    struct CapturedOutput {
+        // The read end of the pipe from PUT. Used by all policies except Discard.
+        int pipe_fd = -1;
+        // Used by Head
+        std::unique_ptr<fuzzuf::utils::BoundedOutputBuffer> head;
+        // Used by Full
+        fuzzuf::executor::output_t buffer;
+        // Used by HashOnly
+        std::uint64_t hash = fuzzuf::executor::output_hash_seed;
+    };
+
+    // Allocate and attach a shared memory for a coverage map, following use_huge_pages and binded_cpuid
+    u8 *AttachMapSharedMemory(int &shmid, u32 size);
+
+    void SetForkServerTimer(u64 timeout_us);
+
+    // In a batch, the timer isn't disarmed after each input, because arming it for the next input
+    // also clears the expiration. It is disarmed once in FinishBatch.
+    void RunBatchInput(const fuzzuf::executor::BatchInput &input, u64 timeout_us) override;
+    void FinishBatch() override;
+
+    // Returns the index of fd in output_captures, or -1 if fd isn't recorded
+    int FindOutputCapture(int fd) const;
+    // Read a chunk from the pipe of output_captures[index]. Returns false if the pipe has no more data for now.
+    bool ReadCapturedOutput(std::size_t index);
+
     PUTExitReasonType last_exit_reason;
     u8 last_signal;    
-    fuzzuf::executor::output_t stdout_buffer;
-    fuzzuf::executor::output_t stderr_buffer;
-    int fork_server_stdout_fd = -1;
-    int fork_server_stderr_fd = -1;
+    // The states of output_captures with the same indices
+    std::vector<CapturedOutput> captured_outputs;
     int fork_server_epoll_fd = -1;
-    epoll_event fork_server_stdout_event;
-    epoll_event fork_server_stderr_event;
+    // A timerfd registered to fork_server_epoll_fd, which tells the timeout of PUT
+    int fork_server_timer_fd = -1;
+    // True if fork_server_timer_fd may expire, i.e. it has been armed and not disarmed since
+    bool fork_server_timer_armed = false;
+    // True while RunBatch is executing the inputs. See RunBatchInput.
+    bool in_batch = false;
     epoll_event fork_server_read_event;
-
-    bool record_stdout_and_err;
 };
@@ -27,6 +27,8 @@
 #include "fuzzuf/exceptions.hpp"
 #include "fuzzuf/executor/executor.hpp"
 #include "fuzzuf/utils/common.hpp"
+#include "fuzzuf/utils/dirty_regions.hpp"
+#include "fuzzuf/utils/environment.hpp"
 #include "fuzzuf/feedback/inplace_memory_feedback.hpp"
 #include "fuzzuf/feedback/exit_status_feedback.hpp"
 #include "fuzzuf/feedback/file_feedback.hpp"
@@ -90,14 +92,22 @@ public:
 
     u8 *bb_trace_bits;
     u8 *afl_trace_bits;
+    // Regions of bb_trace_bits and afl_trace_bits which have to be zeroed before the next execution.
+    // See the same members of NativeLinuxExecutor.
+    fuzzuf::utils::DirtyRegions bb_dirty_regions;
+    fuzzuf::utils::DirtyRegions afl_dirty_regions;
 
     bool child_timed_out;
 
-    static bool has_setup_sighandlers;
-    // A pointer to a currently active instance, used by a signal handler.
-    // nullptr if no such instance.
-    // Beware that it temporarily assumes that multiple fuzzer instances do not become active simultaneously.
-    static ProxyExecutor *active_instance;
+    // Shared with the PUT processes forked in non fork server mode to report the result of each execution.
+    // Allocated only once. In fork server mode, only the members filled by this class are meaningful.
+    std::shared_ptr<fuzzuf::executor::ChildState> child_state;
+    // The number of executions so far
+    u64 exec_seq;
+
+    // The environment variables the proxy is executed with. See the same member of NativeLinuxExecutor.
+    fuzzuf::utils::Environment target_env;
+
 
     ProxyExecutor(
         const fs::path &proxy_path,
@@ -164,7 +174,6 @@ public:
     void SetupForkServer();    
 
     static void SetupSignalHandlers();
-    static void AlarmHandler(int signum);
 
     // InplaceMemoryFeedback made of GetStdOut before calling this function becomes invalid after Run()
     fuzzuf::executor::output_t MoveStdOut();
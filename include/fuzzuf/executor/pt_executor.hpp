@@ -45,6 +45,9 @@ public:
 
     u8 *path_trace_bits;
     u8 *fav_trace_bits;
+    // See bb_dirty_regions and afl_dirty_regions of ProxyExecutor
+    fuzzuf::utils::DirtyRegions path_dirty_regions;
+    fuzzuf::utils::DirtyRegions fav_dirty_regions;
 
     PTExecutor(
         const fs::path &proxy_path,
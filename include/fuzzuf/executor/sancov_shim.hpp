@@ -0,0 +1,45 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// The interface of libfuzzuf-sancov, the shim which defines the callbacks of SanitizerCoverage for InProcessExecutor.
+//
+// A libFuzzer style harness built with -fsanitize-coverage=inline-8bit-counters(e.g. -fsanitize=fuzzer-no-link)
+// calls __sanitizer_cov_8bit_counters_init from its constructors. Without -fsanitize=fuzzer, nothing in the harness
+// defines it, so the harness has to be linked with libfuzzuf-sancov(or loaded with it in LD_PRELOAD).
+// The shim records the regions of the counters, and InProcessExecutor looks them up with dlsym.
+// Only the 8bit counters are used. The other callbacks are defined just to make the harness loadable.
+extern "C" {
+
+struct fuzzuf_sancov_region {
+    std::uint8_t *start;
+    std::uint8_t *stop;
+};
+
+// Returns the regions registered by all the objects loaded so far, and stores their number to count
+const fuzzuf_sancov_region *fuzzuf_sancov_get_counter_regions(std::size_t *count);
+
+using FuzzufSancovGetCounterRegionsFunc = const fuzzuf_sancov_region *(*)(std::size_t *count);
+
+}
+
+// The name InProcessExecutor looks up
+#define FUZZUF_SANCOV_GET_COUNTER_REGIONS_SYMBOL "fuzzuf_sancov_get_counter_regions"
@@ -0,0 +1,248 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#pragma once
+
+#include <sched.h>
+#include "fuzzuf/logger/logger.hpp"
+
+namespace fuzzuf::executor {
+
+/**
+ * Postcondition:
+ *  - One worker thread per executor is started, and waits for Dispatch.
+ */
+template<class E>
+ExecutorPool<E>::ExecutorPool(
+    std::vector<std::shared_ptr<E>> executors,
+    const std::vector<std::optional<int>> &cpuids
+) :
+    executors( std::move(executors) ),
+    cpuids( cpuids ),
+    ranges( new TaskRange[ this->executors.size() ] ),
+    failed( false ),
+    stop_requested( false )
+{
+    if (this->executors.empty()) {
+        ERROR("At least one executor is required");
+    }
+
+    if (this->cpuids.size() != this->executors.size()) {
+        ERROR("The number of cpu cores does not match the number of executors");
+    }
+
+    for (std::size_t i = 0; i < this->executors.size(); i++) {
+        threads.emplace_back([this, i]() { WorkerLoop(i); });
+    }
+}
+
+template<class E>
+ExecutorPool<E>::~ExecutorPool() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        terminating = true;
+    }
+    start_cv.notify_all();
+
+    for (auto &thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+}
+
+/**
+ * Postcondition:
+ *  - task is called exactly once for each index unless a task throws or ReceiveStopSignal is called.
+ *  - All workers are idle again when this function returns.
+ */
+template<class E>
+void ExecutorPool<E>::Dispatch(std::size_t task_count, const Task &task) {
+    if (task_count == 0) return;
+
+    const std::size_t worker_count = executors.size();
+    for (std::size_t i = 0; i < worker_count; i++) {
+        std::lock_guard<std::mutex> guard(ranges[i].mutex);
+        ranges[i].begin = task_count * i / worker_count;
+        ranges[i].end = task_count * (i + 1) / worker_count;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        current_task = &task;
+        running_workers = worker_count;
+        error = nullptr;
+        failed.store(false, std::memory_order_relaxed);
+        generation++;
+    }
+    start_cv.notify_all();
+
+    std::exception_ptr thrown;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [this]() { return running_workers == 0; });
+        current_task = nullptr;
+        thrown = error;
+    }
+
+    if (thrown) std::rethrow_exception(thrown);
+}
+
+template<class E>
+template<class R>
+std::vector<R> ExecutorPool<E>::Map(
+    std::size_t task_count,
+    const std::function<R(E&, std::size_t)> &task
+) {
+    // Each slot is written by only one worker. The slots are not R itself,
+    // because std::vector<bool> packs the elements into bits shared by the workers.
+    std::vector<std::optional<R>> slots(task_count);
+    Dispatch(task_count, [&slots, &task](E &executor, std::size_t i) {
+        slots[i] = task(executor, i);
+    });
+
+    std::vector<R> results;
+    results.reserve(task_count);
+    for (auto &slot : slots) {
+        if (slot) results.emplace_back(std::move(*slot));
+        else results.emplace_back();
+    }
+    return results;
+}
+
+// Do not call non aync-signal-safe functions inside
+// because this function can be called during signal handling
+template<class E>
+void ExecutorPool<E>::ReceiveStopSignal(void) {
+    stop_requested.store(true, std::memory_order_relaxed);
+
+    for (auto &executor : executors) {
+        executor->ReceiveStopSignal();
+    }
+}
+
+template<class E>
+std::size_t ExecutorPool<E>::GetExecutorCount(void) const {
+    return executors.size();
+}
+
+template<class E>
+E &ExecutorPool<E>::GetExecutor(std::size_t i) {
+    return *executors[i];
+}
+
+/**
+ * Postcondition:
+ *  - The thread is bound to cpuids[worker] if it has a value and the core is available.
+ *  - For each Dispatch, the tasks are taken from the own range first, then from the other workers.
+ *  - The thread returns when the pool is destroyed.
+ */
+template<class E>
+void ExecutorPool<E>::WorkerLoop(std::size_t worker) {
+#ifdef __linux__
+    if (cpuids[worker]) {
+        cpu_set_t c;
+        CPU_ZERO(&c);
+        CPU_SET(cpuids[worker].value(), &c);
+
+        // The thread can't report an error before the first Dispatch, so just run it anywhere.
+        // Only the cache locality of the executor is lost.
+        if (sched_setaffinity(0, sizeof(c), &c)) {
+            DEBUG("sched_setaffinity failed. Worker %zu runs on any cpu core", worker);
+        }
+    }
+#endif
+
+    u64 seen_generation = 0;
+    while (true) {
+        const Task *task = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_cv.wait(lock, [this, seen_generation]() {
+                return terminating || generation != seen_generation;
+            });
+            if (terminating) return;
+
+            seen_generation = generation;
+            task = current_task;
+        }
+
+        auto &executor = *executors[worker];
+        std::size_t index;
+        while (!failed.load(std::memory_order_relaxed)
+            && !stop_requested.load(std::memory_order_relaxed)
+            && (PopTask(worker, index) || StealTask(worker, index))) {
+            try {
+                (*task)(executor, index);
+            } catch (...) {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (!error) error = std::current_exception();
+                failed.store(true, std::memory_order_relaxed);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            running_workers--;
+        }
+        done_cv.notify_one();
+    }
+}
+
+// Take the first task of the own range
+template<class E>
+bool ExecutorPool<E>::PopTask(std::size_t worker, std::size_t &index) {
+    auto &range = ranges[worker];
+    std::lock_guard<std::mutex> guard(range.mutex);
+    if (range.begin == range.end) return false;
+
+    index = range.begin++;
+    return true;
+}
+
+/**
+ * Postcondition:
+ *  - If another worker has remaining tasks, the latter half of them is moved to the own range,
+ *    and the first one of the moved tasks is returned with index.
+ *  - Only one range is locked at a time. The own range is empty here, so nobody steals from it meanwhile.
+ */
+template<class E>
+bool ExecutorPool<E>::StealTask(std::size_t worker, std::size_t &index) {
+    const std::size_t worker_count = executors.size();
+    for (std::size_t offset = 1; offset < worker_count; offset++) {
+        auto &victim = ranges[(worker + offset) % worker_count];
+
+        std::size_t begin, end;
+        {
+            std::lock_guard<std::mutex> guard(victim.mutex);
+            const std::size_t remaining = victim.end - victim.begin;
+            if (remaining == 0) continue;
+
+            end = victim.end;
+            begin = end - (remaining + 1) / 2;
+            victim.end = begin;
+        }
+
+        index = begin;
+        auto &range = ranges[worker];
+        std::lock_guard<std::mutex> guard(range.mutex);
+        range.begin = begin + 1;
+        range.end = end;
+        return true;
+    }
+    return false;
+}
+
+} // namespace fuzzuf::executor
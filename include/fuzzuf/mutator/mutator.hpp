@@ -17,8 +17,10 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <random>
+#include <vector>
 
 #include "fuzzuf/algorithms/afl/afl_option.hpp"
 #include "fuzzuf/utils/common.hpp"
@@ -26,6 +28,7 @@
 #include "fuzzuf/exec_input/exec_input.hpp"
 #include "fuzzuf/algorithms/afl/afl_dict_data.hpp"
 #include "fuzzuf/algorithms/afl/afl_util.hpp"
+#include "fuzzuf/rand/rand.hpp"
 
 // Responsibility:
 //  - An instance generates fuzzes an arbitrary number of times according to the specified algorithm
@@ -35,21 +38,40 @@
 //  - The lifetime of an instance is from an instance generation with a given seed to the end of the last fuzz generation
 //  - A fuzz is temporarily saved to a member variable `outbuf`, and given to variables depending on it through `GetBuf()` method
 
+// Make buf hold at least n bytes, keeping its contents.
+// The buffers of Mutator grow geometrically and never shrink, so that mutations extending them
+// (e.g. clones and insertions in Havoc) stop touching the allocator once the buffers have grown enough.
+inline void ReserveMutationBuffer(std::vector<u8> &buf, std::size_t n) {
+    if (buf.size() >= n) return;
+    buf.reserve(std::max(n, buf.capacity() * 2));
+    buf.resize(buf.capacity());
+}
+
 template<class Tag>
 class Mutator {
 protected:
     // NOTE: The lifetime of Mutator must be shorter than ExecInput as it holds const reference
     const ExecInput &input;
 
+    // The RNG of the component using this Mutator(e.g. AFLState::mutator_rng).
+    // It is held by reference, so that the Mutators created one after another continue one stream.
+    fuzzuf::rand::XSAdd &rng;
+
+    // Only the first len (resp. temp_len, spl_len) bytes of each buffer are meaningful.
+    // The buffers may be larger than that (see ReserveMutationBuffer).
     u32 len;
-    u8 *outbuf;
-    u8 *tmpbuf;
+    std::vector<u8> outbuf;
+    std::vector<u8> tmpbuf;
     u32 temp_len;
-    u8 *splbuf;
+    std::vector<u8> splbuf;
     u32 spl_len;
 
-    std::mt19937 mt_engine; // TODO: Enabling Dependency Injection for an easiness of tests
-    int rand_fd;
+    // Shift [pos, len) of outbuf by n bytes to make a gap of n bytes at pos.
+    // The gap is left uninitialized.
+    void OpenGap(u32 pos, u32 n);
+
+    // A random integer in [0, limit)
+    u32 UR(u32 limit) { return fuzzuf::rand::UniformBelow(rng, limit); }
 
 public:
     static const std::vector<s8>  interesting_8;
@@ -64,10 +86,10 @@ public:
     // ムーブコンストラクタ
     Mutator(Mutator&&);
 
-    Mutator( const ExecInput& );
+    Mutator( const ExecInput&, fuzzuf::rand::XSAdd& );
     virtual ~Mutator();
 
-    u8 *GetBuf() { return outbuf; }
+    u8 *GetBuf() { return outbuf.data(); }
     u32 GetLen() { return len; }
     virtual u32 ChooseBlockLen(u32);
     u32 OverwriteWithSet(u32 pos, const std::vector<char> &char_set);
@@ -75,6 +97,7 @@ public:
     u32 FlipByte(u32, int);
     
     void Replace(int pos, const u8 *buf, u32 len);
+    // buf must not point to outbuf, which may be reallocated.
     void Insert(u32 pos, const u8 *buf, u32 extra_len);
     void Delete(u32 pos, u32 n);
 
@@ -91,7 +114,7 @@ public:
      * @tparam CaseDistrib the type of the probability distribution of selecting mutation operators.
      * It should be `u32(const std::vector<AFLDictData>&, const std::vector<AFLDictData>&)` .
      * @tparam CustomCases the type of the function that represents custom cases in havoc.
-     * It should be `void(u32, u8*&, u32&, const std::vector<AFLDictData>&, const std::vector<AFLDictData>&)`.
+     * It should be `void(u32, std::vector<u8>&, u32&, const std::vector<AFLDictData>&, const std::vector<AFLDictData>&)`.
      * @param stacking the number of times mutation operators are applied.
      * @param extras the vector of extras (constant strings) that works as a dictionary.
      * @param a_extras the vector of auto extras (automatically generated constant strings).
@@ -110,6 +133,8 @@ public:
      * CustomCases is a callable object used to execute your own cases instead of preset cases.
      * It should receive as its arguments a number representing which case should be executed, 
      * the references of outbuf and len, extras and a_extras.
+     * Only the first len bytes of outbuf are meaningful. To extend the input,
+     * grow outbuf with ReserveMutationBuffer rather than resizing it to len.
      * Note that, in order to select custom cases in Havoc, 
      * CaseDistrib should return numbers more than or equal to HavocCase::NUM_CASE.
      * For example, if CaseDistrib returns HavocCase::NUM_CASE+1, 
@@ -144,7 +169,7 @@ T Mutator<Tag>::ReadMem(u32 pos) {
 
     // To avoid unaligned memory access, we use memcpy
     T ret;
-    std::memcpy(&ret, outbuf + pos, sizeof(T));
+    std::memcpy(&ret, outbuf.data() + pos, sizeof(T));
     return ret;
 }
 
@@ -158,7 +183,7 @@ u32 Mutator<Tag>::Overwrite(u32 pos, T chr) {
     }
 
     // To avoid unaligned memory access, we use memcpy
-    std::memcpy(outbuf + pos, &chr, sizeof(T));
+    std::memcpy(outbuf.data() + pos, &chr, sizeof(T));
     return 1;
 }
 
@@ -240,18 +265,8 @@ void Mutator<Tag>::Havoc(
     using afl::option::GetHavocBlkXl;
     using afl::option::GetMaxFile;
 
-    // FIXME: all the operations can be rewritten with vector<u8>
-
-    if (temp_len < len) {
-        delete[] tmpbuf;
-        tmpbuf = nullptr;
-    }
-
-    if (!tmpbuf) {
-        tmpbuf = new u8[len];
-    }
-
-    std::memcpy(tmpbuf, outbuf, len);
+    ReserveMutationBuffer(tmpbuf, len);
+    std::memcpy(tmpbuf.data(), outbuf.data(), len);
     temp_len = len;
 
     // swap outbuf and tmpbuf to use mutation function on tmpbuf
@@ -260,11 +275,6 @@ void Mutator<Tag>::Havoc(
     std::swap(outbuf, tmpbuf);
     std::swap(len, temp_len);
 
-    // just an alias of afl::util::UR
-    auto UR = [this](u32 limit) {
-        return afl::util::UR(limit, rand_fd);
-    };
-
     for (std::size_t i = 0; i < stacking; i++) {
         u32 r = case_distrib(extras, a_extras);
         switch (r) {
@@ -444,7 +454,7 @@ void Mutator<Tag>::Havoc(
             u32 del_len = ChooseBlockLen(len - 1);
             u32 del_from = UR(len - del_len + 1);
 
-            std::memmove(outbuf + del_from, outbuf + del_from + del_len,
+            std::memmove(outbuf.data() + del_from, outbuf.data() + del_from + del_len,
                      len - del_from - del_len);
             len -= del_len;
 
@@ -459,20 +469,14 @@ void Mutator<Tag>::Havoc(
                 u32 clone_from = UR(len - clone_len + 1);
                 u32 clone_to   = UR(len);
 
-                u8* new_buf = new u8[len + clone_len];
-
-                /* Head */
-                std::memcpy(new_buf, outbuf, clone_to);
+                OpenGap(clone_to, clone_len);
 
                 /* Inserted part */
-                std::memcpy(new_buf + clone_to, outbuf + clone_from, clone_len);
-
-                /* Tail */
-                std::memcpy(new_buf + clone_to + clone_len, outbuf + clone_to,
-                    len - clone_to);
-                delete[] outbuf;
-                outbuf = new_buf;
-                len += clone_len;
+                // The part of the source after clone_to has been shifted by the gap
+                u32 unshifted = clone_from < clone_to ? std::min(clone_len, clone_to - clone_from) : 0;
+                std::memcpy(outbuf.data() + clone_to, outbuf.data() + clone_from, unshifted);
+                std::memcpy(outbuf.data() + clone_to + unshifted,
+                    outbuf.data() + clone_from + unshifted + clone_len, clone_len - unshifted);
             }
             break;
 
@@ -483,22 +487,13 @@ void Mutator<Tag>::Havoc(
                 u32 clone_len = ChooseBlockLen(GetHavocBlkXl<Tag>());
                 u32 clone_to   = UR(len);
 
-                u8* new_buf = new u8[len + clone_len];
+                // FIXME: why not unroll UR(2) also and create a new case?
+                u8 fill = UR(2) ? UR(256) : outbuf[UR(len)];
 
-                /* Head */
-                std::memcpy(new_buf, outbuf, clone_to);
+                OpenGap(clone_to, clone_len);
 
                 /* Inserted part */
-                // FIXME: why not unroll UR(2) also and create a new case?
-                std::memset(new_buf + clone_to,
-                            UR(2) ? UR(256) : outbuf[UR(len)], clone_len);
-
-                /* Tail */
-                std::memcpy(new_buf + clone_to + clone_len, outbuf + clone_to,
-                    len - clone_to);
-                delete[] outbuf;
-                outbuf = new_buf;
-                len += clone_len;
+                std::memset(outbuf.data() + clone_to, fill, clone_len);
             }
             break;
 
@@ -512,7 +507,7 @@ void Mutator<Tag>::Havoc(
             u32 copy_to   = UR(len - copy_len + 1);
 
             if (likely(copy_from != copy_to))
-                std::memmove(outbuf + copy_to, outbuf + copy_from, copy_len);
+                std::memmove(outbuf.data() + copy_to, outbuf.data() + copy_from, copy_len);
 
             break;
         }
@@ -526,7 +521,7 @@ void Mutator<Tag>::Havoc(
             u32 copy_to   = UR(len - copy_len + 1);
 
             // FIXME: why not unroll "UR(2)" also and create a new case?
-            std::memset(outbuf + copy_to,
+            std::memset(outbuf.data() + copy_to,
                         UR(2) ? UR(256) : outbuf[UR(len)], copy_len);
             break;
         }
@@ -552,7 +547,7 @@ void Mutator<Tag>::Havoc(
             if (extra_len > len) break;
 
             u32 insert_at = UR(len - extra_len + 1);
-            std::memcpy(outbuf + insert_at, &extra.data[0], extra_len);
+            std::memcpy(outbuf.data() + insert_at, &extra.data[0], extra_len);
 
             break;
         }
@@ -577,21 +572,7 @@ void Mutator<Tag>::Havoc(
             u32 extra_len = extra.data.size();
             if (len + extra_len >= GetMaxFile<Tag>()) break;
 
-            u8* new_buf = new u8[len + extra_len];
-
-            /* Head */
-            std::memcpy(new_buf, outbuf, insert_at);
-
-            /* Inserted part */
-            std::memcpy(new_buf + insert_at, &extra.data[0], extra_len);
-
-            /* Tail */
-            std::memcpy(new_buf + insert_at + extra_len, outbuf + insert_at,
-                   len - insert_at);
-
-            delete[] outbuf;
-            outbuf = new_buf;
-            len += extra_len;
+            Insert(insert_at, &extra.data[0], extra_len);
 
             break;
         }
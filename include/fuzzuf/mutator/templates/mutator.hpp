@@ -83,46 +83,29 @@ const std::vector<s32> Mutator<Tag>::interesting_32 { INTERESTING_8,
   } while (0)
 
 template<class Tag>
-Mutator<Tag>::Mutator( const ExecInput &input ) :
+Mutator<Tag>::Mutator( const ExecInput &input, fuzzuf::rand::XSAdd &rng ) :
         input( input ),
+        rng( rng ),
         len( input.GetLen() ),
-        outbuf( new u8[len] ),
-        tmpbuf( nullptr ),
+        outbuf( input.GetBuf(), input.GetBuf() + len ),
         temp_len( 0 ),
-        splbuf( nullptr ),
-        spl_len( 0 ),
-        rand_fd( Util::OpenFile("/dev/urandom", O_RDONLY | O_CLOEXEC) )
-{
-    std::memcpy(outbuf, input.GetBuf(), len);
-}
+        spl_len( 0 )
+{}
 
 template<class Tag>
-Mutator<Tag>::~Mutator() {
-    if (outbuf) delete[] outbuf;
-    if (tmpbuf) delete[] tmpbuf;
-    if (splbuf) delete[] splbuf;
-    if (rand_fd != -1) {
-      Util::CloseFile(rand_fd);
-      rand_fd = -1;
-    }
-}
+Mutator<Tag>::~Mutator() {}
 
 template<class Tag>
 Mutator<Tag>::Mutator(Mutator&& src):
         input( src.input ),
+        rng( src.rng ),
         len( src.len ),
-        outbuf( src.outbuf ),
-        tmpbuf( src.tmpbuf ),
+        outbuf( std::move(src.outbuf) ),
+        tmpbuf( std::move(src.tmpbuf) ),
         temp_len( src.temp_len),
-        splbuf( src.splbuf ),
-        spl_len( src.spl_len ),
-        rand_fd( src.rand_fd )
-{
-    src.outbuf = nullptr;
-    src.tmpbuf = nullptr;
-    src.splbuf = nullptr;
-    src.rand_fd = -1;
-}
+        splbuf( std::move(src.splbuf) ),
+        spl_len( src.spl_len )
+{}
 
 template<class Tag>
 const ExecInput& Mutator<Tag>::GetSource() {
@@ -139,11 +122,6 @@ u32 Mutator<Tag>::ChooseBlockLen(u32 limit) {
     u32 min_value, max_value;
     u32 rlim = 3ULL; 
 
-    // just an alias of afl::util::UR
-    auto UR = [this](u32 limit) {
-        return afl::util::UR(limit, rand_fd);
-    };
-
     switch (UR(rlim)) {
     case 0:  min_value = 1;
              max_value = afl::option::GetHavocBlkSmall<Tag>();
@@ -173,15 +151,7 @@ u32 Mutator<Tag>::ChooseBlockLen(u32 limit) {
 
 template<class Tag>
 u32 Mutator<Tag>::OverwriteWithSet(u32 pos, const std::vector<char> &char_set) {
-  std::vector<char> out;
-  std::sample(
-      char_set.begin(),
-      char_set.end(),
-      std::back_inserter(out),
-      1,
-      mt_engine
-  );
-  outbuf[pos] = out[0];
+  outbuf[pos] = char_set[UR(char_set.size())];
   return 1;
 }
 
@@ -191,7 +161,7 @@ u32 Mutator<Tag>::FlipBit(u32 pos, int n) {
 
     for (int i = 0; i < n; i++) { // Suspected buffer overrun when pos + n - 1 > sizeof(outbuf)?
         u32 flip = pos + i;
-        FLIP_BIT(outbuf, flip);
+        FLIP_BIT(outbuf.data(), flip);
     }
 
     return 1;
@@ -218,31 +188,25 @@ u32 Mutator<Tag>::FlipByte(u32 pos, int n) {
 
 template<class Tag>
 void Mutator<Tag>::Replace(int pos, const u8 *buf, u32 len) {
-    std::memcpy(outbuf+pos, buf, len);
+    std::memcpy(outbuf.data() + pos, buf, len);
 }
 
 template<class Tag>
-void Mutator<Tag>::Insert(u32 pos, const u8 *buf, u32 extra_len) {
-    u8* new_buf = new u8[len + extra_len];
-
-    /* Head */
-    std::memcpy(new_buf, outbuf, pos);
-
-    /* Inserted part */
-    std::memcpy(new_buf + pos, buf, extra_len);
-
-    /* Tail */
-    std::memcpy(new_buf + pos + extra_len, outbuf + pos,
-                len - pos);
+void Mutator<Tag>::OpenGap(u32 pos, u32 n) {
+    ReserveMutationBuffer(outbuf, len + n);
+    std::memmove(outbuf.data() + pos + n, outbuf.data() + pos, len - pos);
+    len += n;
+}
 
-    delete[] outbuf;
-    outbuf   = new_buf;
-    len += extra_len;
+template<class Tag>
+void Mutator<Tag>::Insert(u32 pos, const u8 *buf, u32 extra_len) {
+    OpenGap(pos, extra_len);
+    std::memcpy(outbuf.data() + pos, buf, extra_len);
 }
 
 template<class Tag>
 void Mutator<Tag>::Delete(u32 pos, u32 n) {
-    std::memmove(outbuf + pos, outbuf + pos + n,
+    std::memmove(outbuf.data() + pos, outbuf.data() + pos + n,
                 len - pos - n);
     len -= n;
 }
@@ -258,28 +222,20 @@ void Mutator<Tag>::RestoreHavoc(void) {
 template<class Tag>
 bool Mutator<Tag>::Splice(const ExecInput& target) {
     auto cmp_len = std::min(len, target.GetLen());
-    auto [f_diff, l_diff] = Util::LocateDiffs(outbuf, target.GetBuf(), cmp_len);
+    auto [f_diff, l_diff] = Util::LocateDiffs(outbuf.data(), target.GetBuf(), cmp_len);
 
     if (f_diff < 0 || l_diff < 2 || f_diff == l_diff) return false;
 
     /* Split somewhere between the first and last differing byte. */
 
-    using fuzzuf::algorithm::afl::util::UR;
-    u32 split_at = f_diff + UR(l_diff - f_diff, rand_fd);
+    u32 split_at = f_diff + UR(l_diff - f_diff);
 
     /* Do the thing. */
 
-    if (!splbuf) {
-        splbuf = new u8[target.GetLen()];
-    } else if (spl_len < target.GetLen()) {
-        // We reallocate a buffer only when its size is not enough
-        delete[] splbuf;
-        splbuf = new u8[target.GetLen()];
-    }
-
     spl_len = target.GetLen();
-    std::memcpy(splbuf, outbuf, split_at);
-    std::memcpy(splbuf+split_at, target.GetBuf()+split_at, spl_len - split_at);
+    ReserveMutationBuffer(splbuf, spl_len);
+    std::memcpy(splbuf.data(), outbuf.data(), split_at);
+    std::memcpy(splbuf.data() + split_at, target.GetBuf() + split_at, spl_len - split_at);
 
     std::swap(outbuf, splbuf);
     std::swap(len, spl_len);
@@ -0,0 +1,109 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file rand.hpp
+ * @brief The random number generators all the components of fuzzuf share
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#ifndef FUZZUF_INCLUDE_RAND_RAND_HPP
+#define FUZZUF_INCLUDE_RAND_RAND_HPP
+#include "fuzzuf/rand/xsadd.hpp"
+#include <cstdint>
+#include <limits>
+#include <string_view>
+namespace fuzzuf::rand {
+
+/**
+ * @fn
+ * @brief Fix the seed from which all the RNGs created after this call are
+ * derived, to make a run reproducible. Without this call, the global seed is
+ * taken from std::random_device.
+ * @note The thread local RNGs(see GetThreadLocalXSAdd) are also restarted
+ * from the new seed on their next use.
+ */
+void SetGlobalSeed(std::uint64_t seed);
+
+/**
+ * @fn
+ * @brief The seed given to SetGlobalSeed, or chosen at random if it hasn't
+ * been called yet
+ */
+std::uint64_t GetGlobalSeed();
+
+/**
+ * @fn
+ * @brief Create the RNG of a component of a worker. The stream is derived
+ * only from the global seed, worker and component, so a run with a fixed
+ * seed reproduces the streams of each worker regardless of the order in which
+ * the workers and components are created.
+ * @param (worker) The index of the worker, e.g. AFLState::worker_id. 0 for
+ * the fuzzers running alone.
+ * @param (component) The name of the component owning the RNG, e.g.
+ * "afl.state". The components of one worker must have distinct names.
+ */
+XSAdd CreateXSAdd(std::uint64_t worker, std::string_view component);
+
+/**
+ * @fn
+ * @brief Create an RNG seeded directly with seed, regardless of the global
+ * seed. Mostly for tests and debugging.
+ */
+XSAdd CreateXSAdd(std::uint64_t seed);
+
+/**
+ * @fn
+ * @brief The RNG of the calling thread, for the code which doesn't hold its
+ * own RNG(e.g. the overloads of utils::random without an RNG argument). The
+ * threads never share a state nor take a lock.
+ * @note The stream of a thread depends on the order in which the threads
+ * first draw from their RNGs, so it is not reproducible when several
+ * threads use it. The fuzzers must hold their own RNGs created by
+ * CreateXSAdd(worker, component) instead.
+ */
+XSAdd &GetThreadLocalXSAdd();
+
+/**
+ * @fn
+ * @brief Get a random integer in [0, bound) without modulo bias, using
+ * Lemire's nearly divisionless method. Unlike `rng() % bound`, a division is
+ * needed only in the rare case that the first draw falls into the biased
+ * range.
+ * @param (rng) An RNG returning 32 bit integers uniformly, like XSAdd
+ * @param (bound) The upper bound. Must not be 0.
+ */
+template <class Rng>
+std::uint32_t UniformBelow(Rng &rng, std::uint32_t bound) {
+  static_assert(Rng::min() == 0 &&
+                    Rng::max() == std::numeric_limits<std::uint32_t>::max(),
+                "Rng must return 32 bit integers");
+
+  std::uint64_t m = std::uint64_t(rng()) * bound;
+  auto low = static_cast<std::uint32_t>(m);
+  if (low < bound) {
+    // 2^32 mod bound
+    const std::uint32_t threshold = -bound % bound;
+    while (low < threshold) {
+      m = std::uint64_t(rng()) * bound;
+      low = static_cast<std::uint32_t>(m);
+    }
+  }
+  return static_cast<std::uint32_t>(m >> 32);
+}
+
+} // namespace fuzzuf::rand
+#endif
@@ -0,0 +1,154 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file xsadd.hpp
+ * @brief XORSHIFT-ADD random number engine
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#ifndef FUZZUF_INCLUDE_RAND_XSADD_HPP
+#define FUZZUF_INCLUDE_RAND_XSADD_HPP
+#include <array>
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+namespace fuzzuf::rand {
+
+/**
+ * @class XSAdd
+ * @brief XORSHIFT-ADD (XSadd) by Mutsuo Saito and Makoto Matsumoto
+ *
+ * A 128 bit state generator which returns 32 bit integers uniformly. It is
+ * fast, passes BigCrush except a few tests of the reversed outputs, and
+ * satisfies RandomNumberEngine, so it can be given to std distributions.
+ * See http://www.math.sci.hiroshima-u.ac.jp/m-mat/MT/XSADD/index.html
+ *
+ * The state is initialized in the same way as xsadd_init of the reference
+ * implementation, so the sequence for a 32 bit seed matches it.
+ */
+class XSAdd {
+public:
+  using result_type = std::uint32_t;
+
+  static constexpr result_type default_seed = 5489u;
+
+  XSAdd() : XSAdd(default_seed) {}
+  explicit XSAdd(result_type value) { seed(value); }
+  template <class SeedSeq,
+            class = decltype(std::declval<SeedSeq &>().generate(
+                std::declval<std::uint32_t *>(),
+                std::declval<std::uint32_t *>()))>
+  explicit XSAdd(SeedSeq &seq) {
+    seed(seq);
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  void seed(result_type value = default_seed) {
+    state = {value, 0, 0, 0};
+    for (std::uint32_t i = 1; i < 8; i++) {
+      const auto prev = state[(i - 1) & 3];
+      state[i & 3] ^= i + UINT32_C(1812433253) * (prev ^ (prev >> 30));
+    }
+    CertifyPeriod();
+    discard(8);
+  }
+
+  template <class SeedSeq>
+  auto seed(SeedSeq &seq) -> decltype(seq.generate(
+      std::declval<std::uint32_t *>(), std::declval<std::uint32_t *>())) {
+    seq.generate(state.begin(), state.end());
+    CertifyPeriod();
+    discard(8);
+  }
+
+  /**
+   * Initialize all the 128 bits of the state directly. Used to start
+   * independent streams(see CreateXSAdd).
+   */
+  void SetState(const std::array<std::uint32_t, 4> &new_state) {
+    state = new_state;
+    CertifyPeriod();
+  }
+
+  result_type operator()() {
+    std::uint32_t t = state[0];
+    t ^= t << 15;
+    t ^= t >> 18;
+    t ^= state[3] << 11;
+    state[0] = state[1];
+    state[1] = state[2];
+    state[2] = state[3];
+    state[3] = t;
+    return state[3] + state[2];
+  }
+
+  void discard(unsigned long long n) {
+    for (; n; n--) (*this)();
+  }
+
+  friend bool operator==(const XSAdd &lhs, const XSAdd &rhs) {
+    return lhs.state == rhs.state;
+  }
+  friend bool operator!=(const XSAdd &lhs, const XSAdd &rhs) {
+    return !(lhs == rhs);
+  }
+
+  template <class CharT, class Traits>
+  friend std::basic_ostream<CharT, Traits> &
+  operator<<(std::basic_ostream<CharT, Traits> &os, const XSAdd &rng) {
+    const auto fill = os.fill();
+    const auto flags = os.flags();
+    os.flags(std::ios_base::dec | std::ios_base::left);
+    os.fill(os.widen(' '));
+    os << rng.state[0] << os.widen(' ') << rng.state[1] << os.widen(' ')
+       << rng.state[2] << os.widen(' ') << rng.state[3];
+    os.fill(fill);
+    os.flags(flags);
+    return os;
+  }
+
+  template <class CharT, class Traits>
+  friend std::basic_istream<CharT, Traits> &
+  operator>>(std::basic_istream<CharT, Traits> &is, XSAdd &rng) {
+    const auto flags = is.flags();
+    is.flags(std::ios_base::dec | std::ios_base::skipws);
+    std::array<std::uint32_t, 4> new_state;
+    if (is >> new_state[0] >> new_state[1] >> new_state[2] >> new_state[3]) {
+      rng.state = new_state;
+    }
+    is.flags(flags);
+    return is;
+  }
+
+private:
+  // The all zero state is the only one which never leaves itself
+  void CertifyPeriod() {
+    if (state[0] == 0 && state[1] == 0 && state[2] == 0 && state[3] == 0) {
+      state = {'X', 'S', 'A', 'D'};
+    }
+  }
+
+  std::array<std::uint32_t, 4> state;
+};
+
+} // namespace fuzzuf::rand
+#endif
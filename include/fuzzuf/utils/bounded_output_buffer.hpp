@@ -0,0 +1,103 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file bounded_output_buffer.hpp
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#ifndef FUZZUF_INCLUDE_UTILS_BOUNDED_OUTPUT_BUFFER_HPP
+#define FUZZUF_INCLUDE_UTILS_BOUNDED_OUTPUT_BUFFER_HPP
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+namespace fuzzuf::utils {
+
+/**
+ * @class BoundedOutputBuffer
+ * @brief A fixed size buffer keeping the first bytes a child process writes
+ * to a pipe, and discarding the rest
+ *
+ * The buffer is allocated once with the capacity, and never grows. The owner
+ * calls ReadFrom() with the read end of the pipe whenever it is readable.
+ * Until the buffer is full, the bytes are read directly into it. After that,
+ * they are moved from the pipe to /dev/null with splice(2), so they are
+ * neither copied to this process nor kept anywhere, and are only counted.
+ *
+ * Since the pipe is always drained, the writer never sees its writes fail or
+ * block because of the limit, and the memory used is bounded by the capacity
+ * and the pipe buffer of the kernel, however much it writes.
+ *
+ * The kept bytes are read in place through GetData(), without copying.
+ */
+class BoundedOutputBuffer {
+public:
+  /**
+   * @param capacity The maximum number of bytes kept
+   */
+  explicit BoundedOutputBuffer(std::size_t capacity);
+  ~BoundedOutputBuffer();
+
+  BoundedOutputBuffer(const BoundedOutputBuffer &) = delete;
+  BoundedOutputBuffer(BoundedOutputBuffer &&) = delete;
+  BoundedOutputBuffer &operator=(const BoundedOutputBuffer &) = delete;
+  BoundedOutputBuffer &operator=(BoundedOutputBuffer &&) = delete;
+
+  std::size_t GetCapacity() const { return capacity; }
+
+  /**
+   * Discard the bytes read so far
+   */
+  void Rewind();
+
+  /**
+   * Read a chunk from fd, which has to be the read end of a non-blocking
+   * pipe. Returns false if the pipe has no more data for now, or is closed.
+   */
+  bool ReadFrom(int fd);
+
+  /**
+   * The number of bytes kept since the last Rewind(), i.e. at most the
+   * capacity
+   */
+  std::size_t GetSize() const { return size; }
+
+  /**
+   * The number of bytes read since the last Rewind(), including the
+   * discarded ones
+   */
+  std::uint64_t GetWrittenSize() const { return written_size; }
+
+  const std::uint8_t *GetData() const { return data.get(); }
+  std::uint8_t *GetData() { return data.get(); }
+
+  /**
+   * True if the writers went beyond the capacity. The bytes written after
+   * that are discarded.
+   */
+  bool IsTruncated() const { return written_size > capacity; }
+
+private:
+  std::size_t capacity;
+  std::unique_ptr<std::uint8_t[]> data;
+  std::size_t size = 0;
+  std::uint64_t written_size = 0;
+  // /dev/null, where the bytes beyond the capacity are spliced to
+  int null_fd = -1;
+};
+
+} // namespace fuzzuf::utils
+#endif
@@ -0,0 +1,111 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file dirty_regions.hpp
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#ifndef FUZZUF_INCLUDE_UTILS_DIRTY_REGIONS_HPP
+#define FUZZUF_INCLUDE_UTILS_DIRTY_REGIONS_HPP
+#include <cstdint>
+#include <vector>
+namespace fuzzuf::utils {
+
+/**
+ * @class DirtyRegions
+ * @brief Remembers which cache lines of a coverage map may hold non-zero bytes,
+ * so that the map can be zeroed without writing to the whole of it
+ *
+ * The record is valid only for the current contents of the map. Whoever reads
+ * the map after an execution (e.g. the classification pass of AFL) starts a
+ * record with StartRecording() and marks every region where it saw a non-zero
+ * byte. Clear() then zeroes only those regions. If nobody has recorded the
+ * regions since the last Clear(), or the record has been invalidated because
+ * the map was modified in an untracked way, Clear() zeroes the whole map.
+ *
+ * A disabled instance always zeroes the whole map.
+ */
+class DirtyRegions {
+public:
+  // One cache line
+  static constexpr std::uint32_t REGION_SIZE = 64;
+
+  explicit DirtyRegions(std::uint32_t mem_size);
+
+  void Enable();
+  bool IsEnabled() const { return enabled; }
+
+  /**
+   * Change the size of the map, e.g. when the map turns out to be used only
+   * partially. The next Clear() zeroes the whole of the new size.
+   */
+  void Resize(std::uint32_t new_mem_size);
+
+  /**
+   * Start a new record of the regions which may be non-zero. Does nothing
+   * if disabled.
+   */
+  void StartRecording();
+
+  /**
+   * Mark the region containing mem[offset] as dirty. Offsets are expected to
+   * come in ascending order, as they do in a scan over the map, but anything
+   * else only costs some redundant clears.
+   */
+  void MarkOffset(std::uint32_t offset) {
+    if (!valid)
+      return;
+
+    const std::uint32_t region = offset / REGION_SIZE;
+    if (!regions.empty() && regions.back() == region)
+      return;
+
+    // Past this point, a single memset over the whole map is faster
+    if (regions.size() >= max_regions) {
+      valid = false;
+      return;
+    }
+    regions.push_back(region);
+  }
+
+  /**
+   * Mark the regions containing mem[offsets[i]] for every i. This is for
+   * the consumers which keep a list of non-zero indices instead of scanning.
+   */
+  void MarkOffsets(const std::vector<std::uint32_t> &offsets);
+
+  /**
+   * The map has been modified in a way the record doesn't cover. The next
+   * Clear() zeroes the whole map.
+   */
+  void Invalidate() { valid = false; }
+
+  /**
+   * Zero mem, which has mem_size bytes, and forget the record.
+   */
+  void Clear(std::uint8_t *mem);
+
+private:
+  std::uint32_t mem_size;
+  std::uint32_t max_regions;
+  bool enabled = false;
+  bool valid = false;
+  std::vector<std::uint32_t> regions;
+};
+
+} // namespace fuzzuf::utils
+#endif
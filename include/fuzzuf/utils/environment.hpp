@@ -0,0 +1,78 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file environment.hpp
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#ifndef FUZZUF_INCLUDE_UTILS_ENVIRONMENT_HPP
+#define FUZZUF_INCLUDE_UTILS_ENVIRONMENT_HPP
+#include <string>
+#include <vector>
+namespace fuzzuf::utils {
+
+/**
+ * @class Environment
+ * @brief A set of environment variables owned by one object, to be passed to
+ * execve(2) instead of the environment of this process
+ *
+ * Each executor configures the variables its PUT reads (e.g. the ids of the
+ * shared memories) here, so that executors in one process never overwrite
+ * each other's variables, and setenv(3) is never called while other threads
+ * may read the environment.
+ *
+ * GetEnvp() neither allocates nor modifies anything, so that it can be called
+ * between fork(2) and execve(2).
+ */
+class Environment {
+public:
+  /**
+   * Start with a copy of the environment of this process
+   */
+  Environment();
+
+  /**
+   * The value of the variable, or nullptr if it is not set
+   */
+  const char *Get(const std::string &name) const;
+
+  /**
+   * Set the variable. If overwrite is false and the variable is already set,
+   * it is left as is, same as setenv(3).
+   */
+  void Set(const std::string &name, const std::string &value,
+           bool overwrite = true);
+
+  void Unset(const std::string &name);
+
+  /**
+   * The null-terminated array of "NAME=value" strings. It is valid until the
+   * next call to Set() or Unset().
+   */
+  char *const *GetEnvp() const { return envp.data(); }
+
+private:
+  std::vector<std::string>::iterator Find(const std::string &name);
+  std::vector<std::string>::const_iterator Find(const std::string &name) const;
+  void UpdateEnvp();
+
+  std::vector<std::string> variables;
+  std::vector<char *> envp;
+};
+
+} // namespace fuzzuf::utils
+#endif
@@ -0,0 +1,88 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file huge_page.hpp
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#ifndef FUZZUF_INCLUDE_UTILS_HUGE_PAGE_HPP
+#define FUZZUF_INCLUDE_UTILS_HUGE_PAGE_HPP
+#include <cstddef>
+#include <new>
+#include <vector>
+namespace fuzzuf::utils {
+
+/**
+ * The size of the default huge page of the system, which is the
+ * "Hugepagesize" in /proc/meminfo. 0 if the system doesn't support huge pages.
+ */
+std::size_t GetHugePageSize();
+
+/**
+ * Round up len to a multiple of the size of the pages AllocateHugePageBackedMemory uses for it.
+ */
+std::size_t GetHugePageBackedMemorySize(std::size_t len);
+
+/**
+ * Allocate anonymous, zero filled memory of len bytes. The memory is page
+ * aligned. If len is not less than the size of the huge page, the memory is
+ * also aligned to the huge page and marked with MADV_HUGEPAGE, so that
+ * transparent huge pages back it if the system allows.
+ * Returns nullptr on failure.
+ */
+void *AllocateHugePageBackedMemory(std::size_t len);
+
+/**
+ * Free the memory allocated by AllocateHugePageBackedMemory(len).
+ */
+void FreeHugePageBackedMemory(void *addr, std::size_t len);
+
+/**
+ * @class HugePageAllocator
+ * @brief An allocator for the large arrays scanned in every execution (e.g.
+ * the virgin maps), whose TLB misses are reduced by huge pages.
+ */
+template <class T> struct HugePageAllocator {
+  using value_type = T;
+
+  HugePageAllocator() noexcept = default;
+  template <class U>
+  HugePageAllocator(const HugePageAllocator<U> &) noexcept {}
+
+  T *allocate(std::size_t n) {
+    void *addr = AllocateHugePageBackedMemory(n * sizeof(T));
+    if (!addr) throw std::bad_alloc();
+    return static_cast<T *>(addr);
+  }
+  void deallocate(T *addr, std::size_t n) noexcept {
+    FreeHugePageBackedMemory(addr, n * sizeof(T));
+  }
+};
+
+template <class T, class U>
+bool operator==(const HugePageAllocator<T> &, const HugePageAllocator<U> &) {
+  return true;
+}
+template <class T, class U>
+bool operator!=(const HugePageAllocator<T> &, const HugePageAllocator<U> &) {
+  return false;
+}
+
+template <class T> using HugePageVector = std::vector<T, HugePageAllocator<T>>;
+
+} // namespace fuzzuf::utils
+#endif
@@ -0,0 +1,43 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file numa.hpp
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#ifndef FUZZUF_INCLUDE_UTILS_NUMA_HPP
+#define FUZZUF_INCLUDE_UTILS_NUMA_HPP
+#include <cstddef>
+namespace fuzzuf::utils {
+
+/**
+ * The NUMA node the CPU core belongs to, which is read from
+ * /sys/devices/system/cpu/cpu<cpuid>. -1 if it is unknown(e.g. the kernel is
+ * built without NUMA support).
+ */
+int GetNumaNodeOfCpu(int cpuid);
+
+/**
+ * Let the pages in [addr, addr + len) be allocated on the NUMA node, and
+ * migrate the pages already allocated on the other nodes. addr must be page
+ * aligned. This doesn't require libnuma, since mbind(2) is called directly.
+ * Returns false if the kernel refused it. The memory is usable anyway.
+ */
+bool PreferNumaNode(void *addr, std::size_t len, int node);
+
+} // namespace fuzzuf::utils
+#endif
@@ -32,6 +32,7 @@
 #include <stdexcept>
 #include <type_traits>
 #include <utility>
+#include "fuzzuf/rand/rand.hpp"
 
 
 namespace fuzzuf::utils::random {
@@ -46,22 +47,30 @@ using uniform_distribution = typename std::conditional<
   >::type
 >::type;
 
-namespace {
-std::random_device rd;
-std::default_random_engine eng(rd());
+/**
+ * @fn
+ * @brief Get a random value in [lower, upper]
+ * @param (rng) RNG to draw from
+ * @param (lower) Lower bound
+ * @param (upper) Upper bound
+ * @return Random value
+ */
+template <class T, class Rng>
+T Random(Rng& rng, T lower, T upper) {
+  uniform_distribution<T> dist(lower, upper);
+  return dist(rng);
 }
 
 /**
  * @fn
- * @brief Get a random value in [lower, upper]
+ * @brief Get a random value in [lower, upper] from the RNG of the calling thread
  * @param (lower) Lower bound
  * @param (upper) Upper bound
  * @return Random value
  */
 template <class T>
 T Random(T lower, T upper) {
-  uniform_distribution<T> dist(lower, upper);
-  return dist(eng);
+  return Random<T>(rand::GetThreadLocalXSAdd(), lower, upper);
 }
 
 /**
@@ -180,18 +189,29 @@ public:
   /**
    * @fn
    * @brief Randomly choose an index
+   * @param (rng) RNG to draw from
    * @return Array index chosen by weighted random
    */
-  size_t operator() () const {
-    size_t i = Random<size_t>(0, _index.size() - 1);
+  template <class Rng>
+  size_t operator() (Rng& rng) const {
+    size_t i = Random<size_t>(rng, 0, _index.size() - 1);
 
-    if (_threshold[i] > Random<double>(0.0, 1.0)) {
+    if (_threshold[i] > Random<double>(rng, 0.0, 1.0)) {
       return i;
     } else {
       return _index[i];
     }
   }
 
+  /**
+   * @fn
+   * @brief Randomly choose an index with the RNG of the calling thread
+   * @return Array index chosen by weighted random
+   */
+  size_t operator() () const {
+    return (*this)(rand::GetThreadLocalXSAdd());
+  }
+
 private:
   std::vector<size_t> _index;
   std::vector<double> _threshold;
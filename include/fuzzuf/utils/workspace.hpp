@@ -17,4 +17,7 @@
  */
 #pragma once
 
+#include <string>
+
 void SetupDirs(std::string out_dir);
+std::string SetupDirsForInPlaceResume(std::string out_dir);
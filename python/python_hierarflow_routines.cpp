@@ -130,7 +130,7 @@ NullableRef<HierarFlowCallee<void(u32)>> PyHavoc::operator()(u32 stacking) {
     using algorithm::afl::util::AFLHavocCaseDistrib;
     using algorithm::afl::dictionary::AFLDictData;
     mutator.Havoc(1 << stacking, {}, {}, AFLHavocCaseDistrib, 
-                  [](u32, u8*&, u32&, const std::vector<AFLDictData>&, const std::vector<AFLDictData>&){} );
+                  [](u32, std::vector<u8>&, u32&, const std::vector<AFLDictData>&, const std::vector<AFLDictData>&){} );
     CallSuccessors(mutator.GetBuf(), mutator.GetLen());
     return GoToParent();
 }
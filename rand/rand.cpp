@@ -0,0 +1,99 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file rand.cpp
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#include "fuzzuf/rand/rand.hpp"
+#include <atomic>
+#include <random>
+
+namespace fuzzuf::rand {
+
+namespace {
+
+// The step of SplitMix64, which turns consecutive integers into
+// well distributed 64 bit values
+std::uint64_t SplitMix64(std::uint64_t &x) {
+  std::uint64_t z = (x += UINT64_C(0x9e3779b97f4a7c15));
+  z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return z ^ (z >> 31);
+}
+
+std::uint64_t RandomSeed() {
+  std::random_device rd;
+  return (std::uint64_t(rd()) << 32) | rd();
+}
+
+// FNV-1a, to turn the name of a component into a part of the seed
+std::uint64_t HashComponent(std::string_view component) {
+  std::uint64_t h = UINT64_C(0xcbf29ce484222325);
+  for (unsigned char c : component) {
+    h = (h ^ c) * UINT64_C(0x100000001b3);
+  }
+  return h;
+}
+
+std::atomic<std::uint64_t> global_seed(RandomSeed());
+// The number of thread local RNGs created since the last SetGlobalSeed
+std::atomic<std::uint64_t> thread_count(0);
+// Incremented by SetGlobalSeed to tell the thread local RNGs to restart
+std::atomic<std::uint64_t> generation(0);
+
+} // namespace
+
+void SetGlobalSeed(std::uint64_t seed) {
+  global_seed.store(seed);
+  thread_count.store(0);
+  generation.fetch_add(1);
+}
+
+std::uint64_t GetGlobalSeed() { return global_seed.load(); }
+
+XSAdd CreateXSAdd(std::uint64_t worker, std::string_view component) {
+  std::uint64_t x = global_seed.load() ^ HashComponent(component);
+  x = SplitMix64(x) ^ worker;
+  return CreateXSAdd(SplitMix64(x));
+}
+
+XSAdd CreateXSAdd(std::uint64_t seed) {
+  const auto first = SplitMix64(seed);
+  const auto second = SplitMix64(seed);
+  XSAdd rng;
+  rng.SetState({static_cast<std::uint32_t>(first),
+                static_cast<std::uint32_t>(first >> 32),
+                static_cast<std::uint32_t>(second),
+                static_cast<std::uint32_t>(second >> 32)});
+  return rng;
+}
+
+XSAdd &GetThreadLocalXSAdd() {
+  thread_local std::uint64_t local_generation = generation.load();
+  thread_local XSAdd rng =
+      CreateXSAdd(thread_count.fetch_add(1), "thread_local");
+
+  const auto current = generation.load(std::memory_order_relaxed);
+  if (local_generation != current) {
+    local_generation = current;
+    rng = CreateXSAdd(thread_count.fetch_add(1), "thread_local");
+  }
+  return rng;
+}
+
+} // namespace fuzzuf::rand
@@ -0,0 +1,230 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE algorithms.afl.bitmap
+#define BOOST_TEST_DYN_LINK
+#include <random>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "fuzzuf/algorithms/afl/afl_bitmap.hpp"
+#include "fuzzuf/algorithms/afl/afl_util.hpp"
+
+using fuzzuf::algorithm::afl::util::BitmapKernel;
+using fuzzuf::algorithm::afl::util::ClassifyCountsAndCheckNewBits;
+using fuzzuf::algorithm::afl::util::IsBitmapKernelSupported;
+
+namespace {
+
+// The result HasNewBits would return, computed one byte at a time
+u8 ExpectedNewBits(const std::vector<u8>& trace, const std::vector<u8>& virgin) {
+  u8 ret = 0;
+  for (std::size_t i = 0; i < trace.size(); i++) {
+    if (trace[i] && virgin[i] == 0xff) return 2;
+    if (trace[i] & virgin[i]) ret = 1;
+  }
+  return ret;
+}
+
+std::vector<u8> RandomMap(std::mt19937& rng, u32 map_size, double density) {
+  std::bernoulli_distribution hit(density);
+  std::uniform_int_distribution<int> count(1, 255);
+  std::vector<u8> map(map_size, 0);
+  for (auto& b : map) {
+    if (hit(rng)) b = count(rng);
+  }
+  return map;
+}
+
+} // namespace
+
+// Every kernel must produce the same trace and the same result as ClassifyCounts + HasNewBits
+BOOST_AUTO_TEST_CASE(FusedKernelsMatchClassifyCounts) {
+  std::mt19937 rng(0);
+
+  for (auto kernel : { BitmapKernel::Scalar, BitmapKernel::AVX2, BitmapKernel::AVX512 }) {
+    if (!IsBitmapKernelSupported(kernel)) continue;
+
+    // The kernels get the usual sizes as compile-time constants, and the others at runtime.
+    // The odd size checks the tail which does not fill a whole vector
+    for (u32 map_size : { 1u << 16, 1u << 18, 1u << 12, (1u << 16) + 37 }) {
+      for (double density : { 0.0, 0.001, 0.05, 1.0 }) {
+        auto trace = RandomMap(rng, map_size, density);
+
+        // Some of the tuples are known, with various hit counts
+        std::vector<u8> virgin(map_size, 255);
+        auto known = RandomMap(rng, map_size, 0.5);
+        fuzzuf::algorithm::afl::util::ClassifyCounts<u64>((u64*)known.data(), map_size & ~7u);
+        for (u32 i = 0; i < map_size; i++) virgin[i] &= ~known[i];
+
+        auto expected_trace = trace;
+        fuzzuf::algorithm::afl::util::ClassifyCounts<u64>((u64*)expected_trace.data(), map_size & ~7u);
+        // ClassifyCounts only works on whole words
+        for (u32 i = map_size & ~7u; i < map_size; i++) {
+          expected_trace[i] = fuzzuf::algorithm::afl::util::InitCountClasses().lookup8[expected_trace[i]];
+        }
+
+        u8 ret = ClassifyCountsAndCheckNewBits(trace.data(), virgin.data(), map_size, kernel);
+        BOOST_CHECK(trace == expected_trace);
+        BOOST_CHECK_EQUAL(ret, ExpectedNewBits(expected_trace, virgin));
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FusedKernelsReportNewBits) {
+  constexpr u32 map_size = 1 << 16;
+
+  for (auto kernel : { BitmapKernel::Scalar, BitmapKernel::AVX2, BitmapKernel::AVX512 }) {
+    if (!IsBitmapKernelSupported(kernel)) continue;
+
+    std::vector<u8> virgin(map_size, 255);
+    std::vector<u8> trace(map_size, 0);
+
+    BOOST_CHECK_EQUAL(ClassifyCountsAndCheckNewBits(trace.data(), virgin.data(), map_size, kernel), 0);
+
+    // A tuple never seen before
+    trace[1000] = 3;
+    BOOST_CHECK_EQUAL(ClassifyCountsAndCheckNewBits(trace.data(), virgin.data(), map_size, kernel), 2);
+    BOOST_CHECK_EQUAL(trace[1000], 4);
+
+    // The virgin map is left untouched
+    BOOST_CHECK_EQUAL(virgin[1000], 255);
+
+    // Only the hit count changed
+    virgin[1000] = (u8)~4;
+    trace[1000] = 1;
+    BOOST_CHECK_EQUAL(ClassifyCountsAndCheckNewBits(trace.data(), virgin.data(), map_size, kernel), 1);
+
+    // Nothing new
+    virgin[1000] = (u8)~5;
+    trace[1000] = 1;
+    BOOST_CHECK_EQUAL(ClassifyCountsAndCheckNewBits(trace.data(), virgin.data(), map_size, kernel), 0);
+  }
+}
+
+// Every kernel must return the same result and leave the same virgin map as the scalar one
+BOOST_AUTO_TEST_CASE(HasNewBitsKernelsMatchScalar) {
+  using fuzzuf::algorithm::afl::util::HasNewBits;
+
+  std::mt19937 rng(0);
+
+  for (auto kernel : { BitmapKernel::AVX2, BitmapKernel::AVX512 }) {
+    if (!IsBitmapKernelSupported(kernel)) continue;
+
+    for (u32 map_size : { 1u << 16, 1u << 18, 1u << 12, (1u << 16) + 37 }) {
+      for (double density : { 0.0, 0.001, 0.05, 1.0 }) {
+        std::vector<u8> virgin(map_size, 255);
+        auto known = RandomMap(rng, map_size, 0.5);
+        for (u32 i = 0; i < map_size; i++) virgin[i] &= ~known[i];
+        auto expected_virgin = virgin;
+
+        auto trace = RandomMap(rng, map_size, density);
+        u8 expected = HasNewBits(trace.data(), expected_virgin.data(), map_size, BitmapKernel::Scalar);
+        BOOST_CHECK_EQUAL(expected, ExpectedNewBits(trace, virgin));
+
+        BOOST_CHECK_EQUAL(HasNewBits(trace.data(), virgin.data(), map_size, kernel), expected);
+        BOOST_CHECK(virgin == expected_virgin);
+
+        // The map has been updated
+        BOOST_CHECK_EQUAL(HasNewBits(trace.data(), virgin.data(), map_size, kernel), 0);
+      }
+    }
+  }
+}
+
+// Without contention, the atomic flavor of every kernel must behave as the plain one
+BOOST_AUTO_TEST_CASE(HasNewBitsAtomicKernelsMatchScalar) {
+  using fuzzuf::algorithm::afl::util::HasNewBits;
+  using fuzzuf::algorithm::afl::util::HasNewBitsAtomic;
+
+  std::mt19937 rng(0);
+
+  for (auto kernel : { BitmapKernel::Scalar, BitmapKernel::AVX2, BitmapKernel::AVX512 }) {
+    if (!IsBitmapKernelSupported(kernel)) continue;
+
+    for (u32 map_size : { 1u << 16, 1u << 18, 1u << 12, (1u << 16) + 37 }) {
+      for (double density : { 0.0, 0.001, 0.05, 1.0 }) {
+        std::vector<u8> virgin(map_size, 255);
+        auto known = RandomMap(rng, map_size, 0.5);
+        for (u32 i = 0; i < map_size; i++) virgin[i] &= ~known[i];
+        auto expected_virgin = virgin;
+
+        auto trace = RandomMap(rng, map_size, density);
+        u8 expected = HasNewBits(trace.data(), expected_virgin.data(), map_size, BitmapKernel::Scalar);
+
+        BOOST_CHECK_EQUAL(HasNewBitsAtomic(trace.data(), virgin.data(), map_size, kernel), expected);
+        BOOST_CHECK(virgin == expected_virgin);
+
+        // The map has been updated
+        BOOST_CHECK_EQUAL(HasNewBitsAtomic(trace.data(), virgin.data(), map_size, kernel), 0);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(HasNewBitsKernelsReportNewBits) {
+  using fuzzuf::algorithm::afl::util::HasNewBits;
+
+  constexpr u32 map_size = 1 << 16;
+
+  for (auto kernel : { BitmapKernel::Scalar, BitmapKernel::AVX2, BitmapKernel::AVX512 }) {
+    if (!IsBitmapKernelSupported(kernel)) continue;
+
+    std::vector<u8> virgin(map_size, 255);
+    std::vector<u8> trace(map_size, 0);
+
+    BOOST_CHECK_EQUAL(HasNewBits(trace.data(), virgin.data(), map_size, kernel), 0);
+
+    // A tuple never seen before, at the last byte of the map
+    trace[map_size - 1] = 1;
+    BOOST_CHECK_EQUAL(HasNewBits(trace.data(), virgin.data(), map_size, kernel), 2);
+    BOOST_CHECK_EQUAL(virgin[map_size - 1], 0xfe);
+    BOOST_CHECK_EQUAL(HasNewBits(trace.data(), virgin.data(), map_size, kernel), 0);
+
+    // Only the hit count changed
+    trace[map_size - 1] = 2;
+    BOOST_CHECK_EQUAL(HasNewBits(trace.data(), virgin.data(), map_size, kernel), 1);
+    BOOST_CHECK_EQUAL(virgin[map_size - 1], 0xfc);
+
+    // A new tuple wins over a new hit count found earlier in the map
+    trace[0] = 4;
+    virgin[0] = (u8)~1;
+    trace[100] = 1;
+    BOOST_CHECK_EQUAL(HasNewBits(trace.data(), virgin.data(), map_size, kernel), 2);
+  }
+}
+
+// The fused kernels tell which cache lines have to be reset before the next run
+BOOST_AUTO_TEST_CASE(FusedKernelsRecordDirtyRegions) {
+  constexpr u32 map_size = (1 << 16) + 37;
+
+  for (auto kernel : { BitmapKernel::Scalar, BitmapKernel::AVX2, BitmapKernel::AVX512 }) {
+    if (!IsBitmapKernelSupported(kernel)) continue;
+
+    fuzzuf::utils::DirtyRegions dirty(map_size);
+    dirty.Enable();
+
+    std::vector<u8> virgin(map_size, 255);
+    std::vector<u8> trace(map_size, 0);
+    for (u32 i : { 0u, 63u, 64u, 4096u, 30001u, map_size - 1 }) trace[i] = 1;
+
+    ClassifyCountsAndCheckNewBits(trace.data(), virgin.data(), map_size, kernel, &dirty);
+    dirty.Clear(trace.data());
+
+    BOOST_CHECK(trace == std::vector<u8>(map_size, 0));
+  }
+}
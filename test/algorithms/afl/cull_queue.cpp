@@ -0,0 +1,190 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE algorithms.afl.cull_queue
+#define BOOST_TEST_DYN_LINK
+#include <memory>
+#include <optional>
+#include <random>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "fuzzuf/algorithms/afl/afl_other_hierarflow_routines.hpp"
+#include "fuzzuf/algorithms/afl/afl_util.hpp"
+#include "fuzzuf/hierarflow/hierarflow_node.hpp"
+#include "fuzzuf/hierarflow/hierarflow_intermediates.hpp"
+
+namespace {
+
+constexpr u32 map_size = 256;
+
+struct TestTestcase {
+  bool favored = false;
+  bool fs_redundant = false;
+  bool fuzzed = false;
+  u32 favored_slots = 0;
+  std::shared_ptr<const std::vector<u64>> trace_mini;
+
+  bool WasFuzzed() const { return fuzzed; }
+};
+
+struct TestSetting {
+  bool dumb_mode = false;
+};
+
+// Has only the members of AFLStateTemplate that CullQueueTemplate uses
+struct TestState {
+  using OwnTestcase = TestTestcase;
+
+  std::shared_ptr<TestSetting> setting = std::make_shared<TestSetting>();
+  bool score_changed = false;
+
+  u32 queued_favored = 0;
+  u32 pending_favored = 0;
+
+  std::vector<std::shared_ptr<TestTestcase>> case_queue;
+  std::vector<NullableRef<TestTestcase>> top_rated =
+      std::vector<NullableRef<TestTestcase>>(map_size);
+
+  std::vector<u32> cull_pending_slots;
+  std::vector<u8> cull_pending = std::vector<u8>(map_size, 0);
+  std::vector<u32> cull_cover_count = std::vector<u32>(map_size, 0);
+  std::vector<NullableRef<TestTestcase>> cull_favored =
+      std::vector<NullableRef<TestTestcase>>(map_size);
+  std::vector<std::shared_ptr<const std::vector<u64>>> cull_favored_mini =
+      std::vector<std::shared_ptr<const std::vector<u64>>>(map_size);
+  std::size_t culled_queue_size = 0;
+
+  void MarkAsRedundant(TestTestcase &testcase, bool val) {
+    testcase.fs_redundant = val;
+  }
+
+  void MarkTopRatedDirty(u32 i) {
+    if (cull_pending[i]) return;
+    cull_pending[i] = 1;
+    cull_pending_slots.emplace_back(i);
+  }
+
+  // Let testcase win slot i, as UpdateBitmapScoreWithRawTrace does
+  void SetTopRated(u32 i, TestTestcase &testcase) {
+    top_rated[i] = std::ref(testcase);
+    MarkTopRatedDirty(i);
+    score_changed = true;
+  }
+};
+
+bool Covers(const std::vector<u64> &mini, u32 i) {
+  return (mini[i >> 6] >> (i & 63)) & 1;
+}
+
+// cull_queue() of the original AFL
+std::vector<bool> FullCull(const TestState &state) {
+  std::vector<bool> has_top_rated(map_size, false);
+  std::vector<bool> favored(state.case_queue.size(), false);
+
+  for (u32 i = 0; i < map_size; i++) {
+    if (state.top_rated[i] && !has_top_rated[i]) {
+      auto &top = state.top_rated[i].value().get();
+      for (u32 j = 0; j < map_size; j++) {
+        if (Covers(*top.trace_mini, j)) has_top_rated[j] = true;
+      }
+
+      for (std::size_t k = 0; k < state.case_queue.size(); k++) {
+        if (state.case_queue[k].get() == &top) favored[k] = true;
+      }
+    }
+  }
+
+  return favored;
+}
+
+} // namespace
+
+// Replace top_rated at random and check that every incremental culling agrees
+// with the full culling. Some entries also win slots their trace_mini doesn't
+// cover, so that an entry can be favored at several slots at once.
+BOOST_AUTO_TEST_CASE(IncrementalCullMatchesFullCull) {
+  using fuzzuf::algorithm::afl::routine::other::CullQueueTemplate;
+  using fuzzuf::algorithm::afl::util::MinimizeBits;
+
+  std::mt19937 rng(1);
+  TestState state;
+
+  auto cull_loop = fuzzuf::hierarflow::CreateDummyParent<void(void)>();
+  auto cull_queue =
+      fuzzuf::hierarflow::CreateNode<CullQueueTemplate<TestState>>(state);
+  cull_loop << cull_queue;
+
+  for (int round = 0; round < 200; round++) {
+    // Queue a few testcases, each of which hits some slots and wins some of them
+    for (int n = rng() % 4; n > 0; n--) {
+      auto testcase = std::make_shared<TestTestcase>();
+
+      std::vector<u8> trace(map_size, 0);
+      for (int hits = 1 + rng() % 24; hits > 0; hits--) trace[rng() % map_size] = 1;
+      testcase->trace_mini = std::make_shared<const std::vector<u64>>(
+          MinimizeBits(trace.data(), map_size));
+
+      for (u32 i = 0; i < map_size; i++) {
+        if (trace[i] && (!state.top_rated[i] || rng() % 3 == 0)) {
+          state.SetTopRated(i, *testcase);
+        }
+      }
+
+      state.case_queue.emplace_back(testcase);
+    }
+
+    // Let an entry win a few slots regardless of its trace_mini
+    if (!state.case_queue.empty() && rng() % 2) {
+      auto &testcase = *state.case_queue[rng() % state.case_queue.size()];
+      for (int n = 1 + rng() % 3; n > 0; n--) {
+        state.SetTopRated(rng() % map_size, testcase);
+      }
+    }
+
+    // Fuzz one of them from time to time, as AbandonEntry does
+    if (!state.case_queue.empty() && rng() % 2) {
+      auto &testcase = *state.case_queue[rng() % state.case_queue.size()];
+      if (!testcase.fuzzed) {
+        testcase.fuzzed = true;
+        if (testcase.favored) state.pending_favored--;
+      }
+    }
+
+    cull_loop();
+
+    auto expected = FullCull(state);
+    u32 expected_favored = 0;
+    u32 expected_pending = 0;
+    for (std::size_t k = 0; k < state.case_queue.size(); k++) {
+      auto &testcase = *state.case_queue[k];
+      BOOST_CHECK_EQUAL(testcase.favored, expected[k]);
+      // Like AFL, entries queued without winning any slot wait for the next
+      // culling to be marked
+      if (k < state.culled_queue_size) {
+        BOOST_CHECK_EQUAL(testcase.fs_redundant, !expected[k]);
+      }
+
+      if (expected[k]) {
+        expected_favored++;
+        if (!testcase.fuzzed) expected_pending++;
+      }
+    }
+    BOOST_CHECK_EQUAL(state.queued_favored, expected_favored);
+    BOOST_CHECK_EQUAL(state.pending_favored, expected_pending);
+    BOOST_CHECK(state.cull_pending_slots.empty());
+  }
+}
@@ -29,7 +29,7 @@
 
 // to test both fork server mode and non fork server mode, we specify forksrv
 // via an argument
-static void AFLLoop(bool forksrv) {
+static void AFLLoop(bool forksrv, u32 havoc_batch_size = 1, bool use_mopt = false) {
   // cd $(dirname $0)
   MoveToProgramLocation();
 
@@ -79,6 +79,8 @@ static void AFLLoop(bool forksrv) {
 
   // Create AFLState
   auto state = std::make_unique<AFLState>(setting, executor);
+  state->havoc_batch_size = havoc_batch_size;
+  if (use_mopt) state->mopt = std::make_unique<MOptScheduler>();
 
   AFLFuzzer fuzzer(std::move(state));
 
@@ -100,3 +102,15 @@ BOOST_AUTO_TEST_CASE(AFLLoopForkMode) {
   AFLLoop(true);
   std::cout << "[*] AFLLoopForkMode ended\n";
 }
+
+BOOST_AUTO_TEST_CASE(AFLLoopBatchedHavoc) {
+  std::cout << "[*] AFLLoopBatchedHavoc started\n";
+  AFLLoop(true, 16);
+  std::cout << "[*] AFLLoopBatchedHavoc ended\n";
+}
+
+BOOST_AUTO_TEST_CASE(AFLLoopMOpt) {
+  std::cout << "[*] AFLLoopMOpt started\n";
+  AFLLoop(true, 1, true);
+  std::cout << "[*] AFLLoopMOpt ended\n";
+}
@@ -0,0 +1,128 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE algorithms.afl.mopt_scheduler
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+#include "fuzzuf/algorithms/afl/afl_mopt_scheduler.hpp"
+#include "fuzzuf/mutator/havoc_case.hpp"
+#include "fuzzuf/rand/rand.hpp"
+
+using fuzzuf::algorithm::afl::MOptScheduler;
+
+static void CheckProbabilities(const MOptScheduler &mopt) {
+  for (u32 swarm = 0; swarm < MOptScheduler::NUM_SWARMS; swarm++) {
+    double sum = 0.0;
+    for (u32 op = 0; op < MOptScheduler::NUM_OPERATORS; op++) {
+      BOOST_CHECK_GT(mopt.GetProbability(swarm, op), 0.0);
+      sum += mopt.GetProbability(swarm, op);
+    }
+    BOOST_CHECK_CLOSE(sum, 1.0, 1e-6);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MOptSelectCase) {
+  fuzzuf::rand::SetGlobalSeed(0);
+  MOptScheduler mopt;
+
+  CheckProbabilities(mopt);
+  BOOST_CHECK(mopt.IsPilot());
+  BOOST_CHECK_EQUAL(mopt.GetCurrentSwarm(), 0);
+
+  mopt.BeginStage(0);
+
+  constexpr u32 trials = 10000;
+  for (u32 i = 0; i < trials; i++) {
+    u32 c = mopt.SelectCase();
+    BOOST_CHECK_LT(c, NUM_CASE);
+
+    // MOpt doesn't use the dictionaries
+    BOOST_CHECK(c != INSERT_EXTRA && c != INSERT_AEXTRA);
+    BOOST_CHECK(c != OVERWRITE_WITH_EXTRA && c != OVERWRITE_WITH_AEXTRA);
+  }
+
+  u64 total_hits = 0;
+  for (u32 op = 0; op < MOptScheduler::NUM_OPERATORS; op++) {
+    total_hits += mopt.GetHits(0, op);
+  }
+  BOOST_CHECK_EQUAL(total_hits, trials);
+}
+
+// Only the operators applied to the child which found something get the credit
+BOOST_AUTO_TEST_CASE(MOptCountFinds) {
+  fuzzuf::rand::SetGlobalSeed(0);
+  MOptScheduler mopt;
+
+  mopt.BeginStage(100);
+
+  mopt.SelectCase();
+  mopt.UpdateAfterExec(100);
+
+  std::array<u64, MOptScheduler::NUM_OPERATORS> hits_before {};
+  for (u32 op = 0; op < MOptScheduler::NUM_OPERATORS; op++) {
+    hits_before[op] = mopt.GetHits(0, op);
+    BOOST_CHECK_EQUAL(mopt.GetFinds(0, op), 0);
+  }
+
+  mopt.SelectCase();
+  mopt.SelectCase();
+  mopt.UpdateAfterExec(103);
+
+  u64 credited = 0;
+  for (u32 op = 0; op < MOptScheduler::NUM_OPERATORS; op++) {
+    bool applied = mopt.GetHits(0, op) > hits_before[op];
+    BOOST_CHECK_EQUAL(mopt.GetFinds(0, op), applied ? 3 : 0);
+    credited += mopt.GetFinds(0, op);
+  }
+  BOOST_CHECK_GE(credited, 3);
+  BOOST_CHECK_LE(credited, 6);
+}
+
+// Each swarm is tried in the pilot module, then the one that found the most
+// is used in the core module, and then the swarms move
+BOOST_AUTO_TEST_CASE(MOptModules) {
+  fuzzuf::rand::SetGlobalSeed(0);
+  MOptScheduler mopt;
+
+  constexpr u32 fittest = 3;
+
+  u64 total_finds = 0;
+  mopt.BeginStage(total_finds);
+
+  for (u32 swarm = 0; swarm < MOptScheduler::NUM_SWARMS; swarm++) {
+    BOOST_CHECK(mopt.IsPilot());
+    BOOST_CHECK_EQUAL(mopt.GetCurrentSwarm(), swarm);
+
+    for (u64 i = 0; i < MOptScheduler::PILOT_PERIOD; i++) {
+      mopt.SelectCase();
+      if (swarm == fittest && i % 100 == 0) total_finds++;
+      mopt.UpdateAfterExec(total_finds);
+    }
+  }
+
+  BOOST_CHECK(!mopt.IsPilot());
+  BOOST_CHECK_EQUAL(mopt.GetCurrentSwarm(), fittest);
+
+  for (u64 i = 0; i < MOptScheduler::CORE_PERIOD; i++) {
+    mopt.SelectCase();
+    mopt.UpdateAfterExec(total_finds);
+  }
+
+  BOOST_CHECK(mopt.IsPilot());
+  BOOST_CHECK_EQUAL(mopt.GetCurrentSwarm(), 0);
+  CheckProbabilities(mopt);
+}
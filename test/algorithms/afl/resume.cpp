@@ -0,0 +1,130 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE afl.resume
+#define BOOST_TEST_DYN_LINK
+#include <fstream>
+#include <boost/scope_exit.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "fuzzuf/algorithms/afl/afl_fuzzer.hpp"
+#include "fuzzuf/utils/filesystem.hpp"
+#include "fuzzuf/utils/workspace.hpp"
+#include "move_to_program_location.hpp"
+
+using namespace fuzzuf::algorithm::afl;
+using option::AFLTag;
+
+static std::unique_ptr<AFLState> CreateState(const fs::path& in_dir, const fs::path& out_dir) {
+  std::shared_ptr<AFLSetting> setting(new AFLSetting(
+      {"../../put_binaries/libjpeg/libjpeg_turbo_fuzzer", "@@"},
+      in_dir.native(), out_dir.native(), option::GetExecTimeout<AFLTag>(),
+      option::GetMemLimit<AFLTag>(), true, false, /* dumb_mode*/
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND));
+
+  auto executor = std::make_shared<NativeLinuxExecutor>(
+      setting->argv, setting->exec_timelimit_ms, setting->exec_memlimit,
+      setting->forksrv, setting->out_dir / option::GetDefaultOutfile<AFLTag>(),
+      option::GetMapSize<AFLTag>(), // afl_shm_size
+      0,                            //  bb_shm_size
+      setting->cpuid_to_bind);
+
+  return std::make_unique<AFLState>(setting, executor);
+}
+
+static void WriteCurPath(const fs::path& out_dir, u32 cur_path) {
+  std::ofstream(out_dir / "fuzzer_stats")
+    << "start_time        : 0\n"
+    << "cur_path          : " << cur_path << "\n"
+    << "paths_total       : 2\n";
+}
+
+// An in-place resume must get back the coverage, the queue position and the
+// queue of the previous session, and must not calibrate the entries again
+BOOST_AUTO_TEST_CASE(InPlaceResumeRestoresPreviousSession) {
+  // cd $(dirname $0)
+  MoveToProgramLocation();
+
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  const auto raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_REQUIRE(raw_dirname != nullptr);
+
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) {
+    fs::remove_all(root_dir);
+  }
+  BOOST_SCOPE_EXIT_END
+
+  auto input_dir = fs::path("../../put_binaries/libjpeg/seeds");
+  auto output_dir = root_dir / "output";
+
+  // The previous session: only the dry run of the seeds
+  std::vector<u8> prev_bits;
+  {
+    SetupDirs(output_dir.string());
+    auto state = CreateState(input_dir, output_dir);
+    auto& st = *state;
+    AFLFuzzer fuzzer(std::move(state));
+    prev_bits.assign(st.virgin_bits.begin(), st.virgin_bits.end());
+  }
+
+  // Mark a tuple nobody hits as already seen, so that we can tell the bitmap
+  // has been loaded rather than rebuilt by the dry run
+  auto marker = std::find(prev_bits.rbegin(), prev_bits.rend(), 0xff);
+  BOOST_REQUIRE(marker != prev_bits.rend());
+  *marker = 0;
+  auto marker_idx = std::distance(marker, prev_bits.rend()) - 1;
+
+  std::ofstream(output_dir / "fuzz_bitmap", std::ios::binary)
+    .write(reinterpret_cast<const char*>(prev_bits.data()), prev_bits.size());
+
+  // Add a second entry, and pretend the previous session stopped at it
+  auto first = fs::directory_iterator(output_dir / "queue");
+  while (first->path().filename().string().rfind("id:000000", 0) != 0) ++first;
+  fs::copy_file(first->path(), output_dir / "queue/id:000001,src:000000,op:havoc,rep:2,+cov");
+  WriteCurPath(output_dir, 1);
+
+  // The resumed session
+  auto resume_dir = SetupDirsForInPlaceResume(output_dir.string());
+  auto state = CreateState(resume_dir, output_dir);
+  state->in_place_resume = true;
+  auto& st = *state;
+  AFLFuzzer fuzzer(std::move(state));
+
+  BOOST_CHECK(st.resuming_fuzz);
+  BOOST_CHECK_EQUAL(st.queued_paths, 2);
+  BOOST_CHECK_EQUAL(st.queued_with_cov, 1);
+  BOOST_CHECK(!fs::exists(resume_dir));
+
+  // fuzz_bitmap has been loaded into virgin_bits
+  BOOST_CHECK_EQUAL(st.virgin_bits[marker_idx], 0);
+
+  // quick_cal: every entry has been run exactly once, and later entries will
+  // be calibrated as usual
+  BOOST_CHECK_EQUAL(st.total_execs, st.queued_paths);
+  BOOST_CHECK(!st.quick_cal);
+
+  // The queue position comes from cur_path of fuzzer_stats
+  BOOST_CHECK_EQUAL(st.seek_to, 1);
+
+  // A position beyond the queue is ignored, and so is a missing fuzzer_stats
+  WriteCurPath(output_dir, 100);
+  BOOST_CHECK_EQUAL(st.FindStartPosition(), 0);
+
+  fs::remove(output_dir / "fuzzer_stats");
+  BOOST_CHECK_EQUAL(st.FindStartPosition(), 0);
+}
@@ -0,0 +1,153 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE algorithms.afl.shared_state
+#define BOOST_TEST_DYN_LINK
+#include <memory>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "fuzzuf/algorithms/afl/afl_bitmap.hpp"
+#include "fuzzuf/algorithms/afl/afl_shared_state.hpp"
+
+using fuzzuf::algorithm::afl::AFLSharedState;
+using fuzzuf::algorithm::afl::util::BitmapKernel;
+using fuzzuf::algorithm::afl::util::HasNewBitsAtomic;
+using fuzzuf::algorithm::afl::util::IsBitmapKernelSupported;
+
+BOOST_AUTO_TEST_CASE(SharedHasNewBits) {
+  constexpr u32 map_size = 1 << 16;
+  AFLSharedState shared(map_size);
+
+  std::vector<u8> trace(map_size, 0);
+  trace[10] = 1;
+
+  // A tuple never seen before
+  BOOST_CHECK_EQUAL(HasNewBitsAtomic(trace.data(), shared.virgin_bits.data(), map_size), 2);
+  BOOST_CHECK_EQUAL(HasNewBitsAtomic(trace.data(), shared.virgin_bits.data(), map_size), 0);
+
+  // Only the hit count changed
+  trace[10] = 2;
+  BOOST_CHECK_EQUAL(HasNewBitsAtomic(trace.data(), shared.virgin_bits.data(), map_size), 1);
+  BOOST_CHECK_EQUAL(HasNewBitsAtomic(trace.data(), shared.virgin_bits.data(), map_size), 0);
+
+  // Virgin maps are independent from each other
+  BOOST_CHECK_EQUAL(HasNewBitsAtomic(trace.data(), shared.virgin_crash.data(), map_size), 2);
+}
+
+// Every tuple must be reported as new by exactly one of the workers
+// even if all of them hit the same tuples at the same time
+BOOST_AUTO_TEST_CASE(SharedHasNewBitsFromMultipleThreads) {
+  constexpr u32 map_size = 1 << 16;
+  constexpr int worker_count = 4;
+
+  for (auto kernel : { BitmapKernel::Scalar, BitmapKernel::AVX2, BitmapKernel::AVX512 }) {
+    if (!IsBitmapKernelSupported(kernel)) continue;
+
+    AFLSharedState shared(map_size);
+    std::vector<std::vector<u8>> results(worker_count, std::vector<u8>(map_size, 0));
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < worker_count; w++) {
+      workers.emplace_back([&shared, &results, kernel, w]() {
+        std::vector<u8> trace(map_size, 0);
+        for (u32 i = 0; i < map_size; i++) {
+          trace[i] = 1;
+          results[w][i] = HasNewBitsAtomic(trace.data(), shared.virgin_bits.data(), map_size, kernel);
+          trace[i] = 0;
+        }
+      });
+    }
+    for (auto& worker : workers) worker.join();
+
+    for (u32 i = 0; i < map_size; i++) {
+      int found = 0;
+      for (int w = 0; w < worker_count; w++) {
+        if (results[w][i] == 2) found++;
+        else BOOST_CHECK_EQUAL(results[w][i], 0);
+      }
+      BOOST_CHECK_EQUAL(found, 1);
+    }
+  }
+}
+
+namespace {
+std::shared_ptr<const AFLSharedState::SharedTestcase> MakeSharedTestcase(
+    u32 worker_id, const std::vector<u8>& buf
+) {
+  auto testcase = std::make_shared<AFLSharedState::SharedTestcase>();
+  testcase->worker_id = worker_id;
+  testcase->buf = buf;
+  return testcase;
+}
+}
+
+BOOST_AUTO_TEST_CASE(SharedQueue) {
+  AFLSharedState shared(1 << 16);
+
+  const std::vector<u8> first = { 'f', 'o', 'o' };
+  const std::vector<u8> second = { 'b', 'a', 'r', '!' };
+
+  std::vector<std::shared_ptr<const AFLSharedState::SharedTestcase>> fetched;
+  BOOST_CHECK(!shared.HasUnfetched(0));
+  BOOST_CHECK_EQUAL(shared.Fetch(0, fetched), 0);
+  BOOST_CHECK(fetched.empty());
+
+  shared.Publish(MakeSharedTestcase(0, first));
+  shared.Publish(MakeSharedTestcase(1, second));
+  BOOST_CHECK(shared.HasUnfetched(0));
+
+  std::size_t pos = shared.Fetch(0, fetched);
+  BOOST_CHECK_EQUAL(pos, 2);
+  BOOST_CHECK(!shared.HasUnfetched(pos));
+  BOOST_REQUIRE_EQUAL(fetched.size(), 2);
+  BOOST_CHECK_EQUAL(fetched[0]->worker_id, 0);
+  BOOST_CHECK(fetched[0]->buf == first);
+  BOOST_CHECK_EQUAL(fetched[1]->worker_id, 1);
+  BOOST_CHECK(fetched[1]->buf == second);
+
+  // Only the testcases published after the last fetch are returned
+  fetched.clear();
+  shared.Publish(MakeSharedTestcase(1, first));
+  BOOST_CHECK(shared.HasUnfetched(pos));
+  BOOST_CHECK_EQUAL(shared.Fetch(pos, fetched), 3);
+  BOOST_REQUIRE_EQUAL(fetched.size(), 1);
+  BOOST_CHECK_EQUAL(fetched[0]->worker_id, 1);
+}
+
+// The trace handed over to the other workers must be restored as it was
+BOOST_AUTO_TEST_CASE(SharedTestcaseTrace) {
+  constexpr u32 map_size = (1 << 16) + 37;
+
+  std::vector<u8> trace(map_size, 0);
+  trace[0] = 1;
+  trace[7] = 4;
+  trace[8] = 128;
+  trace[4097] = 32;
+  trace[map_size - 1] = 2;
+
+  AFLSharedState::SharedTestcase testcase;
+  testcase.SetTrace(trace.data(), map_size);
+  BOOST_CHECK_EQUAL(testcase.trace_offsets.size(), 5);
+
+  std::vector<u8> restored(map_size, 0);
+  testcase.RestoreTrace(restored.data());
+  BOOST_CHECK(restored == trace);
+
+  testcase.EraseTrace(restored.data());
+  BOOST_CHECK(restored == std::vector<u8>(map_size, 0));
+}
@@ -0,0 +1,134 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE algorithms.afl.worker_rng
+#define BOOST_TEST_DYN_LINK
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+#include <boost/scope_exit.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "fuzzuf/algorithms/afl/afl_mopt_scheduler.hpp"
+#include "fuzzuf/algorithms/afl/afl_mutator.hpp"
+#include "fuzzuf/algorithms/afl/afl_state.hpp"
+#include "fuzzuf/exec_input/exec_input_set.hpp"
+#include "fuzzuf/rand/rand.hpp"
+#include "fuzzuf/utils/filesystem.hpp"
+#include "fuzzuf/utils/workspace.hpp"
+#include "move_to_program_location.hpp"
+
+using namespace fuzzuf::algorithm::afl;
+using option::AFLTag;
+
+namespace {
+
+// Create the state of a worker as the CLI does for --jobs
+std::unique_ptr<AFLState> CreateWorkerState(const fs::path& out_dir, u32 worker_id) {
+  SetupDirs(out_dir.string());
+
+  std::shared_ptr<AFLSetting> setting(new AFLSetting(
+      {"../../put_binaries/libjpeg/libjpeg_turbo_fuzzer", "@@"},
+      "../../put_binaries/libjpeg/seeds", out_dir.native(),
+      option::GetExecTimeout<AFLTag>(), option::GetMemLimit<AFLTag>(),
+      /* forksrv */ false, /* dumb_mode */ false,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND));
+
+  auto executor = std::make_shared<NativeLinuxExecutor>(
+      setting->argv, setting->exec_timelimit_ms, setting->exec_memlimit,
+      setting->forksrv, setting->out_dir / option::GetDefaultOutfile<AFLTag>(),
+      option::GetMapSize<AFLTag>(), // afl_shm_size
+      0,                            //  bb_shm_size
+      setting->cpuid_to_bind);
+
+  auto state = std::make_unique<AFLState>(setting, executor);
+  state->SetWorkerId(worker_id);
+  state->mopt = std::make_unique<MOptScheduler>(worker_id);
+  return state;
+}
+
+// What the worker draws from the RNGs of its state, mutator and MOpt
+std::vector<u32> Draw(AFLState& state) {
+  std::vector<u32> v;
+  for (int i = 0; i < 32; i++) v.emplace_back(state.UR(1u << 30));
+
+  std::vector<u8> seed(64, 'A');
+  ExecInputSet input_set;
+  auto input = input_set.CreateOnMemory(seed.data(), seed.size());
+  for (int i = 0; i < 4; i++) {
+    AFLMutator mutator(*input, state);
+    v.emplace_back(mutator.ChooseBlockLen(seed.size()));
+  }
+
+  for (int i = 0; i < 32; i++) v.emplace_back(state.mopt->SelectCase());
+  return v;
+}
+
+} // namespace
+
+// Two runs with the same seed and several workers, like `--seed N --jobs K`.
+// The workers are created in different orders and draw in different threads,
+// but each worker draws the same numbers in both runs.
+BOOST_AUTO_TEST_CASE(JobsRunsReproducePerWorkerStreams) {
+  // cd $(dirname $0)
+  MoveToProgramLocation();
+
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  const auto raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_REQUIRE(raw_dirname != nullptr);
+
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) {
+    fs::remove_all(root_dir);
+  }
+  BOOST_SCOPE_EXIT_END
+
+  constexpr u32 worker_count = 3;
+
+  auto run = [&root_dir](const std::vector<u32>& order) {
+    fuzzuf::rand::SetGlobalSeed(1234);
+
+    std::vector<std::unique_ptr<AFLState>> states(worker_count);
+    for (u32 i : order) {
+      states[i] = CreateWorkerState(root_dir / Util::StrPrintf("worker%u", i), i);
+    }
+
+    std::vector<std::vector<u32>> draws(worker_count);
+    std::vector<std::thread> workers;
+    for (u32 i : order) {
+      workers.emplace_back([&states, &draws, i]() { draws[i] = Draw(*states[i]); });
+    }
+    for (auto& worker : workers) worker.join();
+
+    states.clear();
+    for (u32 i = 0; i < worker_count; i++) {
+      fs::remove_all(root_dir / Util::StrPrintf("worker%u", i));
+    }
+    return draws;
+  };
+
+  auto first = run({0, 1, 2});
+  auto second = run({2, 0, 1});
+
+  for (u32 i = 0; i < worker_count; i++) {
+    BOOST_CHECK(first[i] == second[i]);
+  }
+
+  // The workers don't share a stream
+  BOOST_CHECK_EQUAL(std::set<std::vector<u32>>(first.begin(), first.end()).size(), worker_count);
+}
@@ -101,6 +101,19 @@ BOOST_AUTO_TEST_CASE(ParseGlobalFuzzerOptions_LogFileSpecified) {
     BOOST_CHECK_EQUAL(options.log_file.value().string(), "5rC3kk6PzF5P2sPs.log");
 }
 
+BOOST_AUTO_TEST_CASE(ParseGlobalFuzzerOptions_SeedSpecified) {
+    GlobalFuzzerOptions options;
+    #pragma GCC diagnostic ignored "-Wwrite-strings"
+    const char *argv[] = {"fuzzuf", "fuzzer", "--seed=1234", "--"};
+    GlobalArgs args = {
+        .argc = Argc(argv),
+        .argv = argv,
+    };
+    ParseGlobalOptionsForFuzzer(args, options);
+
+    BOOST_CHECK_EQUAL(options.seed.value(), 1234);
+}
+
 inline void BaseSenario_ParseGlobalFuzzerOptions_WithUnregisteredOption(
     const char test_case_name[], GlobalArgs &args, GlobalFuzzerOptions &options) 
 {
@@ -212,6 +225,51 @@ BOOST_AUTO_TEST_CASE(BuildAFLByParsingGlobalOptionAndFuzzerOptionAndPUT) {
     BOOST_CHECK_EQUAL(state.setting->argv[1], "f996ko6rvPgSajvm");
 }
 
+BOOST_AUTO_TEST_CASE(BuildAFLByParsingSyncOption) {
+    GlobalFuzzerOptions options;
+    #pragma GCC diagnostic ignored "-Wwrite-strings"
+    const char *argv[] = {
+        "fuzzuf",
+        "afl",
+        // Global options
+        "--in_dir=Aeb7ohquie5eiShu", 
+        "--forksrv=false",
+        // Fuzzer options
+        "-M", "main-1:2/3",
+        // PUT options. 
+        // Because NativeLinuxExecutor throws error,
+        // we can't use a random value here.
+        "../put_binaries/command_wrapper", // PUT
+        "Eicoh8aiwoo4ahSh" // arguments
+        };
+    GlobalArgs args = {
+        .argc = Argc(argv),
+        .argv = argv,
+    };
+
+    using AFLState = fuzzuf::algorithm::afl::AFLState;
+
+    // Parse global options and PUT, and build fuzzer
+    auto fuzzer_args = ParseGlobalOptionsForFuzzer(args, options);
+    auto fuzzer = BuildAFLFuzzerFromArgs<AFLFuzzerStub<AFLState>, AFLFuzzerStub<AFLState>>(
+            fuzzer_args, options
+        );
+
+    auto& state = *fuzzer->state;
+
+    // out_dir becomes the sync directory, and this instance uses its subdirectory
+    BOOST_CHECK_EQUAL(state.sync_id, "main-1");
+    BOOST_CHECK_EQUAL(state.sync_dir, options.out_dir);
+    BOOST_CHECK(state.setting->out_dir == fs::path(options.out_dir) / "main-1");
+    BOOST_CHECK(fs::is_directory(state.setting->out_dir / ".synced"));
+
+    // Master instances split deterministic steps, and don't skip them
+    BOOST_CHECK_EQUAL(state.master_id, 2);
+    BOOST_CHECK_EQUAL(state.master_max, 3);
+    BOOST_CHECK(state.force_deterministic);
+    BOOST_CHECK(!state.skip_deterministic);
+}
+
 BOOST_AUTO_TEST_CASE(BuildAFLFastByParsingGlobalOptionAndPUT) {
     using AFLFastState = fuzzuf::algorithm::aflfast::AFLFastState;
     GlobalFuzzerOptions options;
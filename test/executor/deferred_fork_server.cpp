@@ -0,0 +1,74 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+// A PUT emulating the fork server built with afl-clang-fast which calls __AFL_INIT() after its initialization.
+// If __AFL_DEFER_FORKSRV is set, the fork server starts after the initialization and each forked process writes "snapshot".
+// Otherwise, it starts at the entry, and each forked process initializes itself and writes "entry".
+// With the argument "exit-before-init", the PUT exits without starting the deferred fork server.
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+constexpr int FORKSRV_FD_READ  = 198;
+constexpr int FORKSRV_FD_WRITE = 199;
+
+// The mark the executor looks for in the binary, which afl-clang-fast embeds for __AFL_INIT()
+__attribute__((used)) volatile const char *defer_sig = "##SIG_AFL_DEFER_FORKSRV##";
+
+// Runs the fork server, and returns in each forked process
+void StartForkServer() {
+    std::uint32_t status = 0;
+    if (write(FORKSRV_FD_WRITE, &status, 4) != 4) std::exit(1);
+
+    while (true) {
+        std::uint32_t was_killed;
+        if (read(FORKSRV_FD_READ, &was_killed, 4) != 4) std::exit(0);
+
+        pid_t pid = fork();
+        if (pid < 0) std::exit(1);
+
+        if (!pid) {
+            close(FORKSRV_FD_READ);
+            close(FORKSRV_FD_WRITE);
+            return;
+        }
+
+        if (write(FORKSRV_FD_WRITE, &pid, 4) != 4) std::exit(1);
+        int put_status;
+        if (waitpid(pid, &put_status, 0) < 0) std::exit(1);
+        if (write(FORKSRV_FD_WRITE, &put_status, 4) != 4) std::exit(1);
+    }
+}
+}
+
+int main(int argc, char **argv) {
+    const bool deferred = getenv("__AFL_DEFER_FORKSRV") != nullptr;
+
+    if (!deferred) StartForkServer();
+
+    // The initialization which doesn't depend on the input would be here
+    if (deferred && argc > 1 && std::strcmp(argv[1], "exit-before-init") == 0) return 0;
+
+    if (deferred) StartForkServer();
+
+    const char *message = deferred ? "snapshot\n" : "entry\n";
+    if (write(1, message, std::strlen(message)) < 0) return 1;
+    return 0;
+}
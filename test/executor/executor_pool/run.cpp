@@ -0,0 +1,213 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE executor_pool.run
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/scope_exit.hpp>
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fuzzuf/executor/executor_pool.hpp"
+#include "fuzzuf/executor/native_linux_executor.hpp"
+#include "fuzzuf/feedback/put_exit_reason_type.hpp"
+#include "fuzzuf/utils/common.hpp"
+#include "fuzzuf/utils/filesystem.hpp"
+#include "fuzzuf/utils/which.hpp"
+
+using fuzzuf::executor::ExecutorPool;
+
+// Check if ExecutorPool runs every input once on one of the executors,
+// and returns the results in the order of the inputs
+BOOST_AUTO_TEST_CASE(ExecutorPoolMap) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  // Each executor needs its own input file
+  const std::string cat = fuzzuf::utils::which(fs::path("cat")).native();
+  constexpr std::size_t executor_count = 3;
+  std::vector<std::shared_ptr<NativeLinuxExecutor>> executors;
+  for (std::size_t i = 0; i < executor_count; ++i) {
+    executors.emplace_back(std::make_shared<NativeLinuxExecutor>(
+        std::vector<std::string>{cat}, 1000, 10000, false,
+        root_dir / ("cur_input" + std::to_string(i)), PAGE_SIZE, PAGE_SIZE,
+        NativeLinuxExecutor::CPUID_DO_NOT_BIND,
+        true /* record_stdout_and_err */));
+  }
+  ExecutorPool<NativeLinuxExecutor> pool(
+      executors, std::vector<std::optional<int>>(executor_count));
+  BOOST_CHECK_EQUAL(pool.GetExecutorCount(), executor_count);
+
+  std::vector<std::string> inputs;
+  for (int i = 0; i < 100; ++i) {
+    inputs.emplace_back("input" + std::to_string(i));
+  }
+
+  // Run twice to check the workers are reused
+  for (int round = 0; round < 2; ++round) {
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    auto outputs = pool.Map<std::string>(
+        inputs.size(),
+        [&](NativeLinuxExecutor &executor, std::size_t i) {
+          {
+            std::lock_guard<std::mutex> guard(mutex);
+            threads.insert(std::this_thread::get_id());
+          }
+          executor.Run(reinterpret_cast<const u8 *>(inputs[i].c_str()),
+                       inputs[i].size());
+          // Boost.Test isn't thread safe. Check the results after Map.
+          if (executor.GetExitStatusFeedback().exit_reason !=
+              PUTExitReasonType::FAULT_NONE) {
+            return std::string("failed");
+          }
+          auto output = executor.MoveStdOut();
+          return std::string(output.begin(), output.end());
+        });
+
+    BOOST_CHECK(outputs == inputs);
+    BOOST_CHECK(threads.size() <= executor_count);
+    BOOST_CHECK(threads.count(std::this_thread::get_id()) == 0);
+  }
+}
+
+// Check if the exception thrown by a task is rethrown by Dispatch, and the pool
+// is still usable afterwards
+BOOST_AUTO_TEST_CASE(ExecutorPoolException) {
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  const std::string cat = fuzzuf::utils::which(fs::path("cat")).native();
+  std::vector<std::shared_ptr<NativeLinuxExecutor>> executors;
+  for (std::size_t i = 0; i < 2; ++i) {
+    executors.emplace_back(std::make_shared<NativeLinuxExecutor>(
+        std::vector<std::string>{cat}, 1000, 10000, false,
+        root_dir / ("cur_input" + std::to_string(i)), PAGE_SIZE, PAGE_SIZE,
+        NativeLinuxExecutor::CPUID_DO_NOT_BIND));
+  }
+  ExecutorPool<NativeLinuxExecutor> pool(executors,
+                                         std::vector<std::optional<int>>(2));
+
+  BOOST_CHECK_THROW(pool.Dispatch(10,
+                                  [](NativeLinuxExecutor &, std::size_t i) {
+                                    if (i == 5)
+                                      throw std::runtime_error("task failed");
+                                  }),
+                    std::runtime_error);
+
+  std::atomic<std::size_t> count(0);
+  pool.Dispatch(10, [&count](NativeLinuxExecutor &, std::size_t) { ++count; });
+  BOOST_CHECK_EQUAL(count.load(), 10);
+}
+
+// Check if Map<bool> keeps every result although the workers write them in
+// parallel, and a worker whose core is unavailable still runs the tasks
+BOOST_AUTO_TEST_CASE(ExecutorPoolMapBool) {
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  const std::string cat = fuzzuf::utils::which(fs::path("cat")).native();
+  constexpr std::size_t executor_count = 4;
+  std::vector<std::shared_ptr<NativeLinuxExecutor>> executors;
+  for (std::size_t i = 0; i < executor_count; ++i) {
+    executors.emplace_back(std::make_shared<NativeLinuxExecutor>(
+        std::vector<std::string>{cat}, 1000, 10000, false,
+        root_dir / ("cur_input" + std::to_string(i)), PAGE_SIZE, PAGE_SIZE,
+        NativeLinuxExecutor::CPUID_DO_NOT_BIND));
+  }
+  // No system has this core
+  std::vector<std::optional<int>> cpuids(executor_count);
+  cpuids[0] = CPU_SETSIZE - 1;
+  ExecutorPool<NativeLinuxExecutor> pool(executors, cpuids);
+
+  constexpr std::size_t task_count = 100000;
+  auto results = pool.Map<bool>(
+      task_count,
+      [](NativeLinuxExecutor &, std::size_t i) { return i % 3 == 0; });
+
+  BOOST_REQUIRE_EQUAL(results.size(), task_count);
+  std::size_t mismatches = 0;
+  for (std::size_t i = 0; i < task_count; ++i) {
+    if (results[i] != (i % 3 == 0)) ++mismatches;
+  }
+  BOOST_CHECK_EQUAL(mismatches, 0);
+}
+
+// Check if the tasks are skipped after ReceiveStopSignal, including the ones
+// given afterwards
+BOOST_AUTO_TEST_CASE(ExecutorPoolStop) {
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  const std::string cat = fuzzuf::utils::which(fs::path("cat")).native();
+  std::vector<std::shared_ptr<NativeLinuxExecutor>> executors;
+  for (std::size_t i = 0; i < 2; ++i) {
+    executors.emplace_back(std::make_shared<NativeLinuxExecutor>(
+        std::vector<std::string>{cat}, 1000, 10000, false,
+        root_dir / ("cur_input" + std::to_string(i)), PAGE_SIZE, PAGE_SIZE,
+        NativeLinuxExecutor::CPUID_DO_NOT_BIND));
+  }
+  ExecutorPool<NativeLinuxExecutor> pool(executors,
+                                         std::vector<std::optional<int>>(2));
+
+  pool.ReceiveStopSignal();
+
+  auto results = pool.Map<int>(
+      10, [](NativeLinuxExecutor &, std::size_t) { return 1; });
+  BOOST_CHECK(results == std::vector<int>(10, 0));
+}
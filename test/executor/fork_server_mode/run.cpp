@@ -21,6 +21,8 @@
 #include <boost/scope_exit.hpp>
 #include <boost/test/unit_test.hpp>
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "fuzzuf/algorithms/afl/afl_option.hpp"
 #include "fuzzuf/exceptions.hpp"
@@ -152,3 +154,347 @@ BOOST_AUTO_TEST_CASE(NativeLinuxExecutorNativeRunTooMuchOutput,
                     PUTExitReasonType::FAULT_TMOUT);
   BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().signal, SIGKILL);
 }
+
+// Check if NativeLinuxExecutor in persistent mode keeps working across
+// multiple executions. command_wrapper doesn't use __AFL_LOOP(), so every
+// execution ends with the exit of the PUT process and the fork server has to
+// fork a new one each time, which must not be confused with a stopped process.
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorNativeRunPersistent) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  // Create input/output dirctory
+  auto input_dir = root_dir / "input";
+  auto output_dir = root_dir / "output";
+  BOOST_CHECK_EQUAL(fs::create_directory(input_dir), true);
+  BOOST_CHECK_EQUAL(fs::create_directory(output_dir), true);
+
+  // Create executor instance
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  auto path_to_write_seed = output_dir / "cur_input";
+  NativeLinuxExecutor executor(
+      {TEST_BINARY_DIR "/put_binaries/command_wrapper", "/bin/cat", "@@"}, 1000,
+      10000, true, path_to_write_seed, PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND, true /* record_stdout_and_err */,
+      2 /* persistent_loop_count */
+  );
+  BOOST_CHECK(executor.IsPersistentMode());
+
+  // Run more times than persistent_loop_count so that recycling is exercised
+  for (int i = 0; i < 5; ++i) {
+    std::string input = "hello" + std::to_string(i) + "\n";
+    executor.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+
+    BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                      PUTExitReasonType::FAULT_NONE);
+
+    auto stdout_buffer_feedback = executor.GetStdOut();
+    stdout_buffer_feedback.ShowMemoryToFunc([&input](const u8 *ptr, u32 len) {
+      BOOST_CHECK_EQUAL_COLLECTIONS(ptr, ptr + len, input.begin(),
+                                    input.end());
+    });
+    InplaceMemoryFeedback::DiscardActive(std::move(stdout_buffer_feedback));
+  }
+}
+
+// Check if NativeLinuxExecutor in persistent mode resumes the PUT process
+// stopped at the end of each iteration of __AFL_LOOP(), and recycles it after
+// persistent_loop_count inputs.
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorNativeRunPersistentLoop) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  // Create input/output dirctory
+  auto input_dir = root_dir / "input";
+  auto output_dir = root_dir / "output";
+  BOOST_CHECK_EQUAL(fs::create_directory(input_dir), true);
+  BOOST_CHECK_EQUAL(fs::create_directory(output_dir), true);
+
+  // Create executor instance
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  constexpr u32 loop_count = 3;
+
+  auto path_to_write_seed = output_dir / "cur_input";
+  NativeLinuxExecutor executor(
+      {TEST_BINARY_DIR "/executor/persistent_fork_server"}, 1000, 10000, true,
+      path_to_write_seed, PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND, true /* record_stdout_and_err */,
+      loop_count
+  );
+  BOOST_CHECK(executor.IsPersistentMode());
+
+  // The PUT writes "<pid>:<input>" in each iteration
+  std::vector<std::string> pids;
+  for (u32 i = 0; i < loop_count * 2 + 1; ++i) {
+    std::string input = "hello" + std::to_string(i) + "\n";
+    executor.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+
+    BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                      PUTExitReasonType::FAULT_NONE);
+
+    auto stdout_buffer_feedback = executor.GetStdOut();
+    stdout_buffer_feedback.ShowMemoryToFunc([&](const u8 *ptr, u32 len) {
+      std::string output(reinterpret_cast<const char *>(ptr), len);
+      auto colon = output.find(':');
+      BOOST_REQUIRE(colon != std::string::npos);
+      BOOST_CHECK_EQUAL(output.substr(colon + 1), input);
+      pids.emplace_back(output.substr(0, colon));
+    });
+    InplaceMemoryFeedback::DiscardActive(std::move(stdout_buffer_feedback));
+  }
+
+  // Each process serves loop_count inputs, and then a new one is forked
+  BOOST_REQUIRE_EQUAL(pids.size(), loop_count * 2 + 1);
+  for (u32 i = 1; i < pids.size(); ++i) {
+    if (i % loop_count == 0) {
+      BOOST_CHECK_NE(pids[i], pids[i - 1]);
+    } else {
+      BOOST_CHECK_EQUAL(pids[i], pids[i - 1]);
+    }
+  }
+}
+
+// Check if NativeLinuxExecutor passes inputs via the shared memory when the
+// fork server advertises the support, without updating the input file.
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorNativeRunSharedMemoryInput) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  // Create input/output dirctory
+  auto input_dir = root_dir / "input";
+  auto output_dir = root_dir / "output";
+  BOOST_CHECK_EQUAL(fs::create_directory(input_dir), true);
+  BOOST_CHECK_EQUAL(fs::create_directory(output_dir), true);
+
+  // Create executor instance
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  auto path_to_write_seed = output_dir / "cur_input";
+  NativeLinuxExecutor executor(
+      {TEST_BINARY_DIR "/executor/shm_input_fork_server"}, 1000, 10000, true,
+      path_to_write_seed, PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND, true /* record_stdout_and_err */
+  );
+  BOOST_CHECK_EQUAL(executor.uses_shm_input, true);
+
+  for (int i = 0; i < 3; ++i) {
+    std::string input = "hello" + std::to_string(i) + "\n";
+    executor.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+
+    BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                      PUTExitReasonType::FAULT_NONE);
+
+    auto stdout_buffer_feedback = executor.GetStdOut();
+    stdout_buffer_feedback.ShowMemoryToFunc([&input](const u8 *ptr, u32 len) {
+      BOOST_CHECK_EQUAL_COLLECTIONS(ptr, ptr + len, input.begin(),
+                                    input.end());
+    });
+    InplaceMemoryFeedback::DiscardActive(std::move(stdout_buffer_feedback));
+  }
+
+  BOOST_CHECK_EQUAL(fs::file_size(path_to_write_seed), 0);
+}
+
+// Check if NativeLinuxExecutor starts the fork server at __AFL_INIT() when
+// SnapshotPoint::Deferred is requested, and falls back to the entry when PUT
+// doesn't have the mark or doesn't reach __AFL_INIT().
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorNativeRunDeferred) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  // Create input/output dirctory
+  auto input_dir = root_dir / "input";
+  auto output_dir = root_dir / "output";
+  BOOST_CHECK_EQUAL(fs::create_directory(input_dir), true);
+  BOOST_CHECK_EQUAL(fs::create_directory(output_dir), true);
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  auto path_to_write_seed = output_dir / "cur_input";
+  auto check = [&](const std::vector<std::string> &argv,
+                   bool expected_deferred) {
+    NativeLinuxExecutor executor(
+        argv, 1000, 10000, true, path_to_write_seed, PAGE_SIZE, PAGE_SIZE,
+        NativeLinuxExecutor::CPUID_DO_NOT_BIND,
+        true /* record_stdout_and_err */,
+        NativeLinuxExecutor::PERSISTENT_MODE_DISABLED,
+        NativeLinuxExecutor::OUTPUT_CAPTURE_UNLIMITED,
+        fuzzuf::executor::SnapshotPoint::Deferred);
+    BOOST_CHECK_EQUAL(executor.IsDeferredForkServer(), expected_deferred);
+
+    const std::string expected = expected_deferred ? "snapshot\n" : "entry\n";
+    for (int i = 0; i < 3; ++i) {
+      std::string input = "hello";
+      executor.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+
+      BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                        PUTExitReasonType::FAULT_NONE);
+
+      auto stdout_buffer_feedback = executor.GetStdOut();
+      stdout_buffer_feedback.ShowMemoryToFunc(
+          [&expected](const u8 *ptr, u32 len) {
+            BOOST_CHECK_EQUAL_COLLECTIONS(ptr, ptr + len, expected.begin(),
+                                          expected.end());
+          });
+      InplaceMemoryFeedback::DiscardActive(std::move(stdout_buffer_feedback));
+    }
+  };
+
+  check({TEST_BINARY_DIR "/executor/deferred_fork_server"}, true);
+  check({TEST_BINARY_DIR "/executor/deferred_fork_server", "exit-before-init"},
+        false);
+  BOOST_CHECK(!NativeLinuxExecutor::HasDeferredForkServerSignature(
+      TEST_BINARY_DIR "/executor/shm_input_fork_server"));
+}
+
+// Check if NativeLinuxExecutor shrinks the coverage map to the size the fork
+// server tells in the handshake
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorNativeRunMapSize) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  // The size is rounded up to a power of two
+  constexpr u32 map_size = 300;
+  NativeLinuxExecutor executor(
+      {TEST_BINARY_DIR "/executor/map_size_fork_server",
+       std::to_string(map_size)},
+      1000, 10000, true, root_dir / "cur_input", PAGE_SIZE * 4, 0,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND);
+  BOOST_CHECK(executor.afl_map_size_negotiated);
+  BOOST_CHECK_EQUAL(executor.afl_map_size, 512u);
+  BOOST_CHECK_EQUAL(executor.afl_shm_size, PAGE_SIZE * 4);
+
+  for (int i = 0; i < 3; ++i) {
+    std::string input = "hello";
+    executor.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+    BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                      PUTExitReasonType::FAULT_NONE);
+
+    executor.GetAFLFeedback().ShowMemoryToFunc([&](const u8 *ptr, u32 len) {
+      BOOST_CHECK_EQUAL(len, 512u);
+      BOOST_CHECK_EQUAL(ptr[map_size - 1], 1);
+    });
+  }
+}
+
+// Check if NativeLinuxExecutor enlarges the coverage map when the fork server
+// tells it needs more than afl_shm_size
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorNativeRunLargerMapSize) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  const u32 map_size = PAGE_SIZE * 4;
+  NativeLinuxExecutor executor(
+      {TEST_BINARY_DIR "/executor/map_size_fork_server",
+       std::to_string(map_size)},
+      1000, 10000, true, root_dir / "cur_input", PAGE_SIZE, 0,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND);
+  BOOST_CHECK(executor.afl_map_size_negotiated);
+  BOOST_CHECK_EQUAL(executor.afl_shm_size, map_size);
+  BOOST_CHECK_EQUAL(executor.afl_map_size, map_size);
+
+  for (int i = 0; i < 3; ++i) {
+    std::string input = "hello";
+    executor.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+    BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                      PUTExitReasonType::FAULT_NONE);
+
+    executor.GetAFLFeedback().ShowMemoryToFunc([&](const u8 *ptr, u32 len) {
+      BOOST_CHECK_EQUAL(len, map_size);
+      BOOST_CHECK_EQUAL(ptr[len - 1], 1);
+    });
+  }
+}
+
+// Check if NativeLinuxExecutors in one process pass their own shared memories
+// to their PUTs, without touching the environment variables of this process
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorNativeRunMultipleInstances) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  unsetenv(NativeLinuxExecutor::AFL_SHM_ENV_VAR);
+
+  NativeLinuxExecutor executor1(
+      {TEST_BINARY_DIR "/executor/map_size_fork_server", "100"}, 1000, 10000,
+      true, root_dir / "cur_input1", PAGE_SIZE, 0,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND);
+  NativeLinuxExecutor executor2(
+      {TEST_BINARY_DIR "/executor/map_size_fork_server", "200"}, 1000, 10000,
+      true, root_dir / "cur_input2", PAGE_SIZE, 0,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND);
+  BOOST_CHECK(getenv(NativeLinuxExecutor::AFL_SHM_ENV_VAR) == nullptr);
+  BOOST_CHECK_NE(executor1.afl_shmid, executor2.afl_shmid);
+
+  for (int i = 0; i < 3; ++i) {
+    std::string input = "hello";
+    executor1.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+    executor2.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+
+    executor1.GetAFLFeedback().ShowMemoryToFunc([&](const u8 *ptr, u32 len) {
+      BOOST_CHECK_EQUAL(len, 128u);
+      BOOST_CHECK_EQUAL(ptr[99], 1);
+    });
+    executor2.GetAFLFeedback().ShowMemoryToFunc([&](const u8 *ptr, u32 len) {
+      BOOST_CHECK_EQUAL(len, 256u);
+      BOOST_CHECK_EQUAL(ptr[99], 0);
+      BOOST_CHECK_EQUAL(ptr[199], 1);
+    });
+  }
+}
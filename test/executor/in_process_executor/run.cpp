@@ -0,0 +1,107 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE in_process_executor.run
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/scope_exit.hpp>
+#include <boost/test/unit_test.hpp>
+#include <csignal>
+#include <string>
+
+#include "fuzzuf/executor/in_process_executor.hpp"
+#include "fuzzuf/feedback/inplace_memory_feedback.hpp"
+#include "fuzzuf/feedback/put_exit_reason_type.hpp"
+#include "fuzzuf/utils/common.hpp"
+#include "fuzzuf/utils/filesystem.hpp"
+
+namespace {
+void RunString(InProcessExecutor &executor, const std::string &input) {
+  executor.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+}
+
+// The harness increments counters[0] on every call, and counters[1 + data[0] % 15] for non-empty inputs
+void CheckCounters(InProcessExecutor &executor, u8 first) {
+  executor.GetBBFeedback().ShowMemoryToFunc([&](const u8 *ptr, u32 len) {
+    BOOST_REQUIRE_GE(len, 16u);
+    for (u32 i = 0; i < len; ++i) {
+      const u8 expected = (i == 0 || i == 1u + first % 15u) ? 1 : 0;
+      BOOST_CHECK_EQUAL(ptr[i], expected);
+    }
+  });
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(InProcessExecutorRun) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  InProcessExecutor executor(
+      TEST_BINARY_DIR "/executor/libin_process_target.so", 1000, 0,
+      root_dir / "cur_input", PAGE_SIZE, PAGE_SIZE);
+  BOOST_CHECK_EQUAL(executor.counter_regions.size(), 1u);
+  const auto runner_pid = executor.runner_pid;
+
+  // The executor must not change the signal dispositions of the whole process
+  struct sigaction sigpipe_action;
+  BOOST_REQUIRE_EQUAL(sigaction(SIGPIPE, nullptr, &sigpipe_action), 0);
+  BOOST_CHECK(sigpipe_action.sa_handler == SIG_DFL);
+
+  // The same runner handles all inputs until it dies
+  for (const std::string input : {"a", "b", "a"}) {
+    RunString(executor, input);
+    BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                      PUTExitReasonType::FAULT_NONE);
+    BOOST_CHECK_EQUAL(executor.runner_pid, runner_pid);
+    CheckCounters(executor, input[0]);
+  }
+
+  RunString(executor, "crash");
+  BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                    PUTExitReasonType::FAULT_CRASH);
+  BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().signal, SIGSEGV);
+
+  // A new runner is launched after the crash
+  RunString(executor, "a");
+  BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                    PUTExitReasonType::FAULT_NONE);
+  CheckCounters(executor, 'a');
+
+  executor.Run(reinterpret_cast<const u8 *>("hang"), 4, 100);
+  BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                    PUTExitReasonType::FAULT_TMOUT);
+  BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().signal, SIGKILL);
+
+  // The harness must not exit
+  RunString(executor, "exit");
+  BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                    PUTExitReasonType::FAULT_CRASH);
+
+  RunString(executor, "b");
+  BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                    PUTExitReasonType::FAULT_NONE);
+  CheckCounters(executor, 'b');
+}
@@ -0,0 +1,60 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+// A libFuzzer style harness for InProcessExecutor.
+// It registers its own counters in the same way as the code inserted by -fsanitize-coverage=inline-8bit-counters.
+// Like the real harnesses, it is linked with libfuzzuf-sancov, which defines __sanitizer_cov_8bit_counters_init.
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+extern "C" void __sanitizer_cov_8bit_counters_init(std::uint8_t *start,
+                                                   std::uint8_t *stop);
+
+namespace {
+std::uint8_t counters[16];
+
+__attribute__((constructor)) void RegisterCounters() {
+  __sanitizer_cov_8bit_counters_init(counters, counters + sizeof(counters));
+}
+
+bool StartsWith(const std::uint8_t *data, std::size_t size, const char *str) {
+  const auto len = std::strlen(str);
+  return size >= len && std::memcmp(data, str, len) == 0;
+}
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data,
+                                      std::size_t size) {
+  ++counters[0];
+  if (size == 0) {
+    return 0;
+  }
+  ++counters[1 + data[0] % 15];
+
+  if (StartsWith(data, size, "crash")) {
+    std::raise(SIGSEGV);
+  } else if (StartsWith(data, size, "hang")) {
+    while (true) {
+    }
+  } else if (StartsWith(data, size, "exit")) {
+    std::exit(0);
+  }
+  return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+// A PUT emulating the fork server built with AFL++ which tells the size of its coverage map in the handshake.
+// The size is given by argv[1]. Each process forked by the fork server sets the last byte of the map.
+// If AFL_MAP_SIZE is smaller than its map, the PUT tells its size in the handshake, but leaves the map untouched
+// and refuses to run, expecting to be started again with a larger map.
+#include <cstdint>
+#include <cstdlib>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+constexpr int FORKSRV_FD_READ  = 198;
+constexpr int FORKSRV_FD_WRITE = 199;
+constexpr std::uint32_t FS_OPT_ENABLED = 0x80000001;
+constexpr std::uint32_t FS_OPT_MAPSIZE = 0x40000000;
+
+// FS_OPT_SET_MAPSIZE of AFL++
+constexpr std::uint32_t SetMapSize(std::uint32_t size) {
+    return ((size - 1) << 1) & 0x00fffffe;
+}
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) return 1;
+    const std::uint32_t map_size = std::strtoul(argv[1], nullptr, 0);
+
+    const char *id = getenv("__AFL_SHM_ID");
+    const char *max_size = getenv("AFL_MAP_SIZE");
+    if (!id || !max_size) return 1;
+
+    auto *trace_bits = static_cast<std::uint8_t*>(shmat(atoi(id), nullptr, 0));
+    if (trace_bits == reinterpret_cast<std::uint8_t*>(-1)) return 1;
+
+    std::uint32_t status = FS_OPT_ENABLED | FS_OPT_MAPSIZE | SetMapSize(map_size);
+    if (write(FORKSRV_FD_WRITE, &status, 4) != 4) return 1;
+
+    if (std::strtoul(max_size, nullptr, 0) < map_size) return 1;
+
+    while (true) {
+        std::uint32_t was_killed;
+        if (read(FORKSRV_FD_READ, &was_killed, 4) != 4) return 0;
+
+        pid_t pid = fork();
+        if (pid < 0) return 1;
+
+        if (!pid) {
+            trace_bits[map_size - 1] = 1;
+            _exit(0);
+        }
+
+        if (write(FORKSRV_FD_WRITE, &pid, 4) != 4) return 1;
+        int put_status;
+        if (waitpid(pid, &put_status, 0) < 0) return 1;
+        if (write(FORKSRV_FD_WRITE, &put_status, 4) != 4) return 1;
+    }
+}
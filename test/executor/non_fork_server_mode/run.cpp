@@ -18,6 +18,8 @@
 #define BOOST_TEST_MODULE native_linux_executor.run
 #define BOOST_TEST_DYN_LINK
 
+#include <algorithm>
+#include <chrono>
 #include <boost/scope_exit.hpp>
 #include <boost/test/unit_test.hpp>
 #include <iostream>
@@ -514,3 +516,416 @@ BOOST_AUTO_TEST_CASE(NativeLinuxExecutorNativeRunNotExecutable) {
                     PUTExitReasonType::FAULT_ERROR);
   BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().signal, 0);
 }
+
+// Check if multiple instances of NativeLinuxExecutor can coexist in one
+// process. Each instance has its own virtual fork server and its own timeout,
+// so a hanging PUT of one instance must not affect the others.
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorNativeRunMultipleInstances) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  if (!raw_dirname)
+    throw -1;
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  // Create input/output dirctory
+  auto input_dir = root_dir / "input";
+  auto output_dir = root_dir / "output";
+  BOOST_CHECK_EQUAL(fs::create_directory(input_dir), true);
+  BOOST_CHECK_EQUAL(fs::create_directory(output_dir), true);
+
+  // Create executor instances
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  NativeLinuxExecutor executor1(
+      {TEST_BINARY_DIR "/executor/never_exit"}, 1000, 10000, false,
+      output_dir / "cur_input1", PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND);
+  NativeLinuxExecutor executor2(
+      {TEST_BINARY_DIR "/executor/ok"}, 1000, 10000, false,
+      output_dir / "cur_input2", PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND);
+
+  std::string input;
+  for (int i = 0; i < 2; ++i) {
+    executor1.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+    executor2.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+    BOOST_CHECK_EQUAL(executor1.GetExitStatusFeedback().exit_reason,
+                      PUTExitReasonType::FAULT_TMOUT);
+    BOOST_CHECK_EQUAL(executor2.GetExitStatusFeedback().exit_reason,
+                      PUTExitReasonType::FAULT_NONE);
+  }
+}
+
+// The control block shared with the virtual fork server is allocated once and reused in every execution
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorReuseChildState) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  auto output_dir = root_dir / "output";
+  BOOST_CHECK_EQUAL(fs::create_directory(output_dir), true);
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  NativeLinuxExecutor executor(
+      {TEST_BINARY_DIR "/executor/ok"}, 1000, 10000, false,
+      output_dir / "cur_input", PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND);
+  BOOST_REQUIRE(executor.child_state);
+  const auto *child_state = executor.child_state.get();
+
+  std::string input;
+  for (u64 i = 1; i <= 3; ++i) {
+    executor.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+    BOOST_CHECK_EQUAL(executor.child_state.get(), child_state);
+    BOOST_CHECK_EQUAL(executor.exec_seq, i);
+    BOOST_CHECK_EQUAL(child_state->seq, i);
+    BOOST_CHECK_EQUAL(child_state->exec_result, 0);
+    BOOST_CHECK(WIFEXITED(child_state->exit_status));
+  }
+}
+
+// With output_capture_limit, the outputs are read into bounded buffers and truncated at the limit
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorCaptureOutputWithLimit) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  auto output_dir = root_dir / "output";
+  BOOST_CHECK_EQUAL(fs::create_directory(output_dir), true);
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  // cat copies the input to stdout, and "result" is created only if all of
+  // its writes have succeeded
+  const auto result = output_dir / "result";
+  const std::string script = "cat && touch " + result.native();
+  NativeLinuxExecutor executor(
+      {fuzzuf::utils::which(fs::path("sh")).c_str(), "-c", script.c_str()},
+      1000, 10000, false, output_dir / "cur_input", PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND, true,
+      NativeLinuxExecutor::PERSISTENT_MODE_DISABLED, PAGE_SIZE);
+
+  // stdout can hold only PAGE_SIZE bytes, but the PUT must not notice it
+  std::string long_input(PAGE_SIZE * 3, 'A');
+  executor.Run(reinterpret_cast<const u8 *>(long_input.c_str()),
+               long_input.size());
+  BOOST_CHECK(fs::exists(result));
+  BOOST_CHECK(executor.IsStdOutTruncated());
+  executor.GetStdOut().ShowMemoryToFunc([&](const u8 *ptr, u32 len) {
+    BOOST_CHECK_EQUAL(len, PAGE_SIZE);
+    BOOST_CHECK(std::all_of(ptr, ptr + len, [](u8 c) { return c == 'A'; }));
+  });
+
+  // The outputs of the last execution must not remain
+  std::string input("Hello, World!");
+  executor.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+  BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                    PUTExitReasonType::FAULT_NONE);
+  BOOST_CHECK(!executor.IsStdOutTruncated());
+  BOOST_CHECK(!executor.IsStdErrTruncated());
+  executor.GetStdOut().ShowMemoryToFunc([&](const u8 *ptr, u32 len) {
+    BOOST_CHECK_EQUAL_COLLECTIONS(ptr, ptr + len, input.begin(), input.end());
+  });
+  const auto stdout_buffer = executor.MoveStdOut();
+  BOOST_CHECK_EQUAL_COLLECTIONS(stdout_buffer.begin(), stdout_buffer.end(),
+                                input.begin(), input.end());
+  BOOST_CHECK(executor.MoveStdErr().empty());
+}
+
+// A PUT writing far more than output_capture_limit finishes normally, while
+// only the limit is kept
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorCaptureHugeOutputWithLimit) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  auto output_dir = root_dir / "output";
+  BOOST_CHECK_EQUAL(fs::create_directory(output_dir), true);
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  // 64MiB of zeros, which would be kept somewhere if the rest were not discarded
+  const auto result = output_dir / "result";
+  const std::string script =
+      "head -c 67108864 /dev/zero && touch " + result.native();
+  NativeLinuxExecutor executor(
+      {fuzzuf::utils::which(fs::path("sh")).c_str(), "-c", script.c_str()},
+      10000, 10000, false, output_dir / "cur_input", PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND, true,
+      NativeLinuxExecutor::PERSISTENT_MODE_DISABLED, PAGE_SIZE);
+
+  for (int i = 0; i < 2; ++i) {
+    std::string input("Hello, World!");
+    executor.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+    BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                      PUTExitReasonType::FAULT_NONE);
+    BOOST_CHECK(fs::exists(result));
+    BOOST_CHECK(executor.IsStdOutTruncated());
+    executor.GetStdOut().ShowMemoryToFunc([&](const u8 *ptr, u32 len) {
+      BOOST_CHECK_EQUAL(len, PAGE_SIZE);
+      BOOST_CHECK(std::all_of(ptr, ptr + len, [](u8 c) { return c == 0; }));
+    });
+    fs::remove(result);
+  }
+}
+
+// The outputs are recorded according to the policy of each fd
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorCaptureOutputPerFd) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  auto output_dir = root_dir / "output";
+  BOOST_CHECK_EQUAL(fs::create_directory(output_dir), true);
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  using fuzzuf::executor::OutputCapturePolicy;
+  const std::string tee = fuzzuf::utils::which(fs::path("tee")).native();
+  NativeLinuxExecutor hash_executor(
+      {tee, (output_dir / "result1").native()}, 1000, 10000, false,
+      output_dir / "cur_input1", PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND,
+      {{1, OutputCapturePolicy::HashOnly}, {2, OutputCapturePolicy::Discard}});
+  NativeLinuxExecutor full_executor(
+      {tee, (output_dir / "result2").native()}, 1000, 10000, false,
+      output_dir / "cur_input2", PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND, {{1, OutputCapturePolicy::Full}});
+
+  for (const std::string input : {"Hello, World!", "", "Goodbye"}) {
+    hash_executor.Run(reinterpret_cast<const u8 *>(input.c_str()),
+                      input.size());
+    full_executor.Run(reinterpret_cast<const u8 *>(input.c_str()),
+                      input.size());
+
+    // Only the hash is kept
+    const auto expected_hash = fuzzuf::executor::UpdateOutputHash(
+        fuzzuf::executor::output_hash_seed,
+        reinterpret_cast<const u8 *>(input.c_str()), input.size());
+    BOOST_CHECK_EQUAL(hash_executor.GetOutputHash(1), expected_hash);
+    BOOST_CHECK(hash_executor.MoveStdOut().empty());
+    BOOST_CHECK(hash_executor.MoveStdErr().empty());
+
+    // The same hash is calculated from the recorded bytes
+    BOOST_CHECK_EQUAL(full_executor.GetOutputHash(1), expected_hash);
+    full_executor.GetOutput(1).ShowMemoryToFunc([&](const u8 *ptr, u32 len) {
+      BOOST_CHECK_EQUAL_COLLECTIONS(ptr, ptr + len, input.begin(), input.end());
+    });
+  }
+}
+
+// Check if RunBatch executes the inputs in order, lets the callback see the
+// feedback of each execution, and stops when the callback returns false.
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorRunBatch) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  auto output_dir = root_dir / "output";
+  BOOST_CHECK_EQUAL(fs::create_directory(output_dir), true);
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  const std::string tee = fuzzuf::utils::which(fs::path("tee")).native();
+  NativeLinuxExecutor executor(
+      {tee, (output_dir / "result").native()}, 1000, 10000, false,
+      output_dir / "cur_input", PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND, true /* record_stdout_and_err */);
+
+  const std::vector<std::string> inputs{"Hello", "", "fuzzuf", "World"};
+  std::vector<fuzzuf::executor::BatchInput> batch;
+  for (const auto &input : inputs) {
+    batch.push_back({reinterpret_cast<const u8 *>(input.c_str()),
+                     static_cast<u32>(input.size())});
+  }
+
+  std::vector<std::size_t> called;
+  auto exit_statuses = executor.RunBatch(
+      batch, [&](std::size_t i, const ExitStatusFeedback &exit_status) {
+        called.push_back(i);
+        BOOST_CHECK_EQUAL(exit_status.exit_reason,
+                          PUTExitReasonType::FAULT_NONE);
+        executor.GetStdOut().ShowMemoryToFunc([&](const u8 *ptr, u32 len) {
+          BOOST_CHECK_EQUAL_COLLECTIONS(ptr, ptr + len, inputs[i].begin(),
+                                        inputs[i].end());
+        });
+        return i != 2;
+      });
+
+  BOOST_CHECK_EQUAL(exit_statuses.size(), 3);
+  BOOST_CHECK((called == std::vector<std::size_t>{0, 1, 2}));
+
+  // Without callback, all inputs are executed
+  BOOST_CHECK_EQUAL(executor.RunBatch(batch).size(), inputs.size());
+}
+
+// The coverage maps are usable whether the system has reserved huge pages or not
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorHugePages) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  const std::string cat = fuzzuf::utils::which(fs::path("cat")).native();
+  NativeLinuxExecutor executor(
+      {cat}, 1000, 10000, false, root_dir / "cur_input", PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND, false,
+      NativeLinuxExecutor::PERSISTENT_MODE_DISABLED,
+      NativeLinuxExecutor::OUTPUT_CAPTURE_UNLIMITED,
+      fuzzuf::executor::SnapshotPoint::Entry, true /* use_huge_pages */);
+  BOOST_CHECK(executor.use_huge_pages);
+
+  std::string input = "Hello";
+  executor.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+  BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                    PUTExitReasonType::FAULT_NONE);
+  executor.GetAFLFeedback().ShowMemoryToFunc([&](const u8 *ptr, u32 len) {
+    BOOST_CHECK_EQUAL(len, PAGE_SIZE);
+    BOOST_CHECK_EQUAL(ptr[len - 1], 0);
+  });
+}
+
+// The time limit shorter than a millisecond is honored, and an expired timer
+// doesn't leak into the next execution
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorRunWithTimeoutUs) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  std::string input = "Hello";
+  {
+    NativeLinuxExecutor executor(
+        {TEST_BINARY_DIR "/executor/never_exit",
+         (root_dir / "result").native()},
+        10000, 10000, false, root_dir / "cur_input", PAGE_SIZE, PAGE_SIZE,
+        NativeLinuxExecutor::CPUID_DO_NOT_BIND);
+
+    const auto begin = std::chrono::steady_clock::now();
+    executor.RunWithTimeoutUs(reinterpret_cast<const u8 *>(input.c_str()),
+                              input.size(), 500);
+    const auto elapsed = std::chrono::steady_clock::now() - begin;
+    BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                      PUTExitReasonType::FAULT_TMOUT);
+    // Far less than exec_timelimit_ms
+    BOOST_CHECK(elapsed < std::chrono::seconds(5));
+  }
+
+  const std::string cat = fuzzuf::utils::which(fs::path("cat")).native();
+  NativeLinuxExecutor executor({cat}, 1000, 10000, false,
+                               root_dir / "cur_input", PAGE_SIZE, PAGE_SIZE,
+                               NativeLinuxExecutor::CPUID_DO_NOT_BIND);
+  for (int i = 0; i < 3; ++i) {
+    // Launching cat takes longer than a microsecond
+    executor.RunWithTimeoutUs(reinterpret_cast<const u8 *>(input.c_str()),
+                              input.size(), 1);
+    executor.RunWithTimeoutUs(reinterpret_cast<const u8 *>(input.c_str()),
+                              input.size(), 1000000);
+    BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                      PUTExitReasonType::FAULT_NONE);
+  }
+}
+
+// In a batch, the timer of an input expiring after the input has finished
+// doesn't leak into the next input
+BOOST_AUTO_TEST_CASE(NativeLinuxExecutorRunBatchWithTimeoutUs) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  auto *const raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_CHECK(raw_dirname != nullptr);
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  long val = sysconf(_SC_PAGESIZE);
+  BOOST_CHECK(val != -1); // Make sure sysconf succeeds
+  u32 PAGE_SIZE = (u32)val;
+
+  // The PUT hangs only if the input is "hang"
+  const std::string script = "read x; [ \"$x\" = hang ] && sleep 10; exit 0";
+  NativeLinuxExecutor executor(
+      {fuzzuf::utils::which(fs::path("sh")).c_str(), "-c", script.c_str()},
+      10000, 10000, false, root_dir / "cur_input", PAGE_SIZE, PAGE_SIZE,
+      NativeLinuxExecutor::CPUID_DO_NOT_BIND);
+
+  const std::vector<std::string> inputs = {"ok\n", "ok\n", "hang\n", "ok\n"};
+  std::vector<fuzzuf::executor::BatchInput> batch;
+  for (const auto &input : inputs) {
+    batch.push_back({reinterpret_cast<const u8 *>(input.data()),
+                     static_cast<u32>(input.size())});
+  }
+
+  constexpr u64 timeout_us = 300000;
+  auto exit_statuses = executor.RunBatchWithTimeoutUs(
+      batch,
+      [&](std::size_t, const ExitStatusFeedback &) {
+        // Let the timer of this input expire before the next input
+        usleep(timeout_us * 2);
+        return true;
+      },
+      timeout_us);
+
+  BOOST_REQUIRE_EQUAL(exit_statuses.size(), inputs.size());
+  BOOST_CHECK_EQUAL(exit_statuses[0].exit_reason, PUTExitReasonType::FAULT_NONE);
+  BOOST_CHECK_EQUAL(exit_statuses[1].exit_reason, PUTExitReasonType::FAULT_NONE);
+  BOOST_CHECK_EQUAL(exit_statuses[2].exit_reason, PUTExitReasonType::FAULT_TMOUT);
+  BOOST_CHECK_EQUAL(exit_statuses[3].exit_reason, PUTExitReasonType::FAULT_NONE);
+
+  // The timer is disarmed once the batch has finished
+  usleep(timeout_us * 2);
+  executor.Run(reinterpret_cast<const u8 *>(inputs[0].data()),
+               inputs[0].size());
+  BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().exit_reason,
+                    PUTExitReasonType::FAULT_NONE);
+}
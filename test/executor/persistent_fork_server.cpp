@@ -0,0 +1,95 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+// A PUT emulating the fork server built with afl-clang-fast whose main loop is __AFL_LOOP().
+// If __AFL_PERSISTENT is set, each forked process handles inputs repeatedly, raising SIGSTOP after each of them,
+// and the fork server resumes the stopped process for the next input as long as the executor doesn't kill it.
+// For each input, the process writes its pid followed by ':' and the input read from stdin.
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+constexpr int FORKSRV_FD_READ  = 198;
+constexpr int FORKSRV_FD_WRITE = 199;
+
+// Runs the fork server in the same way as __afl_start_forkserver() of afl-llvm-rt, and returns in each forked process
+void StartForkServer(bool persistent) {
+    std::uint32_t status = 0;
+    if (write(FORKSRV_FD_WRITE, &status, 4) != 4) std::exit(1);
+
+    pid_t pid = 0;
+    bool child_stopped = false;
+
+    while (true) {
+        std::uint32_t was_killed;
+        if (read(FORKSRV_FD_READ, &was_killed, 4) != 4) std::exit(0);
+
+        // The stopped process killed by the executor has to be reaped here
+        if (child_stopped && was_killed) {
+            child_stopped = false;
+            if (waitpid(pid, nullptr, 0) < 0) std::exit(1);
+        }
+
+        if (!child_stopped) {
+            pid = fork();
+            if (pid < 0) std::exit(1);
+
+            if (!pid) {
+                close(FORKSRV_FD_READ);
+                close(FORKSRV_FD_WRITE);
+                return;
+            }
+        } else {
+            kill(pid, SIGCONT);
+            child_stopped = false;
+        }
+
+        if (write(FORKSRV_FD_WRITE, &pid, 4) != 4) std::exit(1);
+        int put_status;
+        if (waitpid(pid, &put_status, persistent ? WUNTRACED : 0) < 0) std::exit(1);
+        if (WIFSTOPPED(put_status)) child_stopped = true;
+        if (write(FORKSRV_FD_WRITE, &put_status, 4) != 4) std::exit(1);
+    }
+}
+}
+
+int main() {
+    const bool persistent = getenv("__AFL_PERSISTENT") != nullptr;
+
+    StartForkServer(persistent);
+
+    while (true) {
+        char prefix[32];
+        int prefix_len = std::snprintf(prefix, sizeof(prefix), "%d:", static_cast<int>(getpid()));
+        if (write(1, prefix, prefix_len) != prefix_len) return 1;
+
+        // The executor rewinds the input file shared with us before each execution
+        char buf[4096];
+        ssize_t n;
+        while ((n = read(0, buf, sizeof(buf))) > 0) {
+            if (write(1, buf, n) != n) return 1;
+        }
+
+        if (!persistent) return 0;
+        raise(SIGSTOP);
+    }
+}
@@ -21,6 +21,7 @@
 #include <boost/scope_exit.hpp>
 #include <boost/test/unit_test.hpp>
 #include <iostream>
+#include <thread>
 
 #include "fuzzuf/algorithms/afl/afl_option.hpp"
 #include "fuzzuf/exceptions.hpp"
@@ -177,3 +178,48 @@ BOOST_AUTO_TEST_CASE(ProxyExecutorNativeRunTooMuchOutput,
                     PUTExitReasonType::FAULT_TMOUT);
   BOOST_CHECK_EQUAL(executor.GetExitStatusFeedback().signal, SIGKILL);
 }
+
+// Check if multiple instances of ProxyExecutor can run simultaneously on
+// multiple threads in non fork server mode. Each instance has to detect its
+// own timeout without process-wide timers and signal handlers.
+BOOST_AUTO_TEST_CASE(ProxyExecutorNonForkServerRunMultipleThreads,
+                     *boost::unit_test::timeout(10)) {
+  // Setup root directory
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+
+  const auto raw_dirname = mkdtemp(root_dir_template.data());
+  if (!raw_dirname)
+    throw -1;
+  BOOST_CHECK(raw_dirname != nullptr);
+
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) { fs::remove_all(root_dir); }
+  BOOST_SCOPE_EXIT_END
+
+  auto run = [&root_dir](const std::string &put, int id,
+                         PUTExitReasonType &exit_reason) {
+    // Use command_wrapper as a pseudo proxy application, which executes put.
+    ProxyExecutor executor(
+        fs::path(TEST_BINARY_DIR "/put_binaries/command_wrapper"), {put}, {put},
+        1000, 10000, false, root_dir / ("cur_input" + std::to_string(id)), 0,
+        0, ProxyExecutor::CPUID_DO_NOT_BIND);
+    executor.SetCArgvAndDecideInputMode();
+    executor.Initilize();
+
+    std::string input;
+    executor.Run(reinterpret_cast<const u8 *>(input.c_str()), input.size());
+    exit_reason = executor.GetExitStatusFeedback().exit_reason;
+  };
+
+  PUTExitReasonType never_exit_reason = PUTExitReasonType::FAULT_NONE;
+  PUTExitReasonType ok_reason = PUTExitReasonType::FAULT_TMOUT;
+  std::thread never_exit_thread(run, TEST_BINARY_DIR "/executor/never_exit", 0,
+                                std::ref(never_exit_reason));
+  std::thread ok_thread(run, TEST_BINARY_DIR "/executor/ok", 1,
+                        std::ref(ok_reason));
+  never_exit_thread.join();
+  ok_thread.join();
+
+  BOOST_CHECK_EQUAL(never_exit_reason, PUTExitReasonType::FAULT_TMOUT);
+  BOOST_CHECK_EQUAL(ok_reason, PUTExitReasonType::FAULT_NONE);
+}
@@ -0,0 +1,76 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+// A PUT emulating the fork server built with AFL++ which receives inputs via the shared memory(__AFL_SHM_FUZZ_ID).
+// Each process forked by the fork server writes the input to stdout.
+// If the executor declines the shared memory in the handshake, the input is read from stdin instead.
+#include <cstdint>
+#include <cstdlib>
+#include <sys/shm.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+constexpr int FORKSRV_FD_READ  = 198;
+constexpr int FORKSRV_FD_WRITE = 199;
+constexpr std::uint32_t FS_OPT_ENABLED     = 0x80000001;
+constexpr std::uint32_t FS_OPT_SHDMEM_FUZZ = 0x01000000;
+}
+
+int main() {
+    std::uint32_t status = FS_OPT_ENABLED | FS_OPT_SHDMEM_FUZZ;
+    if (write(FORKSRV_FD_WRITE, &status, 4) != 4) return 1;
+
+    std::uint32_t reply;
+    if (read(FORKSRV_FD_READ, &reply, 4) != 4) return 1;
+
+    const std::uint8_t *shm = nullptr;
+    if ((reply & (FS_OPT_ENABLED | FS_OPT_SHDMEM_FUZZ)) == (FS_OPT_ENABLED | FS_OPT_SHDMEM_FUZZ)) {
+        const char *id = getenv("__AFL_SHM_FUZZ_ID");
+        if (!id) return 1;
+        shm = static_cast<const std::uint8_t*>(shmat(atoi(id), nullptr, SHM_RDONLY));
+        if (shm == reinterpret_cast<const std::uint8_t*>(-1)) return 1;
+    }
+
+    while (true) {
+        std::uint32_t was_killed;
+        if (read(FORKSRV_FD_READ, &was_killed, 4) != 4) return 0;
+
+        pid_t pid = fork();
+        if (pid < 0) return 1;
+
+        if (!pid) {
+            close(FORKSRV_FD_READ);
+            close(FORKSRV_FD_WRITE);
+
+            if (shm) {
+                std::uint32_t len = *reinterpret_cast<const std::uint32_t*>(shm);
+                write(1, shm + sizeof(std::uint32_t), len);
+            } else {
+                char buf[4096];
+                ssize_t n;
+                while ((n = read(0, buf, sizeof(buf))) > 0) write(1, buf, n);
+            }
+            _exit(0);
+        }
+
+        if (write(FORKSRV_FD_WRITE, &pid, 4) != 4) return 1;
+        int put_status;
+        if (waitpid(pid, &put_status, 0) < 0) return 1;
+        if (write(FORKSRV_FD_WRITE, &put_status, 4) != 4) return 1;
+    }
+}
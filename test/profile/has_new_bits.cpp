@@ -0,0 +1,76 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+// Compares the kernels of afl::util::HasNewBits on sparse and dense traces.
+// Usage: profile-has-new-bits [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "fuzzuf/algorithms/afl/afl_bitmap.hpp"
+
+using fuzzuf::algorithm::afl::util::BitmapKernel;
+using fuzzuf::algorithm::afl::util::HasNewBits;
+using fuzzuf::algorithm::afl::util::IsBitmapKernelSupported;
+
+int main(int argc, char **argv) {
+  constexpr u32 map_size = 1 << 16;
+  const int iterations = argc > 1 ? std::atoi(argv[1]) : 100000;
+
+  const struct {
+    const char *name;
+    BitmapKernel kernel;
+  } kernels[] = {
+    { "scalar", BitmapKernel::Scalar },
+    { "avx2", BitmapKernel::AVX2 },
+    { "avx512", BitmapKernel::AVX512 },
+  };
+
+  std::mt19937 rng(0);
+
+  printf("%-8s %-8s %12s\n", "kernel", "density", "ns/call");
+  for (double density : { 0.005, 0.05, 0.5 }) {
+    std::bernoulli_distribution hit(density);
+    std::vector<u8> trace(map_size, 0);
+    for (auto &b : trace) {
+      if (hit(rng)) b = 1 << (rng() % 8);
+    }
+
+    for (const auto &k : kernels) {
+      if (!IsBitmapKernelSupported(k.kernel)) continue;
+
+      // Every tuple of the trace is already known, which is by far the
+      // most common case: the whole map is scanned and nothing is updated
+      std::vector<u8> virgin(map_size, 255);
+      HasNewBits(trace.data(), virgin.data(), map_size, k.kernel);
+
+      u32 found = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        found += HasNewBits(trace.data(), virgin.data(), map_size, k.kernel);
+      }
+      auto elapsed = std::chrono::steady_clock::now() - start;
+
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+      printf("%-8s %-8g %12.1f%s\n", k.name, density, double(ns) / iterations,
+             found ? " (unexpected new bits)" : "");
+    }
+  }
+}
@@ -0,0 +1,181 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE rand.rand
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "fuzzuf/rand/rand.hpp"
+#include "fuzzuf/rand/xsadd.hpp"
+
+using namespace fuzzuf::rand;
+
+namespace {
+std::vector<XSAdd::result_type> Take(XSAdd &rng, std::size_t n) {
+  std::vector<XSAdd::result_type> v(n);
+  for (auto &x : v) x = rng();
+  return v;
+}
+}
+
+BOOST_AUTO_TEST_CASE(XSAddIsReproducible) {
+  XSAdd a(1234), b(1234), c(5678);
+  auto va = Take(a, 100);
+  BOOST_CHECK(va == Take(b, 100));
+  BOOST_CHECK(va != Take(c, 100));
+
+  // discard(n) is the same as calling operator() n times
+  XSAdd d(1234);
+  d.discard(50);
+  BOOST_CHECK(std::vector<XSAdd::result_type>(va.begin() + 50, va.end()) == Take(d, 50));
+
+  // The state is restored by operator>> from what operator<< printed
+  XSAdd e(42), f;
+  e.discard(10);
+  std::stringstream ss;
+  ss << e;
+  ss >> f;
+  BOOST_CHECK(e == f);
+  BOOST_CHECK(Take(e, 10) == Take(f, 10));
+}
+
+BOOST_AUTO_TEST_CASE(XSAddNeverSticksToZero) {
+  XSAdd rng;
+  rng.SetState({0, 0, 0, 0});
+  auto v = Take(rng, 16);
+  BOOST_CHECK(std::set<XSAdd::result_type>(v.begin(), v.end()).size() > 1);
+}
+
+BOOST_AUTO_TEST_CASE(XSAddWorksWithStdDistributions) {
+  XSAdd rng(1);
+  std::uniform_int_distribution<int> dist(0, 3);
+  for (int i = 0; i < 1000; i++) {
+    int x = dist(rng);
+    BOOST_CHECK(0 <= x && x <= 3);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GlobalSeedMakesStreamsReproducible) {
+  SetGlobalSeed(1234);
+  BOOST_CHECK_EQUAL(GetGlobalSeed(), 1234);
+  auto rng1 = CreateXSAdd(0, "test.a");
+  auto rng2 = CreateXSAdd(0, "test.b");
+  auto rng3 = CreateXSAdd(1, "test.a");
+  auto v1 = Take(rng1, 100);
+  auto v2 = Take(rng2, 100);
+  auto v3 = Take(rng3, 100);
+  // Each component and each worker has its own stream
+  BOOST_CHECK(v1 != v2);
+  BOOST_CHECK(v1 != v3);
+  BOOST_CHECK(v2 != v3);
+
+  // The streams don't depend on the order of the creation
+  SetGlobalSeed(1234);
+  auto rng4 = CreateXSAdd(1, "test.a");
+  auto rng5 = CreateXSAdd(0, "test.b");
+  auto rng6 = CreateXSAdd(0, "test.a");
+  BOOST_CHECK(v3 == Take(rng4, 100));
+  BOOST_CHECK(v2 == Take(rng5, 100));
+  BOOST_CHECK(v1 == Take(rng6, 100));
+
+  // but do depend on the global seed
+  SetGlobalSeed(4321);
+  auto rng7 = CreateXSAdd(0, "test.a");
+  BOOST_CHECK(v1 != Take(rng7, 100));
+
+  // The explicit seed doesn't depend on the global seed
+  SetGlobalSeed(1);
+  auto rng8 = CreateXSAdd(5678);
+  SetGlobalSeed(2);
+  auto rng9 = CreateXSAdd(5678);
+  BOOST_CHECK(rng8 == rng9);
+}
+
+// Two runs with the same seed and several workers, like `--seed N --jobs K`.
+// The workers start in different orders in different threads, and the other
+// threads draw from their own RNGs meanwhile, but each worker gets the same
+// streams in both runs.
+BOOST_AUTO_TEST_CASE(WorkerStreamsAreReproducibleAcrossRuns) {
+  constexpr std::uint64_t worker_count = 4;
+  using Streams = std::vector<std::vector<XSAdd::result_type>>;
+
+  auto run = [](bool reverse) {
+    SetGlobalSeed(1234);
+    Streams streams(worker_count * 2);
+    std::vector<std::thread> threads;
+    for (std::uint64_t i = 0; i < worker_count; i++) {
+      const std::uint64_t worker = reverse ? worker_count - 1 - i : i;
+      threads.emplace_back([&streams, worker] {
+        Take(GetThreadLocalXSAdd(), worker + 1);
+        auto state_rng = CreateXSAdd(worker, "afl.state");
+        auto mutator_rng = CreateXSAdd(worker, "afl.mutator");
+        streams[worker * 2] = Take(state_rng, 100);
+        streams[worker * 2 + 1] = Take(mutator_rng, 100);
+      });
+      // Serialize the threads, so that they start in the given order
+      threads.back().join();
+    }
+    return streams;
+  };
+
+  const auto first = run(false);
+  const auto second = run(true);
+  BOOST_CHECK(first == second);
+  BOOST_CHECK_EQUAL(std::set<std::vector<XSAdd::result_type>>(first.begin(), first.end()).size(),
+                    first.size());
+}
+
+BOOST_AUTO_TEST_CASE(ThreadLocalXSAddFollowsGlobalSeed) {
+  SetGlobalSeed(1234);
+  auto v1 = Take(GetThreadLocalXSAdd(), 100);
+  SetGlobalSeed(1234);
+  auto v2 = Take(GetThreadLocalXSAdd(), 100);
+  BOOST_CHECK(v1 == v2);
+
+  // Another thread gets another stream
+  std::vector<XSAdd::result_type> v3;
+  std::thread th([&] { v3 = Take(GetThreadLocalXSAdd(), 100); });
+  th.join();
+  BOOST_CHECK(v1 != v3);
+}
+
+BOOST_AUTO_TEST_CASE(UniformBelowIsBoundedAndUnbiased) {
+  XSAdd rng(1);
+  for (std::uint32_t bound : {1u, 2u, 3u, 10u, 1000u, 0x80000001u, 0xffffffffu}) {
+    for (int i = 0; i < 1000; i++) {
+      BOOST_CHECK_LT(UniformBelow(rng, bound), bound);
+    }
+  }
+
+  // With bound = 3 * 2^30, rng() % bound returns the values below 2^30 twice
+  // as often as the others. Check that UniformBelow doesn't.
+  constexpr std::uint32_t bound = 3u << 30;
+  constexpr int n = 300000;
+  int low = 0;
+  for (int i = 0; i < n; i++) {
+    if (UniformBelow(rng, bound) < (1u << 30)) low++;
+  }
+  // Expected to be n / 3, within 5 standard deviations
+  const double sd = std::sqrt(n * (1.0 / 3) * (2.0 / 3));
+  BOOST_CHECK_LT(std::abs(low - n / 3.0), 5 * sd);
+}
@@ -0,0 +1,105 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE util.bounded_output_buffer
+#define BOOST_TEST_DYN_LINK
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <boost/test/unit_test.hpp>
+#include "fuzzuf/utils/bounded_output_buffer.hpp"
+
+using fuzzuf::utils::BoundedOutputBuffer;
+
+namespace {
+// Write size bytes of value to fd, and close it
+void WriteAll(int fd, std::size_t size, std::uint8_t value) {
+  std::vector<std::uint8_t> chunk(4096, value);
+  while (size) {
+    const auto n = write(fd, chunk.data(), std::min(size, chunk.size()));
+    if (n <= 0) break;
+    size -= n;
+  }
+  close(fd);
+}
+
+// Read from fd until the writer closes it
+void Drain(BoundedOutputBuffer &buffer, int fd) {
+  while (true) {
+    pollfd p{fd, POLLIN, 0};
+    poll(&p, 1, -1);
+    if (!buffer.ReadFrom(fd) && (p.revents & POLLHUP)) {
+      while (buffer.ReadFrom(fd))
+        ;
+      break;
+    }
+  }
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(KeepOnlyTheHead) {
+  constexpr std::size_t capacity = 1000;
+  // Far larger than the capacity and the pipe buffer
+  constexpr std::size_t written = 64u * 1024u * 1024u;
+  BoundedOutputBuffer buffer(capacity);
+
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(pipe2(fds, O_NONBLOCK), 0);
+  // The writer blocks until the reader empties the pipe
+  fcntl(fds[1], F_SETFL, 0);
+  std::thread writer(WriteAll, fds[1], written, 'A');
+  Drain(buffer, fds[0]);
+  writer.join();
+  close(fds[0]);
+
+  // The writer has written everything, and only the capacity is kept
+  BOOST_CHECK_EQUAL(buffer.GetWrittenSize(), written);
+  BOOST_CHECK_EQUAL(buffer.GetSize(), capacity);
+  BOOST_CHECK_EQUAL(buffer.GetCapacity(), capacity);
+  BOOST_CHECK(buffer.IsTruncated());
+  BOOST_CHECK(std::all_of(buffer.GetData(), buffer.GetData() + capacity,
+                          [](std::uint8_t c) { return c == 'A'; }));
+}
+
+BOOST_AUTO_TEST_CASE(Rewind) {
+  BoundedOutputBuffer buffer(1000);
+
+  int fds[2];
+  BOOST_REQUIRE_EQUAL(pipe2(fds, O_NONBLOCK), 0);
+  BOOST_REQUIRE_EQUAL(write(fds[1], "abc", 3), 3);
+  while (buffer.ReadFrom(fds[0]))
+    ;
+  BOOST_CHECK_EQUAL(buffer.GetSize(), 3u);
+  BOOST_CHECK(!buffer.IsTruncated());
+
+  buffer.Rewind();
+  BOOST_CHECK_EQUAL(buffer.GetSize(), 0u);
+  BOOST_CHECK_EQUAL(buffer.GetWrittenSize(), 0u);
+
+  BOOST_REQUIRE_EQUAL(write(fds[1], "de", 2), 2);
+  while (buffer.ReadFrom(fds[0]))
+    ;
+  BOOST_CHECK_EQUAL(buffer.GetSize(), 2u);
+  BOOST_CHECK(std::equal(buffer.GetData(), buffer.GetData() + 2, "de"));
+
+  close(fds[0]);
+  close(fds[1]);
+}
@@ -0,0 +1,114 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE util.dirty_regions
+#define BOOST_TEST_DYN_LINK
+#include <vector>
+#include <boost/test/unit_test.hpp>
+#include "fuzzuf/utils/dirty_regions.hpp"
+
+using fuzzuf::utils::DirtyRegions;
+
+namespace {
+bool IsZero(const std::vector<std::uint8_t> &mem) {
+  for (auto b : mem) {
+    if (b) return false;
+  }
+  return true;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(ClearOnlyRecordedRegions) {
+  constexpr std::uint32_t size = 1 << 16;
+  std::vector<std::uint8_t> mem(size, 0);
+
+  DirtyRegions dirty(size);
+  dirty.Enable();
+
+  mem[0] = 1;
+  mem[100] = 1;
+  mem[size - 1] = 1;
+  dirty.StartRecording();
+  dirty.MarkOffset(0);
+  dirty.MarkOffset(100);
+  dirty.MarkOffset(size - 1);
+
+  // A byte the record doesn't cover is left as is
+  mem[1000] = 1;
+
+  dirty.Clear(mem.data());
+  BOOST_CHECK_EQUAL(mem[0], 0);
+  BOOST_CHECK_EQUAL(mem[100], 0);
+  BOOST_CHECK_EQUAL(mem[size - 1], 0);
+  BOOST_CHECK_EQUAL(mem[1000], 1);
+
+  // Nothing has been recorded since the last Clear(), so everything is cleared
+  dirty.Clear(mem.data());
+  BOOST_CHECK(IsZero(mem));
+}
+
+BOOST_AUTO_TEST_CASE(ClearEverythingUnlessRecorded) {
+  constexpr std::uint32_t size = 1 << 16;
+  std::vector<std::uint8_t> mem(size, 0);
+
+  // Disabled instances ignore the record
+  DirtyRegions disabled(size);
+  disabled.StartRecording();
+  disabled.MarkOffset(0);
+  mem.assign(size, 1);
+  disabled.Clear(mem.data());
+  BOOST_CHECK(IsZero(mem));
+
+  DirtyRegions dirty(size);
+  dirty.Enable();
+
+  // An invalidated record is ignored
+  dirty.StartRecording();
+  dirty.MarkOffset(0);
+  dirty.Invalidate();
+  mem.assign(size, 1);
+  dirty.Clear(mem.data());
+  BOOST_CHECK(IsZero(mem));
+
+  // So is a record too large to be worth it
+  dirty.StartRecording();
+  for (std::uint32_t i = 0; i < size; i += DirtyRegions::REGION_SIZE) {
+    dirty.MarkOffset(i);
+  }
+  mem.assign(size, 1);
+  dirty.Clear(mem.data());
+  BOOST_CHECK(IsZero(mem));
+}
+
+BOOST_AUTO_TEST_CASE(MarkOffsetsInAnyOrder) {
+  constexpr std::uint32_t size = 1 << 16;
+  std::vector<std::uint8_t> mem(size, 0);
+
+  DirtyRegions dirty(size);
+  dirty.Enable();
+
+  std::vector<std::uint32_t> offsets = { 5000, 30, 5001, 40000 };
+  for (auto offset : offsets) mem[offset] = 1;
+  mem[20000] = 1;
+
+  dirty.StartRecording();
+  dirty.MarkOffsets(offsets);
+  dirty.Clear(mem.data());
+
+  for (auto offset : offsets) BOOST_CHECK_EQUAL(mem[offset], 0);
+  BOOST_CHECK_EQUAL(mem[20000], 1);
+}
@@ -0,0 +1,81 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE util.environment
+#define BOOST_TEST_DYN_LINK
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include "fuzzuf/utils/environment.hpp"
+
+using fuzzuf::utils::Environment;
+
+namespace {
+std::size_t CountVariables(const Environment &env) {
+  std::size_t count = 0;
+  for (auto v = env.GetEnvp(); *v; ++v) ++count;
+  return count;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(CopyOfProcessEnvironment) {
+  setenv("FUZZUF_TEST_ENVIRONMENT", "foo", 1);
+  Environment env;
+  BOOST_REQUIRE(env.Get("FUZZUF_TEST_ENVIRONMENT") != nullptr);
+  BOOST_CHECK_EQUAL(std::string(env.Get("FUZZUF_TEST_ENVIRONMENT")), "foo");
+
+  // Neither modifies the other
+  setenv("FUZZUF_TEST_ENVIRONMENT", "bar", 1);
+  BOOST_CHECK_EQUAL(std::string(env.Get("FUZZUF_TEST_ENVIRONMENT")), "foo");
+  env.Set("FUZZUF_TEST_ENVIRONMENT", "baz");
+  BOOST_CHECK_EQUAL(std::string(getenv("FUZZUF_TEST_ENVIRONMENT")), "bar");
+  unsetenv("FUZZUF_TEST_ENVIRONMENT");
+}
+
+BOOST_AUTO_TEST_CASE(SetAndUnset) {
+  unsetenv("FUZZUF_TEST_ENVIRONMENT");
+  unsetenv("FUZZUF_TEST_ENVIRONMENT_LONGER");
+  Environment env;
+  const auto count = CountVariables(env);
+
+  // A variable whose name is a prefix of another one is distinct from it
+  env.Set("FUZZUF_TEST_ENVIRONMENT_LONGER", "1");
+  BOOST_CHECK(env.Get("FUZZUF_TEST_ENVIRONMENT") == nullptr);
+
+  env.Set("FUZZUF_TEST_ENVIRONMENT", "");
+  BOOST_REQUIRE(env.Get("FUZZUF_TEST_ENVIRONMENT") != nullptr);
+  BOOST_CHECK_EQUAL(std::string(env.Get("FUZZUF_TEST_ENVIRONMENT")), "");
+  BOOST_CHECK_EQUAL(CountVariables(env), count + 2);
+
+  // Same as setenv(3), a set variable is kept if overwrite is false
+  env.Set("FUZZUF_TEST_ENVIRONMENT", "foo", false);
+  BOOST_CHECK_EQUAL(std::string(env.Get("FUZZUF_TEST_ENVIRONMENT")), "");
+  env.Set("FUZZUF_TEST_ENVIRONMENT", "foo");
+  BOOST_CHECK_EQUAL(CountVariables(env), count + 2);
+
+  bool found = false;
+  for (auto v = env.GetEnvp(); *v; ++v) {
+    if (std::strcmp(*v, "FUZZUF_TEST_ENVIRONMENT=foo") == 0) found = true;
+  }
+  BOOST_CHECK(found);
+
+  env.Unset("FUZZUF_TEST_ENVIRONMENT");
+  BOOST_CHECK(env.Get("FUZZUF_TEST_ENVIRONMENT") == nullptr);
+  BOOST_CHECK(env.Get("FUZZUF_TEST_ENVIRONMENT_LONGER") != nullptr);
+  BOOST_CHECK_EQUAL(CountVariables(env), count + 1);
+}
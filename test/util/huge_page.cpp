@@ -0,0 +1,76 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE util.huge_page
+#define BOOST_TEST_DYN_LINK
+#include <cstdint>
+#include <boost/test/unit_test.hpp>
+#include <unistd.h>
+#include "fuzzuf/utils/huge_page.hpp"
+#include "fuzzuf/utils/numa.hpp"
+
+using fuzzuf::utils::GetHugePageSize;
+using fuzzuf::utils::HugePageVector;
+
+namespace {
+bool IsAlignedTo(const void *addr, std::size_t alignment) {
+  return reinterpret_cast<std::uintptr_t>(addr) % alignment == 0;
+}
+} // namespace
+
+// Small arrays are page aligned, and are not rounded up to the huge page
+BOOST_AUTO_TEST_CASE(SmallArray) {
+  const auto page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  HugePageVector<std::uint8_t> map(1 << 16, 255);
+  BOOST_CHECK(IsAlignedTo(map.data(), page_size));
+  BOOST_CHECK_EQUAL(map[0], 255);
+  BOOST_CHECK_EQUAL(map[(1 << 16) - 1], 255);
+  BOOST_CHECK_EQUAL(fuzzuf::utils::GetHugePageBackedMemorySize(1 << 16),
+                    ((1 << 16) + page_size - 1) / page_size * page_size);
+}
+
+// Arrays as large as the huge page are aligned to it
+BOOST_AUTO_TEST_CASE(LargeArray) {
+  const auto huge_page_size = GetHugePageSize();
+  if (huge_page_size == 0) return;
+
+  HugePageVector<std::uint8_t> map(huge_page_size * 2 + 1, 0);
+  BOOST_CHECK(IsAlignedTo(map.data(), huge_page_size));
+  map.back() = 1;
+  BOOST_CHECK_EQUAL(map.back(), 1);
+  BOOST_CHECK_EQUAL(
+      fuzzuf::utils::GetHugePageBackedMemorySize(huge_page_size * 2 + 1),
+      huge_page_size * 3);
+
+  // Reallocation keeps the contents
+  map.resize(huge_page_size * 4, 2);
+  BOOST_CHECK(IsAlignedTo(map.data(), huge_page_size));
+  BOOST_CHECK_EQUAL(map[huge_page_size * 2], 1);
+  BOOST_CHECK_EQUAL(map.back(), 2);
+}
+
+// Whether the kernel supports NUMA or not, the memory is usable after the request
+BOOST_AUTO_TEST_CASE(PreferNumaNode) {
+  HugePageVector<std::uint8_t> map(1 << 16, 255);
+  const int node = fuzzuf::utils::GetNumaNodeOfCpu(0);
+  BOOST_CHECK_GE(node, -1);
+  if (node >= 0) {
+    fuzzuf::utils::PreferNumaNode(map.data(), map.size(), node);
+  }
+  BOOST_CHECK_EQUAL(map[1000], 255);
+  BOOST_CHECK_EQUAL(fuzzuf::utils::GetNumaNodeOfCpu(-1), -1);
+}
@@ -0,0 +1,68 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+#define BOOST_TEST_MODULE util.workspace
+#define BOOST_TEST_DYN_LINK
+#include <fstream>
+#include <boost/scope_exit.hpp>
+#include <boost/test/unit_test.hpp>
+#include "fuzzuf/utils/filesystem.hpp"
+#include "fuzzuf/utils/workspace.hpp"
+
+// The old queue must become the input of the resumed session, and old crashes must be kept aside
+BOOST_AUTO_TEST_CASE(InPlaceResumeMovesPreviousSession) {
+  std::string root_dir_template("/tmp/fuzzuf_test.XXXXXX");
+  const auto raw_dirname = mkdtemp(root_dir_template.data());
+  BOOST_REQUIRE(raw_dirname != nullptr);
+
+  auto root_dir = fs::path(raw_dirname);
+  BOOST_SCOPE_EXIT(&root_dir) {
+    fs::remove_all(root_dir);
+  }
+  BOOST_SCOPE_EXIT_END
+
+  auto out_dir = root_dir / "out";
+  SetupDirs(out_dir.string());
+  std::ofstream(out_dir / "queue/id:000000,orig:seed") << "seed";
+  std::ofstream(out_dir / "queue/.state/deterministic_done/id:000000,orig:seed");
+  std::ofstream(out_dir / "crashes/id:000000,sig:11,src:000000,op:havoc,rep:2") << "crash";
+  std::ofstream(out_dir / "fuzz_bitmap") << "bitmap";
+
+  auto in_dir = fs::path(SetupDirsForInPlaceResume(out_dir.string()));
+
+  BOOST_CHECK(in_dir == out_dir / "_resume");
+  BOOST_CHECK(fs::exists(in_dir / "id:000000,orig:seed"));
+  BOOST_CHECK(fs::exists(in_dir / ".state/deterministic_done/id:000000,orig:seed"));
+
+  // The directories for the new session are ready and empty
+  BOOST_CHECK(fs::is_directory(out_dir / "queue/.state/deterministic_done"));
+  BOOST_CHECK(fs::is_empty(out_dir / "queue/.state/deterministic_done"));
+  BOOST_CHECK(fs::is_empty(out_dir / "crashes"));
+
+  // Files of the previous session are kept
+  BOOST_CHECK(fs::exists(out_dir / "fuzz_bitmap"));
+
+  int renamed_crashes = 0;
+  for (const auto& entry : fs::directory_iterator(out_dir)) {
+    auto name = entry.path().filename().string();
+    if (name.rfind("crashes.", 0) == 0) {
+      renamed_crashes++;
+      BOOST_CHECK(fs::exists(entry.path() / "id:000000,sig:11,src:000000,op:havoc,rep:2"));
+    }
+  }
+  BOOST_CHECK_EQUAL(renamed_crashes, 1);
+}
@@ -0,0 +1,86 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file bounded_output_buffer.cpp
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#include "fuzzuf/utils/bounded_output_buffer.hpp"
+#include "fuzzuf/utils/errno_to_system_error.hpp"
+#include <array>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fuzzuf::utils {
+
+namespace {
+// The maximum number of bytes discarded by one ReadFrom(). The same as the
+// default capacity of pipes, so that a full pipe is emptied at once.
+constexpr std::size_t discard_chunk_size = 65536u;
+} // namespace
+
+BoundedOutputBuffer::BoundedOutputBuffer(std::size_t capacity_)
+    : capacity(capacity_), data(new std::uint8_t[capacity_]) {
+  null_fd = open("/dev/null", O_WRONLY | O_CLOEXEC);
+  if (null_fd < 0) {
+    throw errno_to_system_error(errno, "unable to open /dev/null");
+  }
+}
+
+BoundedOutputBuffer::~BoundedOutputBuffer() { close(null_fd); }
+
+void BoundedOutputBuffer::Rewind() {
+  size = 0;
+  written_size = 0;
+}
+
+bool BoundedOutputBuffer::ReadFrom(int fd) {
+  ssize_t read_stat;
+  if (size < capacity) {
+    read_stat = read(fd, data.get() + size, capacity - size);
+    if (read_stat > 0) {
+      size += read_stat;
+    }
+  } else {
+    read_stat = splice(fd, nullptr, null_fd, nullptr, discard_chunk_size,
+                       SPLICE_F_NONBLOCK);
+    // Some kernels can't splice to /dev/null. Read the bytes to throw them
+    // away instead.
+    if (read_stat < 0 && errno == EINVAL) {
+      std::array<std::uint8_t, 4096u> chunk;
+      read_stat = read(fd, chunk.data(), chunk.size());
+    }
+  }
+
+  if (read_stat < 0) {
+    const int e = errno;
+    if (e == EAGAIN || e == EWOULDBLOCK) {
+      return false;
+    }
+    if (e != EINTR) {
+      throw errno_to_system_error(
+          e, "read from child process failed during the execution");
+    }
+    return true;
+  }
+
+  written_size += read_stat;
+  return read_stat != 0;
+}
+
+} // namespace fuzzuf::utils
@@ -0,0 +1,74 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file dirty_regions.cpp
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#include "fuzzuf/utils/dirty_regions.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace fuzzuf::utils {
+
+DirtyRegions::DirtyRegions(std::uint32_t mem_size)
+    : mem_size(mem_size),
+      // Clearing more than 1/8 of the map line by line isn't worth it
+      max_regions((mem_size + REGION_SIZE - 1) / REGION_SIZE / 8) {}
+
+void DirtyRegions::Enable() {
+  enabled = true;
+  regions.reserve(max_regions);
+}
+
+void DirtyRegions::Resize(std::uint32_t new_mem_size) {
+  mem_size = new_mem_size;
+  max_regions = (mem_size + REGION_SIZE - 1) / REGION_SIZE / 8;
+  if (enabled) {
+    regions.reserve(max_regions);
+  }
+  regions.clear();
+  valid = false;
+}
+
+void DirtyRegions::StartRecording() {
+  regions.clear();
+  valid = enabled;
+}
+
+void DirtyRegions::MarkOffsets(const std::vector<std::uint32_t> &offsets) {
+  for (auto offset : offsets) {
+    MarkOffset(offset);
+  }
+}
+
+void DirtyRegions::Clear(std::uint8_t *mem) {
+  if (valid) {
+    for (auto region : regions) {
+      const std::uint32_t begin = region * REGION_SIZE;
+      std::memset(mem + begin, 0, std::min(REGION_SIZE, mem_size - begin));
+    }
+  } else {
+    std::memset(mem, 0, mem_size);
+  }
+
+  // The next execution may touch any region
+  regions.clear();
+  valid = false;
+}
+
+} // namespace fuzzuf::utils
@@ -0,0 +1,89 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file environment.cpp
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#include "fuzzuf/utils/environment.hpp"
+#include <algorithm>
+#include <unistd.h>
+
+namespace fuzzuf::utils {
+
+Environment::Environment() {
+  for (char **v = environ; *v; ++v) {
+    variables.emplace_back(*v);
+  }
+  UpdateEnvp();
+}
+
+const char *Environment::Get(const std::string &name) const {
+  const auto v = Find(name);
+  if (v == variables.end()) {
+    return nullptr;
+  }
+  return v->c_str() + name.size() + 1;
+}
+
+void Environment::Set(const std::string &name, const std::string &value,
+                      bool overwrite) {
+  const auto v = Find(name);
+  if (v == variables.end()) {
+    variables.push_back(name + "=" + value);
+  } else if (overwrite) {
+    *v = name + "=" + value;
+  } else {
+    return;
+  }
+  UpdateEnvp();
+}
+
+void Environment::Unset(const std::string &name) {
+  const auto v = Find(name);
+  if (v == variables.end()) {
+    return;
+  }
+  variables.erase(v);
+  UpdateEnvp();
+}
+
+std::vector<std::string>::iterator Environment::Find(const std::string &name) {
+  return std::find_if(variables.begin(), variables.end(),
+                      [&](const std::string &v) {
+                        return v.size() > name.size() &&
+                               v.compare(0, name.size(), name) == 0 &&
+                               v[name.size()] == '=';
+                      });
+}
+
+std::vector<std::string>::const_iterator
+Environment::Find(const std::string &name) const {
+  return const_cast<Environment *>(this)->Find(name);
+}
+
+// The strings may have been moved by the modification, so the pointers are
+// taken again.
+void Environment::UpdateEnvp() {
+  envp.clear();
+  for (auto &v : variables) {
+    envp.push_back(v.data());
+  }
+  envp.push_back(nullptr);
+}
+
+} // namespace fuzzuf::utils
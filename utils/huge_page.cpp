@@ -0,0 +1,87 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file huge_page.cpp
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#include "fuzzuf/utils/huge_page.hpp"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace fuzzuf::utils {
+
+std::size_t GetHugePageSize() {
+  // The value never changes while the system is running
+  static const std::size_t huge_page_size = [] {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    std::size_t value;
+    while (meminfo >> key >> value) {
+      if (key == "Hugepagesize:") return value * 1024; // in kB
+      meminfo.ignore(256, '\n');
+    }
+    return std::size_t(0);
+  }();
+  return huge_page_size;
+}
+
+std::size_t GetHugePageBackedMemorySize(std::size_t len) {
+  const auto huge_page_size = GetHugePageSize();
+  const auto page_size =
+      (huge_page_size && len >= huge_page_size)
+          ? huge_page_size
+          : static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  if (len == 0) return page_size;
+  return (len + page_size - 1) / page_size * page_size;
+}
+
+void *AllocateHugePageBackedMemory(std::size_t len) {
+  const auto size = GetHugePageBackedMemorySize(len);
+  const auto huge_page_size = GetHugePageSize();
+  if (!huge_page_size || size < huge_page_size) {
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return addr == MAP_FAILED ? nullptr : addr;
+  }
+
+  // mmap doesn't align the memory to the huge page. Map a larger region and
+  // unmap the both ends.
+  void *addr = mmap(nullptr, size + huge_page_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) return nullptr;
+
+  const auto head = reinterpret_cast<std::uintptr_t>(addr);
+  const auto aligned =
+      (head + huge_page_size - 1) / huge_page_size * huge_page_size;
+  if (aligned != head) munmap(addr, aligned - head);
+  const auto tail = head + size + huge_page_size - (aligned + size);
+  if (tail) munmap(reinterpret_cast<void *>(aligned + size), tail);
+
+  // Only a hint. The memory is still usable if THP is disabled.
+  madvise(reinterpret_cast<void *>(aligned), size, MADV_HUGEPAGE);
+  return reinterpret_cast<void *>(aligned);
+}
+
+void FreeHugePageBackedMemory(void *addr, std::size_t len) {
+  if (addr) munmap(addr, GetHugePageBackedMemorySize(len));
+}
+
+} // namespace fuzzuf::utils
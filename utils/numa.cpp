@@ -0,0 +1,73 @@
+/*
+ * fuzzuf
+ * Copyright (C) 2021 Ricerca Security
+ * 
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/.
+ */
+/**
+ * @file numa.cpp
+ * @author Ricerca Security <fuzzuf-dev@ricsec.co.jp>
+ */
+#include "fuzzuf/utils/numa.hpp"
+#include <climits>
+#include <dirent.h>
+#include <linux/mempolicy.h>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fuzzuf::utils {
+
+int GetNumaNodeOfCpu(int cpuid) {
+  if (cpuid < 0) return -1;
+
+  // The directory of a CPU core has a link named node<N> to its node
+  const auto path = "/sys/devices/system/cpu/cpu" + std::to_string(cpuid);
+  DIR *dir = opendir(path.c_str());
+  if (!dir) return -1;
+
+  int node = -1;
+  while (const dirent *entry = readdir(dir)) {
+    const std::string name(entry->d_name);
+    if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+        name.find_first_not_of("0123456789", 4) == std::string::npos) {
+      node = std::stoi(name.substr(4));
+      break;
+    }
+  }
+  closedir(dir);
+  return node;
+}
+
+bool PreferNumaNode(void *addr, std::size_t len, int node) {
+#ifdef SYS_mbind
+  if (node < 0) return false;
+
+  constexpr std::size_t bits = sizeof(unsigned long) * CHAR_BIT;
+  std::vector<unsigned long> mask(node / bits + 1, 0);
+  mask[node / bits] |= 1UL << (node % bits);
+  // The kernel reads one bit less than maxnode
+  const unsigned long maxnode = mask.size() * bits + 1;
+  return syscall(SYS_mbind, addr, len, MPOL_PREFERRED, mask.data(), maxnode,
+                 MPOL_MF_MOVE) == 0;
+#else
+  (void)addr;
+  (void)len;
+  (void)node;
+  return false;
+#endif
+}
+
+} // namespace fuzzuf::utils
@@ -15,7 +15,9 @@
  * You should have received a copy of the GNU Affero General Public License
  * along with this program.  If not, see http://www.gnu.org/licenses/.
  */
+#include <ctime>
 #include "fuzzuf/utils/common.hpp"
+#include "fuzzuf/utils/filesystem.hpp"
 #include "fuzzuf/logger/logger.hpp"
 
 // FIXME: this should be moved to Algorithms/AFL/?
@@ -38,3 +40,44 @@ void SetupDirs(std::string out_dir) {
         throw;
     }
 }
+
+// Prepare out_dir of an interrupted session for "-i -", i.e. in-place resume,
+// in the same way as maybe_delete_out_dir() in afl-fuzz.c:
+//   - the old queue is moved to out_dir/_resume, which becomes the new in_dir
+//   - crashes and hangs are preserved by renaming them to crashes.<date> and hangs.<date>
+// fuzz_bitmap, fuzzer_stats and queue/.state are left in place so that they can be loaded later.
+// Returns the path to be used as in_dir.
+std::string SetupDirsForInPlaceResume(std::string out_dir) {
+    std::string orig_q = out_dir + "/queue";
+    std::string in_dir = out_dir + "/_resume";
+
+    if (!fs::is_directory(orig_q)) {
+        ERROR("Resume attempted but old output directory '%s' has no queue", out_dir.c_str());
+    }
+
+    if (fs::exists(in_dir)) {
+        // _resume is left if the previous resume was interrupted before pivoting inputs
+        // In that case, the queue directory is the one the previous resume has just created
+        fs::remove_all(orig_q);
+    } else if (rename(orig_q.c_str(), in_dir.c_str())) {
+        ERROR("Unable to rename '%s' to '%s'", orig_q.c_str(), in_dir.c_str());
+    }
+
+    time_t cur_t = time(0);
+    struct tm* t = localtime(&cur_t);
+
+    for (const char *name : { "crashes", "hangs" }) {
+        std::string fn = out_dir + "/" + name;
+
+        // Empty ones can simply be removed
+        if (!fs::exists(fn) || rmdir(fn.c_str()) == 0) continue;
+
+        std::string nfn = Util::StrPrintf("%s.%04u-%02u-%02u-%02u:%02u:%02u", fn.c_str(),
+                            t->tm_year + 1900, t->tm_mon + 1, t->tm_mday,
+                            t->tm_hour, t->tm_min, t->tm_sec);
+        rename(fn.c_str(), nfn.c_str()); /* Ignore errors. */
+    }
+
+    SetupDirs(out_dir);
+    return in_dir;
+}